@@ -0,0 +1,37 @@
+#!/bin/bash
+# Compares scene build and ray tracing times for the voxel grid and the bounding
+# volume hierarchy acceleration structures on the same scenes and settings
+
+mkdir -p output
+
+benchmark() {
+    local name=$1
+    shift
+    for structure in voxel-grid bvh; do
+        echo "=== $name, $structure"
+        ./build/rpk "$@" -acceleration-structure $structure -timings \
+            > output/benchmark_${name}_${structure}.log 2>&1
+        grep -E "Acceleration structure creation|Radiance total time|Raytracing total time" \
+            output/benchmark_${name}_${structure}.log
+    done
+}
+
+benchmark floorStochasticRaytracing etc/floor_gloss.mgf \
+    -raytracing-method StochasticRaytracing -nqcdivs 16 \
+    -iterations 3 -radiance-method StochJacobi \
+    -eyepoint 9.16 3.0 0.81 -center -2.72 1.63 -0.44 -updir 0 0 1 \
+    -raytracing-image-savefile ./output/benchmark_floor.ppm \
+    -rts-samples-per-pixel 4
+
+benchmark floorBidirectionalPathTracing etc/floor_gloss.mgf \
+    -raytracing-method BidirectionalPathTracing -nqcdivs 16 \
+    -iterations 2 -radiance-method RandomWalk \
+    -eyepoint 8.16 1.99 0.81 -center -1.72 2.63 -0.44 -updir 0 0 1 \
+    -raytracing-image-savefile ./output/benchmark_floorbp.ppm \
+    -bidir-samples-per-pixel 4
+
+benchmark office1Galerkin etc/office1/graz.mgf \
+    -raytracing-method none -iterations 1 -radiance-method Galerkin \
+    -eyepoint 3.7311 -0.011 2.3034 -center 1.0023 8.9229 -1.113 \
+    -dont-force-onesided \
+    -raycast -radiance-image-savefile ./output/benchmark_office1.ppm
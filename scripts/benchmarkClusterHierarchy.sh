@@ -0,0 +1,32 @@
+#!/bin/bash
+# Compares the octree and the surface area heuristic patch cluster hierarchies:
+# the time to build them and the ray tracing time through them
+
+mkdir -p output
+
+THREADS=${THREADS:-$(nproc)}
+
+benchmark() {
+    local name=$1
+    shift
+    for hierarchy in octree sah; do
+        echo "=== $name, $hierarchy"
+        ./build/rpk "$@" -cluster-hierarchy $hierarchy -cluster-threads "$THREADS" -timings \
+            > output/benchmark_clusters_${name}_${hierarchy}.log 2>&1
+        grep -E "cluster hierarchy|Radiance total time|Raytracing total time" \
+            output/benchmark_clusters_${name}_${hierarchy}.log
+    done
+}
+
+benchmark floorStochasticRaytracing etc/floor_gloss.mgf \
+    -raytracing-method StochasticRaytracing -nqcdivs 16 \
+    -iterations 3 -radiance-method StochJacobi \
+    -eyepoint 9.16 3.0 0.81 -center -2.72 1.63 -0.44 -updir 0 0 1 \
+    -raytracing-image-savefile ./output/benchmark_clusters_floor.ppm \
+    -rts-samples-per-pixel 4
+
+benchmark office1Galerkin etc/office1/graz.mgf \
+    -raytracing-method none -iterations 1 -radiance-method Galerkin \
+    -eyepoint 3.7311 -0.011 2.3034 -center 1.0023 8.9229 -1.113 \
+    -dont-force-onesided \
+    -raycast -radiance-image-savefile ./output/benchmark_clusters_office1.ppm
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Measures the MGF parsing throughput: reads each scene several times without
+# computing anything on it and reports the best time of the "read" phase and the
+# corresponding megabytes of MGF text per second
+
+mkdir -p output
+
+RUNS=${RUNS:-5}
+
+benchmark() {
+    local name=$1
+    local sceneFile=$2
+    local bytes
+    bytes=$(stat -c %s "$sceneFile")
+    echo "=== $name, $sceneFile ($bytes bytes, best of $RUNS runs)"
+    for run in $(seq 1 "$RUNS"); do
+        ./build/rpk "$sceneFile" \
+            -raytracing-method none -radiance-method none -iterations 0 \
+            -timings-report output/benchmark_mgf_${name}_${run}.csv \
+            > output/benchmark_mgf_${name}_${run}.log 2>&1
+        awk -F, '$2 == "read" { print $5 }' output/benchmark_mgf_${name}_${run}.csv
+    done | sort -g | head -1 | awk -v bytes="$bytes" \
+        '{ printf("Read time: %.4f s, %.2f MB/s\n", $1, bytes / $1 / 1e6) }'
+}
+
+benchmark office1 etc/office1/graz.mgf
+benchmark salon etc/salon/classroom.mgf
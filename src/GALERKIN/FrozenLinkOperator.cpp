@@ -0,0 +1,127 @@
+#include <thread>
+
+#include "java/lang/Math.h"
+#include "java/util/ArrayList.txx"
+#include "GALERKIN/Interaction.h"
+#include "GALERKIN/FrozenLinkOperator.h"
+
+/**
+Collects the links of all elements in the hierarchy below the top cluster
+*/
+FrozenLinkOperator::FrozenLinkOperator(GalerkinElement *topCluster) {
+    firstLink.add(0);
+    if ( topCluster != nullptr ) {
+        addReceiver(topCluster);
+    }
+}
+
+void
+FrozenLinkOperator::addReceiver(GalerkinElement *element) {
+    for ( int i = 0; element->irregularSubElements != nullptr && i < element->irregularSubElements->size(); i++ ) {
+        addReceiver((GalerkinElement *)element->irregularSubElements->get(i));
+    }
+    if ( element->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            addReceiver((GalerkinElement *)element->regularSubElements[i]);
+        }
+    }
+
+    if ( element->interactions == nullptr || element->interactions->size() == 0 ) {
+        return;
+    }
+
+    // Same coefficients as used by HierarchicalRefinementStrategy::hierarchicRefinementComputeLightTransport()
+    for ( int i = 0; i < element->interactions->size(); i++ ) {
+        const Interaction *interaction = element->interactions->get(i);
+        int a = 1;
+        int b = 1;
+        if ( interaction->numberOfBasisFunctionsOnReceiver != 1 || interaction->numberOfBasisFunctionsOnSource != 1 ) {
+            a = java::Math::min(interaction->numberOfBasisFunctionsOnReceiver, element->basisSize);
+            b = java::Math::min(interaction->numberOfBasisFunctionsOnSource, interaction->sourceElement->basisSize);
+            if ( interaction->sourceElement->isCluster() && interaction->sourceElement != element ) {
+                // An isotropic source cluster radiates its average radiance
+                b = java::Math::min(b, 1);
+            }
+        }
+
+        sources.add(interaction->sourceElement);
+        firstCoefficient.add((int)coefficients.size());
+        receiverBasisSize.add(a);
+        sourceBasisSize.add(b);
+        for ( int alpha = 0; alpha < a; alpha++ ) {
+            for ( int beta = 0; beta < b; beta++ ) {
+                coefficients.add(interaction->K[alpha * interaction->numberOfBasisFunctionsOnSource + beta]);
+            }
+        }
+    }
+    receivers.add(element);
+    firstLink.add((int)sources.size());
+}
+
+int
+FrozenLinkOperator::getNumberOfLinks() const {
+    return (int)sources.size();
+}
+
+/**
+Adds the radiance gathered over the links of receivers first .. last - 1 to
+their received radiance
+*/
+void
+FrozenLinkOperator::transportRows(int first, int last) const {
+    for ( int i = first; i < last; i++ ) {
+        ColorRgb *receivedRadiance = receivers.get(i)->receivedRadiance;
+        for ( int j = firstLink.get(i); j < firstLink.get(i + 1); j++ ) {
+            const ColorRgb *sourceRadiance = sources.get(j)->radiance;
+            int K = firstCoefficient.get(j);
+            int a = receiverBasisSize.get(j);
+            int b = sourceBasisSize.get(j);
+            for ( int alpha = 0; alpha < a; alpha++ ) {
+                for ( int beta = 0; beta < b; beta++ ) {
+                    receivedRadiance[alpha].addScaled(
+                        receivedRadiance[alpha],
+                        coefficients.get(K + alpha * b + beta),
+                        sourceRadiance[beta]);
+                }
+            }
+        }
+    }
+}
+
+void
+FrozenLinkOperator::transportWorker(const FrozenLinkOperator *linkOperator, int first, int last) {
+    linkOperator->transportRows(first, last);
+}
+
+/**
+Gathers radiance over all links, on up to numberOfThreads threads (the calling
+one included), each doing a range of receivers with about the same number of links
+*/
+void
+FrozenLinkOperator::transport(int numberOfThreads) const {
+    int numberOfReceivers = (int)receivers.size();
+    int numberOfLinks = getNumberOfLinks();
+    numberOfThreads = java::Math::max(1, java::Math::min(numberOfThreads, numberOfLinks / MINIMUM_LINKS_PER_THREAD));
+    if ( numberOfThreads == 1 ) {
+        transportRows(0, numberOfReceivers);
+        return;
+    }
+
+    std::thread **workers = new std::thread *[numberOfThreads];
+    int first = 0;
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        long linksBefore = (long)numberOfLinks * i / numberOfThreads;
+        int last = first;
+        while ( last < numberOfReceivers && firstLink.get(last) < linksBefore ) {
+            last++;
+        }
+        workers[i] = new std::thread(transportWorker, this, first, last);
+        first = last;
+    }
+    transportRows(first, numberOfReceivers);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
+}
@@ -0,0 +1,49 @@
+#ifndef __FROZEN_LINK_OPERATOR__
+#define __FROZEN_LINK_OPERATOR__
+
+#include "java/util/ArrayList.h"
+#include "GALERKIN/GalerkinElement.h"
+
+/**
+The light transport over all links of a hierarchy that stopped being refined,
+as a sparse matrix in compressed row form: one row per receiver element, with
+for each link the source element and its coupling coefficients, copied one after
+the other in a single array.
+
+Once Jacobi iterations hardly create or refine links any more, see
+GatheringStrategy::freezeStableLinks(), gathering only needs the product of this
+matrix with the radiance of the source elements, which transport() computes
+without evaluating the links for refinement again. The links
+of a receiver keep the order of its interaction list, so the received radiance
+adds up exactly as during refinement. Rows only write to their own receiver and
+only read source radiance, so they are split over several threads.
+
+Only valid for the linear transport of Jacobi iterations with isotropic clusters
+(or without clustering) and without importance, see
+GatheringStrategy::canFreezeLinks(), and as long as the element hierarchy and the
+links don't change
+*/
+class FrozenLinkOperator {
+  private:
+    static const int MINIMUM_LINKS_PER_THREAD = 4096;
+
+    java::ArrayList<GalerkinElement *> receivers;
+    java::ArrayList<int> firstLink; // Per receiver, and one past the last link
+    java::ArrayList<GalerkinElement *> sources; // Per link
+    java::ArrayList<int> firstCoefficient; // Per link
+    java::ArrayList<int> receiverBasisSize; // Per link, coefficients used on the receiver
+    java::ArrayList<int> sourceBasisSize; // Per link, coefficients used on the source
+    java::ArrayList<float> coefficients; // receiverBasisSize x sourceBasisSize per link, row by row
+
+    void addReceiver(GalerkinElement *element);
+    void transportRows(int first, int last) const;
+    static void transportWorker(const FrozenLinkOperator *linkOperator, int first, int last);
+
+  public:
+    explicit FrozenLinkOperator(GalerkinElement *topCluster);
+
+    int getNumberOfLinks() const;
+    void transport(int numberOfThreads) const;
+};
+
+#endif
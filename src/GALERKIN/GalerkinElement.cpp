@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "java/lang/Character.h"
 #include "java/lang/Math.h"
 #include "java/util/ArrayList.txx"
@@ -12,6 +14,9 @@
 static int globalNumberOfElements = 0;
 static int globalNumberOfClusters = 0;
 
+// Refinement on several threads can subdivide the same source element at once
+static std::mutex globalSubdivisionMutex;
+
 /**
 Orientation and position of regular sub-elements is fully determined by the following transformations.
 A uniform mapping of parameter domain to the elements is supposed (in other words use uniformPoint() to map
@@ -208,7 +213,7 @@ GalerkinElement::GalerkinElement(Geometry *inGeometry, GalerkinState *inGalerkin
 
 GalerkinElement::~GalerkinElement() {
     for ( int i = 0; interactions != nullptr && i < interactions->size(); i++ ) {
-        delete interactions->get(i);
+        Interaction::interactionFree(interactions->get(i));
     }
     delete interactions;
 
@@ -326,7 +331,8 @@ GalerkinElement::reAllocCoefficients() {
 /**
 Regularly subdivides the given element. A pointer to an array of 4 pointers to sub-elements is returned.
 
-Only applicable to surface elements.
+Only applicable to surface elements. Safe to call from several threads: the
+sub-elements are only created once
 */
 void
 GalerkinElement::regularSubDivide() {
@@ -334,6 +340,7 @@ GalerkinElement::regularSubDivide() {
         logFatal(-1, "galerkinElementRegularSubDivide", "Cannot regularly subdivide cluster elements");
     }
 
+    std::lock_guard<std::mutex> lock(globalSubdivisionMutex);
     if ( regularSubElements != nullptr ) {
         return;
     }
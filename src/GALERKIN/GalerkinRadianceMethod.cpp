@@ -16,12 +16,17 @@ Galerkin radiosity, with the following variants:
 #include "render/glutDebugTools.h"
 #include "tonemap/ToneMap.h"
 #include "GALERKIN/basisgalerkin.h"
+#include "GALERKIN/InteractionArena.h"
+#include "GALERKIN/FrozenLinkOperator.h"
 #include "GALERKIN/processing/ScratchVisibilityStrategy.h"
 #include "GALERKIN/processing/ShootingStrategy.h"
 #include "GALERKIN/GalerkinRadianceMethod.h"
 #include "GALERKIN/processing/GatheringSimpleStrategy.h"
 #include "GALERKIN/processing/GatheringClusteredStrategy.h"
 #include "GALERKIN/processing/ClusterCreationStrategy.h"
+#include "GALERKIN/processing/CheckpointStrategy.h"
+#include "GALERKIN/processing/FormFactorStrategy.h"
+#include "GALERKIN/processing/ConvergenceStrategy.h"
 
 #define STRING_LENGTH 2000
 
@@ -298,6 +303,11 @@ GalerkinRadianceMethod::initialize(Scene *scene) {
         patchInit(scene->patchList->get(i));
     }
 
+    ConvergenceStrategy::reset(scene, &galerkinState);
+    ShootingStrategy::clearShooterQueues(&galerkinState);
+    GatheringStrategy::thawLinks(&galerkinState);
+    FormFactorStrategy::invalidateNodeCaches();
+
     galerkinState.topCluster = ClusterCreationStrategy::createClusterHierarchy(
         scene->clusteredRootGeometry, &galerkinState);
 
@@ -336,11 +346,35 @@ GalerkinRadianceMethod::doStep(Scene *scene, RenderOptions *renderOptions) {
             logFatal(2, "doGalerkinOneStep", "Invalid iteration method %d\n", galerkinState.galerkinIterationMethod);
     }
 
+    if ( ConvergenceStrategy::hasConverged(scene, &galerkinState) ) {
+        done = true;
+    }
+
     updateCpuSecs();
 
     return done;
 }
 
+bool
+GalerkinRadianceMethod::writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const {
+    CheckpointStrategy::writeCheckpoint(checkpoint, scene->patchList, &galerkinState);
+    return true;
+}
+
+bool
+GalerkinRadianceMethod::readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions * /*renderOptions*/) {
+    if ( !CheckpointStrategy::readCheckpoint(checkpoint, scene->patchList, &galerkinState) ) {
+        return false;
+    }
+    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+        recomputePatchColor(scene->patchList->get(i));
+    }
+    ConvergenceStrategy::reset(scene, &galerkinState);
+    ShootingStrategy::clearShooterQueues(&galerkinState);
+    GatheringStrategy::thawLinks(&galerkinState);
+    return true;
+}
+
 /**
 Disposes of the cluster hierarchy
 */
@@ -358,6 +392,8 @@ GalerkinRadianceMethod::galerkinDestroyClusterHierarchy(GalerkinElement *cluster
 
 void
 GalerkinRadianceMethod::terminate(java::ArrayList<Patch *> *scenePatches) {
+    GatheringStrategy::thawLinks(&galerkinState);
+    FormFactorStrategy::invalidateNodeCaches();
     if ( galerkinState.clusteringStrategy == GalerkinClusteringStrategy::Z_VISIBILITY ) {
         ScratchVisibilityStrategy::scratchTerminate(&galerkinState);
     }
@@ -366,6 +402,9 @@ GalerkinRadianceMethod::terminate(java::ArrayList<Patch *> *scenePatches) {
         delete galerkinState.topCluster;
         galerkinState.topCluster = nullptr;
     }
+    InteractionArena::freeMemory();
+    ConvergenceStrategy::terminate(&galerkinState);
+    ShootingStrategy::clearShooterQueues(&galerkinState);
 }
 
 ColorRgb
@@ -419,6 +458,31 @@ GalerkinRadianceMethod::destroyPatchData(Patch *patch) {
     }
 }
 
+/**
+Bytes used by the interaction and sub-element lists of the element and its descendants
+*/
+static size_t
+galerkinListMemory(const GalerkinElement *element) {
+    size_t bytes = 0;
+    if ( element->interactions != nullptr ) {
+        bytes += element->interactions->getMemoryUsage();
+    }
+    if ( element->irregularSubElements != nullptr ) {
+        bytes += element->irregularSubElements->getMemoryUsage();
+        for ( int i = 0; i < element->irregularSubElements->size(); i++ ) {
+            bytes += galerkinListMemory((const GalerkinElement *)element->irregularSubElements->get(i));
+        }
+    }
+    if ( element->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            if ( element->regularSubElements[i] != nullptr ) {
+                bytes += galerkinListMemory((const GalerkinElement *)element->regularSubElements[i]);
+            }
+        }
+    }
+    return bytes;
+}
+
 char *
 GalerkinRadianceMethod::getStats() {
     static char stats[STRING_LENGTH]{};
@@ -450,9 +514,30 @@ GalerkinRadianceMethod::getStats() {
     p += n;
     snprintf(p, STRING_LENGTH, "surface to surface: %d\n%n", Interaction::getNumberOfSurfaceToSurfaceInteractions(), &n);
     p += n;
-    snprintf(p, STRING_LENGTH, "shadow hits: %d\n%n", GLOBAL_statistics.numberOfShadowRays, &n);
+    snprintf(p, STRING_LENGTH, "frozen links: %d\n%n",
+             galerkinState.frozenLinks != nullptr ? galerkinState.frozenLinks->getNumberOfLinks() : 0,
+             &n);
+    p += n;
+    snprintf(p, STRING_LENGTH, "link memory: %.1f KB (peak %.1f KB, reserved %.1f KB)\n%n",
+             (double)InteractionArena::getBytesInUse() / 1024.0,
+             (double)InteractionArena::getPeakBytesInUse() / 1024.0,
+             (double)InteractionArena::getBytesReserved() / 1024.0,
+             &n);
+    p += n;
+    snprintf(p, STRING_LENGTH, "element list memory: %.1f KB\n%n",
+             galerkinState.topCluster != nullptr ? (double)galerkinListMemory(galerkinState.topCluster) / 1024.0 : 0.0,
+             &n);
+    p += n;
+    ConvergenceStrategy::updateResiduals(&galerkinState);
+    snprintf(p, STRING_LENGTH, "flux change: %g, max. radiance change: %g, un-shot power: %g\n%n",
+             galerkinState.fluxChange,
+             galerkinState.maximumRadianceChange,
+             galerkinState.unShotPower,
+             &n);
+    p += n;
+    snprintf(p, STRING_LENGTH, "shadow hits: %d\n%n", GLOBAL_statistics.numberOfShadowRays.load(), &n);
     p += n;
-    snprintf(p, STRING_LENGTH, "shadow hits cached: %d\n%n", GLOBAL_statistics.numberOfShadowCacheHits, &n);
+    snprintf(p, STRING_LENGTH, "shadow hits cached: %d\n%n", GLOBAL_statistics.numberOfShadowCacheHits.load(), &n);
     p += n;
     snprintf(p, STRING_LENGTH, "CPU time: %g secs.\n%n", galerkinState.cpuSeconds, &n);
     p += n;
@@ -7,7 +7,7 @@
 #include "GALERKIN/GalerkinState.h"
 #include "GALERKIN/processing/GatheringStrategy.h"
 #include "scene/Background.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "scene/Scene.h"
 
 class GalerkinRadianceMethod final : public RadianceMethod {
@@ -59,6 +59,8 @@ class GalerkinRadianceMethod final : public RadianceMethod {
     char *getStats() final;
     void renderScene(const Scene *scene, const RenderOptions *renderOptions) const final;
     void writeVRML(const Camera *camera, FILE *fp, const RenderOptions *renderOptions) const final;
+    bool writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const final;
+    bool readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions *renderOptions) final;
     void setStrategy();
 };
 
@@ -41,6 +41,21 @@ static const int DEFAULT_GAL_SCRATCH_FRAME_BUFFER_SIDE_SIZE_IN_PIXELS = 200;
 // Default strategy is "overlap open", which was the most efficient strategy tested
 static const ShaftCullStrategy DEFAULT_GAL_SHAFT_CULL_STRATEGY = ShaftCullStrategy::OVERLAP_OPEN;
 
+// -gr-threads option
+static const int DEFAULT_GAL_NUMBER_OF_THREADS = 1;
+
+// -gr-shooting-batch option
+static const int DEFAULT_GAL_SHOOTING_BATCH_SIZE = 1;
+
+// -gr-freeze-links and -gr-no-freeze-links options
+static const bool DEFAULT_GAL_FREEZE_LINKS = false;
+
+// -gr-freeze-link-fraction option
+static const float DEFAULT_GAL_FREEZE_LINK_FRACTION = 0.05f;
+
+// -gr-convergence-tolerance option
+static const float DEFAULT_GAL_CONVERGENCE_TOLERANCE = 0.0f;
+
 // Other Constant initial values
 static const int DEFAULT_GAL_ITERATION_NOT_INITIALIZED = -1;
 
@@ -55,7 +70,23 @@ GalerkinState::GalerkinState():
     lastClusterId(),
     lastEye(),
     lastClock(),
-    cpuSeconds()
+    cpuSeconds(),
+    totalFlux(),
+    fluxChange(),
+    maximumRadianceChange(),
+    unShotPower(),
+    previousPatchRadiance(),
+    numberOfPreviousPatchRadiances(),
+    convergencePatches(),
+    residualsUpToDate(),
+    powerShooterQueue(),
+    importanceShooterQueue(),
+    potentialShooterQueue(),
+    shooterIndexByPatchId(),
+    numberOfShooterPatchIds(),
+    shooterUnShotPower(),
+    totalUnShotPower(),
+    frozenLinks()
 {
     hierarchical = DEFAULT_GAL_HIERARCHICAL;
     galerkinIterationMethod = DEFAULT_GAL_ITERATION_METHOD;
@@ -79,6 +110,11 @@ GalerkinState::GalerkinState():
     scratch = nullptr;
     iterationNumber = DEFAULT_GAL_ITERATION_NOT_INITIALIZED;
     shaftCullStrategy = DEFAULT_GAL_SHAFT_CULL_STRATEGY;
+    numberOfThreads = DEFAULT_GAL_NUMBER_OF_THREADS;
+    convergenceTolerance = DEFAULT_GAL_CONVERGENCE_TOLERANCE;
+    shootingBatchSize = DEFAULT_GAL_SHOOTING_BATCH_SIZE;
+    freezeLinks = DEFAULT_GAL_FREEZE_LINKS;
+    freezeLinkFraction = DEFAULT_GAL_FREEZE_LINK_FRACTION;
 
     TriangleCubatureRule::setTriangleCubatureRules(&receiverTriangleCubatureRule, receiverDegree);
     TriangleCubatureRule::setTriangleCubatureRules(&sourceTriangleCubatureRule, sourceDegree);
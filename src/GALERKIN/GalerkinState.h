@@ -5,6 +5,7 @@
 #include "common/ColorRgb.h"
 #include "common/numericalAnalysis/CubatureRule.h"
 #include "SGL/sgl.h"
+#include "common/dataStructures/IndexedMaxHeap.h"
 #include "GALERKIN/GalerkinElement.h"
 #include "GALERKIN/ShaftCullStrategy.h"
 #include "GALERKIN/GalerkinClusteringStrategy.h"
@@ -13,6 +14,8 @@
 #include "GALERKIN/GalerkinIterationMethod.h"
 #include "GALERKIN/GalerkinShaftCullMode.h"
 
+class FrozenLinkOperator;
+
 class GalerkinState {
   public:
     int iterationNumber;
@@ -65,6 +68,34 @@ class GalerkinState {
 
     ShaftCullStrategy shaftCullStrategy;
 
+    // Convergence, see ConvergenceStrategy
+    float convergenceTolerance; // Stop when the residuals are below this, 0 to do all iterations
+    double totalFlux; // Power leaving all patches after the last step
+    float fluxChange; // Change in total flux in the last step, relative to the total flux
+    float maximumRadianceChange; // Largest change in patch radiance, relative to the max. self-emitted radiance
+    float unShotPower; // Power still to propagate, relative to the total self-emitted power
+    float *previousPatchRadiance; // Luminance of the patch radiance when the changes were last measured
+    int numberOfPreviousPatchRadiances;
+    const java::ArrayList<Patch *> *convergencePatches; // Patches compared, kept for measuring on demand
+    bool residualsUpToDate; // False when steps were done since the flux and radiance changes were measured
+
+    // Shooting patches for Southwell iterations, by scene patch index, see ShootingStrategy
+    int shootingBatchSize; // Number of patches shooting their un-shot power in one step
+    IndexedMaxHeap *powerShooterQueue; // On un-shot power
+    IndexedMaxHeap *importanceShooterQueue; // On un-shot power times indirect potential
+    IndexedMaxHeap *potentialShooterQueue; // On un-shot potential times area
+    int *shooterIndexByPatchId; // Scene patch index of each patch id, -1 for ids not in the scene
+    int numberOfShooterPatchIds;
+    float *shooterUnShotPower; // Un-shot power of each patch as counted in totalUnShotPower
+    double totalUnShotPower; // Sum of the un-shot power of all patches, kept up to date by shooting
+
+    // Frozen links, see GatheringStrategy::canFreezeLinks()
+    bool freezeLinks; // Gather over a FrozenLinkOperator once refinement hardly changes the links
+    float freezeLinkFraction; // Freeze when an iteration creates at most this fraction of the links
+    FrozenLinkOperator *frozenLinks;
+
+    int numberOfThreads; // Threads refining the interactions of different receivers, see HierarchicalRefinementStrategy
+
     GalerkinState();
 };
 
@@ -1,17 +1,22 @@
+#include <new>
+
 #include "common/error.h"
+#include "GALERKIN/InteractionArena.h"
 #include "GALERKIN/Interaction.h"
 
-int Interaction::totalInteractions = 0;
-int Interaction::ccInteractions = 0;
-int Interaction::csInteractions = 0;
-int Interaction::scInteractions = 0;
-int Interaction::ssInteractions = 0;
+std::atomic<int> Interaction::totalInteractions(0);
+std::atomic<int> Interaction::ccInteractions(0);
+std::atomic<int> Interaction::csInteractions(0);
+std::atomic<int> Interaction::scInteractions(0);
+std::atomic<int> Interaction::ssInteractions(0);
+std::atomic<long> Interaction::createdInteractions(0);
 
 Interaction::Interaction():
     receiverElement(),
     sourceElement(),
     K(),
     deltaK(),
+    constantK(),
     numberOfBasisFunctionsOnReceiver(),
     numberOfBasisFunctionsOnSource(),
     numberOfReceiverCubaturePositions(),
@@ -19,6 +24,9 @@ Interaction::Interaction():
 {
 }
 
+/**
+Only for links in an arena slot of slotSize() bytes, see interactionCreate()
+*/
 Interaction::Interaction(
     GalerkinElement *inReceiverElement,
     GalerkinElement *inSourceElement,
@@ -28,7 +36,7 @@ Interaction::Interaction(
     unsigned char inNumberOfBasisFunctionsOnSource,
     unsigned char inNumberOfReceiverCubaturePositions,
     unsigned char inVisibility
-): K(), deltaK() {
+): K(), deltaK(), constantK() {
     this->receiverElement = inReceiverElement;
     this->sourceElement = inSourceElement;
     this->numberOfBasisFunctionsOnReceiver = inNumberOfBasisFunctionsOnReceiver;
@@ -37,10 +45,11 @@ Interaction::Interaction(
     this->visibility = inVisibility;
 
     if ( inNumberOfBasisFunctionsOnReceiver == 1 && inNumberOfBasisFunctionsOnSource == 1 ) {
-        this->K = new float[1];
+        this->K = constantK;
         *K = *inK;
     } else {
-        this->K = new float[inNumberOfBasisFunctionsOnReceiver * inNumberOfBasisFunctionsOnSource];
+        // The coefficients follow the link in its slot
+        this->K = (float *)(this + 1);
         for ( int i = 0; i < inNumberOfBasisFunctionsOnReceiver * inNumberOfBasisFunctionsOnSource; i++ ) {
             K[i] = inK[i];
         }
@@ -49,10 +58,10 @@ Interaction::Interaction(
     if ( inNumberOfReceiverCubaturePositions > 1 ) {
         logFatal(2, "interactionCreate", "Not yet implemented for higher order approximations");
     }
-    deltaK = new float[1];
     *deltaK = *inDeltaK;
 
     totalInteractions++;
+    createdInteractions++;
     if ( inReceiverElement->isCluster() ) {
         if ( inSourceElement->isCluster() ) {
             ccInteractions++;
@@ -68,15 +77,16 @@ Interaction::Interaction(
     }
 }
 
-Interaction::~Interaction() {
-    if ( K != nullptr ) {
-        delete[] K;
-        K = nullptr;
-    }
-    if ( deltaK != nullptr ) {
-        delete[] deltaK;
-        deltaK = nullptr;
+/**
+Bytes taken by a link and its coupling coefficients
+*/
+size_t
+Interaction::slotSize(unsigned char inNumberOfBasisFunctionsOnReceiver, unsigned char inNumberOfBasisFunctionsOnSource) {
+    int numberOfCoefficients = inNumberOfBasisFunctionsOnReceiver * inNumberOfBasisFunctionsOnSource;
+    if ( numberOfCoefficients == 1 ) {
+        return sizeof(Interaction);
     }
+    return sizeof(Interaction) + numberOfCoefficients * sizeof(float);
 }
 
 int
@@ -104,9 +114,38 @@ Interaction::getNumberOfSurfaceToSurfaceInteractions() {
     return ssInteractions;
 }
 
+long
+Interaction::getNumberOfCreatedInteractions() {
+    return createdInteractions;
+}
+
+Interaction *
+Interaction::interactionCreate(
+    GalerkinElement *inReceiverElement,
+    GalerkinElement *inSourceElement,
+    const float *inK,
+    const float *inDeltaK,
+    unsigned char inNumberOfBasisFunctionsOnReceiver,
+    unsigned char inNumberOfBasisFunctionsOnSource,
+    unsigned char inNumberOfReceiverCubaturePositions,
+    unsigned char inVisibility)
+{
+    void *slot = InteractionArena::allocate(
+        slotSize(inNumberOfBasisFunctionsOnReceiver, inNumberOfBasisFunctionsOnSource));
+    return new(slot) Interaction(
+        inReceiverElement,
+        inSourceElement,
+        inK,
+        inDeltaK,
+        inNumberOfBasisFunctionsOnReceiver,
+        inNumberOfBasisFunctionsOnSource,
+        inNumberOfReceiverCubaturePositions,
+        inVisibility);
+}
+
 Interaction *
 Interaction::interactionDuplicate(Interaction *interaction) {
-    Interaction *newInteraction = new Interaction(
+    return interactionCreate(
         interaction->receiverElement,
         interaction->sourceElement,
         interaction->K,
@@ -114,9 +153,7 @@ Interaction::interactionDuplicate(Interaction *interaction) {
         interaction->numberOfBasisFunctionsOnReceiver,
         interaction->numberOfBasisFunctionsOnSource,
         interaction->numberOfReceiverCubaturePositions,
-        interaction->visibility
-    );
-    return newInteraction;
+        interaction->visibility);
 }
 
 void
@@ -136,10 +173,16 @@ Interaction::interactionDestroy(Interaction *interaction) {
         }
     }
 
-    if ( interaction->numberOfBasisFunctionsOnReceiver > 1 || interaction->numberOfBasisFunctionsOnSource > 1 ) {
-        delete[] interaction->K;
-        interaction->K = nullptr;
-    }
+    interactionFree(interaction);
+}
 
-    delete interaction;
+/**
+Gives back the memory of the link without updating the interaction counts, for
+when the elements may be gone already
+*/
+void
+Interaction::interactionFree(Interaction *interaction) {
+    InteractionArena::release(
+        interaction,
+        slotSize(interaction->numberOfBasisFunctionsOnReceiver, interaction->numberOfBasisFunctionsOnSource));
 }
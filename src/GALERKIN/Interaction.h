@@ -1,28 +1,65 @@
 #ifndef __INTERACTION__
 #define __INTERACTION__
 
+#include <atomic>
+#include <cstddef>
+
 class GalerkinElement;
 
+/**
+Link between a receiver and a source element. Links stored with the elements
+are created with interactionCreate() or interactionDuplicate() in memory from the
+InteractionArena, with the coupling coefficients right after the link, or inside
+it for constant basis functions on both elements, and must be destroyed with
+interactionDestroy(). Links declared on the stack during refinement point K to a
+buffer of their own
+*/
 class Interaction {
   private:
-    static int totalInteractions;
-    static int ccInteractions;
-    static int csInteractions;
-    static int scInteractions;
-    static int ssInteractions;
+    // Interactions are created and destroyed while refining on several threads
+    static std::atomic<int> totalInteractions;
+    static std::atomic<int> ccInteractions;
+    static std::atomic<int> csInteractions;
+    static std::atomic<int> scInteractions;
+    static std::atomic<int> ssInteractions;
+    static std::atomic<long> createdInteractions; // Never decreases, tells whether links changed
+
+    static size_t
+    slotSize(unsigned char inNumberOfBasisFunctionsOnReceiver, unsigned char inNumberOfBasisFunctionsOnSource);
+
+    explicit Interaction(
+        GalerkinElement *inReceiverElement,
+        GalerkinElement *inSourceElement,
+        const float *inK,
+        const float *inDeltaK,
+        unsigned char inNumberOfBasisFunctionsOnReceiver,
+        unsigned char inNumberOfBasisFunctionsOnSource,
+        unsigned char inNumberOfReceiverCubaturePositions,
+        unsigned char inVisibility
+    );
 
   public:
     GalerkinElement *receiverElement;
     GalerkinElement *sourceElement;
     float *K; // Coupling coefficient(s), stored top to bottom, left to right
-    float *deltaK; // Used for approximation error estimation over the link
+    float deltaK[1]; // Used for approximation error estimation over the link, one receiver cubature position
+    float constantK[1]; // Storage of K for constant basis functions on both elements
     unsigned char numberOfBasisFunctionsOnReceiver;
     unsigned char numberOfBasisFunctionsOnSource;
     unsigned char numberOfReceiverCubaturePositions;
     unsigned char visibility; // 255 for full visibility, 0 for full occlusion
 
     Interaction();
-    explicit Interaction(
+
+    static int getNumberOfInteractions();
+    static int getNumberOfClusterToClusterInteractions();
+    static int getNumberOfClusterToSurfaceInteractions();
+    static int getNumberOfSurfaceToClusterInteractions();
+    static int getNumberOfSurfaceToSurfaceInteractions();
+    static long getNumberOfCreatedInteractions();
+
+    static Interaction *
+    interactionCreate(
         GalerkinElement *inReceiverElement,
         GalerkinElement *inSourceElement,
         const float *inK,
@@ -30,16 +67,10 @@ class Interaction {
         unsigned char inNumberOfBasisFunctionsOnReceiver,
         unsigned char inNumberOfBasisFunctionsOnSource,
         unsigned char inNumberOfReceiverCubaturePositions,
-        unsigned char inVisibility
-    );
-    virtual ~Interaction();
+        unsigned char inVisibility);
 
-    static int getNumberOfInteractions();
-    static int getNumberOfClusterToClusterInteractions();
-    static int getNumberOfClusterToSurfaceInteractions();
-    static int getNumberOfSurfaceToClusterInteractions();
-    static int getNumberOfSurfaceToSurfaceInteractions();
     static void interactionDestroy(Interaction *interaction);
+    static void interactionFree(Interaction *interaction);
     static Interaction *interactionDuplicate(Interaction *interaction);
 };
 
@@ -0,0 +1,125 @@
+#include <cstdlib>
+
+#include "java/util/ArrayList.txx"
+#include "GALERKIN/InteractionArena.h"
+
+std::mutex InteractionArena::mutex;
+java::ArrayList<char *> *InteractionArena::blocks = nullptr;
+char *InteractionArena::blockCursor = nullptr;
+size_t InteractionArena::blockBytesLeft = 0;
+void *InteractionArena::freeSlots[NUMBER_OF_SIZE_CLASSES] = {};
+size_t InteractionArena::bytesInUse = 0;
+size_t InteractionArena::peakBytesInUse = 0;
+size_t InteractionArena::bytesReserved = 0;
+
+/**
+Size of the slot holding an object of the given size, slots are kept aligned
+and can hold the free list pointer
+*/
+size_t
+InteractionArena::slotSize(size_t size) {
+    if ( size < sizeof(void *) ) {
+        size = sizeof(void *);
+    }
+    return (size + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+}
+
+void *
+InteractionArena::allocate(size_t size) {
+    size_t slot = slotSize(size);
+    int sizeClass = (int)(slot / SLOT_ALIGNMENT) - 1;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bytesInUse += slot;
+    if ( bytesInUse > peakBytesInUse ) {
+        peakBytesInUse = bytesInUse;
+    }
+
+    if ( sizeClass >= NUMBER_OF_SIZE_CLASSES ) {
+        return malloc(slot);
+    }
+
+    void *result = freeSlots[sizeClass];
+    if ( result != nullptr ) {
+        freeSlots[sizeClass] = *(void **)result;
+        return result;
+    }
+
+    if ( blockBytesLeft < slot ) {
+        if ( blocks == nullptr ) {
+            blocks = new java::ArrayList<char *>();
+        }
+        // What is left of the current block is lost, it is less than the largest slot
+        blockCursor = (char *)malloc(BLOCK_SIZE);
+        blockBytesLeft = BLOCK_SIZE;
+        bytesReserved += BLOCK_SIZE;
+        blocks->add(blockCursor);
+    }
+    result = blockCursor;
+    blockCursor += slot;
+    blockBytesLeft -= slot;
+    return result;
+}
+
+/**
+Gives back a slot obtained from allocate() with the same size
+*/
+void
+InteractionArena::release(void *slot, size_t size) {
+    size_t slotBytes = slotSize(size);
+    int sizeClass = (int)(slotBytes / SLOT_ALIGNMENT) - 1;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bytesInUse -= slotBytes;
+    if ( sizeClass >= NUMBER_OF_SIZE_CLASSES ) {
+        free(slot);
+        return;
+    }
+    *(void **)slot = freeSlots[sizeClass];
+    freeSlots[sizeClass] = slot;
+}
+
+/**
+Frees all blocks. Does nothing while some slot is still in use, as it would be
+left dangling
+*/
+void
+InteractionArena::freeMemory() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if ( bytesInUse > 0 || blocks == nullptr ) {
+        return;
+    }
+    for ( int i = 0; i < blocks->size(); i++ ) {
+        free(blocks->get(i));
+    }
+    delete blocks;
+    blocks = nullptr;
+    blockCursor = nullptr;
+    blockBytesLeft = 0;
+    bytesReserved = 0;
+    for ( int i = 0; i < NUMBER_OF_SIZE_CLASSES; i++ ) {
+        freeSlots[i] = nullptr;
+    }
+}
+
+size_t
+InteractionArena::getBytesInUse() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesInUse;
+}
+
+/**
+Largest number of bytes in use at the same time since the program started
+*/
+size_t
+InteractionArena::getPeakBytesInUse() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peakBytesInUse;
+}
+
+size_t
+InteractionArena::getBytesReserved() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesReserved;
+}
@@ -0,0 +1,46 @@
+#ifndef __INTERACTION_ARENA__
+#define __INTERACTION_ARENA__
+
+#include <cstddef>
+#include <mutex>
+
+#include "java/util/ArrayList.h"
+
+/**
+Memory for the Interaction links. Hierarchical refinement creates and destroys a
+large number of small links on every iteration: instead of going to the heap for
+each of them (and for their coupling coefficients), slots are cut from large blocks
+and the slots of destroyed links are kept on a free list per slot size, to be used
+again by the next links of the same size. Blocks are only given back by freeMemory().
+
+Links are created and destroyed from several refinement threads, see
+HierarchicalRefinementStrategy, so all methods are synchronized
+*/
+class InteractionArena {
+  private:
+    static const size_t SLOT_ALIGNMENT = 8;
+    static const int NUMBER_OF_SIZE_CLASSES = 64; // Larger slots go to the heap
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    static std::mutex mutex;
+    static java::ArrayList<char *> *blocks;
+    static char *blockCursor;
+    static size_t blockBytesLeft;
+    static void *freeSlots[NUMBER_OF_SIZE_CLASSES];
+    static size_t bytesInUse;
+    static size_t peakBytesInUse;
+    static size_t bytesReserved;
+
+    static size_t slotSize(size_t size);
+
+  public:
+    static void *allocate(size_t size);
+    static void release(void *slot, size_t size);
+    static void freeMemory();
+
+    static size_t getBytesInUse();
+    static size_t getPeakBytesInUse();
+    static size_t getBytesReserved();
+};
+
+#endif
@@ -292,6 +292,33 @@ basisGalerkinPushPullRadiance(GalerkinElement *top, GalerkinState *galerkinState
     basisGalerkinPushPullRadianceRecursive(top, bDown, Bup, galerkinState);
 }
 
+/**
+Push-pull for shooting of the radiance received in the hierarchy below the element
+only: what is pulled up to the element is also added to the radiance and un-shot
+radiance of its ancestors. Since shooting push-pull only adds what was received,
+this gives the same result as a push-pull from the top of the hierarchy when no
+element outside the hierarchy below the element received radiance
+*/
+void
+basisGalerkinShootingPushPullRadiance(GalerkinElement *element, GalerkinState *galerkinState) {
+    ColorRgb bDown[MAX_BASIS_SIZE];
+    ColorRgb bUp[MAX_BASIS_SIZE];
+    colorsArrayClear(bDown, element->basisSize);
+    basisGalerkinPushPullRadianceRecursive(element, bDown, bUp, galerkinState);
+
+    const GalerkinElement *child = element;
+    for ( GalerkinElement *parent = (GalerkinElement *)element->parent;
+          parent != nullptr;
+          parent = (GalerkinElement *)parent->parent ) {
+        ColorRgb parentUp[MAX_BASIS_SIZE];
+        basisGalerkinPull(parent, parentUp, child, bUp);
+        colorsArrayAdd(parent->radiance, parentUp, parent->basisSize);
+        colorsArrayAdd(parent->unShotRadiance, parentUp, parent->basisSize);
+        colorsArrayCopy(bUp, parentUp, parent->basisSize);
+        child = parent;
+    }
+}
+
 /**
 Generic interpolator. Note that this traverses the needed terms to contribute for the interpolated
 approximation of the solution over CONSTANT (1 term), LINEAR (3 terms), QUADRATIC (6 terms) or
@@ -48,6 +48,7 @@ basisGalerkinPush(
     ColorRgb *childCoefficients);
 
 extern void basisGalerkinPushPullRadiance(GalerkinElement *top, GalerkinState *basisGalerkinPushPullRadiance);
+extern void basisGalerkinShootingPushPullRadiance(GalerkinElement *element, GalerkinState *galerkinState);
 
 extern void
 basisGalerkinComputeRegularFilterCoefficients(
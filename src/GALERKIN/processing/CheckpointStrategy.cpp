@@ -0,0 +1,295 @@
+#include <cstdlib>
+
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "GALERKIN/basisgalerkin.h"
+#include "GALERKIN/processing/CheckpointStrategy.h"
+
+/**
+Number of an element in the checkpoint, looked up by the address of the element
+when writing the interactions
+*/
+class CheckpointElementEntry {
+  public:
+    const GalerkinElement *element;
+    int index;
+};
+
+static int
+checkpointCompareEntries(const void *a, const void *b) {
+    const GalerkinElement *elementA = ((const CheckpointElementEntry *)a)->element;
+    const GalerkinElement *elementB = ((const CheckpointElementEntry *)b)->element;
+    if ( elementA < elementB ) {
+        return -1;
+    }
+    return elementA > elementB ? 1 : 0;
+}
+
+static int
+checkpointFindEntry(const CheckpointElementEntry *entries, int numberOfEntries, const GalerkinElement *element) {
+    CheckpointElementEntry key{};
+    key.element = element;
+    const CheckpointElementEntry *found = (const CheckpointElementEntry *)bsearch(
+        &key, entries, numberOfEntries, sizeof(CheckpointElementEntry), checkpointCompareEntries);
+    return found != nullptr ? found->index : -1;
+}
+
+/**
+Cluster elements below and including the given one, depth first. The irregular
+sub-elements of a cluster can also be toplevel surface elements, these are left out
+*/
+void
+CheckpointStrategy::collectClusters(GalerkinElement *cluster, java::ArrayList<GalerkinElement *> *elements) {
+    if ( cluster == nullptr || !cluster->isCluster() ) {
+        return;
+    }
+    elements->add(cluster);
+    for ( int i = 0; cluster->irregularSubElements != nullptr && i < cluster->irregularSubElements->size(); i++ ) {
+        collectClusters((GalerkinElement *)cluster->irregularSubElements->get(i), elements);
+    }
+}
+
+/**
+The surface element and its regular sub-elements, depth first
+*/
+void
+CheckpointStrategy::collectSurfaceElements(GalerkinElement *element, java::ArrayList<GalerkinElement *> *elements) {
+    elements->add(element);
+    if ( element->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            collectSurfaceElements((GalerkinElement *)element->regularSubElements[i], elements);
+        }
+    }
+}
+
+void
+CheckpointStrategy::writeElement(RadianceCheckpoint *checkpoint, const GalerkinElement *element) {
+    checkpoint->writeInt(element->flags & ElementFlags::INTERACTIONS_CREATED_MASK);
+    checkpoint->writeInt(element->basisSize);
+    checkpoint->writeInt(element->basisUsed);
+    checkpoint->writeColors(element->radiance, element->basisSize);
+    checkpoint->writeColors(element->receivedRadiance, element->basisSize);
+    checkpoint->writeInt(element->unShotRadiance != nullptr);
+    if ( element->unShotRadiance != nullptr ) {
+        checkpoint->writeColors(element->unShotRadiance, element->basisSize);
+    }
+    checkpoint->writeFloat(element->potential);
+    checkpoint->writeFloat(element->receivedPotential);
+    checkpoint->writeFloat(element->unShotPotential);
+    checkpoint->writeFloat(element->directPotential);
+}
+
+void
+CheckpointStrategy::readElement(RadianceCheckpoint *checkpoint, GalerkinElement *element) {
+    element->flags |= checkpoint->readInt() & ElementFlags::INTERACTIONS_CREATED_MASK;
+    int basisSize = checkpoint->readInt();
+    int basisUsed = checkpoint->readInt();
+    if ( basisSize != element->basisSize || basisUsed < 0 || basisUsed > basisSize ) {
+        logFatal(-1, "CheckpointStrategy::readElement", "Element %d does not match the checkpoint", element->id);
+    }
+    element->basisUsed = (char)basisUsed;
+    checkpoint->readColors(element->radiance, element->basisSize);
+    checkpoint->readColors(element->receivedRadiance, element->basisSize);
+    bool hasUnShotRadiance = checkpoint->readInt() != 0;
+    if ( hasUnShotRadiance != (element->unShotRadiance != nullptr) ) {
+        logFatal(-1, "CheckpointStrategy::readElement", "Element %d does not match the checkpoint", element->id);
+    }
+    if ( hasUnShotRadiance ) {
+        checkpoint->readColors(element->unShotRadiance, element->basisSize);
+    }
+    element->potential = checkpoint->readFloat();
+    element->receivedPotential = checkpoint->readFloat();
+    element->unShotPotential = checkpoint->readFloat();
+    element->directPotential = checkpoint->readFloat();
+}
+
+/**
+Reads a surface element and subdivides it as it was when the checkpoint was
+written, before reading its sub-elements
+*/
+void
+CheckpointStrategy::readSurfaceElement(
+    RadianceCheckpoint *checkpoint,
+    GalerkinElement *element,
+    java::ArrayList<GalerkinElement *> *elements)
+{
+    elements->add(element);
+    readElement(checkpoint, element);
+    if ( checkpoint->readInt() != 0 && !checkpoint->hasReadError() ) {
+        element->regularSubDivide();
+        for ( int i = 0; i < 4; i++ ) {
+            readSurfaceElement(checkpoint, (GalerkinElement *)element->regularSubElements[i], elements);
+        }
+    }
+}
+
+void
+CheckpointStrategy::writeCheckpoint(
+    RadianceCheckpoint *checkpoint,
+    const java::ArrayList<Patch *> *scenePatches,
+    const GalerkinState *galerkinState)
+{
+    // Options the element hierarchy and the interactions depend on
+    checkpoint->writeInt(galerkinState->basisType);
+    checkpoint->writeInt(galerkinState->galerkinIterationMethod);
+    checkpoint->writeInt(galerkinState->hierarchical);
+    checkpoint->writeInt(galerkinState->clustered);
+    checkpoint->writeInt(galerkinState->importanceDriven);
+    checkpoint->writeInt(galerkinState->lazyLinking);
+
+    checkpoint->writeInt(galerkinState->iterationNumber);
+    checkpoint->writeFloat(galerkinState->cpuSeconds);
+    checkpoint->writeColor(galerkinState->ambientRadiance);
+    checkpoint->writeColor(galerkinState->constantRadiance);
+
+    java::ArrayList<GalerkinElement *> *elements = new java::ArrayList<GalerkinElement *>();
+    collectClusters(galerkinState->topCluster, elements);
+    checkpoint->writeInt((int)elements->size());
+    for ( int i = 0; i < elements->size(); i++ ) {
+        const GalerkinElement *cluster = elements->get(i);
+        checkpoint->writeInt(cluster->irregularSubElements != nullptr ? (int)cluster->irregularSubElements->size() : 0);
+        writeElement(checkpoint, cluster);
+    }
+
+    for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
+        int first = (int)elements->size();
+        collectSurfaceElements(galerkinGetElement(scenePatches->get(i)), elements);
+        for ( int j = first; j < elements->size(); j++ ) {
+            const GalerkinElement *element = elements->get(j);
+            writeElement(checkpoint, element);
+            checkpoint->writeInt(element->regularSubElements != nullptr);
+        }
+    }
+
+    int numberOfElements = (int)elements->size();
+    CheckpointElementEntry *entries = new CheckpointElementEntry[numberOfElements];
+    for ( int i = 0; i < numberOfElements; i++ ) {
+        entries[i].element = elements->get(i);
+        entries[i].index = i;
+    }
+    qsort(entries, numberOfElements, sizeof(CheckpointElementEntry), checkpointCompareEntries);
+
+    for ( int i = 0; i < numberOfElements; i++ ) {
+        const java::ArrayList<Interaction *> *interactions = elements->get(i)->interactions;
+        checkpoint->writeInt((int)interactions->size());
+        for ( int j = 0; j < interactions->size(); j++ ) {
+            const Interaction *interaction = interactions->get(j);
+            int numberOfCoefficients =
+                interaction->numberOfBasisFunctionsOnReceiver * interaction->numberOfBasisFunctionsOnSource;
+            checkpoint->writeInt(checkpointFindEntry(entries, numberOfElements, interaction->receiverElement));
+            checkpoint->writeInt(checkpointFindEntry(entries, numberOfElements, interaction->sourceElement));
+            checkpoint->writeInt(interaction->numberOfBasisFunctionsOnReceiver);
+            checkpoint->writeInt(interaction->numberOfBasisFunctionsOnSource);
+            checkpoint->writeInt(interaction->numberOfReceiverCubaturePositions);
+            checkpoint->writeInt(interaction->visibility);
+            for ( int k = 0; k < numberOfCoefficients; k++ ) {
+                checkpoint->writeFloat(interaction->K[k]);
+            }
+            checkpoint->writeFloat(interaction->deltaK[0]);
+        }
+    }
+
+    delete[] entries;
+    delete elements;
+}
+
+/**
+Reads the state written by writeCheckpoint() into the elements created by
+GalerkinRadianceMethod::initialize(). Returns false, without changing anything,
+if the checkpoint was written with other Galerkin options. Once the elements are
+being changed, a checkpoint that does not fit the scene is a fatal error
+*/
+bool
+CheckpointStrategy::readCheckpoint(
+    RadianceCheckpoint *checkpoint,
+    const java::ArrayList<Patch *> *scenePatches,
+    GalerkinState *galerkinState)
+{
+    bool sameOptions = checkpoint->readInt() == galerkinState->basisType;
+    sameOptions = checkpoint->readInt() == galerkinState->galerkinIterationMethod && sameOptions;
+    sameOptions = checkpoint->readInt() == galerkinState->hierarchical && sameOptions;
+    sameOptions = checkpoint->readInt() == galerkinState->clustered && sameOptions;
+    sameOptions = checkpoint->readInt() == galerkinState->importanceDriven && sameOptions;
+    sameOptions = checkpoint->readInt() == galerkinState->lazyLinking && sameOptions;
+    if ( !sameOptions || checkpoint->hasReadError() ) {
+        logWarning("CheckpointStrategy::readCheckpoint", "The checkpoint was written with other Galerkin options");
+        return false;
+    }
+
+    int iterationNumber = checkpoint->readInt();
+    float cpuSeconds = checkpoint->readFloat();
+    ColorRgb ambientRadiance = checkpoint->readColor();
+    ColorRgb constantRadiance = checkpoint->readColor();
+
+    java::ArrayList<GalerkinElement *> *elements = new java::ArrayList<GalerkinElement *>();
+    collectClusters(galerkinState->topCluster, elements);
+    if ( checkpoint->readInt() != elements->size() || checkpoint->hasReadError() ) {
+        logWarning("CheckpointStrategy::readCheckpoint", "The checkpoint was written with another cluster hierarchy");
+        delete elements;
+        return false;
+    }
+
+    galerkinState->iterationNumber = iterationNumber;
+    galerkinState->cpuSeconds = cpuSeconds;
+    galerkinState->ambientRadiance = ambientRadiance;
+    galerkinState->constantRadiance = constantRadiance;
+
+    for ( int i = 0; i < elements->size(); i++ ) {
+        GalerkinElement *cluster = elements->get(i);
+        int numberOfChildren = cluster->irregularSubElements != nullptr ? (int)cluster->irregularSubElements->size() : 0;
+        if ( checkpoint->readInt() != numberOfChildren ) {
+            logFatal(-1, "CheckpointStrategy::readCheckpoint", "Cluster %d does not match the checkpoint", cluster->id);
+        }
+        readElement(checkpoint, cluster);
+    }
+
+    for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
+        readSurfaceElement(checkpoint, galerkinGetElement(scenePatches->get(i)), elements);
+    }
+
+    int numberOfElements = (int)elements->size();
+    for ( int i = 0; i < numberOfElements && !checkpoint->hasReadError(); i++ ) {
+        GalerkinElement *element = elements->get(i);
+        int numberOfInteractions = checkpoint->readInt();
+        for ( int j = 0; j < numberOfInteractions && !checkpoint->hasReadError(); j++ ) {
+            int receiverIndex = checkpoint->readInt();
+            int sourceIndex = checkpoint->readInt();
+            int numberOfBasisFunctionsOnReceiver = checkpoint->readInt();
+            int numberOfBasisFunctionsOnSource = checkpoint->readInt();
+            int numberOfReceiverCubaturePositions = checkpoint->readInt();
+            int visibility = checkpoint->readInt();
+            if ( receiverIndex < 0 || receiverIndex >= numberOfElements
+              || sourceIndex < 0 || sourceIndex >= numberOfElements
+              || numberOfBasisFunctionsOnReceiver < 1
+              || numberOfBasisFunctionsOnReceiver > elements->get(receiverIndex)->basisSize
+              || numberOfBasisFunctionsOnSource < 1
+              || numberOfBasisFunctionsOnSource > elements->get(sourceIndex)->basisSize
+              || numberOfReceiverCubaturePositions != 1 ) {
+                logFatal(-1, "CheckpointStrategy::readCheckpoint", "Invalid interaction in the checkpoint");
+            }
+
+            float K[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+            float deltaK[1];
+            for ( int k = 0; k < numberOfBasisFunctionsOnReceiver * numberOfBasisFunctionsOnSource; k++ ) {
+                K[k] = checkpoint->readFloat();
+            }
+            deltaK[0] = checkpoint->readFloat();
+
+            element->interactions->add(Interaction::interactionCreate(
+                elements->get(receiverIndex),
+                elements->get(sourceIndex),
+                K,
+                deltaK,
+                (unsigned char)numberOfBasisFunctionsOnReceiver,
+                (unsigned char)numberOfBasisFunctionsOnSource,
+                (unsigned char)numberOfReceiverCubaturePositions,
+                (unsigned char)visibility));
+        }
+    }
+
+    delete elements;
+    if ( checkpoint->hasReadError() ) {
+        logFatal(-1, "CheckpointStrategy::readCheckpoint", "The checkpoint does not match the scene");
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef __CHECKPOINT_STRATEGY__
+#define __CHECKPOINT_STRATEGY__
+
+#include "java/util/ArrayList.h"
+#include "io/RadianceCheckpoint.h"
+#include "GALERKIN/GalerkinState.h"
+
+/**
+Writes and reads the Galerkin radiosity state to and from a RadianceCheckpoint:
+the iteration state, the element hierarchy with the radiance and potential on
+every element, and the interactions with their coupling coefficients.
+
+The cluster elements and the toplevel surface elements are created again by
+GalerkinRadianceMethod::initialize() in the same order, so only the regular
+subdivision of the surface elements is stored. Elements are numbered in the order
+they are written: first the clusters, depth first from the top cluster, then for
+each patch its toplevel element and its regular sub-elements, depth first.
+Interactions refer to their elements by these numbers
+*/
+class CheckpointStrategy {
+  private:
+    static void collectClusters(GalerkinElement *cluster, java::ArrayList<GalerkinElement *> *elements);
+    static void collectSurfaceElements(GalerkinElement *element, java::ArrayList<GalerkinElement *> *elements);
+    static void writeElement(RadianceCheckpoint *checkpoint, const GalerkinElement *element);
+    static void readElement(RadianceCheckpoint *checkpoint, GalerkinElement *element);
+    static void
+    readSurfaceElement(
+        RadianceCheckpoint *checkpoint,
+        GalerkinElement *element,
+        java::ArrayList<GalerkinElement *> *elements);
+
+  public:
+    static void
+    writeCheckpoint(
+        RadianceCheckpoint *checkpoint,
+        const java::ArrayList<Patch *> *scenePatches,
+        const GalerkinState *galerkinState);
+
+    static bool
+    readCheckpoint(
+        RadianceCheckpoint *checkpoint,
+        const java::ArrayList<Patch *> *scenePatches,
+        GalerkinState *galerkinState);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "java/util/ArrayList.txx"
+#include "java/lang/Math.h"
+#include "common/Statistics.h"
+#include "GALERKIN/GalerkinElement.h"
+#include "GALERKIN/processing/ConvergenceStrategy.h"
+
+/**
+Compares the patch radiance with the radiance when it was last measured, and
+remembers it for the next time. One pass over the patches
+*/
+void
+ConvergenceStrategy::measureChanges(GalerkinState *galerkinState) {
+    const java::ArrayList<Patch *> *patches = galerkinState->convergencePatches;
+    double flux = 0.0;
+    double changedPower = 0.0;
+    float maximumChange = 0.0f;
+    for ( int i = 0; i < galerkinState->numberOfPreviousPatchRadiances; i++ ) {
+        Patch *patch = patches->get(i);
+        float radiance = galerkinGetElement(patch)->radiance[0].luminance();
+        float change = java::Math::abs(radiance - galerkinState->previousPatchRadiance[i]);
+        if ( change > maximumChange ) {
+            maximumChange = change;
+        }
+        flux += M_PI * patch->area * radiance;
+        changedPower += M_PI * patch->area * change;
+        galerkinState->previousPatchRadiance[i] = radiance;
+    }
+
+    double fluxChange = java::Math::abs(flux - galerkinState->totalFlux);
+    galerkinState->totalFlux = flux;
+
+    float maximumRadiance = GLOBAL_statistics.maxSelfEmittedRadiance.luminance();
+    float emittedPower = GLOBAL_statistics.totalEmittedPower.luminance();
+
+    galerkinState->fluxChange = flux > 0.0 ? (float)(fluxChange / flux) : 0.0f;
+    galerkinState->maximumRadianceChange = maximumRadiance > 0.0f ? maximumChange / maximumRadiance : 0.0f;
+    if ( galerkinState->galerkinIterationMethod != GalerkinIterationMethod::SOUTH_WELL ) {
+        galerkinState->unShotPower = emittedPower > 0.0f ? (float)(changedPower / emittedPower) : 0.0f;
+    }
+    galerkinState->residualsUpToDate = true;
+}
+
+/**
+Remembers the current patch radiance as the starting point for the next step,
+after initialization or reading a checkpoint
+*/
+void
+ConvergenceStrategy::reset(const Scene *scene, GalerkinState *galerkinState) {
+    int numberOfPatches = scene->patchList != nullptr ? (int)scene->patchList->size() : 0;
+    if ( galerkinState->numberOfPreviousPatchRadiances != numberOfPatches ) {
+        delete[] galerkinState->previousPatchRadiance;
+        galerkinState->previousPatchRadiance = new float[numberOfPatches];
+        galerkinState->numberOfPreviousPatchRadiances = numberOfPatches;
+    }
+    galerkinState->convergencePatches = scene->patchList;
+
+    double flux = 0.0;
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        Patch *patch = scene->patchList->get(i);
+        float radiance = galerkinGetElement(patch)->radiance[0].luminance();
+        galerkinState->previousPatchRadiance[i] = radiance;
+        flux += M_PI * patch->area * radiance;
+    }
+    galerkinState->totalFlux = flux;
+    galerkinState->fluxChange = 1.0f;
+    galerkinState->maximumRadianceChange = 1.0f;
+    galerkinState->unShotPower = 1.0f;
+    galerkinState->residualsUpToDate = true;
+}
+
+/**
+Updates the residuals after a step, as far as needed for the test. Returns true
+when they are below the tolerance set with -gr-convergence-tolerance
+*/
+bool
+ConvergenceStrategy::hasConverged(const Scene *scene, GalerkinState *galerkinState) {
+    int numberOfPatches = scene->patchList != nullptr ? (int)scene->patchList->size() : 0;
+    if ( galerkinState->numberOfPreviousPatchRadiances != numberOfPatches ) {
+        reset(scene, galerkinState);
+        return false;
+    }
+    galerkinState->residualsUpToDate = false;
+
+    bool shooting = galerkinState->galerkinIterationMethod == GalerkinIterationMethod::SOUTH_WELL;
+    if ( shooting && galerkinState->shooterUnShotPower != nullptr ) {
+        float emittedPower = GLOBAL_statistics.totalEmittedPower.luminance();
+        double unShotPower = galerkinState->totalUnShotPower > 0.0 ? galerkinState->totalUnShotPower : 0.0;
+        galerkinState->unShotPower = emittedPower > 0.0f ? (float)(unShotPower / emittedPower) : 0.0f;
+    }
+
+    float tolerance = galerkinState->convergenceTolerance;
+    if ( tolerance <= 0.0f ) {
+        return false;
+    }
+    if ( shooting ) {
+        return galerkinState->unShotPower <= tolerance;
+    }
+
+    // The first gathering iteration only brings in the direct illumination
+    measureChanges(galerkinState);
+    return galerkinState->iterationNumber > 1
+        && galerkinState->fluxChange <= tolerance
+        && galerkinState->maximumRadianceChange <= tolerance;
+}
+
+/**
+Measures the flux and radiance changes if steps were done since they were last
+measured, for showing them
+*/
+void
+ConvergenceStrategy::updateResiduals(GalerkinState *galerkinState) {
+    if ( !galerkinState->residualsUpToDate && galerkinState->convergencePatches != nullptr ) {
+        measureChanges(galerkinState);
+    }
+}
+
+void
+ConvergenceStrategy::terminate(GalerkinState *galerkinState) {
+    delete[] galerkinState->previousPatchRadiance;
+    galerkinState->previousPatchRadiance = nullptr;
+    galerkinState->numberOfPreviousPatchRadiances = 0;
+    galerkinState->convergencePatches = nullptr;
+}
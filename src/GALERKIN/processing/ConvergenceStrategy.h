@@ -0,0 +1,40 @@
+#ifndef __CONVERGENCE_STRATEGY__
+#define __CONVERGENCE_STRATEGY__
+
+#include "scene/Scene.h"
+#include "GALERKIN/GalerkinState.h"
+
+/**
+Measures how much the Galerkin radiosity solution still changes, so the
+computations can stop once it has converged instead of always doing the number
+of iterations asked for.
+
+The residuals are:
+- the change in total flux leaving the patches, relative to that flux
+- the largest change in patch radiance, relative to the maximum self-emitted radiance
+- the power still to be propagated, relative to the total self-emitted power:
+  the un-shot power for Southwell iterations, and the power by which the patches
+  changed in the last step for Jacobi and Gauss-Seidel iterations, which is
+  what the next step gathers
+
+Gathering iterations have converged when the flux and radiance changes are both
+below the tolerance, shooting when the un-shot power is. The changes compare the
+patch radiance (of their toplevel elements) with the radiance when they were last
+measured, in one pass over the patches. Steps only pay for that pass when a
+gathering method tests a tolerance: shooting tests the total un-shot power that
+ShootingStrategy keeps up to date, and without a tolerance nothing is tested.
+Otherwise the changes are measured when the statistics are shown, and then cover
+all steps since they were last shown
+*/
+class ConvergenceStrategy {
+  private:
+    static void measureChanges(GalerkinState *galerkinState);
+
+  public:
+    static void reset(const Scene *scene, GalerkinState *galerkinState);
+    static bool hasConverged(const Scene *scene, GalerkinState *galerkinState);
+    static void updateResiduals(GalerkinState *galerkinState);
+    static void terminate(GalerkinState *galerkinState);
+};
+
+#endif
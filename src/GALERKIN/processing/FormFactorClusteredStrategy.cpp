@@ -41,7 +41,6 @@ FormFactorClusteredStrategy::doConstantAreaToAreaFormFactor(
     }
     link->K[0] = (float)(receiverElement->area * G);
 
-    link->deltaK = new float[1];
     link->deltaK[0] = (float)(G - gMin);
     if ( gMax - G > link->deltaK[0] ) {
         link->deltaK[0] = (float)(gMax - G);
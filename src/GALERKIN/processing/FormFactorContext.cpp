@@ -0,0 +1,14 @@
+#include "GALERKIN/processing/FormFactorContext.h"
+
+FormFactorContext::FormFactorContext():
+    generation(-1),
+    receiverElement(),
+    receiverCubatureRule(),
+    x(),
+    sourceElement(),
+    sourceCubatureRule(),
+    y(),
+    rays(),
+    distances()
+{
+}
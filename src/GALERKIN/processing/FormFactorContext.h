@@ -0,0 +1,41 @@
+#ifndef __FORM_FACTOR_CONTEXT__
+#define __FORM_FACTOR_CONTEXT__
+
+#include "common/Ray.h"
+#include "common/numericalAnalysis/CubatureRule.h"
+#include "GALERKIN/GalerkinElement.h"
+
+/**
+Working memory of FormFactorStrategy::computeAreaToAreaFormFactorVisibility(),
+one per thread, as refinement computes form factors on several threads.
+
+It keeps the cubature rule and nodes of the last receiver and source element:
+the links of a receiver are refined one after the other, and subdividing one
+element of a link gives links sharing the other element, so the nodes are often
+the same as for the previous link. Elements are only created while refining,
+never destroyed, so the element is enough to identify its nodes until
+FormFactorStrategy::invalidateNodeCaches() is called when elements are destroyed.
+
+It also holds the shadow rays between all pairs of nodes, which are set up
+for the whole link before any of them is traced
+*/
+class FormFactorContext {
+  public:
+    int generation; // Nodes are only valid if equal to FormFactorStrategy's generation
+
+    const GalerkinElement *receiverElement;
+    CubatureRule *receiverCubatureRule;
+    Vector3D x[CUBATURE_MAXIMUM_NODES];
+
+    const GalerkinElement *sourceElement;
+    CubatureRule *sourceCubatureRule;
+    Vector3D y[CUBATURE_MAXIMUM_NODES];
+
+    // Shadow ray from source node s to receiver node r, and its length
+    Ray rays[CUBATURE_MAXIMUM_NODES][CUBATURE_MAXIMUM_NODES];
+    float distances[CUBATURE_MAXIMUM_NODES][CUBATURE_MAXIMUM_NODES];
+
+    FormFactorContext();
+};
+
+#endif
@@ -16,8 +16,8 @@ References:
   with Scattering Volumes and Object Clusters", IEEE TVCG Vol 1 Nr 3, September 1995
 */
 
-GalerkinElement *FormFactorStrategy::formFactorLastReceived;
-GalerkinElement *FormFactorStrategy::formFactorLastSource;
+std::atomic<int> FormFactorStrategy::nodeCacheGeneration(0);
+thread_local FormFactorContext FormFactorStrategy::context;
 
 /**
 Tests whether the ray intersects a geometry in the geometrySceneList. Returns
@@ -29,7 +29,7 @@ RayHit *
 FormFactorStrategy::shadowTestDiscretization(
     Ray *ray,
     const java::ArrayList<Geometry *> *geometrySceneList,
-    const VoxelGrid *voxelGrid,
+    const AccelerationStructure *accelerationStructure,
     ShadowCache *shadowCache,
     float minimumDistance,
     RayHit *hitStore,
@@ -50,7 +50,7 @@ FormFactorStrategy::shadowTestDiscretization(
                 RayHitFlag::FRONT | RayHitFlag::ANY,
                 hitStore);
         } else {
-            hit = voxelGrid->gridIntersect(
+            hit = accelerationStructure->intersect(
                 ray,
                 Numeric::EPSILON_FLOAT * minimumDistance,
                 &minimumDistance,
@@ -129,38 +129,30 @@ FormFactorStrategy::determineNodes(
 }
 
 /**
-Evaluates the radiosity kernel (*not* taking into account the reflectivity of
-the receiver) at positions x on the receiverElement and y on
-sourceElement. The shadowGeometryList contains potential occluders.
-Shadow caching is used to speed up the visibility detection
-between x and y. The shadow cache is initialized before doing the first
-evaluation of the kernel between each pair of patches. The un-occluded
-point-to-point form factor is returned. Visibility is computed and returned
-as part of the kernel.
+Evaluates the un-occluded radiosity kernel (*not* taking into account the
+reflectivity of the receiver) at positions x on the receiverElement and y on
+sourceElement, see equation (1) from [BEKA1996]. The shadow ray for testing
+visibility between x and y is returned in ray, with its length in distance.
+Where the kernel is zero no shadow ray needs to be traced
 */
 double
-FormFactorStrategy::evaluatePointsPairKernel(
-    ShadowCache *shadowCache,
-    const VoxelGrid *sceneWorldVoxelGrid,
+FormFactorStrategy::unOccludedPointsPairKernel(
     const Vector3D *x,
     const Vector3D *y,
     const GalerkinElement *receiverElement,
     const GalerkinElement *sourceElement,
-    const java::ArrayList<Geometry *> *shadowGeometryList,
-    const bool isSceneGeometry,
-    const bool isClusteredGeometry,
-    const GalerkinState *galerkinState)
+    Ray *ray,
+    float *distance)
 {
     // Trace the ray from source to receiver (y to x) to handle one-sided surfaces correctly
-    Ray ray;
-    ray.pos = *y;
-    ray.dir.subtraction(*x, *y);
-    double distance = ray.dir.norm();
-    ray.dir.inverseScaledCopy((float) distance, ray.dir, Numeric::EPSILON_FLOAT);
+    ray->pos = *y;
+    ray->dir.subtraction(*x, *y);
+    double rayLength = ray->dir.norm();
+    ray->dir.inverseScaledCopy((float) rayLength, ray->dir, Numeric::EPSILON_FLOAT);
 
     // Don't allow too nearby nodes to interact
-    if ( distance < Numeric::EPSILON ) {
-        logWarning("evaluatePointsPairKernel", "Nodes too close too each other (receiver id %d, source id %d)",
+    if ( rayLength < Numeric::EPSILON ) {
+        logWarning("unOccludedPointsPairKernel", "Nodes too close too each other (receiver id %d, source id %d)",
             receiverElement->id, sourceElement->id);
         return 0.0;
     }
@@ -170,7 +162,7 @@ FormFactorStrategy::evaluatePointsPairKernel(
     if ( sourceElement->isCluster() ) {
         cosThetaY = 0.25;
     } else {
-        cosThetaY = ray.dir.dotProduct(sourceElement->patch->normal);
+        cosThetaY = ray->dir.dotProduct(sourceElement->patch->normal);
         if ( cosThetaY <= 0.0 ) {
             // Ray leaves behind the source
             return 0.0;
@@ -182,50 +174,61 @@ FormFactorStrategy::evaluatePointsPairKernel(
     if ( receiverElement->isCluster() ) {
         cosThetaX = 0.25;
     } else {
-        cosThetaX = -ray.dir.dotProduct(receiverElement->patch->normal);
+        cosThetaX = -ray->dir.dotProduct(receiverElement->patch->normal);
         if ( cosThetaX <= 0.0 ) {
             // Ray hits receiver from the back
             return 0.0;
         }
     }
 
-    // Un-occluded kernel value (without reflectivity term) - see equation (1) from [BEKA1996]
-    double formFactorKernelTerm = cosThetaX * cosThetaY / (M_PI * distance * distance);
-    float shortenedDistance = (float)(distance * (1.0f - Numeric::EPSILON));
+    *distance = (float)(rayLength * (1.0f - Numeric::EPSILON));
+    return cosThetaX * cosThetaY / (M_PI * rayLength * rayLength);
+}
 
-    // Determine transmissivity (visibility)
+/**
+Visibility along the shadow ray, over the given distance: 0.0 or 1.0, or a
+fraction with multi-resolution visibility. The shadowGeometryList contains
+potential occluders. Shadow caching is used to speed up the visibility detection
+between the nodes of a pair of elements
+*/
+double
+FormFactorStrategy::pointsPairVisibility(
+    ShadowCache *shadowCache,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
+    Ray *ray,
+    float distance,
+    const GalerkinElement *sourceElement,
+    const java::ArrayList<Geometry *> *shadowGeometryList,
+    const bool isSceneGeometry,
+    const bool isClusteredGeometry,
+    const GalerkinState *galerkinState)
+{
     RayHit hitStore;
-    double visibilityFactor; // Will be 0.0 or 1.0
 
-    if ( !shadowGeometryList || shadowGeometryList->size() == 0 ) {
-        visibilityFactor = 1.0;
-    } else if ( !galerkinState->multiResolutionVisibility ) {
+    if ( !galerkinState->multiResolutionVisibility ) {
         if ( shadowTestDiscretization(
-                &ray,
+                ray,
                 shadowGeometryList,
-                sceneWorldVoxelGrid,
+                sceneWorldAccelerationStructure,
                 shadowCache,
-                shortenedDistance,
+                distance,
                 &hitStore,
                 isSceneGeometry,
                 isClusteredGeometry) == nullptr ) {
             // No intersection with occluders means no shadow, so full visibility
-            visibilityFactor = 1.0;
-        } else {
-            // If intersection with occluders found, there is shadow, so no visibility
-            visibilityFactor = 0.0;
+            return 1.0;
         }
-    } else if ( shadowCache->cacheHit(&ray, &shortenedDistance, &hitStore) ) {
-        visibilityFactor = 0.0;
+        // If intersection with occluders found, there is shadow, so no visibility
+        return 0.0;
+    } else if ( shadowCache->cacheHit(ray, &distance, &hitStore) ) {
+        return 0.0;
     } else {
         // Case never used if clustering disabled
         float minimumFeatureSize = 2.0f
             * (float)java::Math::sqrt(GLOBAL_statistics.totalArea * galerkinState->relMinElemArea / M_PI);
-        visibilityFactor = FormFactorClusteredStrategy::geomListMultiResolutionVisibility(
-            shadowGeometryList, shadowCache, &ray, shortenedDistance, sourceElement->blockerSize, minimumFeatureSize);
+        return FormFactorClusteredStrategy::geomListMultiResolutionVisibility(
+            shadowGeometryList, shadowCache, ray, distance, sourceElement->blockerSize, minimumFeatureSize);
     }
-
-    return formFactorKernelTerm * visibilityFactor;
 }
 
 inline void
@@ -350,10 +353,6 @@ FormFactorStrategy::computeInteractionError(
     Interaction *link)
 {
     // Compute error and write it to interaction deltaK
-    if ( link->deltaK != nullptr ) {
-        delete[] link->deltaK;
-    }
-    link->deltaK = new float[1];
     if ( sourceRadiance[0].isBlack() ) {
         // No source radiance: use constant radiance error approximation
         double gav = link->K[0] / receiverElement->area;
@@ -473,27 +472,13 @@ is used, see [SILL1995b].
 */
 void
 FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Geometry *> *geometryShadowList,
     const bool isSceneGeometry,
     const bool isClusteredGeometry,
     Interaction *link,
     const GalerkinState *galerkinState)
 {
-    // TODO: Check how to keep the cache, in a re-entrant implementation (use GalerkinState?)
-    // Very often, the source or receiver element is the same as the one in
-    // the previous call of the function. We cache cubature rules and nodes
-    // in order to prevent re-computation
-    static CubatureRule *receiveCubatureRule = nullptr; // Cubature rules to be used over the
-    static CubatureRule *sourceCubatureRule = nullptr; // Receiving patch and source patch
-    static Vector3D x[CUBATURE_MAXIMUM_NODES];
-    static Vector3D y[CUBATURE_MAXIMUM_NODES];
-
-    // TODO: To make this re-entrant, should use the class as instanced objects,
-    // one per thread, and move static global variables to usual class attributes
-    formFactorLastReceived = nullptr;
-    formFactorLastSource = nullptr;
-
     GalerkinElement *receiverElement = link->receiverElement;
     GalerkinElement *sourceElement = link->sourceElement;
 
@@ -517,7 +502,6 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
             }
 
             // And a large error on the form factor
-            link->deltaK = new float[1];
             link->deltaK[0] = 1.0f;
             link->numberOfReceiverCubaturePositions = 1;
 
@@ -541,7 +525,6 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
             }
 
             // And a 0 error on the form factor
-            link->deltaK = new float[1];
             link->deltaK[0] = 0.0f;
             link->numberOfReceiverCubaturePositions = 1;
 
@@ -551,25 +534,60 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
         }
     }
 
-    // If the receiver is another one than before, determine the cubature
-    // rule to be used on it and the nodes (positions on the patch)
-    if ( receiverElement != formFactorLastReceived ) {
-        determineNodes(receiverElement, GalerkinRole::RECEIVER, galerkinState, &receiveCubatureRule, x);
+    // Very often, the source or receiver element is the same as for the previous
+    // link: the cubature rules and nodes are only determined for another one
+    FormFactorContext *formFactorContext = &context;
+    if ( formFactorContext->generation != nodeCacheGeneration ) {
+        formFactorContext->receiverElement = nullptr;
+        formFactorContext->sourceElement = nullptr;
+        formFactorContext->generation = nodeCacheGeneration;
     }
-
-    // Same for the source element
-    if ( sourceElement != formFactorLastSource ) {
-        determineNodes(sourceElement, GalerkinRole::SOURCE, galerkinState, &sourceCubatureRule, y);
+    if ( receiverElement != formFactorContext->receiverElement ) {
+        determineNodes(
+            receiverElement,
+            GalerkinRole::RECEIVER,
+            galerkinState,
+            &formFactorContext->receiverCubatureRule,
+            formFactorContext->x);
+        formFactorContext->receiverElement = receiverElement;
     }
-
-    // Evaluate the radiosity kernel between each pair of nodes on the source
-    // and the receiver element if at least receiver or source changed since
-    // last time
-    double maximumKernelValue = 0.0;
+    if ( sourceElement != formFactorContext->sourceElement ) {
+        determineNodes(
+            sourceElement,
+            GalerkinRole::SOURCE,
+            galerkinState,
+            &formFactorContext->sourceCubatureRule,
+            formFactorContext->y);
+        formFactorContext->sourceElement = sourceElement;
+    }
+    const CubatureRule *receiveCubatureRule = formFactorContext->receiverCubatureRule;
+    const CubatureRule *sourceCubatureRule = formFactorContext->sourceCubatureRule;
+    int numberOfReceiverNodes = receiveCubatureRule != nullptr ? receiveCubatureRule->numberOfNodes : 0;
+    int numberOfSourceNodes = sourceCubatureRule != nullptr ? sourceCubatureRule->numberOfNodes : 0;
+
+    // Evaluate the un-occluded radiosity kernel between each pair of nodes on the
+    // source and the receiver element, setting up the shadow rays for the pairs
+    // where it is not zero
     double Gxy[CUBATURE_MAXIMUM_NODES][CUBATURE_MAXIMUM_NODES];
-    unsigned visibilityCount = 0; // Number of rays that "pass" occluders
+    int numberOfShadowRays = 0;
+    for ( int r = 0; r < numberOfReceiverNodes; r++ ) {
+        for ( int s = 0; s < numberOfSourceNodes; s++ ) {
+            Gxy[r][s] = unOccludedPointsPairKernel(
+                &formFactorContext->x[r],
+                &formFactorContext->y[s],
+                receiverElement,
+                sourceElement,
+                &formFactorContext->rays[r][s],
+                &formFactorContext->distances[r][s]);
+            if ( Gxy[r][s] != 0.0 ) {
+                numberOfShadowRays++;
+            }
+        }
+    }
 
-        if ( receiverElement != formFactorLastReceived || sourceElement != formFactorLastSource ) {
+    // Trace the shadow rays of the link as one batch. Nothing to do when no
+    // pair of nodes sees each other un-occluded or there are no occluders
+    if ( numberOfShadowRays > 0 && geometryShadowList != nullptr && geometryShadowList->size() > 0 ) {
         // Use shadow caching for accelerating occlusion detection
         ShadowCache shadowCache;
 
@@ -584,27 +602,19 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
             receiverElement->isCluster() ? receiverElement->geometry : nullptr,
             sourceElement->isCluster() ? sourceElement->geometry : nullptr);
 
-        maximumKernelValue = 0.0; // Compute maximum un-occluded kernel value
-        visibilityCount = 0; // Count the number of rays that "pass" occluders
-        for ( int r = 0; receiveCubatureRule != nullptr && r < receiveCubatureRule->numberOfNodes; r++ ) {
-            for ( int s = 0; sourceCubatureRule != nullptr && s < sourceCubatureRule->numberOfNodes; s++ ) {
-                Gxy[r][s] = evaluatePointsPairKernel(
-                    &shadowCache,
-                    sceneWorldVoxelGrid,
-                    &x[r],
-                    &y[s],
-                    receiverElement,
-                    sourceElement,
-                    geometryShadowList,
-                    isSceneGeometry,
-                    isClusteredGeometry,
-                    galerkinState);
-
-                if ( Gxy[r][s] > maximumKernelValue ) {
-                    maximumKernelValue = Gxy[r][s];
-                }
-                if ( java::Math::abs(Gxy[r][s]) > Numeric::EPSILON ) {
-                    visibilityCount++;
+        for ( int r = 0; r < numberOfReceiverNodes; r++ ) {
+            for ( int s = 0; s < numberOfSourceNodes; s++ ) {
+                if ( Gxy[r][s] != 0.0 ) {
+                    Gxy[r][s] *= pointsPairVisibility(
+                        &shadowCache,
+                        sceneWorldAccelerationStructure,
+                        &formFactorContext->rays[r][s],
+                        formFactorContext->distances[r][s],
+                        sourceElement,
+                        geometryShadowList,
+                        isSceneGeometry,
+                        isClusteredGeometry,
+                        galerkinState);
                 }
             }
         }
@@ -614,6 +624,19 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
         geomDontIntersect(nullptr, nullptr);
     }
 
+    double maximumKernelValue = 0.0; // Maximum un-occluded kernel value
+    unsigned visibilityCount = 0; // Number of rays that "pass" occluders
+    for ( int r = 0; r < numberOfReceiverNodes; r++ ) {
+        for ( int s = 0; s < numberOfSourceNodes; s++ ) {
+            if ( Gxy[r][s] > maximumKernelValue ) {
+                maximumKernelValue = Gxy[r][s];
+            }
+            if ( java::Math::abs(Gxy[r][s]) > Numeric::EPSILON ) {
+                visibilityCount++;
+            }
+        }
+    }
+
     if ( visibilityCount != 0 ) {
         // Actually compute the form factors
         if ( link->numberOfBasisFunctionsOnReceiver == 1 && link->numberOfBasisFunctionsOnSource == 1 ) {
@@ -625,16 +648,8 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
         }
     }
 
-    // Remember receiver and source for next time
-    formFactorLastReceived = receiverElement;
-    formFactorLastSource = sourceElement;
-
     if ( galerkinState->clusteringStrategy == GalerkinClusteringStrategy::ISOTROPIC
         && (receiverElement->isCluster() || sourceElement->isCluster()) ) {
-        if ( link-> deltaK != nullptr ) {
-            delete[] link->deltaK;
-        }
-        link->deltaK = new float[1];
         link->deltaK[0] = (float)(maximumKernelValue * sourceElement->area);
     }
 
@@ -649,3 +664,12 @@ FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
         link->visibility = 254;
     }
 }
+
+/**
+Makes the cubature nodes cached by the form factor contexts of all threads
+invalid, when elements are destroyed
+*/
+void
+FormFactorStrategy::invalidateNodeCaches() {
+    nodeCacheGeneration++;
+}
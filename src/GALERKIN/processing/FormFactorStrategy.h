@@ -5,25 +5,27 @@ All kind of form factor computations
 #ifndef __FORM_FACTOR_STRATEGY__
 #define __FORM_FACTOR_STRATEGY__
 
+#include <atomic>
+
 #include "java/util/ArrayList.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "skin/Geometry.h"
 #include "GALERKIN/ShadowCache.h"
 #include "GALERKIN/basisgalerkin.h"
 #include "GALERKIN/Interaction.h"
 #include "GALERKIN/GalerkinRole.h"
+#include "GALERKIN/processing/FormFactorContext.h"
 
 class FormFactorStrategy {
   private:
-    // Global variables used for form factor computation optimisation
-    static GalerkinElement *formFactorLastReceived;
-    static GalerkinElement *formFactorLastSource;
+    static std::atomic<int> nodeCacheGeneration;
+    static thread_local FormFactorContext context;
 
     static RayHit *
     shadowTestDiscretization(
         Ray *ray,
         const java::ArrayList<Geometry *> *geometrySceneList,
-        const VoxelGrid *voxelGrid,
+        const AccelerationStructure *accelerationStructure,
         ShadowCache *shadowCache,
         float minimumDistance,
         RayHit *hitStore,
@@ -39,13 +41,21 @@ class FormFactorStrategy {
             Vector3D x[CUBATURE_MAXIMUM_NODES]);
 
     static double
-    evaluatePointsPairKernel(
-        ShadowCache *shadowCache,
-        const VoxelGrid *sceneWorldVoxelGrid,
+    unOccludedPointsPairKernel(
         const Vector3D *x,
         const Vector3D *y,
         const GalerkinElement *receiverElement,
         const GalerkinElement *sourceElement,
+        Ray *ray,
+        float *distance);
+
+    static double
+    pointsPairVisibility(
+        ShadowCache *shadowCache,
+        const AccelerationStructure *sceneWorldAccelerationStructure,
+        Ray *ray,
+        float distance,
+        const GalerkinElement *sourceElement,
         const java::ArrayList<Geometry *> *shadowGeometryList,
         bool isSceneGeometry,
         bool isClusteredGeometry,
@@ -85,9 +95,11 @@ class FormFactorStrategy {
         Interaction *twoPatchesInteraction);
 
   public:
+    static void invalidateNodeCaches();
+
     static void
     computeAreaToAreaFormFactorVisibility(
-        const VoxelGrid *sceneWorldVoxelGrid,
+        const AccelerationStructure *sceneWorldAccelerationStructure,
         const java::ArrayList<Geometry *> *geometryShadowList,
         bool isSceneGeometry,
         bool isClusteredGeometry,
@@ -67,6 +67,8 @@ GatheringClusteredStrategy::doGatheringIteration(const Scene *scene, GalerkinSta
 
     printf("Galerkin (clustered) iteration %i\n", galerkinState->iterationNumber);
 
+    long createdInteractions = Interaction::getNumberOfCreatedInteractions();
+
     // Initial linking stage is replaced by the creation of a self-link between
     // the whole scene and itself
     if ( galerkinState->iterationNumber <= 1 ) {
@@ -77,8 +79,12 @@ GatheringClusteredStrategy::doGatheringIteration(const Scene *scene, GalerkinSta
 
     double userErrorThreshold = galerkinState->relLinkErrorThreshold;
 
-    // Refines and computes light transport over the refined links
-    HierarchicalRefinementStrategy::refineInteractions(scene, galerkinState->topCluster, galerkinState);
+    // Refines and computes light transport over the refined links, or only
+    // computes light transport if the links were frozen
+    if ( !GatheringStrategy::gatherOverFrozenLinks(createdInteractions, galerkinState) ) {
+        HierarchicalRefinementStrategy::refineInteractions(scene, galerkinState->topCluster, galerkinState);
+        GatheringStrategy::freezeStableLinks(createdInteractions, galerkinState);
+    }
 
     // TODO: This makes galerkinState non const. Check if this can be changed
     galerkinState->relLinkErrorThreshold = (float)userErrorThreshold;
@@ -101,5 +107,5 @@ GatheringClusteredStrategy::doGatheringIteration(const Scene *scene, GalerkinSta
         GalerkinRadianceMethod::recomputePatchColor(scene->patchList->get(i));
     }
 
-    return false; // Never done
+    return false; // Convergence is checked by ConvergenceStrategy after the step
 }
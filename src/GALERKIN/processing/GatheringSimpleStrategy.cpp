@@ -53,16 +53,14 @@ GatheringSimpleStrategy::patchUpdateRadiance(Patch *patch, GalerkinState *galerk
 }
 
 /**
-Creates initial interactions if necessary, recursively refines the interactions
-of the toplevel element, gathers radiance over the resulting lowest level
-interactions and updates the radiance for the patch if doing
-Gauss-Seidel iterations
+Creates initial interactions for the toplevel element of the patch if necessary.
+Returns the toplevel element, or nullptr if there is no need to gather to the patch
 */
-void
-GatheringSimpleStrategy::patchGather(
-    Patch *patch,
+GalerkinElement *
+GatheringSimpleStrategy::patchCreateInteractions(
+    const Patch *patch,
     const Scene *scene,
-    GalerkinState *galerkinState)
+    const GalerkinState *galerkinState)
 {
     GalerkinElement *topLevelElement = galerkinGetElement(patch);
 
@@ -70,7 +68,7 @@ GatheringSimpleStrategy::patchGather(
     // be combined with lazy linking based on radiance
     if ( galerkinState->importanceDriven &&
          topLevelElement->potential < GLOBAL_statistics.maxDirectPotential * Numeric::EPSILON ) {
-        return;
+        return nullptr;
     }
 
     // The form factors have been computed and stored with the source patch
@@ -87,6 +85,26 @@ GatheringSimpleStrategy::patchGather(
         topLevelElement->flags |= ElementFlags::INTERACTIONS_CREATED_MASK;
     }
 
+    return topLevelElement;
+}
+
+/**
+Creates initial interactions if necessary, recursively refines the interactions
+of the toplevel element, gathers radiance over the resulting lowest level
+interactions and updates the radiance for the patch if doing
+Gauss-Seidel iterations
+*/
+void
+GatheringSimpleStrategy::patchGather(
+    Patch *patch,
+    const Scene *scene,
+    GalerkinState *galerkinState)
+{
+    GalerkinElement *topLevelElement = patchCreateInteractions(patch, scene, galerkinState);
+    if ( topLevelElement == nullptr ) {
+        return;
+    }
+
     // Refine the interactions and compute light transport at the leaves
     HierarchicalRefinementStrategy::refineInteractions(scene, topLevelElement, galerkinState);
 
@@ -120,6 +138,8 @@ GatheringSimpleStrategy::doGatheringIteration(
         scene->camera->changed = false;
     }
 
+    long createdInteractions = Interaction::getNumberOfCreatedInteractions();
+
     // Not importance-driven Jacobi iterations with lazy linking
     if ( galerkinState->galerkinIterationMethod != GalerkinIterationMethod::GAUSS_SEIDEL
          && galerkinState->lazyLinking
@@ -136,9 +156,25 @@ GatheringSimpleStrategy::doGatheringIteration(
     galerkinState->ambientRadiance.clear();
 
     // One iteration = gather to all patches
-    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
-        GatheringSimpleStrategy::patchGather(scene->patchList->get(i), scene, galerkinState);
+    if ( GatheringStrategy::gatherOverFrozenLinks(createdInteractions, galerkinState) ) {
+        // Same links as in the previous iteration, no need to refine them
+    } else if ( HierarchicalRefinementStrategy::canUseThreads(galerkinState) ) {
+        // Jacobi iterations: the interactions of all patches are refined at once, on several threads
+        java::ArrayList<GalerkinElement *> topLevelElements;
+        for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+            GalerkinElement *topLevelElement =
+                GatheringSimpleStrategy::patchCreateInteractions(scene->patchList->get(i), scene, galerkinState);
+            if ( topLevelElement != nullptr ) {
+                topLevelElements.add(topLevelElement);
+            }
+        }
+        HierarchicalRefinementStrategy::refineInteractions(scene, &topLevelElements, galerkinState);
+    } else {
+        for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+            GatheringSimpleStrategy::patchGather(scene->patchList->get(i), scene, galerkinState);
+        }
     }
+    GatheringStrategy::freezeStableLinks(createdInteractions, galerkinState);
 
     // Update the radiosity after gathering to all patches with Jacobi, immediately
     // update with Gauss-Seidel so the new radiosity are already used for the
@@ -155,5 +191,5 @@ GatheringSimpleStrategy::doGatheringIteration(
         }
     }
 
-    return false; // Never done, until we have a better criteria
+    return false; // Convergence is checked by ConvergenceStrategy after the step
 }
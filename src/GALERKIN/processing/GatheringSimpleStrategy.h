@@ -14,6 +14,12 @@ class GatheringSimpleStrategy final: public GatheringStrategy {
         const Patch *patch,
         const GalerkinState *galerkinState);
 
+    static GalerkinElement *
+    patchCreateInteractions(
+        const Patch *patch,
+        const Scene *scene,
+        const GalerkinState *galerkinState);
+
     static void
     patchGather(
         Patch *patch,
@@ -1,4 +1,6 @@
 #include "java/util/ArrayList.txx"
+#include "GALERKIN/Interaction.h"
+#include "GALERKIN/FrozenLinkOperator.h"
 #include "GALERKIN/processing/GatheringStrategy.h"
 
 GatheringStrategy::GatheringStrategy() {
@@ -42,3 +44,63 @@ GatheringStrategy::pushPullPotential(GalerkinElement *element, float down) {
     element->potential = up;
     return element->potential;
 }
+
+/**
+Links can be frozen (-gr-freeze-links) when gathering over them is a linear
+function of the source radiance alone: Jacobi iterations, without importance
+and with isotropic clusters if clustering
+*/
+bool
+GatheringStrategy::canFreezeLinks(const GalerkinState *galerkinState) {
+    return galerkinState->freezeLinks
+        && galerkinState->galerkinIterationMethod == GalerkinIterationMethod::JACOBI
+        && !galerkinState->importanceDriven
+        && (!galerkinState->clustered || galerkinState->clusteringStrategy == GalerkinClusteringStrategy::ISOTROPIC);
+}
+
+/**
+Gathers radiance over the frozen links, if the links were frozen and none were
+created since createdInteractions was taken (by lazy linking at the start of the
+iteration). Otherwise the frozen links are dropped and false is returned: the
+links are to be refined again
+*/
+bool
+GatheringStrategy::gatherOverFrozenLinks(long createdInteractions, GalerkinState *galerkinState) {
+    if ( galerkinState->frozenLinks == nullptr ) {
+        return false;
+    }
+    if ( !canFreezeLinks(galerkinState) || Interaction::getNumberOfCreatedInteractions() != createdInteractions ) {
+        thawLinks(galerkinState);
+        return false;
+    }
+    galerkinState->frozenLinks->transport(galerkinState->numberOfThreads);
+    return true;
+}
+
+/**
+Freezes the links when refinement during the iteration, which started with
+createdInteractions links created so far, created at most a fraction
+(-gr-freeze-link-fraction) of the links. Refinement rarely stops creating links
+altogether on larger scenes, since the link errors keep changing with the
+radiance they carry. Freezing is therefore an approximation: the links that
+would still have been refined are kept as they are for the rest of the
+computation, and only the radiance gathered over them is iterated
+*/
+void
+GatheringStrategy::freezeStableLinks(long createdInteractions, GalerkinState *galerkinState) {
+    long newInteractions = Interaction::getNumberOfCreatedInteractions() - createdInteractions;
+    if ( canFreezeLinks(galerkinState)
+      && galerkinState->frozenLinks == nullptr
+      && (double)newInteractions <= galerkinState->freezeLinkFraction * Interaction::getNumberOfInteractions() ) {
+        galerkinState->frozenLinks = new FrozenLinkOperator(galerkinState->topCluster);
+    }
+}
+
+/**
+Drops the frozen links, when the element hierarchy is changed or destroyed
+*/
+void
+GatheringStrategy::thawLinks(GalerkinState *galerkinState) {
+    delete galerkinState->frozenLinks;
+    galerkinState->frozenLinks = nullptr;
+}
@@ -17,8 +17,13 @@ See [COHE1993] section 5.3.2.
 class GatheringStrategy {
   protected:
     static float pushPullPotential(GalerkinElement *element, float down);
+    static bool canFreezeLinks(const GalerkinState *galerkinState);
+    static bool gatherOverFrozenLinks(long createdInteractions, GalerkinState *galerkinState);
+    static void freezeStableLinks(long createdInteractions, GalerkinState *galerkinState);
 
   public:
+    static void thawLinks(GalerkinState *galerkinState);
+
     GatheringStrategy();
     virtual ~GatheringStrategy();
 
@@ -2,6 +2,10 @@
 Hierarchical refinement
 */
 
+#include <atomic>
+#include <thread>
+
+#include "java/lang/Math.h"
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
 #include "common/Statistics.h"
@@ -10,6 +14,43 @@ Hierarchical refinement
 #include "GALERKIN/processing/ClusterTraversalStrategy.h"
 #include "GALERKIN/processing/HierarchicalRefinementStrategy.h"
 
+/**
+Refinement of the interactions of one receiver element, when the interactions of
+several receivers are refined on several threads. Links are only refined to links
+with the receiver or its descendants, but the descendants with interactions of their
+own are refined by other tasks. So the task stores new links with its own receiver
+right away, just as when refining on a single thread, and only records the links
+for other receivers. Light transport is recorded too, as it accumulates radiance on
+elements shared with other tasks. Both are applied once all tasks are done, in the
+order a single thread would have refined the receivers, which gives exactly the same
+interactions and radiance whatever the number of threads
+*/
+class HierarchicalRefinementTask {
+  public:
+    GalerkinElement *receiverElement;
+    java::ArrayList<Interaction *> transportInteractions; // Accurate enough links, in refinement order
+    java::ArrayList<Interaction *> storedInteractions; // New links with other receivers, in refinement order
+
+    explicit HierarchicalRefinementTask(GalerkinElement *inReceiverElement): receiverElement(inReceiverElement) {}
+};
+
+/**
+Receivers to refine, in the order refineInteractions() visits them on a single
+thread. Threads take the next task until none is left
+*/
+class HierarchicalRefinementJob {
+  public:
+    const Scene *scene;
+    GalerkinState *galerkinState;
+    java::ArrayList<HierarchicalRefinementTask *> tasks;
+    std::atomic<int> nextTask;
+
+    HierarchicalRefinementJob(): scene(), galerkinState(), nextTask(0) {}
+};
+
+// Task of the calling thread, nullptr when light transport is computed right away
+static thread_local HierarchicalRefinementTask *globalRefinementTask = nullptr;
+
 /**
 Does shaft-culling between elements in a interaction (if the user asked for it).
 Updates the *candidatesList. Returns the old candidate list, so it can be restored
@@ -453,7 +494,7 @@ HierarchicalRefinementStrategy::hierarchicRefinementCreateSubdivisionLink(
     const bool isSceneGeometry = (candidatesList == scene->geometryList);
     const bool isClusteredGeometry = (candidatesList == scene->clusteredGeometryList);
     FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
-        (const VoxelGrid *)scene->voxelGrid,
+        (const AccelerationStructure *)scene->accelerationStructure,
         candidatesList,
         isSceneGeometry,
         isClusteredGeometry,
@@ -476,6 +517,14 @@ HierarchicalRefinementStrategy::hierarchicRefinementStoreInteraction(
 
     if ( galerkinState->galerkinIterationMethod == GalerkinIterationMethod::SOUTH_WELL ) {
         interaction->sourceElement->interactions->add(newInteraction);
+    } else if ( globalRefinementTask != nullptr ) {
+        // Light transport over the link is still to be computed, see HierarchicalRefinementTask
+        globalRefinementTask->transportInteractions.add(newInteraction);
+        if ( interaction->receiverElement == globalRefinementTask->receiverElement ) {
+            interaction->receiverElement->interactions->add(newInteraction);
+        } else {
+            globalRefinementTask->storedInteractions.add(newInteraction);
+        }
     } else {
         interaction->receiverElement->interactions->add(newInteraction);
     }
@@ -502,10 +551,11 @@ HierarchicalRefinementStrategy::hierarchicRefinementRegularSubdivideSource(
     GalerkinElement *receiverElement = interaction->receiverElement;
 
     sourceElement->regularSubDivide();
+    float subInteractionK[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
     for ( int i = 0; i < 4; i++ ) {
         GalerkinElement *child = (GalerkinElement *)sourceElement->regularSubElements[i];
         Interaction subInteraction{};
-        subInteraction.K = new float[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+        subInteraction.K = subInteractionK;
 
         if ( hierarchicRefinementCreateSubdivisionLink(
                 scene,
@@ -544,10 +594,11 @@ HierarchicalRefinementStrategy::hierarchicRefinementRegularSubdivideReceiver(
     GalerkinElement *receiverElement = interaction->receiverElement;
 
     receiverElement->regularSubDivide();
+    float subInteractionK[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
     for ( int i = 0; i < 4; i++ ) {
         Interaction subInteraction{};
         GalerkinElement *child = (GalerkinElement *)receiverElement->regularSubElements[i];
-        subInteraction.K = new float[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+        subInteraction.K = subInteractionK;
 
         if ( hierarchicRefinementCreateSubdivisionLink(
                 scene,
@@ -585,12 +636,13 @@ HierarchicalRefinementStrategy::hierarchicRefinementSubdivideSourceCluster(
     const GalerkinElement *sourceElement = interaction->sourceElement;
     GalerkinElement *receiverElement = interaction->receiverElement;
 
+    float subInteractionK[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
     for ( int i = 0;
           sourceElement->irregularSubElements != nullptr && i < sourceElement->irregularSubElements->size();
           i++ ) {
         GalerkinElement *childElement = (GalerkinElement *)sourceElement->irregularSubElements->get(i);
         Interaction subInteraction{};
-        subInteraction.K = new float[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+        subInteraction.K = subInteractionK;
 
         if ( !childElement->isCluster() ) {
             const Patch *thePatch = childElement->patch;
@@ -638,12 +690,13 @@ HierarchicalRefinementStrategy::hierarchicRefinementSubdivideReceiverCluster(
     GalerkinElement *sourceElement = interaction->sourceElement;
     const GalerkinElement *receiverElement = interaction->receiverElement;
 
+    float subInteractionK[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
     for ( int i = 0;
           receiverElement->irregularSubElements != nullptr && i < receiverElement->irregularSubElements->size();
           i++ ) {
         GalerkinElement *child = (GalerkinElement *)receiverElement->irregularSubElements->get(i);
         Interaction subInteraction{};
-        subInteraction.K = new float [MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+        subInteraction.K = subInteractionK;
 
         if ( !child->isCluster() ) {
             const Patch *thePatch = child->patch;
@@ -692,7 +745,10 @@ HierarchicalRefinementStrategy::refineRecursive(
     bool isClusteredGeometry = (*candidatesList == scene->clusteredGeometryList);
     switch ( hierarchicRefinementEvaluateInteraction(interaction, galerkinState) ) {
         case InteractionEvaluationCode::ACCURATE_ENOUGH:
-            hierarchicRefinementComputeLightTransport(interaction, galerkinState);
+            // Refinement tasks record the link instead, once it is stored
+            if ( globalRefinementTask == nullptr ) {
+                hierarchicRefinementComputeLightTransport(interaction, galerkinState);
+            }
             refined = false;
             break;
         case InteractionEvaluationCode::REGULAR_SUBDIVIDE_SOURCE:
@@ -741,19 +797,154 @@ HierarchicalRefinementStrategy::HierarchicalRefinementStrategy::refineInteractio
     return refineRecursive(scene, &candidateOccluderList, interaction, galerkinState);
 }
 
+/**
+Destroys the refined interactions and removes them from the list they were refined
+from, in a single pass over the list: interactionsToRemove is in list order
+*/
 void
 HierarchicalRefinementStrategy::removeRefinedInteractions(
-    const GalerkinState *galerkinState,
+    java::ArrayList<Interaction *> *interactions,
     const java::ArrayList<Interaction *> *interactionsToRemove)
 {
-    for ( int i = 0; i < interactionsToRemove->size(); i++ ) {
-        Interaction *interaction = interactionsToRemove->get(i);
-        if ( galerkinState->galerkinIterationMethod == GalerkinIterationMethod::SOUTH_WELL ) {
-            interaction->sourceElement->interactions->remove(interaction);
+    if ( interactionsToRemove->size() == 0 ) {
+        return;
+    }
+
+    long kept = 0;
+    long next = 0;
+    for ( long i = 0; i < interactions->size(); i++ ) {
+        Interaction *interaction = interactions->get(i);
+        if ( next < interactionsToRemove->size() && interaction == interactionsToRemove->get(next) ) {
+            Interaction::interactionDestroy(interaction);
+            next++;
         } else {
-            interaction->receiverElement->interactions->remove(interaction);
+            interactions->set(kept, interaction);
+            kept++;
+        }
+    }
+    while ( interactions->size() > kept ) {
+        interactions->remove(interactions->size() - 1);
+    }
+}
+
+/**
+Refines and computes light transport over the interactions stored with the
+receiver element itself
+*/
+void
+HierarchicalRefinementStrategy::refineReceiverInteractions(
+    const Scene *scene,
+    const GalerkinElement *receiverElement,
+    GalerkinState *galerkinState)
+{
+    // Iterate over the interactions. Interactions that are refined are removed from the list
+    java::ArrayList<Interaction *> interactionsToRemove;
+
+    for ( int i = 0; receiverElement->interactions != nullptr && i < receiverElement->interactions->size(); i++ ) {
+        Interaction *interaction = receiverElement->interactions->get(i);
+        if ( refineInteraction(scene, interaction, galerkinState) ) {
+            interactionsToRemove.add(interaction);
+        } else if ( globalRefinementTask != nullptr ) {
+            globalRefinementTask->transportInteractions.add(interaction);
         }
-        Interaction::interactionDestroy(interaction);
+    }
+    removeRefinedInteractions(receiverElement->interactions, &interactionsToRemove);
+}
+
+/**
+Appends a task for every element with interactions in the hierarchy, in the order
+refineInteractions() refines them
+*/
+void
+HierarchicalRefinementStrategy::collectRefinementTasks(HierarchicalRefinementJob *job, GalerkinElement *parentElement) {
+    for ( int i = 0;
+          parentElement->irregularSubElements != nullptr && i < parentElement->irregularSubElements->size();
+          i++ ) {
+        collectRefinementTasks(job, (GalerkinElement *)parentElement->irregularSubElements->get(i));
+    }
+
+    if ( parentElement->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            collectRefinementTasks(job, (GalerkinElement *)parentElement->regularSubElements[i]);
+        }
+    }
+
+    if ( parentElement->interactions != nullptr && parentElement->interactions->size() > 0 ) {
+        job->tasks.add(new HierarchicalRefinementTask(parentElement));
+    }
+}
+
+void
+HierarchicalRefinementStrategy::refinementWorker(HierarchicalRefinementJob *job) {
+    for ( int i = job->nextTask++; i < job->tasks.size(); i = job->nextTask++ ) {
+        globalRefinementTask = job->tasks.get(i);
+        refineReceiverInteractions(job->scene, globalRefinementTask->receiverElement, job->galerkinState);
+    }
+    globalRefinementTask = nullptr;
+}
+
+/**
+Receivers can only be refined at once when doing Jacobi iterations, where the
+radiance that is gathered is not changed before all receivers are done, and with
+isotropic clusters, where light transport to a receiver cluster only changes the
+received radiance of the cluster itself
+*/
+bool
+HierarchicalRefinementStrategy::canUseThreads(const GalerkinState *galerkinState) {
+    return galerkinState->numberOfThreads > 1
+        && galerkinState->galerkinIterationMethod == GalerkinIterationMethod::JACOBI
+        && (!galerkinState->clustered || galerkinState->clusteringStrategy == GalerkinClusteringStrategy::ISOTROPIC);
+}
+
+/**
+Refines and computes light transport over all interactions of the given
+toplevel elements, on galerkinState->numberOfThreads threads (the calling one
+included) when canUseThreads() allows it. The result is the same as refining the
+toplevel elements one after the other
+*/
+void
+HierarchicalRefinementStrategy::refineInteractions(
+    const Scene *scene,
+    const java::ArrayList<GalerkinElement *> *topLevelElements,
+    GalerkinState *galerkinState)
+{
+    if ( !canUseThreads(galerkinState) ) {
+        for ( int i = 0; i < topLevelElements->size(); i++ ) {
+            refineInteractions(scene, topLevelElements->get(i), galerkinState);
+        }
+        return;
+    }
+
+    HierarchicalRefinementJob job;
+    job.scene = scene;
+    job.galerkinState = galerkinState;
+    for ( int i = 0; i < topLevelElements->size(); i++ ) {
+        collectRefinementTasks(&job, topLevelElements->get(i));
+    }
+
+    int numberOfThreads = java::Math::max(1, java::Math::min(galerkinState->numberOfThreads, (int)job.tasks.size()));
+    std::thread **workers = new std::thread *[numberOfThreads];
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(refinementWorker, &job);
+    }
+    refinementWorker(&job);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
+
+    // Store the links with the other receivers and compute light transport, always in task order
+    for ( int i = 0; i < job.tasks.size(); i++ ) {
+        HierarchicalRefinementTask *task = job.tasks.get(i);
+        for ( int j = 0; j < task->storedInteractions.size(); j++ ) {
+            Interaction *interaction = task->storedInteractions.get(j);
+            interaction->receiverElement->interactions->add(interaction);
+        }
+        for ( int j = 0; j < task->transportInteractions.size(); j++ ) {
+            hierarchicRefinementComputeLightTransport(task->transportInteractions.get(j), galerkinState);
+        }
+        delete task;
     }
 }
 
@@ -767,6 +958,13 @@ HierarchicalRefinementStrategy::refineInteractions(
     const GalerkinElement *parentElement,
     GalerkinState *galerkinState)
 {
+    if ( canUseThreads(galerkinState) ) {
+        java::ArrayList<GalerkinElement *> topLevelElements;
+        topLevelElements.add((GalerkinElement *)parentElement);
+        refineInteractions(scene, &topLevelElements, galerkinState);
+        return;
+    }
+
     // Interactions will only be replaced by lower level interactions. We try refinement
     // beginning at the lowest levels in the hierarchy and working upwards to
     // prevent already refined interactions from being tested for refinement
@@ -789,15 +987,5 @@ HierarchicalRefinementStrategy::refineInteractions(
         }
     }
 
-    // Iterate over the interactions. Interactions that are refined are removed from the list
-    java::ArrayList<Interaction *> *interactionsToRemove = new java::ArrayList<Interaction *>();
-
-    for ( int i = 0; parentElement->interactions != nullptr && i < parentElement->interactions->size(); i++ ) {
-        Interaction *interaction = parentElement->interactions->get(i);
-        if ( refineInteraction(scene, interaction, galerkinState) ) {
-            interactionsToRemove->add(interaction);
-        }
-    }
-    removeRefinedInteractions(galerkinState, interactionsToRemove);
-    delete interactionsToRemove;
+    refineReceiverInteractions(scene, parentElement, galerkinState);
 }
@@ -1,12 +1,14 @@
 #ifndef __HIERARCHICAL_REFINE__
 #define __HIERARCHICAL_REFINE__
 
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "scene/Scene.h"
 #include "GALERKIN/GalerkinElement.h"
 #include "GALERKIN/GalerkinState.h"
 #include "GALERKIN/processing/InteractionEvaluationCode.h"
 
+class HierarchicalRefinementJob;
+
 /**
 Shaft culling stuff for hierarchical refinement
 */
@@ -112,14 +114,33 @@ class HierarchicalRefinementStrategy {
     static bool refineInteraction(const Scene *scene, Interaction *interaction, GalerkinState *galerkinState);
 
     static void
-    removeRefinedInteractions(const GalerkinState *galerkinState, const java::ArrayList<Interaction *> *interactionsToRemove);
+    removeRefinedInteractions(
+        java::ArrayList<Interaction *> *interactions,
+        const java::ArrayList<Interaction *> *interactionsToRemove);
+
+    static void
+    refineReceiverInteractions(
+        const Scene *scene,
+        const GalerkinElement *receiverElement,
+        GalerkinState *galerkinState);
+
+    static void collectRefinementTasks(HierarchicalRefinementJob *job, GalerkinElement *parentElement);
+    static void refinementWorker(HierarchicalRefinementJob *job);
 
   public:
+    static bool canUseThreads(const GalerkinState *galerkinState);
+
     static void
     refineInteractions(
         const Scene *scene,
         const GalerkinElement *parentElement,
         GalerkinState *galerkinState);
+
+    static void
+    refineInteractions(
+        const Scene *scene,
+        const java::ArrayList<GalerkinElement *> *topLevelElements,
+        GalerkinState *galerkinState);
 };
 
 #endif
@@ -33,22 +33,15 @@ LinkingClusteredStrategy::createInitialLinks(
     }
 
     // Assume no light transport (overlapping receiver and source)
-    float *K;
-    float *deltaK;
+    float K[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+    float deltaK[1];
 
-    if ( receiverElement->basisSize * sourceElement->basisSize == 1 ) {
-        K = new float[1];
-        K[0] = 0.0;
-    } else {
-        K = new float[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
-        for ( int i = 0; i < receiverElement->basisSize * sourceElement->basisSize; i++ ) {
-            K[i] = 0.0;
-        }
+    for ( int i = 0; i < receiverElement->basisSize * sourceElement->basisSize; i++ ) {
+        K[i] = 0.0;
     }
-    deltaK = new float[1];
     deltaK[0] = Numeric::HUGE_FLOAT_VALUE; // Huge value error on the form factor
 
-    Interaction *newLink = new Interaction(
+    Interaction *newLink = Interaction::interactionCreate(
         receiverElement,
         sourceElement,
         K,
@@ -59,9 +52,6 @@ LinkingClusteredStrategy::createInitialLinks(
         128
     );
 
-    delete[] K;
-    delete[] deltaK;
-
     // Store interactions with the source patch for the progressive radiosity method
     // and with the receiving patch for gathering methods
     if ( galerkinState->galerkinIterationMethod == SOUTH_WELL ) {
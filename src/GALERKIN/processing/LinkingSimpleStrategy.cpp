@@ -70,7 +70,8 @@ LinkingSimpleStrategy::createInitialLink(
     }
 
     Interaction link{};
-    link.K = new float[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+    float K[MAX_BASIS_SIZE * MAX_BASIS_SIZE];
+    link.K = K;
     link.receiverElement = rcv;
     link.sourceElement = src;
 
@@ -86,7 +87,7 @@ LinkingSimpleStrategy::createInitialLink(
     bool isClusteredGeometry = (*candidateList == scene->clusteredGeometryList);
     const java::ArrayList<Geometry *> *geometryListReferences = *candidateList;
     FormFactorStrategy::computeAreaToAreaFormFactorVisibility(
-        scene->voxelGrid,
+        scene->accelerationStructure,
         geometryListReferences,
         isSceneGeometry,
         isClusteredGeometry,
@@ -3,7 +3,7 @@
 
 #include "java/util/ArrayList.h"
 #include "skin/Geometry.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "GALERKIN/GalerkinRole.h"
 #include "GALERKIN/GalerkinElement.h"
 #include "GALERKIN/GalerkinState.h"
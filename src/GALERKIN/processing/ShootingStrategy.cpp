@@ -15,45 +15,140 @@ Southwell Galerkin radiosity (progressive refinement radiosity)
 #include "GALERKIN/processing/ShootingStrategy.h"
 
 /**
-Returns the patch with highest un-shot power, weighted with indirect
-importance if importance-driven (see Bekaert & Willems, "Importance-driven
-Progressive refinement radiosity", EGRW'95, Dublin
+Sets the keys of the patch in the shooter queues: its un-shot power and,
+if importance-driven, its un-shot power weighted with indirect importance and
+its un-shot importance (see Bekaert & Willems, "Importance-driven Progressive
+refinement radiosity", EGRW'95, Dublin). Also keeps the total un-shot power,
+which ConvergenceStrategy tests, up to date
 */
-Patch *
-ShootingStrategy::chooseRadianceShootingPatch(const java::ArrayList<Patch *> *scenePatches, const GalerkinState *galerkinState) {
-    Patch *shooting_patch;
-    Patch *pot_shooting_patch;
-    float power;
-    float maximumPower;
-    float powerImportance;
-    float maximumPowerImportance;
-
-    maximumPower = maximumPowerImportance = 0.0f;
-    shooting_patch = pot_shooting_patch = nullptr;
-    for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
-        Patch *patch = scenePatches->get(i);
+void
+ShootingStrategy::updateShooterQueues(int patchIndex, Patch *patch, GalerkinState *galerkinState) {
+    float power = (float)M_PI * patch->area * patch->radianceData->unShotRadiance[0].sumAbsComponents();
+    galerkinState->powerShooterQueue->update(patchIndex, power);
+
+    float unShotPower = (float)M_PI * patch->area
+        * java::Math::abs(patch->radianceData->unShotRadiance[0].luminance());
+    galerkinState->totalUnShotPower += unShotPower - galerkinState->shooterUnShotPower[patchIndex];
+    galerkinState->shooterUnShotPower[patchIndex] = unShotPower;
+
+    if ( galerkinState->importanceDriven ) {
+        // For importance-driven progressive refinement radiosity, choose the patch
+        // with highest indirectly received potential times power
+        float powerImportance = (galerkinGetPotential(patch) - patch->directPotential) * power;
+        galerkinState->importanceShooterQueue->update(patchIndex, powerImportance);
+        galerkinState->potentialShooterQueue->update(
+            patchIndex,
+            patch->area * java::Math::abs(galerkinGetUnShotPotential(patch)));
+    }
+}
 
-        power = (float)M_PI * patch->area * patch->radianceData->unShotRadiance[0].sumAbsComponents();
-        if ( power > maximumPower ) {
-            shooting_patch = patch;
-            maximumPower = power;
+/**
+Makes the shooter queues hold the keys of all patches, creating them if needed.
+Also sets the ambient radiance, which shooting steps then keep up to date
+*/
+void
+ShootingStrategy::refreshShooterQueues(const java::ArrayList<Patch *> *scenePatches, GalerkinState *galerkinState) {
+    int numberOfPatches = scenePatches != nullptr ? (int)scenePatches->size() : 0;
+    if ( galerkinState->powerShooterQueue == nullptr
+      || galerkinState->powerShooterQueue->getNumberOfItems() != numberOfPatches ) {
+        clearShooterQueues(galerkinState);
+        galerkinState->powerShooterQueue = new IndexedMaxHeap(numberOfPatches);
+        galerkinState->importanceShooterQueue = new IndexedMaxHeap(numberOfPatches);
+        galerkinState->potentialShooterQueue = new IndexedMaxHeap(numberOfPatches);
+
+        int numberOfIds = 0;
+        for ( int i = 0; i < numberOfPatches; i++ ) {
+            numberOfIds = java::Math::max(numberOfIds, (int)scenePatches->get(i)->id + 1);
         }
+        galerkinState->shooterIndexByPatchId = new int[numberOfIds];
+        galerkinState->numberOfShooterPatchIds = numberOfIds;
+        for ( int i = 0; i < numberOfIds; i++ ) {
+            galerkinState->shooterIndexByPatchId[i] = -1;
+        }
+        for ( int i = 0; i < numberOfPatches; i++ ) {
+            galerkinState->shooterIndexByPatchId[scenePatches->get(i)->id] = i;
+        }
+        galerkinState->shooterUnShotPower = new float[numberOfPatches];
+    }
 
-        if ( galerkinState->importanceDriven ) {
-            // For importance-driven progressive refinement radiosity, choose the patch
-            // with highest indirectly received potential times power
-            powerImportance = (galerkinGetPotential(patch) - patch->directPotential) * power;
-            if ( powerImportance > maximumPowerImportance ) {
-                pot_shooting_patch = patch;
-                maximumPowerImportance = powerImportance;
-            }
+    // Summed anew, so rounding errors of the running total do not pile up
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        galerkinState->shooterUnShotPower[i] = 0.0f;
+    }
+    galerkinState->totalUnShotPower = 0.0;
+
+    if ( !galerkinState->clustered ) {
+        galerkinState->ambientRadiance.clear();
+    }
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        Patch *patch = scenePatches->get(i);
+        updateShooterQueues(i, patch, galerkinState);
+        if ( !galerkinState->clustered ) {
+            galerkinState->ambientRadiance.addScaled(
+                galerkinState->ambientRadiance,
+                patch->area / GLOBAL_statistics.totalArea,
+                patch->radianceData->unShotRadiance[0]);
         }
     }
+}
+
+/**
+Discards the shooter queues, when the un-shot radiance and potential were set
+otherwise than by shooting (initialization, reading a checkpoint)
+*/
+void
+ShootingStrategy::clearShooterQueues(GalerkinState *galerkinState) {
+    delete galerkinState->powerShooterQueue;
+    galerkinState->powerShooterQueue = nullptr;
+    delete galerkinState->importanceShooterQueue;
+    galerkinState->importanceShooterQueue = nullptr;
+    delete galerkinState->potentialShooterQueue;
+    galerkinState->potentialShooterQueue = nullptr;
+    delete[] galerkinState->shooterIndexByPatchId;
+    galerkinState->shooterIndexByPatchId = nullptr;
+    galerkinState->numberOfShooterPatchIds = 0;
+    delete[] galerkinState->shooterUnShotPower;
+    galerkinState->shooterUnShotPower = nullptr;
+    galerkinState->totalUnShotPower = 0.0;
+}
 
-    if ( galerkinState->importanceDriven && pot_shooting_patch ) {
-        return pot_shooting_patch;
+/**
+Adds the element to the receivers of the shooting step, once. Radiance received on
+a surface is handled from the toplevel element of its patch
+*/
+void
+ShootingStrategy::addReceiver(GalerkinElement *element, java::ArrayList<GalerkinElement *> *receivers) {
+    if ( !element->isCluster() ) {
+        element = galerkinGetElement(element->patch);
+    }
+    if ( !(element->flags & ElementFlags::SHOOTING_RECEIVER_MASK) ) {
+        element->flags |= ElementFlags::SHOOTING_RECEIVER_MASK;
+        receivers->add(element);
+    }
+}
+
+/**
+Collects the receivers of the links of the shooting element and its sub-elements,
+where the links of a shooting patch are kept
+*/
+void
+ShootingStrategy::collectReceivers(
+    const GalerkinElement *sourceElement,
+    java::ArrayList<GalerkinElement *> *receivers)
+{
+    for ( int i = 0; sourceElement->interactions != nullptr && i < sourceElement->interactions->size(); i++ ) {
+        addReceiver(sourceElement->interactions->get(i)->receiverElement, receivers);
+    }
+
+    if ( sourceElement->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            collectReceivers((GalerkinElement *)sourceElement->regularSubElements[i], receivers);
+        }
+    }
+
+    for ( int i = 0; sourceElement->irregularSubElements != nullptr && i < sourceElement->irregularSubElements->size(); i++ ) {
+        collectReceivers((GalerkinElement *)sourceElement->irregularSubElements->get(i), receivers);
     }
-    return shooting_patch;
 }
 
 void
@@ -81,7 +176,8 @@ void
 ShootingStrategy::patchPropagateUnShotRadianceAndPotential(
     const Scene *scene,
     const Patch *patch,
-    GalerkinState *galerkinState)
+    GalerkinState *galerkinState,
+    java::ArrayList<GalerkinElement *> *receivers)
 {
     GalerkinElement *topLevelElement = galerkinGetElement(patch);
 
@@ -104,8 +200,16 @@ ShootingStrategy::patchPropagateUnShotRadianceAndPotential(
         scene,
         topLevelElement,
         galerkinState);
+    collectReceivers(topLevelElement, receivers);
+    addReceiver(topLevelElement, receivers);
 
     // Clear the un-shot radiance at all levels
+    if ( !galerkinState->clustered ) {
+        galerkinState->ambientRadiance.addScaled(
+            galerkinState->ambientRadiance,
+            -topLevelElement->area / GLOBAL_statistics.totalArea,
+            topLevelElement->unShotRadiance[0]);
+    }
     clearUnShotRadianceAndPotential(topLevelElement);
 }
 
@@ -146,64 +250,136 @@ ShootingStrategy::shootingPushPullPotential(GalerkinElement *element, float down
     return up;
 }
 
+/**
+Push-pull of the radiance and potential received in the hierarchy below the
+element. With clustering, what is pulled up to the element is also added to the
+clusters containing it. Without, the ambient radiance is updated for the change
+in un-shot radiance of the patch
+*/
 void
-ShootingStrategy::patchUpdateRadianceAndPotential(const Patch *patch, GalerkinState *galerkinState) {
-    GalerkinElement *topLevelElement = galerkinGetElement(patch);
+ShootingStrategy::elementUpdateRadianceAndPotential(GalerkinElement *element, GalerkinState *galerkinState) {
     if ( galerkinState->importanceDriven ) {
-        shootingPushPullPotential(topLevelElement, 0.0f);
+        float up = shootingPushPullPotential(element, 0.0f);
+        const GalerkinElement *child = element;
+        for ( GalerkinElement *parent = (GalerkinElement *)element->parent;
+              galerkinState->clustered && parent != nullptr;
+              parent = (GalerkinElement *)parent->parent ) {
+            up *= child->area / parent->area;
+            parent->potential += up;
+            parent->unShotPotential += up;
+            child = parent;
+        }
     }
-    basisGalerkinPushPullRadiance(topLevelElement, galerkinState);
 
-    galerkinState->ambientRadiance.addScaled(
-        galerkinState->ambientRadiance,
-        patch->area,
-        patch->radianceData->unShotRadiance[0]);
+    if ( galerkinState->clustered ) {
+        basisGalerkinShootingPushPullRadiance(element, galerkinState);
+    } else {
+        float areaFraction = element->area / GLOBAL_statistics.totalArea;
+        galerkinState->ambientRadiance.addScaled(galerkinState->ambientRadiance, -areaFraction, element->unShotRadiance[0]);
+        basisGalerkinPushPullRadiance(element, galerkinState);
+        galerkinState->ambientRadiance.addScaled(galerkinState->ambientRadiance, areaFraction, element->unShotRadiance[0]);
+    }
 }
 
+/**
+Updates the shooter queue keys, and the colors if asked, of the patches in the
+hierarchy below the element
+*/
 void
-ShootingStrategy::doPropagate(const Scene *scene, const Patch *shootingPatch, GalerkinState *galerkinState) {
-    // Propagate the un-shot power of the shooting patch into the environment
-    patchPropagateUnShotRadianceAndPotential(scene, shootingPatch, galerkinState);
+ShootingStrategy::updatePatches(const GalerkinElement *element, bool recomputeColors, GalerkinState *galerkinState) {
+    if ( element->isCluster() ) {
+        for ( int i = 0; element->irregularSubElements != nullptr && i < element->irregularSubElements->size(); i++ ) {
+            updatePatches((GalerkinElement *)element->irregularSubElements->get(i), recomputeColors, galerkinState);
+        }
+        return;
+    }
 
-    // Recompute the colors of all patches, not only the patches that received
-    // radiance from the shooting patch, since the ambient term has also changed
-    if ( galerkinState->clustered ) {
-        if ( galerkinState->importanceDriven ) {
-            shootingPushPullPotential(galerkinState->topCluster, 0.0);
+    Patch *patch = element->patch;
+    if ( recomputeColors ) {
+        GalerkinRadianceMethod::recomputePatchColor(patch);
+    }
+    if ( (int)patch->id < galerkinState->numberOfShooterPatchIds && galerkinState->shooterIndexByPatchId[patch->id] >= 0 ) {
+        updateShooterQueues(galerkinState->shooterIndexByPatchId[patch->id], patch, galerkinState);
+    }
+}
+
+/**
+Makes the hierarchical representation of radiance and potential consistent again
+after shooting, and updates the colors and shooter queue keys. Only the receivers
+of the shooting patches and the shooting patches themselves changed, so only they
+are visited, except for the colors of all patches when they include the ambient
+radiance, which changes with every step
+*/
+void
+ShootingStrategy::updateAfterPropagation(
+    const Scene *scene,
+    GalerkinState *galerkinState,
+    const java::ArrayList<GalerkinElement *> *receivers)
+{
+    // Receivers inside a cluster that received as well are handled with that cluster
+    java::ArrayList<GalerkinElement *> outermostReceivers;
+    for ( int i = 0; i < receivers->size(); i++ ) {
+        GalerkinElement *receiver = receivers->get(i);
+        bool inReceivingCluster = false;
+        for ( const Element *parent = receiver->parent;
+              galerkinState->clustered && parent != nullptr && !inReceivingCluster;
+              parent = parent->parent ) {
+            inReceivingCluster = (parent->flags & ElementFlags::SHOOTING_RECEIVER_MASK) != 0;
         }
-        basisGalerkinPushPullRadiance(galerkinState->topCluster, galerkinState);
-        galerkinState->ambientRadiance = galerkinState->topCluster->unShotRadiance[0];
-    } else {
-        galerkinState->ambientRadiance.clear();
-        for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
-            patchUpdateRadianceAndPotential(scene->patchList->get(i), galerkinState);
+        if ( !inReceivingCluster ) {
+            outermostReceivers.add(receiver);
         }
-        galerkinState->ambientRadiance.scale(1.0f / GLOBAL_statistics.totalArea);
+    }
+    for ( int i = 0; i < receivers->size(); i++ ) {
+        receivers->get(i)->flags &= ~ElementFlags::SHOOTING_RECEIVER_MASK;
+    }
+
+    for ( int i = 0; i < outermostReceivers.size(); i++ ) {
+        elementUpdateRadianceAndPotential(outermostReceivers.get(i), galerkinState);
+    }
+    if ( galerkinState->clustered ) {
+        galerkinState->ambientRadiance = galerkinState->topCluster->unShotRadiance[0];
     }
 
-    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
-        GalerkinRadianceMethod::recomputePatchColor(scene->patchList->get(i));
+    for ( int i = 0; i < outermostReceivers.size(); i++ ) {
+        updatePatches(outermostReceivers.get(i), !galerkinState->useAmbientRadiance, galerkinState);
+    }
+    if ( galerkinState->useAmbientRadiance ) {
+        for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+            GalerkinRadianceMethod::recomputePatchColor(scene->patchList->get(i));
+        }
     }
 }
 
+/**
+Shoots the un-shot power of the patches with the most of it: up to
+-gr-shooting-batch patches before the hierarchy is made consistent again. Returns
+true when there is no un-shot power left
+*/
 bool
 ShootingStrategy::propagateRadiance(const Scene *scene, GalerkinState *galerkinState) {
-    // Choose a shooting patch. also accumulates the total un-shot power into
-    // galerkinState->ambientRadiance
-    const Patch *shootingPatch = chooseRadianceShootingPatch(scene->patchList, galerkinState);
-    if ( !shootingPatch ) {
+    if ( galerkinState->powerShooterQueue == nullptr ) {
+        refreshShooterQueues(scene->patchList, galerkinState);
+    }
+
+    IndexedMaxHeap *queue = galerkinState->powerShooterQueue;
+    if ( galerkinState->importanceDriven && !galerkinState->importanceShooterQueue->isEmpty() ) {
+        queue = galerkinState->importanceShooterQueue;
+    }
+    if ( queue->isEmpty() ) {
         return true;
     }
 
     ColorRgb yellow = {1.0, 1.0, 0.0};
+    java::ArrayList<GalerkinElement *> receivers;
     openGlRenderSetColor(&yellow);
-    openGlRenderPatchOutline(shootingPatch);
-
-    doPropagate(
-        scene,
-        shootingPatch,
-        galerkinState);
+    for ( int i = 0; i < galerkinState->shootingBatchSize && !queue->isEmpty(); i++ ) {
+        const Patch *shootingPatch = scene->patchList->get(queue->pop());
+        openGlRenderPatchOutline(shootingPatch);
+        patchPropagateUnShotRadianceAndPotential(scene, shootingPatch, galerkinState, &receivers);
+    }
 
+    updateAfterPropagation(scene, galerkinState, &receivers);
     return false;
 }
 
@@ -228,38 +404,26 @@ ShootingStrategy::clusterUpdatePotential(GalerkinElement *clusterElement) {
 }
 
 /**
-Chooses the patch with highest un-shot importance (potential times
-area), see Bekaert & Willems, EGRW'95 (Dublin)
+Shoots the un-shot importance of the patch with the most of it (potential
+times area), see Bekaert & Willems, EGRW'95 (Dublin)
 */
-Patch *
-ShootingStrategy::choosePotentialShootingPatch(const java::ArrayList<Patch *> *scenePatches) {
-    float maximumImportance = 0.0f;
-    Patch *shootingPatch = nullptr;
-
-    for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
-        Patch *patch = scenePatches->get(i);
-        float imp = patch->area * java::Math::abs(galerkinGetUnShotPotential(patch));
-
-        if ( imp > maximumImportance ) {
-            shootingPatch = patch;
-            maximumImportance = imp;
-        }
-    }
-
-    return shootingPatch;
-}
-
 void
 ShootingStrategy::propagatePotential(const Scene *scene, GalerkinState *galerkinState) {
-    const Patch *shootingPatch;
+    if ( galerkinState->powerShooterQueue == nullptr ) {
+        refreshShooterQueues(scene->patchList, galerkinState);
+    }
 
-    shootingPatch = choosePotentialShootingPatch(scene->patchList);
-    if ( shootingPatch ) {
+    int shootingPatchIndex = galerkinState->potentialShooterQueue->pop();
+    if ( shootingPatchIndex >= 0 ) {
+        const Patch *shootingPatch = scene->patchList->get(shootingPatchIndex);
         ColorRgb white = {1.0, 1.0, 1.0};
 
+        java::ArrayList<GalerkinElement *> receivers;
+
         openGlRenderSetColor(&white);
         openGlRenderPatchOutline(shootingPatch);
-        doPropagate(scene, shootingPatch, galerkinState);
+        patchPropagateUnShotRadianceAndPotential(scene, shootingPatch, galerkinState, &receivers);
+        updateAfterPropagation(scene, galerkinState, &receivers);
     } else {
         fprintf(stderr, "No patches with un-shot potential??\n");
     }
@@ -301,6 +465,7 @@ ShootingStrategy::doShootingStep(Scene *scene, GalerkinState *galerkinState, con
             if ( galerkinState->clustered ) {
                 clusterUpdatePotential(galerkinState->topCluster);
             }
+            refreshShooterQueues(scene->patchList, galerkinState);
         }
         propagatePotential(scene, galerkinState);
     }
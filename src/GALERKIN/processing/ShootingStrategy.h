@@ -13,6 +13,12 @@ Reference:
 
 /**
 See [COHE1993].5.3.3. section
+
+The patches to shoot next are taken from indexed max heaps on their un-shot
+power (and importance), instead of being searched for among all patches. After
+each step only the receivers of the shooting patches, found through the links kept
+with the shooting patches, are made consistent again and get new keys, so a step
+costs in proportion to the links of the shooting patches rather than to the scene
 */
 class ShootingStrategy {
   private:
@@ -26,8 +32,17 @@ class ShootingStrategy {
         return ((GalerkinElement *)(patch->radianceData))->unShotPotential;
     }
 
-    static Patch *
-    chooseRadianceShootingPatch(const java::ArrayList<Patch *> *scenePatches, const GalerkinState *galerkinState);
+    static void
+    updateShooterQueues(int patchIndex, Patch *patch, GalerkinState *galerkinState);
+
+    static void
+    refreshShooterQueues(const java::ArrayList<Patch *> *scenePatches, GalerkinState *galerkinState);
+
+    static void
+    addReceiver(GalerkinElement *element, java::ArrayList<GalerkinElement *> *receivers);
+
+    static void
+    collectReceivers(const GalerkinElement *sourceElement, java::ArrayList<GalerkinElement *> *receivers);
 
     static void
     clearUnShotRadianceAndPotential(GalerkinElement *elem);
@@ -36,16 +51,23 @@ class ShootingStrategy {
     patchPropagateUnShotRadianceAndPotential(
         const Scene *scene,
         const Patch *patch,
-        GalerkinState *galerkinState);
+        GalerkinState *galerkinState,
+        java::ArrayList<GalerkinElement *> *receivers);
 
     static float
     shootingPushPullPotential(GalerkinElement *element, float down);
 
     static void
-    patchUpdateRadianceAndPotential(const Patch *patch, GalerkinState *galerkinState);
+    elementUpdateRadianceAndPotential(GalerkinElement *element, GalerkinState *galerkinState);
+
+    static void
+    updatePatches(const GalerkinElement *element, bool recomputeColors, GalerkinState *galerkinState);
 
     static void
-    doPropagate(const Scene *scene, const Patch *shootingPatch, GalerkinState *galerkinState);
+    updateAfterPropagation(
+        const Scene *scene,
+        GalerkinState *galerkinState,
+        const java::ArrayList<GalerkinElement *> *receivers);
 
     static bool
     propagateRadiance(const Scene *scene, GalerkinState *galerkinState);
@@ -53,15 +75,13 @@ class ShootingStrategy {
     static void
     clusterUpdatePotential(GalerkinElement *clusterElement);
 
-    static Patch *
-    choosePotentialShootingPatch(const java::ArrayList<Patch *> *scenePatches);
-
     static void propagatePotential(const Scene *scene, GalerkinState *galerkinState);
 
     static void
     shootingUpdateDirectPotential(GalerkinElement *galerkinElement, float potentialIncrement);
 
   public:
+    static void clearShooterQueues(GalerkinState *galerkinState);
     static bool doShootingStep(Scene *scene, GalerkinState *galerkinState, const RenderOptions *renderOptions);
 };
 
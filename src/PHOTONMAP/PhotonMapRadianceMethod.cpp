@@ -4,10 +4,13 @@
 
 #include <cstdlib>
 #include <ctime>
+#include <thread>
 
 #include "java/util/ArrayList.txx"
+#include "java/lang/Math.h"
 #include "common/ColorRgb.h"
 #include "common/error.h"
+#include "common/ThreadRandom.h"
 #include "skin/Patch.h"
 #include "render/opengl.h"
 #include "raycasting/common/Raytracer.h"
@@ -20,6 +23,7 @@
 #include "raycasting/bidirectionalRaytracing/LightDirSampler.h"
 #include "raycasting/raytracing/bsdfsampler.h"
 #include "raycasting/raytracing/samplertools.h"
+#include "raycasting/raytracing/ScreenSplatList.h"
 #include "PHOTONMAP/photonmapsampler.h"
 #include "PHOTONMAP/screensampler.h"
 #include "PHOTONMAP/photonmap.h"
@@ -36,6 +40,112 @@ static bool globalDoingLocalRayCasting = false;
 
 #define STRING_LENGTH 1000
 
+static const int INITIAL_STORE_CAPACITY = 1024;
+
+/**
+Photons and screen additions of the paths traced by one thread. They are added to
+the photon map and the screen buffer in thread order when all threads are done, so
+the maps only depend on the number of threads
+*/
+class PhotonMapThreadStore {
+  public:
+    PhotonMapConfig *config;
+    CPhoton *photons;
+    Vector3D *normals;
+    short *flags;
+    int numberOfPhotons;
+    int capacity;
+    ScreenSplatList *splats;
+    long rayCount;
+
+    PhotonMapThreadStore();
+    ~PhotonMapThreadStore();
+
+    void add(const CPhoton &photon, const Vector3D &normal, short photonFlags);
+};
+
+PhotonMapThreadStore::PhotonMapThreadStore():
+    config(),
+    photons(),
+    normals(),
+    flags(),
+    numberOfPhotons(),
+    capacity(),
+    splats(),
+    rayCount()
+{
+    splats = new ScreenSplatList();
+}
+
+PhotonMapThreadStore::~PhotonMapThreadStore() {
+    delete[] photons;
+    delete[] normals;
+    delete[] flags;
+    delete splats;
+}
+
+void
+PhotonMapThreadStore::add(const CPhoton &photon, const Vector3D &normal, short photonFlags) {
+    if ( numberOfPhotons == capacity ) {
+        int newCapacity = capacity > 0 ? 2 * capacity : INITIAL_STORE_CAPACITY;
+        CPhoton *newPhotons = new CPhoton[newCapacity];
+        Vector3D *newNormals = new Vector3D[newCapacity];
+        short *newFlags = new short[newCapacity];
+        for ( int i = 0; i < numberOfPhotons; i++ ) {
+            newPhotons[i] = photons[i];
+            newNormals[i] = normals[i];
+            newFlags[i] = flags[i];
+        }
+        delete[] photons;
+        delete[] normals;
+        delete[] flags;
+        photons = newPhotons;
+        normals = newNormals;
+        flags = newFlags;
+        capacity = newCapacity;
+    }
+
+    photons[numberOfPhotons] = photon;
+    normals[numberOfPhotons] = normal;
+    flags[numberOfPhotons] = photonFlags;
+    numberOfPhotons++;
+}
+
+/**
+Shared state of the photon paths traced on several threads. Thread i traces a
+contiguous range of the paths, with its own samplers, path nodes and random numbers
+*/
+class PhotonMapTracingJob {
+  public:
+    Camera *camera;
+    AccelerationStructure *sceneWorldAccelerationStructure;
+    Background *sceneBackground;
+    const RadianceMethod *radianceMethod;
+    char bsdfFlags;
+    int numberOfPaths;
+    int numberOfThreads;
+    unsigned long long seed;
+    PhotonMapThreadStore **stores; // One per thread
+
+    PhotonMapTracingJob();
+};
+
+PhotonMapTracingJob::PhotonMapTracingJob():
+    camera(),
+    sceneWorldAccelerationStructure(),
+    sceneBackground(),
+    radianceMethod(),
+    bsdfFlags(),
+    numberOfPaths(),
+    numberOfThreads(),
+    seed(),
+    stores()
+{
+}
+
+// Store of the calling thread while tracing photon paths on several threads
+static thread_local PhotonMapThreadStore *globalThreadStore = nullptr;
+
 PhotonMapRadianceMethod::PhotonMapRadianceMethod() {
     GLOBAL_photonMap_state.setDefaults();
     className = PHOTON_MAP;
@@ -92,6 +202,36 @@ photonMapChooseSurfaceSampler(CSurfaceSampler **samplerPtr) {
     }
 }
 
+/**
+Creates the eye and light path samplers of a configuration
+*/
+static void
+photonMapInitSamplers(PhotonMapConfig *config) {
+    CSamplerConfig *cfg = &config->eyeConfig;
+
+    cfg->pointSampler = new CEyeSampler;
+
+    cfg->dirSampler = new ScreenSampler;
+
+    photonMapChooseSurfaceSampler(&cfg->surfaceSampler);
+    cfg->surfaceSampler->SetComputeFromNextPdf(false);
+    cfg->neSampler = nullptr;
+
+    cfg->minDepth = 1;
+    cfg->maxDepth = 1;  // Only eye point needed, for Particle tracing test
+
+    cfg = &config->lightConfig;
+
+    cfg->pointSampler = new UniformLightSampler;
+    cfg->dirSampler = new LightDirSampler;
+    photonMapChooseSurfaceSampler(&cfg->surfaceSampler);
+    // cfg->surfaceSampler = new CPhotonMapSampler; //new CBsdfSampler;
+    cfg->surfaceSampler->SetComputeFromNextPdf(false);  // Only 1 pdf
+
+    cfg->minDepth = GLOBAL_photonMap_state.minimumLightPathDepth;
+    cfg->maxDepth = GLOBAL_photonMap_state.maximumLightPathDepth;
+}
+
 /**
 Initializes the computations for the current scene (if any)
 */
@@ -120,29 +260,7 @@ PhotonMapRadianceMethod::initialize(Scene *scene) {
     GLOBAL_photonMap_config.lightConfig.releaseVars();
     GLOBAL_photonMap_config.eyeConfig.releaseVars();
 
-    CSamplerConfig *cfg = &GLOBAL_photonMap_config.eyeConfig;
-
-    cfg->pointSampler = new CEyeSampler;
-
-    cfg->dirSampler = new ScreenSampler;
-
-    photonMapChooseSurfaceSampler(&cfg->surfaceSampler);
-    cfg->surfaceSampler->SetComputeFromNextPdf(false);
-    cfg->neSampler = nullptr;
-
-    cfg->minDepth = 1;
-    cfg->maxDepth = 1;  // Only eye point needed, for Particle tracing test
-
-    cfg = &GLOBAL_photonMap_config.lightConfig;
-
-    cfg->pointSampler = new UniformLightSampler;
-    cfg->dirSampler = new LightDirSampler;
-    photonMapChooseSurfaceSampler(&cfg->surfaceSampler);
-    // cfg->surfaceSampler = new CPhotonMapSampler; //new CBsdfSampler;
-    cfg->surfaceSampler->SetComputeFromNextPdf(false);  // Only 1 pdf
-
-    cfg->minDepth = GLOBAL_photonMap_state.minimumLightPathDepth;
-    cfg->maxDepth = GLOBAL_photonMap_state.maximumLightPathDepth;
+    photonMapInitSamplers(&GLOBAL_photonMap_config);
 
     GLOBAL_raytracer_rayCount = 0;
 
@@ -279,7 +397,7 @@ does not give correct display
 static void
 photonMapDoScreenNEE(
     Camera *camera,
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     PhotonMapConfig *config,
     const RadianceMethod *radianceMethod)
 {
@@ -298,7 +416,7 @@ photonMapDoScreenNEE(
     // the camera. At the same time the pixel hit is computed
     if ( eyeNodeVisible(
             camera,
-            sceneWorldVoxelGrid,
+            sceneWorldAccelerationStructure,
             bp->m_eyeEndNode,
             bp->m_lightEndNode,
             &pixX,
@@ -320,7 +438,11 @@ photonMapDoScreenNEE(
 
         f.scale(factor);
 
-        config->screen->add(nx, ny, f);
+        if ( globalThreadStore != nullptr ) {
+            globalThreadStore->splats->add(nx, ny, f);
+        } else {
+            config->screen->add(nx, ny, f);
+        }
     }
 }
 
@@ -353,6 +475,10 @@ photonMapDoPhotonStore(
             }
 
             if ( GLOBAL_photonMap_state.densityControl == PhotonMapDensityControlOption::NO_DENSITY_CONTROL ) {
+                if ( globalThreadStore != nullptr ) {
+                    globalThreadStore->add(photon, node->m_hit.getNormal(), flags);
+                    return true;
+                }
                 return GLOBAL_photonMap_config.currentMap->addPhoton(photon, node->m_hit.getNormal(), flags);
             } else {
                 float reqDensity;
@@ -378,7 +504,7 @@ Handle one path : store at all end positions and for testing, connect to the eye
 static void
 photonMapHandlePath(
     Camera *camera,
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     PhotonMapConfig *config,
     const RadianceMethod *radianceMethod)
 {
@@ -409,7 +535,7 @@ photonMapHandlePath(
             if ( bp->m_lightSize > 1 && photonMapDoPhotonStore(camera, currentNode, accPower) ) {
                 // Screen next event estimation for testing
                 bp->m_lightEndNode = currentNode;
-                photonMapDoScreenNEE(camera, sceneWorldVoxelGrid, config, radianceMethod);
+                photonMapDoScreenNEE(camera, sceneWorldAccelerationStructure, config, radianceMethod);
             }
         } else {
             // Caustic map...
@@ -418,7 +544,7 @@ photonMapHandlePath(
                 // Screen next event estimation for testing
 
                 bp->m_lightEndNode = currentNode;
-                photonMapDoScreenNEE(camera, sceneWorldVoxelGrid, config, radianceMethod);
+                photonMapDoScreenNEE(camera, sceneWorldAccelerationStructure, config, radianceMethod);
             }
         }
 
@@ -438,20 +564,20 @@ photonMapHandlePath(
 static void
 photonMapTracePath(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     PhotonMapConfig *config,
     char bsdfFlags) {
-    config->biPath.m_eyePath = config->eyeConfig.tracePath(camera, sceneVoxelGrid, sceneBackground, config->biPath.m_eyePath);
+    config->biPath.m_eyePath = config->eyeConfig.tracePath(camera, sceneAccelerationStructure, sceneBackground, config->biPath.m_eyePath);
 
     // Use qmc for light sampling
     SimpleRaytracingPathNode *path = config->biPath.m_lightPath;
 
     // First node
-    double x1 = drand48(); // nrs[0] * RECIP
-    double x2 = drand48(); // nrs[1] * RECIP
+    double x1 = ThreadRandom::nextDouble(); // nrs[0] * RECIP
+    double x2 = ThreadRandom::nextDouble(); // nrs[1] * RECIP
 
-    path = config->lightConfig.traceNode(camera, sceneVoxelGrid, sceneBackground, path, x1, x2, bsdfFlags);
+    path = config->lightConfig.traceNode(camera, sceneAccelerationStructure, sceneBackground, path, x1, x2, bsdfFlags);
     if ( path == nullptr ) {
         return;
     }
@@ -462,36 +588,194 @@ photonMapTracePath(
 
     // Second node
     SimpleRaytracingPathNode *node = path->next();
-    x1 = drand48(); // nrs[2] * RECIP
-    x2 = drand48(); // nrs[3] * RECIP // 4D Niederreiter...
+    x1 = ThreadRandom::nextDouble(); // nrs[2] * RECIP
+    x2 = ThreadRandom::nextDouble(); // nrs[3] * RECIP // 4D Niederreiter...
 
-    if ( config->lightConfig.traceNode(camera, sceneVoxelGrid, sceneBackground, node, x1, x2, bsdfFlags) ) {
+    if ( config->lightConfig.traceNode(camera, sceneAccelerationStructure, sceneBackground, node, x1, x2, bsdfFlags) ) {
         // Successful trace
         node->ensureNext();
-        config->lightConfig.tracePath(camera, sceneVoxelGrid, sceneBackground, node->next(), bsdfFlags);
+        config->lightConfig.tracePath(camera, sceneAccelerationStructure, sceneBackground, node->next(), bsdfFlags);
     }
 }
 
+static void
+photonMapDeletePath(SimpleRaytracingPathNode *node) {
+    while ( node != nullptr ) {
+        SimpleRaytracingPathNode *next = node->next();
+        delete node;
+        node = next;
+    }
+}
+
+static void
+photonMapTracePathsWorker(PhotonMapTracingJob *job, int threadIndex) {
+    PhotonMapThreadStore *store = job->stores[threadIndex];
+    int firstPath = (int)((long)job->numberOfPaths * threadIndex / job->numberOfThreads);
+    int lastPath = (int)((long)job->numberOfPaths * (threadIndex + 1) / job->numberOfThreads);
+    long raysBefore = GLOBAL_raytracer_rayCount;
+
+    globalThreadStore = store;
+    store->splats->setTile(threadIndex);
+    ThreadRandom::useOwnState(job->seed + (unsigned long long)threadIndex);
+
+    for ( int i = firstPath; i < lastPath; i++ ) {
+        photonMapTracePath(job->camera, job->sceneWorldAccelerationStructure, job->sceneBackground, store->config, job->bsdfFlags);
+        photonMapHandlePath(job->camera, job->sceneWorldAccelerationStructure, store->config, job->radianceMethod);
+    }
+
+    ThreadRandom::useProcessState();
+    globalThreadStore = nullptr;
+    store->rayCount = GLOBAL_raytracer_rayCount - raysBefore;
+}
+
+/**
+Photon paths can be traced on several threads when photons are stored without
+density control, which would make storing a photon depend on the ones stored before
+*/
+static bool
+photonMapCanUseThreads() {
+    return GLOBAL_photonMap_state.numberOfThreads > 1
+        && GLOBAL_photonMap_state.densityControl == PhotonMapDensityControlOption::NO_DENSITY_CONTROL;
+}
+
+/**
+Traces the paths on GLOBAL_photonMap_state.numberOfThreads threads (the calling one
+included). The photons found by each thread are added to the current map in thread
+order afterwards
+*/
+static void
+photonMapTracePathsThreaded(PhotonMapTracingJob *job) {
+    int numberOfThreads = job->numberOfThreads;
+
+    // Each call gets new streams, following the process wide sequence
+    job->seed = (unsigned long long)(drand48() * 281474976710656.0);
+
+    job->stores = new PhotonMapThreadStore *[numberOfThreads];
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        PhotonMapThreadStore *store = new PhotonMapThreadStore();
+        PhotonMapConfig *threadConfig = new PhotonMapConfig();
+
+        photonMapInitSamplers(threadConfig);
+        threadConfig->importanceMap = GLOBAL_photonMap_config.importanceMap;
+        threadConfig->importanceCMap = GLOBAL_photonMap_config.importanceCMap;
+        threadConfig->globalMap = GLOBAL_photonMap_config.globalMap;
+        threadConfig->causticMap = GLOBAL_photonMap_config.causticMap;
+        threadConfig->currentMap = GLOBAL_photonMap_config.currentMap;
+        threadConfig->currentImpMap = GLOBAL_photonMap_config.currentImpMap;
+        threadConfig->screen = GLOBAL_photonMap_config.screen; // Only read while tracing
+        store->config = threadConfig;
+        job->stores[i] = store;
+    }
+
+    std::thread **workers = new std::thread *[numberOfThreads];
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(photonMapTracePathsWorker, job, i);
+    }
+    photonMapTracePathsWorker(job, 0);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
+
+    ScreenSplatList **splats = new ScreenSplatList *[numberOfThreads];
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        PhotonMapThreadStore *store = job->stores[i];
+
+        GLOBAL_photonMap_config.currentMap->addPhotons(store->photons, store->normals, store->flags, store->numberOfPhotons);
+        splats[i] = store->splats;
+
+        // Main thread ray count is already on GLOBAL_raytracer_rayCount
+        if ( i > 0 ) {
+            GLOBAL_raytracer_rayCount += store->rayCount;
+        }
+    }
+    ScreenSplatList::replay(splats, numberOfThreads, numberOfThreads, GLOBAL_photonMap_config.screen);
+    delete[] splats;
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        PhotonMapConfig *threadConfig = job->stores[i]->config;
+
+        threadConfig->lightConfig.releaseVars();
+        threadConfig->eyeConfig.releaseVars();
+        photonMapDeletePath(threadConfig->biPath.m_eyePath);
+        photonMapDeletePath(threadConfig->biPath.m_lightPath);
+        delete threadConfig;
+        delete job->stores[i];
+    }
+    delete[] job->stores;
+    job->stores = nullptr;
+}
+
 static void
 photonMapTracePaths(
     Camera *camera,
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     Background *sceneBackground,
     int numberOfPaths,
     char bsdfFlags = BSDF_ALL_COMPONENTS,
     const RadianceMethod *radianceMethod = nullptr)
 {
+    if ( photonMapCanUseThreads() && numberOfPaths > 1 ) {
+        PhotonMapTracingJob job;
+
+        job.camera = camera;
+        job.sceneWorldAccelerationStructure = sceneWorldAccelerationStructure;
+        job.sceneBackground = sceneBackground;
+        job.radianceMethod = radianceMethod;
+        job.bsdfFlags = bsdfFlags;
+        job.numberOfPaths = numberOfPaths;
+        job.numberOfThreads = java::Math::min(GLOBAL_photonMap_state.numberOfThreads, numberOfPaths);
+        photonMapTracePathsThreaded(&job);
+        return;
+    }
+
     // Fill in config structures
     for ( int i = 0; i < numberOfPaths; i++ ) {
-        photonMapTracePath(camera, sceneWorldVoxelGrid, sceneBackground, &GLOBAL_photonMap_config, bsdfFlags);
-        photonMapHandlePath(camera, sceneWorldVoxelGrid, &GLOBAL_photonMap_config, radianceMethod);
+        photonMapTracePath(camera, sceneWorldAccelerationStructure, sceneBackground, &GLOBAL_photonMap_config, bsdfFlags);
+        photonMapHandlePath(camera, sceneWorldAccelerationStructure, &GLOBAL_photonMap_config, radianceMethod);
+    }
+}
+
+static void
+photonMapBalanceWorker(CPhotonMap **maps, int numberOfMaps, int numberOfThreads, int threadIndex) {
+    for ( int i = threadIndex; i < numberOfMaps; i += numberOfThreads ) {
+        maps[i]->doBalancing(GLOBAL_photonMap_state.balanceKDTree);
+        maps[i]->checkNBalance();
+    }
+}
+
+/**
+Balances the global, caustic and importance maps in one step, each map on its own
+thread as far as there are threads. Without threads the maps are balanced when first used
+*/
+static void
+photonMapBalanceMaps() {
+    CPhotonMap *maps[] = {
+        GLOBAL_photonMap_config.globalMap,
+        GLOBAL_photonMap_config.causticMap,
+        GLOBAL_photonMap_config.importanceMap,
+        GLOBAL_photonMap_config.importanceCMap
+    };
+    int numberOfMaps = 4;
+    int numberOfThreads = java::Math::min(GLOBAL_photonMap_state.numberOfThreads, numberOfMaps);
+
+    std::thread **workers = new std::thread *[numberOfThreads];
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(photonMapBalanceWorker, maps, numberOfMaps, numberOfThreads, i);
     }
+    photonMapBalanceWorker(maps, numberOfMaps, numberOfThreads, 0);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
 }
 
 static void
 photonMapBRRealIteration(
     Camera *camera,
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     Background *sceneBackground,
     const RadianceMethod *radianceMethod)
 {
@@ -512,7 +796,7 @@ photonMapBRRealIteration(
         GLOBAL_photonMap_config.currentMap->setTotalPaths(GLOBAL_photonMap_state.totalIPaths);
         GLOBAL_photonMap_config.importanceCMap->setTotalPaths(GLOBAL_photonMap_state.totalIPaths);
 
-        tracePotentialPaths(camera, sceneWorldVoxelGrid, sceneBackground, (int)GLOBAL_photonMap_state.iPathsPerIteration);
+        tracePotentialPaths(camera, sceneWorldAccelerationStructure, sceneBackground, (int)GLOBAL_photonMap_state.iPathsPerIteration);
 
         fprintf(stderr, "Total potential paths : %li, Total rays %li\n",
                 GLOBAL_photonMap_state.totalIPaths,
@@ -531,7 +815,7 @@ photonMapBRRealIteration(
 
         photonMapTracePaths(
                 camera,
-                sceneWorldVoxelGrid,
+                sceneWorldAccelerationStructure,
                 sceneBackground,
                 (int)GLOBAL_photonMap_state.gPathsPerIteration,
                 BSDF_ALL_COMPONENTS,
@@ -553,7 +837,7 @@ photonMapBRRealIteration(
 
         photonMapTracePaths(
             camera,
-            sceneWorldVoxelGrid,
+            sceneWorldAccelerationStructure,
             sceneBackground,
             (int)GLOBAL_photonMap_state.cPathsPerIteration,
             BSDF_SPECULAR_COMPONENT);
@@ -561,6 +845,10 @@ photonMapBRRealIteration(
         fprintf(stderr, "Caustic map: ");
         GLOBAL_photonMap_config.causticMap->printStats(stderr);
     }
+
+    if ( photonMapCanUseThreads() ) {
+        photonMapBalanceMaps();
+    }
 }
 
 /**
@@ -573,7 +861,7 @@ bool
 PhotonMapRadianceMethod::doStep(Scene *scene, RenderOptions *renderOptions) {
     GLOBAL_photonMap_state.lastClock = clock();
 
-    photonMapBRRealIteration(scene->camera, scene->voxelGrid, scene->background, this);
+    photonMapBRRealIteration(scene->camera, scene->accelerationStructure, scene->background, this);
     photonMapRadiosityUpdateCpuSecs();
 
     GLOBAL_photonMap_state.runStopNumber++;
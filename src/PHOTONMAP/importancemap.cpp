@@ -22,7 +22,7 @@ CImportanceMap::addPhoton(
 
 // reconstruct
 float
-CImportanceMap::reconstructImportance(Vector3D /*pos*/, const Vector3D &normal) const  {
+CImportanceMap::reconstructImportance(const PhotonMapQuery *query, Vector3D /*pos*/, const Vector3D &normal) const  {
     float maxDistance;
     float result = 0.0;
     float importance;
@@ -31,10 +31,10 @@ CImportanceMap::reconstructImportance(Vector3D /*pos*/, const Vector3D &normal)
     // Nearest photons must be found beforehand!
 
     // Construct radiance estimate
-    maxDistance = m_distances[0];
+    maxDistance = query->distances[0];
 
-    for ( int i = 0; i < m_nrpFound; i++ ) {
-        const CImporton *importon = (CImporton *) m_photons[i];
+    for ( int i = 0; i < query->numberOfPhotons; i++ ) {
+        const CImporton *importon = (CImporton *) query->photons[i];
 
         Vector3D dir = importon->dir();
 
@@ -61,9 +61,14 @@ CImportanceMap::reconstructImportance(Vector3D /*pos*/, const Vector3D &normal)
 }
 
 float
-CImportanceMap::getImpReqDensity(const Camera *camera, const Vector3D &pos, const Vector3D &normal) const {
+CImportanceMap::getImpReqDensity(
+    const PhotonMapQuery *query,
+    const Camera *camera,
+    const Vector3D &pos,
+    const Vector3D &normal) const
+{
     // reconstruct importance
-    float density = reconstructImportance(pos, normal);
+    float density = reconstructImportance(query, pos, normal);
 
     // We want impScale photons per pixel density, account for
     // the pixel area here
@@ -105,14 +110,13 @@ CImportanceMap::getRequiredDensity(const Camera *camera, Vector3D pos, Vector3D
         // normal query or no irradiance photon found
 
         // Query photons, to be used by the appropriate req dest method
-        m_nrpFound = doQuery(&pos);
-
-        if ( m_nrpFound < 3 )
+        PhotonMapQuery query;
+        if ( doQuery(&query, &pos) < 3 )
             return 0; // State for minimumImpRD
 
         switch ( GLOBAL_photonMap_state.importanceOption ) {
             case PhotonMapImportanceOption::USE_IMPORTANCE:
-                density = getImpReqDensity(camera, pos, normal);
+                density = getImpReqDensity(&query, camera, pos, normal);
                 density *= *m_impScalePtr;
                 break;
             default:
@@ -129,6 +133,7 @@ CImportanceMap::getRequiredDensity(const Camera *camera, Vector3D pos, Vector3D
 
 void
 CImportanceMap::ComputeAllRequiredDensities(
+    PhotonMapQuery *query,
     const Camera *camera,
     Vector3D &pos,
     const Vector3D &normal,
@@ -137,13 +142,12 @@ CImportanceMap::ComputeAllRequiredDensities(
     float *diff)
 {
     // Query photons, to be used by the appropriate req dest method
-    m_nrpFound = doQuery(&pos);
-    if ( m_nrpFound < 5 ) {
+    if ( doQuery(query, &pos) < 5 ) {
         // not enough photons
         *imp = *pot = *diff = 0.0;
     }
 
-    *imp = getImpReqDensity(camera, pos, normal);
+    *imp = getImpReqDensity(query, camera, pos, normal);
 }
 
 void
@@ -151,13 +155,14 @@ CImportanceMap::photonPrecomputeIrradiance(Camera *camera, CIrrPhoton *photon) {
     float imp;
     float pot;
     float diff{};
+    PhotonMapQuery query;
     Vector3D pos = photon->pos();
     Vector3D normal = photon->Normal();
 
-    ComputeAllRequiredDensities(camera, pos, normal, &imp, &pot, &diff);
+    ComputeAllRequiredDensities(&query, camera, pos, normal, &imp, &pot, &diff);
 
     // Abuse pot for tail enhancement
-    pot = m_distances[0]; // Only valid since max heap is used in kd-tree
+    pot = query.distances[0]; // Only valid since max heap is used in kd-tree
     m_totalMaxDistance = java::Math::max(pot, m_totalMaxDistance);
 
     ((CImporton *) photon)->PSetAll(imp, pot, diff);
@@ -39,13 +39,19 @@ class CImportanceMap: public CPhotonMap {
     void precomputeIrradiance() override;
 
     // New functions
-    float reconstructImportance(Vector3D, const Vector3D &normal) const;
-    float getImpReqDensity(const Camera *camera, const Vector3D &pos, const Vector3D &normal) const;
+    float reconstructImportance(const PhotonMapQuery *query, Vector3D, const Vector3D &normal) const;
+    float
+    getImpReqDensity(
+        const PhotonMapQuery *query,
+        const Camera *camera,
+        const Vector3D &pos,
+        const Vector3D &normal) const;
     float getRequiredDensity(const Camera *camera, Vector3D pos, Vector3D normal);
 
 protected:
     void
     ComputeAllRequiredDensities(
+        PhotonMapQuery *query,
         const Camera *camera,
         Vector3D &pos,
         const Vector3D &normal,
@@ -4,6 +4,9 @@ Implementation of specific kdtree for photonmaps
 
 #include "PHOTONMAP/photonkdtree.h"
 
+/**
+State of one nearest photon with similar normal query, on the stack of the caller
+*/
 class NormalQuery {
 public:
     CIrrPhoton *photon;
@@ -15,75 +18,51 @@ public:
     NormalQuery(): photon(), point(), normal(), threshold(), maximumDistance() {};
 };
 
-static NormalQuery qdat_s;
-
-// Distance calculation COPY FROM kdtree.C !
-inline static float sqrDistance3D(const float *a, const float *b) {
-    float result;
-    float tmp;
-
-    tmp = *(a++) - *(b++);
-    result = tmp * tmp;
-
-    tmp = *(a++) - *(b++);
-    result += tmp * tmp;
-
-    tmp = *a - *b;
-    result += tmp * tmp;
-
-    return result;
-}
-
 PhotonKDTree::PhotonKDTree(int dataSize, bool copyData) : KDTree(dataSize, copyData) {
 }
 
 void
-PhotonKDTree::NormalBQuery_rec(const int index) {
-    const BalancedKDTreeNode &node = balancedRootNode[index];
-    int discr = node.discriminator();
+PhotonKDTree::NormalBQuery_rec(const int index, NormalQuery *q) const {
+    if ( index >= numberOfBuckets - 1 ) {
+        // Bucket: test all its photons
+        float distances[KD_MAXIMUM_BUCKET_SIZE];
+        int bucket = index - (numberOfBuckets - 1);
+        int first = bucketStart[bucket];
+        int count = bucketSquaredDistances(bucket, q->point, distances);
+
+        for ( int i = 0; i < count; i++ ) {
+            // Normal constraint
+            if ( distances[i] < q->maximumDistance &&
+                 (((CIrrPhoton *)balancedData[first + i])->Normal().dotProduct(q->normal) > q->threshold) ) {
+                // Replace point if distance < maxdist AND normal is similar
+                q->maximumDistance = distances[i];
+                q->photon = (CIrrPhoton *)balancedData[first + i];
+            }
+        }
+        return;
+    }
 
-    float dist;
+    int discr = splitDiscriminators[index];
+    float dist = splitValues[index] - q->point[discr];
     int nearIndex;
     int farIndex;
 
-    // Recursive call to the child nodes
-
-    // Test discr (reuse distance)
-
-    if ( index < firstLeaf ) {
-        dist = ((float *) node.m_data)[discr] - (qdat_s.point)[discr];
-
-        if ( dist >= 0.0 )  // qdat_s.point[discr] <= ((float *)node->m_data)[discr]
-        {
-            nearIndex = (index << 1) + 1; // node loson
-            farIndex = nearIndex + 1; // node hison
-        } else {
-            farIndex = (index << 1) + 1; // node loson
-            nearIndex = farIndex + 1;// node hison
-        }
-
-        // Always call near node recursively
-
-        if ( nearIndex < numBalanced ) {
-            NormalBQuery_rec(nearIndex);
-        }
-
-        dist *= dist; // Square distance to the separator plane
-        if ((farIndex < numBalanced) && (dist < qdat_s.maximumDistance) ) {
-            // Discriminator line closer than maxdist : nearer positions can lie
-            // on the far side. Or there are still not enough nodes found
-            NormalBQuery_rec(farIndex);
-        }
+    if ( dist >= 0.0 ) {
+        nearIndex = (index << 1) + 1; // Low side
+        farIndex = nearIndex + 1; // High side
+    } else {
+        farIndex = (index << 1) + 1;
+        nearIndex = farIndex + 1;
     }
 
-    dist = sqrDistance3D((float *) node.m_data, qdat_s.point);
+    // Always call near node recursively
+    NormalBQuery_rec(nearIndex, q);
 
-    // Normal constraint
-    if ( dist < qdat_s.maximumDistance &&
-         (((CIrrPhoton *) node.m_data)->Normal().dotProduct(qdat_s.normal) > qdat_s.threshold ) ) {
-        // Replace point if distance < maxdist AND normal is similar
-        qdat_s.maximumDistance = dist;
-        qdat_s.photon = (CIrrPhoton *) node.m_data;
+    dist *= dist; // Square distance to the separator plane
+    if ( dist < q->maximumDistance ) {
+        // Discriminator line closer than maxdist : nearer positions can lie
+        // on the far side
+        NormalBQuery_rec(farIndex, q);
     }
 }
 
@@ -96,18 +75,19 @@ PhotonKDTree::normalPhotonQuery(
     Vector3D *position,
     const Vector3D *normal,
     float threshold,
-    float maxR2)
+    float maxR2) const
 {
-    // Fill qdat_s
-    qdat_s.photon = nullptr;
-    qdat_s.normal = *normal;
-    qdat_s.point = (float *)position;
-    qdat_s.threshold = threshold;
-    qdat_s.maximumDistance = maxR2;
+    NormalQuery normalQuery;
+
+    normalQuery.photon = nullptr;
+    normalQuery.normal = *normal;
+    normalQuery.point = (float *)position;
+    normalQuery.threshold = threshold;
+    normalQuery.maximumDistance = maxR2;
 
-    if ( balancedRootNode && (numberOfNodes > 0) && (numUnbalanced == 0) ) {
+    if ( balancedData && (numberOfNodes > 0) && (numUnbalanced == 0) ) {
         // Find the best photon
-        NormalBQuery_rec(0);
+        NormalBQuery_rec(0, &normalQuery);
     }
-    return qdat_s.photon;
+    return normalQuery.photon;
 }
@@ -8,9 +8,11 @@ Photon kd-tree : specialized kd-tree with some photon map specific additions
 #include "common/dataStructures/KDTree.h"
 #include "PHOTONMAP/photon.h"
 
+class NormalQuery;
+
 class PhotonKDTree final : public KDTree {
   private:
-    void NormalBQuery_rec(int index);
+    void NormalBQuery_rec(int index, NormalQuery *q) const;
 
   public:
     explicit PhotonKDTree(int dataSize, bool copyData = true);
@@ -20,7 +22,7 @@ class PhotonKDTree final : public KDTree {
         Vector3D *position,
         const Vector3D *normal,
         float threshold,
-        float maxR2);
+        float maxR2) const;
 };
 
 #endif
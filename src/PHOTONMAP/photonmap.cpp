@@ -79,7 +79,7 @@ getFalseColor(float val) {
 }
 
 CPhotonMap::CPhotonMap(int *estimate_nrp, bool doPrecomputeIrradiance):
-    m_sample_nrp(), m_nrpCosinePos()
+    m_sample_nrp()
 {
     m_balanced = true;
     m_doBalancing = false;
@@ -101,38 +101,31 @@ CPhotonMap::CPhotonMap(int *estimate_nrp, bool doPrecomputeIrradiance):
 
     m_grid = new CSampleGrid2D(2, 4);
     m_sampleLastPos.set(Numeric::HUGE_FLOAT_VALUE, Numeric::HUGE_FLOAT_VALUE, Numeric::HUGE_FLOAT_VALUE);
-
-    m_photons = new CPhoton *[MAXIMUM_RECON_PHOTONS];
-    m_distances = new float[MAXIMUM_RECON_PHOTONS];
-    m_cosines = new float[MAXIMUM_RECON_PHOTONS];
-
-    m_nrpFound = 0;  // No valid photons in array
-    m_cosinesOk = true;
 }
 
 CPhotonMap::~CPhotonMap() {
     delete m_kdtree;
-    delete[] m_photons;
-    delete[] m_distances;
-    delete[] m_cosines;
 }
 
+/**
+Compute cosines of the photons found with a supplied normal
+*/
 void
-CPhotonMap::computeCosines(const Vector3D normal) {
+PhotonMapQuery::computeCosines(const Vector3D normal) {
     Vector3D dir;
 
-    if ( !m_cosinesOk ) {
-        m_nrpCosinePos = 0;
+    if ( !cosinesOk ) {
+        numberOfPositiveCosines = 0;
 
-        for ( int i = 0; i < m_nrpFound; i++ ) {
-            dir = m_photons[i]->dir();
-            m_cosines[i] = dir.dotProduct(normal);
-            if ( m_cosines[i] > 0 ) {
-                m_nrpCosinePos++;
+        for ( int i = 0; i < numberOfPhotons; i++ ) {
+            dir = photons[i]->dir();
+            cosines[i] = dir.dotProduct(normal);
+            if ( cosines[i] > 0 ) {
+                numberOfPositiveCosines++;
             }
         }
 
-        m_cosinesOk = true;
+        cosinesOk = true;
     }
 }
 
@@ -169,6 +162,29 @@ CPhotonMap::addPhoton(CPhoton &photon, Vector3D normal, short flags) {
     return true;
 }
 
+/**
+Adds photons stored elsewhere first, such as the ones found by the threads tracing
+photon paths. No random numbers are drawn, unlike addPhoton()
+*/
+void
+CPhotonMap::addPhotons(
+    CPhoton *photons,
+    const Vector3D *normals,
+    const short *flags,
+    int numberOfPhotons)
+{
+    for ( int i = 0; i < numberOfPhotons; i++ ) {
+        doAddPhoton(photons[i], normals[i], flags[i]);
+    }
+
+    if ( numberOfPhotons > 0 ) {
+        m_nrPhotons += numberOfPhotons;
+        m_totalPhotons += numberOfPhotons;
+        m_balanced = false;
+        m_irradianceComputed = false;
+    }
+}
+
 double
 ComputeAcceptProb(float currentD, float requiredD) {
     // Step function
@@ -190,9 +206,9 @@ ComputeAcceptProb(float currentD, float requiredD) {
 }
 
 void
-CPhotonMap::redistribute(const CPhoton &photon) const {
+CPhotonMap::redistribute(const PhotonMapQuery *query, const CPhoton &photon) const {
     // redistribute this photon over the nearest neighbours
-    // m_distances, m_photons and m_cosines should be filled correctly!
+    // the distances, photons and cosines of the query should be filled correctly!
     // only photons are used for which direction * normal > 0
 
     // -- Check the flags
@@ -200,14 +216,19 @@ CPhotonMap::redistribute(const CPhoton &photon) const {
 
     ColorRgb deltaPower;
     ColorRgb pow;
-    float factor = 1.0f / (float)m_nrpCosinePos;
+
+    if ( !query->cosinesOk || query->numberOfPositiveCosines == 0 ) {
+        // Too few neighbours found for computing the cosines: the power is ignored
+        return;
+    }
+    float factor = 1.0f / (float)query->numberOfPositiveCosines;
 
     pow = photon.power();
     deltaPower.scaledCopy(factor, pow);
 
-    for ( int i = 0; i < m_nrpFound; i++ ) {
-        if ( m_cosines[i] > 0.0 ) {
-            m_photons[i]->addPower(deltaPower);
+    for ( int i = 0; i < query->numberOfPhotons; i++ ) {
+        if ( query->cosines[i] > 0.0 ) {
+            query->photons[i]->addPower(deltaPower);
         }
     }
 }
@@ -222,9 +243,10 @@ CPhotonMap::DC_AddPhoton(
     // Get current density
     // Vector3D pos = photon.Pos();
     bool stored;
+    PhotonMapQuery query;
 
-    float currentD = getCurrentDensity(hit, GLOBAL_photonMap_state.distribPhotons);
-    // m_photons and m_distances is valid now !!
+    float currentD = getCurrentDensity(&query, hit, GLOBAL_photonMap_state.distribPhotons);
+    // The photons and distances of the query are valid now !!
 
     // Compute acceptance probability
 
@@ -243,7 +265,7 @@ CPhotonMap::DC_AddPhoton(
     } else {
         // redistribute power over neighbours or ignore
         stored = false;
-        redistribute(photon);
+        redistribute(&query, photon);
     }
 
     m_totalPhotons++; // All photons including non stored photons
@@ -255,7 +277,7 @@ CPhotonMap::DC_AddPhoton(
 Get a maximum radius^2 to be used when locating photons
 */
 double
-CPhotonMap::GetMaxR2() {
+CPhotonMap::GetMaxR2() const {
     /* A maximum radius^2 is chosen as follows:
      * The radiance of the reconstruction must be larger
      * than a fraction of the radiance contribution when
@@ -281,16 +303,17 @@ CPhotonMap::photonPrecomputeIrradiance(Camera *camera, CIrrPhoton *photon) {
     irradiance.clear();
 
     // Locate the nearest photons using a max radius limit
+    PhotonMapQuery query;
     Vector3D pos = photon->pos();
-    m_nrpFound = doQuery(&pos);
+    int numberOfPhotons = doQuery(&query, &pos);
 
-    if ( m_nrpFound > 3 ) {
+    if ( numberOfPhotons > 3 ) {
         // Construct irradiance estimate
-        float maxDistance = m_distances[0];
+        float maxDistance = query.distances[0];
 
-        for ( int i = 0; i < m_nrpFound; i++ ) {
-            if ( photon->Normal().dotProduct(m_photons[i]->dir()) > 0 ) {
-                power = m_photons[i]->power();
+        for ( int i = 0; i < numberOfPhotons; i++ ) {
+            if ( photon->Normal().dotProduct(query.photons[i]->dir()) > 0 ) {
+                power = query.photons[i]->power();
                 irradiance.add(irradiance, power);
             }
         }
@@ -393,18 +416,19 @@ CPhotonMap::reconstruct(
     // Normal reconstruct...
 
     // Locate nearest photons using a max radius limit
+    PhotonMapQuery query;
     Vector3D position = hit->getPoint();
-    m_nrpFound = doQuery(&position);
+    int numberOfPhotons = doQuery(&query, &position);
 
-    if ( m_nrpFound < 3 ) {
+    if ( numberOfPhotons < 3 ) {
         return result;
     }
 
     // Construct radiance estimate
-    maxDistance = m_distances[0];
+    maxDistance = query.distances[0];
 
-    for ( int i = 0; i < m_nrpFound; i++ ) {
-        Vector3D dir = m_photons[i]->dir();
+    for ( int i = 0; i < numberOfPhotons; i++ ) {
+        Vector3D dir = query.photons[i]->dir();
 
         if ( bsdf == nullptr ) {
             eval.clear();
@@ -412,7 +436,7 @@ CPhotonMap::reconstruct(
             eval = bsdf->evaluate(
                 hit, inBsdf, outBsdf, &outDir, &dir, BSDF_DIFFUSE_COMPONENT | BSDF_GLOSSY_COMPONENT);
         }
-        power = m_photons[i]->power();
+        power = query.photons[i]->power();
 
         col.scalarProduct(eval, power);
         result.add(result, col);
@@ -429,7 +453,7 @@ CPhotonMap::reconstruct(
 }
 
 float
-CPhotonMap::getCurrentDensity(RayHit &hit, int nrPhotons) {
+CPhotonMap::getCurrentDensity(PhotonMapQuery *query, RayHit &hit, int nrPhotons) const {
     // Find the nearest photons
     if ( nrPhotons == 0 ) {
         nrPhotons = *m_estimate_nrp;
@@ -442,22 +466,20 @@ CPhotonMap::getCurrentDensity(RayHit &hit, int nrPhotons) {
     }
 
     Vector3D position = hit.getPoint();
-    m_nrpFound = doQuery(&position, nrPhotons, (float) GetMaxR2());
-
-    if ( m_nrpFound < 3 ) {
+    if ( doQuery(query, &position, nrPhotons, (float) GetMaxR2()) < 3 ) {
         return 0.0;
     }
 
     // Construct density estimate
-    maxDistance = m_distances[0]; // Only valid since max heap is used in kdtree
+    maxDistance = query->distances[0]; // Only valid since max heap is used in kdtree
 
-    computeCosines(hit.getGeometricNormal()); // Shading normal?
+    query->computeCosines(hit.getGeometricNormal()); // Shading normal?
 
-    if ( m_nrpCosinePos <= 3 ) {
+    if ( query->numberOfPositiveCosines <= 3 ) {
         return 0.0;
     }
 
-    return (float)(m_nrpCosinePos / (M_PI * maxDistance));
+    return (float)(query->numberOfPositiveCosines / (M_PI * maxDistance));
 }
 
 /**
@@ -467,8 +489,9 @@ ColorRgb
 CPhotonMap::getDensityColor(RayHit &hit) {
     float density;
     ColorRgb result;
+    PhotonMapQuery query;
 
-    density = getCurrentDensity(hit, 0);
+    density = getCurrentDensity(&query, hit, 0);
 
     result = getFalseColor(density);
 
@@ -493,15 +516,16 @@ CPhotonMap::sample(
         m_grid->init();
 
         // Find the nearest photons
-        m_nrpFound = doQuery(&position, m_sample_nrp, KD_MAX_RADIUS, NO_IMPSAMP_PHOTON);
+        PhotonMapQuery query;
+        int numberOfPhotons = doQuery(&query, &position, m_sample_nrp, KD_MAX_RADIUS, NO_IMPSAMP_PHOTON);
 
         double pr;
         double ps;
 
-        for ( int i = 0; i < m_nrpFound; i++ ) {
-            m_photons[i]->findRS(&pr, &ps, coord, flag, n);
+        for ( int i = 0; i < numberOfPhotons; i++ ) {
+            query.photons[i]->findRS(&pr, &ps, coord, flag, n);
 
-            color = m_photons[i]->power();
+            color = query.photons[i]->power();
 
             m_grid->add(pr, ps, color.average() / (float)m_nrPhotons);
         }
@@ -14,6 +14,27 @@ bool zeroAlbedo(const PhongBidirectionalScatteringDistributionFunction *bsdf, Ra
 // Convert a value val given a maximum into some nice color
 ColorRgb getFalseColor(float val);
 
+/**
+Result of one nearest photons query on a photon map: the photons found, their
+squared distances (a max heap, so the largest comes first) and, once computed,
+the cosines of their directions with a reconstruction normal. Owned by the
+caller, so lookups leave the map itself unchanged
+*/
+class PhotonMapQuery {
+  public:
+    CPhoton *photons[MAXIMUM_RECON_PHOTONS];
+    float distances[MAXIMUM_RECON_PHOTONS];
+    float cosines[MAXIMUM_RECON_PHOTONS]; // photon dir * reconstruction normal
+    int numberOfPhotons; // Number of photons found
+    int numberOfPositiveCosines; // Number of photons found with dir * normal > 0
+    bool cosinesOk; // Indicates if cosines are computed
+
+    // The arrays are left for the queries to fill
+    PhotonMapQuery(): numberOfPhotons(), numberOfPositiveCosines(), cosinesOk(true) {}
+
+    void computeCosines(Vector3D normal);
+};
+
 class CPhotonMap {
   protected:
     bool m_balanced;
@@ -37,49 +58,34 @@ class CPhotonMap {
     CSampleGrid2D *m_grid;
     Vector3D m_sampleLastPos;
 
-    // Space to hold the photons and distances for queries
-
-    int m_nrpFound; // Number of photons in the array
-    int m_nrpCosinePos; /* Number of photons in the array that have
-			direction * normal > 0, where normal is
-			the supplied reconstruction normal. */
-
-    CPhoton **m_photons;
-    float *m_distances;
-    float *m_cosines; // photon dir * reconstruction normal
-    bool m_cosinesOk; // indicates if cosines are computed
-
     // nearest photon queries must use these functions!
     int
     doQuery(
+        PhotonMapQuery *query,
         Vector3D *position,
         int numberOfPhotons,
         float maximumRadius,
-        short excludeFlags = 0) {
-        m_cosinesOk = false;
-        return m_kdtree->query(
+        short excludeFlags = 0) const {
+        query->cosinesOk = false;
+        query->numberOfPhotons = m_kdtree->query(
             (float *)position,
             numberOfPhotons,
-            m_photons,
-            m_distances,
+            query->photons,
+            query->distances,
             maximumRadius,
             excludeFlags);
+        return query->numberOfPhotons;
     }
 
-    int doQuery(Vector3D *pos) {
-        m_cosinesOk = false;
-        return m_kdtree->query((float *) pos, *m_estimate_nrp /*pmapstate.reconPhotons*/,
-                               m_photons, m_distances, (float) GetMaxR2());
+    int doQuery(PhotonMapQuery *query, Vector3D *pos) const {
+        return doQuery(query, pos, *m_estimate_nrp /*pmapstate.reconPhotons*/, (float) GetMaxR2());
     }
 
     CIrrPhoton *
-    DoIrradianceQuery(Vector3D *position, const Vector3D *normal, float maxR2 = Numeric::HUGE_FLOAT_VALUE) {
+    DoIrradianceQuery(Vector3D *position, const Vector3D *normal, float maxR2 = Numeric::HUGE_FLOAT_VALUE) const {
         return m_kdtree->normalPhotonQuery(position, normal, 0.8f, maxR2);
     }
 
-    // Compute cosines of photons with a supplied normal
-    void computeCosines(Vector3D normal);
-
     // Add a photon taking possible irrPhoton into account
     void doAddPhoton(CPhoton &photon, Vector3D normal, short flags);
 
@@ -91,13 +97,20 @@ class CPhotonMap {
 
     virtual bool addPhoton(CPhoton &photon, Vector3D normal, short flags);
 
+    void
+    addPhotons(
+        CPhoton *photons,
+        const Vector3D *normals,
+        const short *flags,
+        int numberOfPhotons);
+
     bool DC_AddPhoton(CPhoton &photon, RayHit &hit,
                       float requiredD, short flags = 0);
 
-    void redistribute(const CPhoton &photon) const;
+    void redistribute(const PhotonMapQuery *query, const CPhoton &photon) const;
 
     // Get a maximum radius^2 for locating the nearest photons
-    virtual double GetMaxR2();
+    virtual double GetMaxR2() const;
 
     // Precompute irradiance
     virtual void precomputeIrradiance();
@@ -116,7 +129,7 @@ class CPhotonMap {
         const ColorRgb &diffuseAlbedo,
         ColorRgb *result);
 
-    virtual float getCurrentDensity(RayHit &hit, int nrPhotons);
+    virtual float getCurrentDensity(PhotonMapQuery *query, RayHit &hit, int nrPhotons) const;
 
     // Return a color coded density of the photonmap
     virtual ColorRgb getDensityColor(RayHit &hit);
@@ -82,7 +82,7 @@ CPhotonMapSampler::chooseComponent(
 bool
 CPhotonMapSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -124,10 +124,10 @@ CPhotonMapSampler::sample(
     bool ok;
 
     if ( sChosen ) {
-        ok = fresnelSample(sceneVoxelGrid, sceneBackground, prevNode, thisNode, newNode, x2, flags);
+        ok = fresnelSample(sceneAccelerationStructure, sceneBackground, prevNode, thisNode, newNode, x2, flags);
     } else {
         flags = (char)(gdFLAGS & flags);
-        ok = gdSample(camera, sceneVoxelGrid, sceneBackground, prevNode, thisNode, newNode, x1, x2, flags);
+        ok = gdSample(camera, sceneAccelerationStructure, sceneBackground, prevNode, thisNode, newNode, x1, x2, flags);
     }
 
     if ( ok ) {
@@ -320,7 +320,7 @@ chooseFresnelDirection(
 
 bool
 CPhotonMapSampler::fresnelSample(
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     const SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -342,7 +342,7 @@ CPhotonMapSampler::fresnelSample(
     DetermineRayType(thisNode, newNode, &dir);
 
     // Transfer
-    if ( !sampleTransfer(sceneVoxelGrid, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
+    if ( !sampleTransfer(sceneAccelerationStructure, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
         thisNode->m_rayType = PathRayType::STOPS;
         return false;
     }
@@ -375,7 +375,7 @@ CPhotonMapSampler::fresnelSample(
 bool
 CPhotonMapSampler::gdSample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -390,7 +390,7 @@ CPhotonMapSampler::gdSample(
     if ( m_photonMap == nullptr ) {
         // We can just use standard bsdf sampling
         ok = CBsdfSampler::sample(
-            camera, sceneVoxelGrid, sceneBackground, prevNode, thisNode, newNode, x1, x2, false, flags);
+            camera, sceneAccelerationStructure, sceneBackground, prevNode, thisNode, newNode, x1, x2, false, flags);
         thisNode->m_usedComponents = flags;
         return ok;
     }
@@ -435,7 +435,7 @@ CPhotonMapSampler::gdSample(
     // Do real sampling
     ok = CBsdfSampler::sample(
         camera,
-        sceneVoxelGrid,
+        sceneAccelerationStructure,
         sceneBackground,
         prevNode,
         thisNode,
@@ -21,7 +21,7 @@ class CPhotonMapSampler final : public CBsdfSampler {
 
     bool
     fresnelSample(
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         const SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
@@ -32,7 +32,7 @@ class CPhotonMapSampler final : public CBsdfSampler {
     bool
     gdSample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
@@ -64,7 +64,7 @@ class CPhotonMapSampler final : public CBsdfSampler {
     bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
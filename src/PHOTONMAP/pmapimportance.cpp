@@ -52,7 +52,7 @@ DoImportanceStore(CImportanceMap *map, SimpleRaytracingPathNode *node, ColorRgb
 static bool
 tracePotentialPath(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     PhotonMapConfig *config)
 {
@@ -60,7 +60,7 @@ tracePotentialPath(
     const CSamplerConfig &scfg = config->eyeConfig;
 
     // Eye node
-    path = scfg.traceNode(camera, sceneVoxelGrid, sceneBackground, path, drand48(), drand48(), BSDF_ALL_COMPONENTS);
+    path = scfg.traceNode(camera, sceneAccelerationStructure, sceneBackground, path, drand48(), drand48(), BSDF_ALL_COMPONENTS);
     if ( path == nullptr ) {
         return false;
     }
@@ -89,7 +89,7 @@ tracePotentialPath(
 
     while ( scfg.traceNode(
             camera,
-            sceneVoxelGrid,
+            sceneAccelerationStructure,
             sceneBackground,
             node,
             x1,
@@ -132,7 +132,7 @@ tracePotentialPath(
 void
 tracePotentialPaths(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     int numberOfPaths)
 {
@@ -141,7 +141,7 @@ tracePotentialPaths(
     GLOBAL_photonMap_config.eyeConfig.minDepth = 3;
 
     for ( int i = 0; i < numberOfPaths; i++ ) {
-        tracePotentialPath(camera, sceneVoxelGrid, sceneBackground, &GLOBAL_photonMap_config);
+        tracePotentialPath(camera, sceneAccelerationStructure, sceneBackground, &GLOBAL_photonMap_config);
     }
 
     GLOBAL_photonMap_config.eyeConfig.maxDepth = 1; // Back to NEE state
@@ -2,13 +2,13 @@
 #define __PHOTON_MAP_IMPORTANCE__
 
 #include "scene/Background.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "scene/Camera.h"
 
 void
 tracePotentialPaths(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     int numberOfPaths);
 
@@ -8,7 +8,7 @@ PhotonMapState::PhotonMapState():
         usePhotonMapSampler(), densityControl(), importanceOption(), acceptPdfType(), constantRD(), minimumImpRD(),
         doImportanceMap(), iPathsPerIteration(), cImpScale(), gImpScale(), gThreshold(),
         falseColMax(), falseColLog(), falseColMono(), radianceReturn(), minimumLightPathDepth(),
-        maximumLightPathDepth(), iterationNumber(), gIterationNumber(), cIterationNumber(),
+        maximumLightPathDepth(), numberOfThreads(), iterationNumber(), gIterationNumber(), cIterationNumber(),
         i_iteration_nr(), totalCPaths(), totalGPaths(), totalIPaths(), runStopNumber(),
         cpuSecs(), lastClock()
 {
@@ -63,4 +63,6 @@ PhotonMapState::setDefaults() {
 
     minimumLightPathDepth = 0;
     maximumLightPathDepth = 7;
+
+    numberOfThreads = 1;
 }
@@ -43,6 +43,7 @@ class PhotonMapState
     RadiosityReturnOption radianceReturn;
     int minimumLightPathDepth;
     int maximumLightPathDepth;
+    int numberOfThreads; // Threads tracing photon paths, only used without density control
     int iterationNumber;
     int gIterationNumber;
     int cIterationNumber;
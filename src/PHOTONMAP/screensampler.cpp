@@ -15,7 +15,7 @@ newNode gets filled, others may change
 bool
 ScreenSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode */*prevNode*/,
     SimpleRaytracingPathNode *thisNode,
@@ -49,7 +49,7 @@ ScreenSampler::sample(
     newNode->m_inBsdf = thisNode->m_outBsdf; // Camera can be placed in a medium
 
     // Transfer
-    if ( !sampleTransfer(sceneVoxelGrid, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
+    if ( !sampleTransfer(sceneAccelerationStructure, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
         thisNode->m_rayType = PathRayType::STOPS;
         return false;
     }
@@ -17,7 +17,7 @@ class ScreenSampler final : public Sampler {
     bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
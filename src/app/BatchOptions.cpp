@@ -7,6 +7,9 @@ BatchOptions::BatchOptions() {
     saveModulo = 10;
     raytracingImageFileName = "";
     timings = false;
+    timingsReportFileName = "";
+    checkpointFileName = "";
+    checkpointModulo = 1;
 }
 
 BatchOptions::~BatchOptions() {
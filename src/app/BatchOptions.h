@@ -9,6 +9,9 @@ class BatchOptions {
     int saveModulo; // Every n-th iteration, surface model and image will be saved
     const char *raytracingImageFileName;
     int timings = false;
+    const char *timingsReportFileName; // JSON or CSV (".csv" extension) report of the run phase timings
+    const char *checkpointFileName; // Radiance method state to resume from and to save while iterating
+    int checkpointModulo; // Every n-th iteration, the checkpoint will be written
 
     BatchOptions();
     virtual ~BatchOptions();
@@ -1,5 +1,6 @@
 #include <cstring>
 #include "common/numericalAnalysis/QuadCubatureRule.h"
+#include "common/Timings.h"
 #include "tonemap/ToneMap.h"
 #include "tonemap/LightnessToneMap.h"
 #include "tonemap/RevisedTumblinRushmeierToneMap.h"
@@ -12,6 +13,8 @@
 #include "GALERKIN/GalerkinRadianceMethod.h"
 #include "GALERKIN/processing/ClusterCreationStrategy.h"
 #include "scene/PatchClusterOctreeNode.h"
+#include "skin/PatchIntersectionRecords.h"
+#include "scene/VoxelGrid.h"
 #include "app/options.h"
 #include "app/commandLine.h"
 #include "app/sceneBuilder.h"
@@ -31,6 +34,10 @@ Material RpkApplication::defaultMaterial("(default)", nullptr, nullptr, false);
 RpkApplication::RpkApplication():
     imageOutputWidth(),
     imageOutputHeight(),
+    accelerationStructureType(),
+    sceneCacheFileName(),
+    clusterHierarchyType(),
+    clusterHierarchyThreads(),
     selectedRadianceMethod(),
     rayTracer()
 {
@@ -93,7 +100,12 @@ RpkApplication::mainParseOptions(int *argc, char **argv, char *rayTracerName, ch
         &mgfContext->singleSided,
         &mgfContext->numberOfQuarterCircleDivisions,
         &imageOutputWidth,
-        &imageOutputHeight);
+        &imageOutputHeight,
+        &accelerationStructureType,
+        &sceneCacheFileName,
+        &mgfContext->numberOfThreads,
+        &clusterHierarchyType,
+        &clusterHierarchyThreads);
     renderParseOptions(argc, argv, renderOptions);
     toneMapParseOptions(argc, argv, toneMapName);
     cameraParseOptions(argc, argv, scene->camera, imageOutputWidth, imageOutputHeight);
@@ -134,13 +146,16 @@ RpkApplication::freeMemory(MgfContext *mgfContext) {
     PatchClusterOctreeNode::deleteCachedGeometries();
     ClusterCreationStrategy::freeClusterElements();
     VoxelGrid::freeVoxelGridElements();
+    PatchIntersectionRecords::freeMemory();
     if ( mgfContext->radianceMethod != nullptr ) {
         delete mgfContext->radianceMethod;
     }
     dkColorFreeBuffer();
+    Timings::freeMemory();
 #ifdef RAYTRACING_ENABLED
     if ( GLOBAL_lightList != nullptr ) {
         delete GLOBAL_lightList;
+        GLOBAL_lightList = nullptr;
     }
 #endif
 }
@@ -161,7 +176,15 @@ RpkApplication::entryPoint(int argc, char *argv[]) {
     mgfContext->monochrome = DEFAULT_MONOCHROME;
     mgfContext->currentMaterial = &defaultMaterial;
     selectToneMapByName(initializationToneMapName); // Note this is used for basic Galerkin model initialization
-    sceneBuilderCreateModel(&argc, argv, mgfContext, scene);
+    sceneBuilderCreateModel(
+        &argc,
+        argv,
+        mgfContext,
+        scene,
+        accelerationStructureType,
+        sceneCacheFileName,
+        clusterHierarchyType,
+        clusterHierarchyThreads);
     selectToneMapByName(renderToneMapName);
 
     // 4. Run main radiosity simulation and export result
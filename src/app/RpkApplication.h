@@ -4,12 +4,18 @@
 #include "io/mgf/MgfContext.h"
 #include "raycasting/common/Raytracer.h"
 #include "scene/Scene.h"
+#include "scene/AccelerationStructureType.h"
+#include "scene/ClusterHierarchyType.h"
 
 class RpkApplication {
   private:
     static Material defaultMaterial;
     int imageOutputWidth;
     int imageOutputHeight;
+    AccelerationStructureType accelerationStructureType;
+    const char *sceneCacheFileName;
+    ClusterHierarchyType clusterHierarchyType;
+    int clusterHierarchyThreads;
     Scene *scene;
     MgfContext *mgfContext;
     RadianceMethod *selectedRadianceMethod;
@@ -1,13 +1,15 @@
-#include <ctime>
 #include <cstring>
 #include <GL/gl.h>
 
 #include "common/RenderOptions.h"
+#include "common/Timings.h"
+#include "common/error.h"
 #include "java/util/ArrayList.txx"
 #include "io/writevrml.h"
 #include "render/canvas.h"
 #include "render/render.h"
 #include "io/FileUncompressWrapper.h"
+#include "io/RadianceCheckpoint.h"
 #include "raycasting/simple/RayCaster.h"
 #include "app/commandLine.h"
 #include "app/BatchOptions.h"
@@ -107,7 +109,7 @@ batchSaveRadianceImage(
     const RayTracer * /*rayTracer*/,
     const RenderOptions *renderOptions)
 {
-    clock_t t;
+    double t;
     const char *extension;
 
     if ( !fp ) {
@@ -124,12 +126,12 @@ batchSaveRadianceImage(
     }
     fflush(stdout);
 
-    t = clock();
+    t = Timings::wallClock();
 
     // No OpenGL really if renderOptions->trace is true
     openGlSaveScreen(fileName, fp, isPipe, scene, radianceMethod, renderOptions);
 
-    fprintf(stdout, "%g secs.\n", (float) (clock() - t) / (float) CLOCKS_PER_SEC);
+    fprintf(stdout, "%g secs.\n", Timings::wallClock() - t);
     canvasPullMode();
 }
 
@@ -143,7 +145,7 @@ batchSaveRadianceModel(
     const RayTracer */*rayTracer*/,
     const RenderOptions *renderOptions)
 {
-    clock_t t;
+    double t;
 
     if ( !fp ) {
         return;
@@ -152,16 +154,53 @@ batchSaveRadianceModel(
     canvasPushMode();
     fprintf(stdout, "Saving VRML model to file '%s' ... ", fileName);
     fflush(stdout);
-    t = clock();
+    t = Timings::wallClock();
 
     if ( radianceMethod != nullptr ) {
         radianceMethod->writeVRML(scene->camera, fp, renderOptions);
     }
 
-    fprintf(stdout, "%g secs.\n", (float) (clock() - t) / (float) CLOCKS_PER_SEC);
+    fprintf(stdout, "%g secs.\n", Timings::wallClock() - t);
     canvasPullMode();
 }
 
+/**
+Continues the radiance computations from the checkpoint, if there is one for this
+method and scene. Returns the number of iterations already done
+*/
+static int
+batchReadCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RadianceMethod *radianceMethod, RenderOptions *renderOptions) {
+    int iterationNumber = 0;
+    int readPhase = Timings::begin("read checkpoint");
+    bool resumed = checkpoint->openForReading(radianceMethod->getRadianceMethodName(), scene, &iterationNumber)
+        && radianceMethod->readCheckpoint(checkpoint, scene, renderOptions)
+        && checkpoint->finishReading();
+    Timings::end(readPhase);
+    if ( !resumed ) {
+        return 0;
+    }
+    printf("Resuming %s after %d iterations from checkpoint '%s'\n",
+        radianceMethod->getRadianceMethodName(), iterationNumber, globalBatchOptions.checkpointFileName);
+    return iterationNumber;
+}
+
+/**
+Saves the state of the radiance computations after the given number of iterations.
+Returns false if the radiance method does not support checkpoints
+*/
+static bool
+batchWriteCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene, const RadianceMethod *radianceMethod, int iterationNumber) {
+    if ( !checkpoint->openForWriting(radianceMethod->getRadianceMethodName(), scene, iterationNumber) ) {
+        return true;
+    }
+    if ( !radianceMethod->writeCheckpoint(checkpoint, scene) ) {
+        logWarning("batchWriteCheckpoint", "%s does not support checkpoints", radianceMethod->getRadianceMethodName());
+        return false;
+    }
+    checkpoint->finishWriting();
+    return true;
+}
+
 void
 batchExecuteRadianceSimulation(
     Scene *scene,
@@ -169,16 +208,16 @@ batchExecuteRadianceSimulation(
     const RayTracer *rayTracer,
     RenderOptions *renderOptions)
 {
-    clock_t startTime;
-    clock_t wasted_start;
-    float wastedSecs;
+    int radiancePhase;
+    double radianceSecs;
+    double wastedSecs; // Spent saving images and models
 
     if ( scene->geometryList == nullptr || scene->geometryList->size() == 0 ) {
         printf("Empty world? Missing argument to some command line parameter option?\n");
         return;
     }
 
-    startTime = clock();
+    radiancePhase = Timings::begin("radiance");
     wastedSecs = 0.0;
 
     if ( radianceMethod != nullptr ) {
@@ -187,8 +226,15 @@ batchExecuteRadianceSimulation(
         fflush(stdout);
         fflush(stderr);
 
+        RadianceCheckpoint checkpoint(globalBatchOptions.checkpointFileName);
+        bool writeCheckpoints = checkpoint.isEnabled();
+        int firstIteration = 0;
+        if ( checkpoint.isEnabled() ) {
+            firstIteration = batchReadCheckpoint(&checkpoint, scene, radianceMethod, renderOptions);
+        }
+
         bool done = false;
-        for ( int iterationNumber = 0;
+        for ( int iterationNumber = firstIteration;
               iterationNumber < globalBatchOptions.iterations && !done;
               iterationNumber++ ) {
             printf("-----------------------------------\n"
@@ -196,7 +242,9 @@ batchExecuteRadianceSimulation(
                    "-----------------------------------\n\n", iterationNumber);
 
             canvasPushMode();
+            int stepPhase = Timings::begin("doStep", iterationNumber);
             done = radianceMethod->doStep(scene, renderOptions);
+            Timings::end(stepPhase);
             canvasPullMode();
 
             fflush(stdout);
@@ -209,12 +257,11 @@ batchExecuteRadianceSimulation(
             fflush(stdout);
             fflush(stderr);
 
-            wasted_start = clock();
-
             if ( (!(iterationNumber % globalBatchOptions.saveModulo)) && *globalBatchOptions.radianceImageFileNameFormat ) {
                 int n = (int)strlen(globalBatchOptions.radianceImageFileNameFormat) + 1;
                 char *fileName = new char[n];
                 snprintf(fileName, n, globalBatchOptions.radianceImageFileNameFormat, iterationNumber);
+                int savePhase = Timings::begin("save radiance image", iterationNumber);
                 batchProcessFile(
                     fileName,
                     "w",
@@ -223,6 +270,7 @@ batchExecuteRadianceSimulation(
                     radianceMethod,
                     rayTracer,
                     renderOptions);
+                wastedSecs += Timings::end(savePhase);
                 delete[] fileName;
             }
 
@@ -230,6 +278,7 @@ batchExecuteRadianceSimulation(
                 int n = (int)strlen(globalBatchOptions.radianceModelFileNameFormat) + 1;
                 char *fileName = new char[n];
                 snprintf(fileName, n, globalBatchOptions.radianceModelFileNameFormat, iterationNumber);
+                int savePhase = Timings::begin("save radiance model", iterationNumber);
                 batchProcessFile(
                     fileName,
                     "w",
@@ -238,10 +287,18 @@ batchExecuteRadianceSimulation(
                     radianceMethod,
                     rayTracer,
                     renderOptions);
+                wastedSecs += Timings::end(savePhase);
                 delete[] fileName;
             }
 
-            wastedSecs += (float) (wasted_start - clock()) / (float) CLOCKS_PER_SEC;
+            if ( writeCheckpoints
+              && ((iterationNumber + 1) % globalBatchOptions.checkpointModulo == 0
+                  || iterationNumber + 1 == globalBatchOptions.iterations
+                  || done) ) {
+                int checkpointPhase = Timings::begin("write checkpoint", iterationNumber);
+                writeCheckpoints = batchWriteCheckpoint(&checkpoint, scene, radianceMethod, iterationNumber + 1);
+                wastedSecs += Timings::end(checkpointPhase);
+            }
 
             fflush(stdout);
             fflush(stderr);
@@ -250,16 +307,16 @@ batchExecuteRadianceSimulation(
         printf("(No world-space radiance computations are being done)\n");
     }
 
+    radianceSecs = Timings::end(radiancePhase) - wastedSecs;
     if ( globalBatchOptions.timings ) {
-        fprintf(stdout, "Radiance total time %g secs.\n",
-                ((float) (clock() - startTime) / (float) CLOCKS_PER_SEC) - wastedSecs);
+        fprintf(stdout, "Radiance total time %g secs.\n", radianceSecs);
     }
 
     #ifdef RAYTRACING_ENABLED
         if ( GLOBAL_rayTracer != nullptr ) {
             printf("Doing %s ...\n", rayTracer->getName());
 
-            startTime = clock();
+            int rayTracingPhase = Timings::begin("raytracing");
             rayTraceExecute(
                 nullptr,
                 nullptr,
@@ -269,11 +326,16 @@ batchExecuteRadianceSimulation(
                 rayTracer,
                 renderOptions);
 
+            double raytracingSecs = Timings::end(rayTracingPhase);
+
             if ( globalBatchOptions.timings ) {
-                fprintf(stdout, "Raytracing total time %g secs.\n",
-                        (float) (clock() - startTime) / (float) CLOCKS_PER_SEC);
+                fprintf(stdout, "Raytracing total time %g secs, %ld rays (%g rays / sec).\n",
+                        raytracingSecs,
+                        GLOBAL_raytracer_rayCount,
+                        raytracingSecs > 0.0 ? (double) GLOBAL_raytracer_rayCount / raytracingSecs : 0.0);
             }
 
+            int savePhase = Timings::begin("save raytracing image");
             batchProcessFile(
                 globalBatchOptions.raytracingImageFileName,
                 "w",
@@ -282,10 +344,15 @@ batchExecuteRadianceSimulation(
                 radianceMethod,
                 rayTracer,
                 renderOptions);
+            Timings::end(savePhase);
         } else {
             printf("(No pixel-based radiance computations are being done)\n");
         }
     #endif
 
     printf("Computations finished.\n");
+
+    if ( *globalBatchOptions.timingsReportFileName ) {
+        Timings::writeReport(globalBatchOptions.timingsReportFileName);
+    }
 }
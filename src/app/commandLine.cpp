@@ -2,6 +2,7 @@
 #include "common/error.h"
 #include "common/RenderOptions.h"
 #include "scene/Camera.h"
+#include "scene/AccelerationStructureType.h"
 #include "tonemap/ToneMap.h"
 #include "GALERKIN/GalerkinRadianceMethod.h"
 
@@ -14,6 +15,7 @@
     #include "raycasting/stochasticRaytracing/StochasticRayTracingState.h"
     #include "raycasting/stochasticRaytracing/StochasticRelaxation.h"
     #include "PHOTONMAP/pmapoptions.h"
+    #include "raycasting/raytracing/screeniterate.h"
 #endif
 
 #include "app/options.h"
@@ -36,6 +38,11 @@ static int globalYes = 1;
 static int globalNo = 0;
 static int globalOutputImageWidth = 1920;
 static int globalOutputImageHeight = 1080;
+static int globalAccelerationStructureType = AccelerationStructureType::VOXEL_GRID;
+static const char *globalSceneCacheFileName = "";
+static int globalSceneReadingThreads = 1;
+static int globalClusterHierarchyType = ClusterHierarchyType::OCTREE_CLUSTERS;
+static int globalClusterHierarchyThreads = 1;
 static Camera globalCamera;
 
 static void
@@ -58,6 +65,20 @@ commandLineImageHeightOption(void *value) {
     globalOutputImageHeight = *(int *)value;
 }
 
+static ENUMDESC globalAccelerationStructureValues[] = {
+    {AccelerationStructureType::VOXEL_GRID, "voxel-grid", 2},
+    {AccelerationStructureType::BOUNDING_VOLUME_HIERARCHY, "bvh", 2},
+    {0, nullptr, 0}
+};
+MakeEnumOptTypeStruct(accelerationStructureTypeStruct, globalAccelerationStructureValues);
+
+static ENUMDESC globalClusterHierarchyValues[] = {
+    {ClusterHierarchyType::OCTREE_CLUSTERS, "octree", 2},
+    {ClusterHierarchyType::SURFACE_AREA_HEURISTIC_CLUSTERS, "sah", 2},
+    {0, nullptr, 0}
+};
+MakeEnumOptTypeStruct(clusterHierarchyTypeStruct, globalClusterHierarchyValues);
+
 static CommandLineOptionDescription globalOptions[] = {
     {"-nqcdivs", 3, &GLOBAL_options_intType, &globalNumberOfQuarterCircleDivisions, DEFAULT_ACTION,
      "-nqcdivs <integer>\t: number of quarter circle divisions"},
@@ -71,6 +92,16 @@ static CommandLineOptionDescription globalOptions[] = {
             "-width \t\t: image output width in pixels"},
     {"-height", 6, &GLOBAL_options_intType, &globalOutputImageHeight, commandLineImageHeightOption,
             "-width \t\t: image output width in pixels"},
+    {"-acceleration-structure", 4, &accelerationStructureTypeStruct, &globalAccelerationStructureType, DEFAULT_ACTION,
+     "-acceleration-structure <voxel-grid|bvh>: scene ray intersection accelerator"},
+    {"-scene-cache", 7, Tstring, &globalSceneCacheFileName, DEFAULT_ACTION,
+     "-scene-cache <filename>\t: read the scene from this binary cache when it is up to date,\n\twrite it otherwise"},
+    {"-mgf-threads", 9, &GLOBAL_options_intType, &globalSceneReadingThreads, DEFAULT_ACTION,
+     "-mgf-threads <n>\t: threads reading the included MGF files ahead of the parser"},
+    {"-cluster-hierarchy", 10, &clusterHierarchyTypeStruct, &globalClusterHierarchyType, DEFAULT_ACTION,
+     "-cluster-hierarchy <octree|sah>: patch cluster hierarchy construction"},
+    {"-cluster-threads", 10, &GLOBAL_options_intType, &globalClusterHierarchyThreads, DEFAULT_ACTION,
+     "-cluster-threads <n>\t: threads building the sah cluster hierarchy"},
     {nullptr, 0, TYPELESS, nullptr, DEFAULT_ACTION, nullptr}
 };
 
@@ -81,7 +112,12 @@ commandLineGeneralProgramParseOptions(
     bool *oneSidedSurfaces,
     int *conicSubDivisions,
     int *imageOutputWidth,
-    int *imageOutputHeight)
+    int *imageOutputHeight,
+    AccelerationStructureType *accelerationStructureType,
+    const char **sceneCacheFileName,
+    int *sceneReadingThreads,
+    ClusterHierarchyType *clusterHierarchyType,
+    int *clusterHierarchyThreads)
 {
     globalFileOptionsForceOneSidedSurfaces = DEFAULT_FORCE_ONE_SIDED;
     globalNumberOfQuarterCircleDivisions = DEFAULT_NUMBER_OF_QUARTIC_DIVISIONS;
@@ -95,6 +131,19 @@ commandLineGeneralProgramParseOptions(
     *conicSubDivisions = globalNumberOfQuarterCircleDivisions;
     *imageOutputWidth = globalOutputImageWidth;
     *imageOutputHeight = globalOutputImageHeight;
+    *accelerationStructureType = (AccelerationStructureType)globalAccelerationStructureType;
+    *sceneCacheFileName = globalSceneCacheFileName;
+    if ( globalSceneReadingThreads < 1 ) {
+        logWarning("-mgf-threads", "Invalid number of threads %d, using 1", globalSceneReadingThreads);
+        globalSceneReadingThreads = 1;
+    }
+    *sceneReadingThreads = globalSceneReadingThreads;
+    *clusterHierarchyType = (ClusterHierarchyType)globalClusterHierarchyType;
+    if ( globalClusterHierarchyThreads < 1 ) {
+        logWarning("-cluster-threads", "Invalid number of threads %d, using 1", globalClusterHierarchyThreads);
+        globalClusterHierarchyThreads = 1;
+    }
+    *clusterHierarchyThreads = globalClusterHierarchyThreads;
 }
 
 static void
@@ -210,6 +259,12 @@ ambientOption(void *value) {
     GalerkinRadianceMethod::galerkinState.useAmbientRadiance = yesno;
 }
 
+static void
+freezeLinksOption(void *value) {
+    int yesno = *(int *) value;
+    GalerkinRadianceMethod::galerkinState.freezeLinks = yesno;
+}
+
 static CommandLineOptionDescription galerkinOptions[] = {
         {"-gr-iteration-method", 6, Tstring, nullptr, iterationMethodOption,
                                                 "-gr-iteration-method <methodname>: Jacobi, GaussSeidel, Southwell"},
@@ -233,16 +288,38 @@ static CommandLineOptionDescription galerkinOptions[] = {
                                                 "-gr-ambient         \t: do visualisation with ambient term"},
         {"-gr-no-ambient", 10, TYPELESS, (void *)&globalFalse, ambientOption,
                                                 "-gr-no-ambient      \t: do visualisation without ambient term"},
+        {"-gr-freeze-links", 6, TYPELESS, (void *)&globalTrue, freezeLinksOption,
+                                                "-gr-freeze-links    \t: stop refining once the links hardly change (Jacobi only)"},
+        {"-gr-no-freeze-links", 10, TYPELESS, (void *)&globalFalse, freezeLinksOption,
+                                                "-gr-no-freeze-links \t: keep refining the links every iteration"},
+        {"-gr-freeze-link-fraction", 10, Tfloat, &GalerkinRadianceMethod::galerkinState.freezeLinkFraction, nullptr,
+                                                "-gr-freeze-link-fraction <float>: Freeze once an iteration creates at most this fraction of the links"},
         {"-gr-link-error-threshold", 6, Tfloat, &GalerkinRadianceMethod::galerkinState.relLinkErrorThreshold, nullptr,
                                                 "-gr-link-error-threshold <float>: Relative link error threshold"},
         {"-gr-min-elem-area", 6, Tfloat, &GalerkinRadianceMethod::galerkinState.relMinElemArea, nullptr,
                                                 "-gr-min-elem-area <float> \t: Relative element area threshold"},
+        {"-gr-threads", 6, &GLOBAL_options_intType, &GalerkinRadianceMethod::galerkinState.numberOfThreads, nullptr,
+                                                "-gr-threads <n>     \t: Threads for refining interactions (Jacobi only)"},
+        {"-gr-shooting-batch", 10, &GLOBAL_options_intType, &GalerkinRadianceMethod::galerkinState.shootingBatchSize, nullptr,
+                                                "-gr-shooting-batch <n>\t: Patches shooting in one step (Southwell only)"},
+        {"-gr-convergence-tolerance", 6, Tfloat, &GalerkinRadianceMethod::galerkinState.convergenceTolerance, nullptr,
+                                                "-gr-convergence-tolerance <float>: Stop when the relative change is below this"},
         {nullptr, 0, nullptr, nullptr, nullptr, nullptr}
 };
 
 void
 galerkinParseOptions(int *argc, char **argv) {
     parseGeneralOptions(galerkinOptions, argc, argv);
+    if ( GalerkinRadianceMethod::galerkinState.shootingBatchSize < 1 ) {
+        logWarning("-gr-shooting-batch", "Invalid number of patches %d, using 1",
+                   GalerkinRadianceMethod::galerkinState.shootingBatchSize);
+        GalerkinRadianceMethod::galerkinState.shootingBatchSize = 1;
+    }
+    if ( GalerkinRadianceMethod::galerkinState.freezeLinkFraction < 0.0f ) {
+        logWarning("-gr-freeze-link-fraction", "Invalid fraction %g, using 0",
+                   GalerkinRadianceMethod::galerkinState.freezeLinkFraction);
+        GalerkinRadianceMethod::galerkinState.freezeLinkFraction = 0.0f;
+    }
 }
 
 // Composes explanation for -tonemapping command line option
@@ -436,6 +513,12 @@ static CommandLineOptionDescription globalCommandLineBatchOptions[] = {
      "-raytracing-image-savefile <filename>\t: raytracing PPM savefile name"},
     {"-timings", 3, Tsettrue, &globalBatchOptions.timings, DEFAULT_ACTION,
      "-timings\t: printRegularHierarchy timings for world-space radiance and raytracing methods"},
+    {"-timings-report", 9, Tstring, &globalBatchOptions.timingsReportFileName, DEFAULT_ACTION,
+     "-timings-report <filename>\t: write wall clock and CPU time of each phase of the run,\n\tas CSV if filename ends in .csv, JSON otherwise"},
+    {"-checkpoint", 11, Tstring, &globalBatchOptions.checkpointFileName, DEFAULT_ACTION,
+     "-checkpoint <filename>\t: resume the world-space radiance computations from this\n\tcheckpoint if it exists and write it while iterating"},
+    {"-checkpoint-modulo", 12, &GLOBAL_options_intType, &globalBatchOptions.checkpointModulo, DEFAULT_ACTION,
+     "-checkpoint-modulo <integer>\t: write the checkpoint every n-th iteration"},
     {nullptr, 0,  TYPELESS, nullptr, DEFAULT_ACTION, nullptr}
 };
 
@@ -443,6 +526,10 @@ void
 batchParseOptions(int *argc, char **argv, BatchOptions *options) {
     globalBatchOptions = *options;
     parseGeneralOptions(globalCommandLineBatchOptions, argc, argv);
+    if ( globalBatchOptions.checkpointModulo < 1 ) {
+        logWarning("-checkpoint-modulo", "Invalid checkpoint interval %d, using 1", globalBatchOptions.checkpointModulo);
+        globalBatchOptions.checkpointModulo = 1;
+    }
     *options = globalBatchOptions;
 }
 
@@ -502,6 +589,8 @@ MakeEnumOptTypeStruct(showWhatTypeStruct, showWhatVals);
 static CommandLineOptionDescription srrOptions[] = {
     {"-srr-ray-units", 8, &GLOBAL_options_intType, &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.rayUnitsPerIt, DEFAULT_ACTION,
      "-srr-ray-units <n>          : To tune the amount of work in a single iteration"},
+    {"-srr-threads", 8, &GLOBAL_options_intType, &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads, DEFAULT_ACTION,
+     "-srr-threads <n>            : Threads for shooting rays, used without hierarchical refinement"},
     {"-srr-bidirectional", 7, Tbool, &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.bidirectionalTransfers, DEFAULT_ACTION,
      "-srr-bidirectional <yes|no> : Use lines bidirectionally"},
     {"-srr-control-variate", 7, Tbool, &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.constantControlVariate, DEFAULT_ACTION,
@@ -712,6 +801,12 @@ mainRayTracingOption(void *value) {
 
 static CommandLineOptionDescription globalRaytracingOptions[] = {
     {"-raytracing-method", 4, Tstring,  nullptr, mainRayTracingOption, globalRaytracingMethodsString},
+    {"-raytracing-threads", 13, &GLOBAL_options_intType, &GLOBAL_screenIterate_numberOfThreads, DEFAULT_ACTION,
+    "-raytracing-threads <number>\t: threads computing image tiles (stochastic and bidirectional raytracing)"},
+    {"-raytracing-tile-size", 13, &GLOBAL_options_intType, &GLOBAL_screenIterate_tileSize, DEFAULT_ACTION,
+    "-raytracing-tile-size <pixels>\t: width and height of the image tiles"},
+    {"-raytracing-fixed-seeds", 13, Tsettrue, &GLOBAL_screenIterate_fixedPixelSeeds, DEFAULT_ACTION,
+    "-raytracing-fixed-seeds\t: random sequence fixed per pixel, same image for any number of threads"},
     {nullptr, 0, TYPELESS, nullptr, DEFAULT_ACTION, nullptr}
 };
 
@@ -724,6 +819,15 @@ rayTracingParseOptions(
     globalRayTracerName = rayTracerName;
     globalRaytracingMethodsString = raytracingMethodsString;
     parseGeneralOptions(globalRaytracingOptions, argc, argv);
+
+    if ( GLOBAL_screenIterate_numberOfThreads < 1 ) {
+        logWarning("-raytracing-threads", "Invalid number of threads %d, using 1", GLOBAL_screenIterate_numberOfThreads);
+        GLOBAL_screenIterate_numberOfThreads = 1;
+    }
+    if ( GLOBAL_screenIterate_tileSize < 1 ) {
+        logWarning("-raytracing-tile-size", "Invalid tile size %d, using 16", GLOBAL_screenIterate_tileSize);
+        GLOBAL_screenIterate_tileSize = 16;
+    }
 }
 
 // Command line options
@@ -748,6 +852,8 @@ static CommandLineOptionDescription globalPhotonMapOptions[] = {
      "-pmap-recon-photons <number> : Number of photons to use in reconstructions (importance)"},
     {"-pmap-balancing", 9, Tbool, &GLOBAL_photonMap_state.balanceKDTree, DEFAULT_ACTION,
      "-pmap-balancing <true|false> : Balance KD Tree before raytracing"},
+    {"-pmap-threads", 9, &GLOBAL_options_intType, &GLOBAL_photonMap_state.numberOfThreads, DEFAULT_ACTION,
+     "-pmap-threads <number> : Threads tracing photon paths, used without density control"},
     {nullptr, 0, TYPELESS, nullptr, DEFAULT_ACTION, nullptr}
 };
 
@@ -2,6 +2,8 @@
 #define __COMMAND_LINE_OPTIONS__
 
 #include "raycasting/common/Raytracer.h"
+#include "scene/AccelerationStructureType.h"
+#include "scene/ClusterHierarchyType.h"
 #include "app/BatchOptions.h"
 
 extern void cameraParseOptions(int *argc, char **argv, Camera *camera, int imageWidth, int imageHeight);
@@ -13,7 +15,12 @@ commandLineGeneralProgramParseOptions(
     bool *oneSidedSurfaces,
     int *conicSubDivisions,
     int *imageOutputWidth,
-    int *imageOutputHeight);
+    int *imageOutputHeight,
+    AccelerationStructureType *accelerationStructureType,
+    const char **sceneCacheFileName,
+    int *sceneReadingThreads,
+    ClusterHierarchyType *clusterHierarchyType,
+    int *clusterHierarchyThreads);
 
 extern void stochasticRelaxationRadiosityParseOptions(int *argc, char **argv);
 extern void randomWalkRadiosityParseOptions(int *argc, char **argv);
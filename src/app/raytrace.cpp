@@ -3,10 +3,10 @@
 
 #include <cstdio>
 #include <cstring>
-#include <ctime>
 
 #include "common/error.h"
 #include "common/Statistics.h"
+#include "common/Timings.h"
 #include "render/canvas.h"
 #include "raycasting/stochasticRaytracing/StochasticRaytracer.h"
 #include "raycasting/bidirectionalRaytracing/BidirectionalPathRaytracer.h"
@@ -79,13 +79,13 @@ rayTraceSaveImage(
     const RayTracer *rayTracer,
     const RenderOptions * /*renderOptions*/)
 {
-    clock_t t;
+    double t;
 
     if ( fp == nullptr ) {
         return;
     }
 
-    t = clock();
+    t = Timings::wallClock();
 
     ImageOutputHandle *img = createRadianceImageOutputHandle(
         fileName,
@@ -105,7 +105,7 @@ rayTraceSaveImage(
 
     deleteImageOutputHandle(img);
 
-    fprintf(stdout, "Raytrace save image: %g secs.\n", (float) (clock() - t) / (float) CLOCKS_PER_SEC);
+    fprintf(stdout, "Raytrace save image: %g secs.\n", Timings::wallClock() - t);
 }
 
 void
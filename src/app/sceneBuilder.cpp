@@ -1,15 +1,21 @@
-#include <ctime>
 #include <cstring>
 
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
 #include "common/Statistics.h"
+#include "common/Timings.h"
 #include "tonemap/ToneMap.h"
 #include "scene/Scene.h"
 #include "io/mgf/readmgf.h"
+#include "io/FileUncompressWrapper.h"
+#include "io/SceneCache.h"
 #include "render/renderhook.h"
 #include "render/ScreenBuffer.h"
 #include "scene/PatchClusterOctreeNode.h"
+#include "scene/PatchClusterSahBuilder.h"
+#include "skin/PatchIntersectionRecords.h"
+#include "scene/VoxelGrid.h"
+#include "scene/BoundingVolumeHierarchy.h"
 #include "app/adaptation.h"
 #include "app/options.h"
 #include "app/radiance.h"
@@ -124,19 +130,30 @@ Creates a hierarchical model of the discrete scene (the patches in the scene) us
 algorithm described in
 - Per Christensen, "Hierarchical Techniques for Glossy Global Illumination",
   PhD Thesis, University of Washington, 1995, p 116
+or, with SURFACE_AREA_HEURISTIC_CLUSTERS, with the binned surface area heuristic on several
+threads, see PatchClusterSahBuilder.
 This hierarchy is often much more efficient for tracing rays and clustering radiosity algorithms
 than the given hierarchy of bounding boxes. A pointer to the toplevel "cluster" is returned
 */
 static Geometry *
-sceneBuilderCreateClusterHierarchy(const java::ArrayList<Patch *> *patches) {
+sceneBuilderCreateClusterHierarchy(
+    const java::ArrayList<Patch *> *patches,
+    ClusterHierarchyType clusterHierarchyType,
+    int clusterHierarchyThreads)
+{
     PatchClusterOctreeNode *rootCluster;
     Geometry *rootGeometry;
 
-    // Create a toplevel cluster containing (references to) all the patches in the scene
-    rootCluster = new PatchClusterOctreeNode(patches);
+    if ( clusterHierarchyType == ClusterHierarchyType::SURFACE_AREA_HEURISTIC_CLUSTERS ) {
+        PatchClusterSahBuilder builder(patches, clusterHierarchyThreads);
+        rootCluster = builder.build();
+    } else {
+        // Create a toplevel cluster containing (references to) all the patches in the scene
+        rootCluster = new PatchClusterOctreeNode(patches);
 
-    // Split the toplevel cluster recursively into sub-clusters
-    rootCluster->splitCluster();
+        // Split the toplevel cluster recursively into sub-clusters
+        rootCluster->splitCluster();
+    }
     //rootCluster->print(0);
 
     // Convert to a Geometry GLOBAL_stochasticRaytracing_hierarchy, disposing of the clusters
@@ -199,7 +216,15 @@ Tries to read the scene in the given file. Returns false if not successful.
 Returns true if successful
 */
 static bool
-sceneBuilderReadFile(char *fileName, MgfContext *mgfContext, Scene *scene) {
+sceneBuilderReadFile(
+    char *fileName,
+    MgfContext *mgfContext,
+    Scene *scene,
+    AccelerationStructureType accelerationStructureType,
+    const char *sceneCacheFileName,
+    ClusterHierarchyType clusterHierarchyType,
+    int clusterHierarchyThreads)
+{
     // Check whether the file can be opened if not reading from stdin
     if ( fileName[0] != '#' ) {
         FILE *input = fopen(fileName, "r");
@@ -234,28 +259,47 @@ sceneBuilderReadFile(char *fileName, MgfContext *mgfContext, Scene *scene) {
     // Read the mgf file. The result is a new GLOBAL_scene_world and GLOBAL_scene_materials if everything goes well
     const char *extension;
     fprintf(stderr, "Reading the scene from file '%s' ... \n", fileName);
-    clock_t last = clock();
+    int sceneLoadPhase = Timings::begin("scene load");
+    int phase = Timings::begin("read");
 
     const char *dot = strrchr(fileName, '.');
+    if ( dot != nullptr && compressionFormatOfFileName(fileName) != CompressionFormat::NO_COMPRESSION ) {
+        // The extension of a compressed file is the one before ".gz" or ".zst"
+        const char *compressedDot = dot;
+        dot = nullptr;
+        for ( const char *c = fileName; c < compressedDot; c++ ) {
+            if ( *c == '.' ) {
+                dot = c;
+            }
+        }
+    }
     if ( dot != nullptr ) {
         extension = dot + 1;
     } else {
         extension = "mgf";
     }
 
+    // The scene cache can not check whether the standard input changed
+    SceneCache sceneCache(fileName[0] != '#' ? sceneCacheFileName : nullptr, mgfContext->currentMaterial, clusterHierarchyType);
+    bool sceneFromCache = false;
+
     if ( strncmp(extension, "mgf", 3) == 0 ) {
-        readMgf(fileName, mgfContext);
+        sceneFromCache = sceneCache.readModel(fileName, mgfContext);
+        if ( sceneFromCache ) {
+            fprintf(stderr, "Scene read from the scene cache '%s'\n", sceneCacheFileName);
+        } else {
+            readMgf(fileName, mgfContext);
+        }
         scene->geometryList = mgfContext->geometries;
     }
 
-    clock_t t = clock();
-    fprintf(stderr, "Reading took %g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "Reading took %g secs.\n", Timings::end(phase));
 
     delete[] currentDirectory;
 
     // Check for errors
     if ( scene->geometryList == nullptr || scene->geometryList->size() == 0 ) {
+        Timings::end(sceneLoadPhase);
         return false; // Not successful
     }
 
@@ -264,29 +308,35 @@ sceneBuilderReadFile(char *fileName, MgfContext *mgfContext, Scene *scene) {
     // so many times
     fprintf(stderr, "Building patch list ... ");
     fflush(stderr);
+    phase = Timings::begin("patch list");
 
     scene->patchList = new java::ArrayList<Patch *>();
     sceneBuilderPatchList(scene->geometryList, scene->patchList);
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
 
     // Build the list of patches on light sources from the patch list
     fprintf(stderr, "Building light source patch list ... ");
     fflush(stderr);
+    phase = Timings::begin("light source patch list");
 
     sceneBuilderFillLightSourcePatchList(scene);
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
 
     // Build a cluster hierarchy for the new scene
     fprintf(stderr, "Building cluster hierarchy ... ");
     fflush(stderr);
+    phase = Timings::begin("cluster hierarchy");
 
-    scene->clusteredRootGeometry = sceneBuilderCreateClusterHierarchy(scene->patchList);
+    scene->clusteredRootGeometry = nullptr;
+    if ( sceneFromCache ) {
+        scene->clusteredRootGeometry = sceneCache.readClusterHierarchy();
+    }
+    if ( scene->clusteredRootGeometry == nullptr ) {
+        scene->clusteredRootGeometry = sceneBuilderCreateClusterHierarchy(
+            scene->patchList, clusterHierarchyType, clusterHierarchyThreads);
+    }
 
     if ( scene->clusteredRootGeometry->className == GeometryClassId::COMPOUND ) {
         if ( scene->clusteredRootGeometry->compoundData == nullptr ) {
@@ -297,39 +347,50 @@ sceneBuilderReadFile(char *fileName, MgfContext *mgfContext, Scene *scene) {
         logWarning(nullptr, "Strange clusters for this world ...");
     }
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
+
+    // Save the model and the cluster hierarchy for the next runs on the same scene
+    if ( sceneCache.isEnabled() && !sceneFromCache ) {
+        fprintf(stderr, "Writing scene cache ... ");
+        fflush(stderr);
+        phase = Timings::begin("scene cache");
+
+        sceneCache.write(fileName, mgfContext, scene->clusteredRootGeometry);
 
-    // Create the scene level voxel grid
-    scene->voxelGrid = new VoxelGrid(scene->clusteredRootGeometry);
+        fprintf(stderr, "%g secs.\n", Timings::end(phase));
+    }
+
+    // Create the scene level ray intersection acceleration structure
+    phase = Timings::begin("acceleration structure");
+    PatchIntersectionRecords::build(scene->patchList);
+    if ( accelerationStructureType == AccelerationStructureType::BOUNDING_VOLUME_HIERARCHY ) {
+        scene->accelerationStructure = new BoundingVolumeHierarchy(scene->patchList);
+    } else {
+        scene->accelerationStructure = new VoxelGrid(scene->clusteredRootGeometry);
+    }
 
-    t = clock();
-    fprintf(stderr, "Voxel grid creation took %g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "Acceleration structure creation took %g secs.\n", Timings::end(phase));
 
     // Estimate average radiance, for radiance to display RGB conversion
     fprintf(stderr, "Computing some scene statistics ... ");
     fflush(stderr);
+    phase = Timings::begin("scene statistics");
 
     GLOBAL_statistics.numberOfPatches = GLOBAL_statistics.numberOfElements;
     sceneBuilderComputeStats(scene);
     GLOBAL_statistics.referenceLuminance = 5.42 * ((1.0 - GLOBAL_statistics.averageReflectivity.gray()) *
                                                    GLOBAL_statistics.estimatedAverageRadiance.luminance());
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
 
     // Initialize tone mapping
     fprintf(stderr, "Initializing tone mapping ... ");
     fflush(stderr);
+    phase = Timings::begin("tone mapping");
 
     initSceneAdaptation(scene->patchList);
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
-    last = t;
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
 
     // Print statistics report
     printf("\nStats: GLOBAL_statistics.totalEmittedPower ................: %f W\n"
@@ -351,17 +412,18 @@ sceneBuilderReadFile(char *fileName, MgfContext *mgfContext, Scene *scene) {
     // Initialize radiance for the freshly loaded scene
     fprintf(stderr, "Initializing radiance method ... ");
     fflush(stderr);
+    phase = Timings::begin("radiance method initialization");
 
     setRadianceMethod(mgfContext->radianceMethod, scene);
 
-    t = clock();
-    fprintf(stderr, "%g secs.\n", (float) (t - last) / (float) CLOCKS_PER_SEC);
+    fprintf(stderr, "%g secs.\n", Timings::end(phase));
 
     // Remove possible render hooks
     removeAllRenderHooks();
 
     removeEmptyMeshSurfaces(mgfContext, scene->geometryList);
 
+    Timings::end(sceneLoadPhase);
     fprintf(stderr, "Initialisations done.\n");
 
     return true;
@@ -372,13 +434,24 @@ sceneBuilderCreateModel(
     const int *argc,
     char *const *argv,
     MgfContext *mgfContext,
-    Scene *scene)
+    Scene *scene,
+    AccelerationStructureType accelerationStructureType,
+    const char *sceneCacheFileName,
+    ClusterHierarchyType clusterHierarchyType,
+    int clusterHierarchyThreads)
 {
     // All options should have disappeared from argv now
     if ( *argc > 1 ) {
         if ( *argv[1] == '-' ) {
             logError(nullptr, "Unrecognized option '%s'", argv[1]);
-        } else if ( !sceneBuilderReadFile(argv[1], mgfContext, scene) ) {
+        } else if ( !sceneBuilderReadFile(
+                argv[1],
+                mgfContext,
+                scene,
+                accelerationStructureType,
+                sceneCacheFileName,
+                clusterHierarchyType,
+                clusterHierarchyThreads) ) {
             exit(1);
         }
     }
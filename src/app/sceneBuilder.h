@@ -3,12 +3,18 @@
 
 #include "io/mgf/MgfContext.h"
 #include "scene/Scene.h"
+#include "scene/AccelerationStructureType.h"
+#include "scene/ClusterHierarchyType.h"
 
 extern void
 sceneBuilderCreateModel(
     const int *argc,
     char *const *argv,
     MgfContext *mgfContext,
-    Scene *scene);
+    Scene *scene,
+    AccelerationStructureType accelerationStructureType,
+    const char *sceneCacheFileName,
+    ClusterHierarchyType clusterHierarchyType,
+    int clusterHierarchyThreads);
 
 #endif
@@ -0,0 +1,135 @@
+/**
+Micro benchmark for k nearest neighbour queries on the kd tree, as done by photon
+map density estimation. Builds a balanced tree over random points and reports
+queries per second, on one thread and on the requested number of threads sharing
+the same tree.
+
+Usage: kdTreeBenchmark [points] [queries] [k] [threads]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "common/dataStructures/KDTree.h"
+
+class BenchmarkPoint {
+  public:
+    float position[3]; // Must be first, see KDTree
+    int index;
+};
+
+class BenchmarkJob {
+  public:
+    KDTree *tree;
+    const float *queryPoints;
+    int firstQuery;
+    int numberOfQueries;
+    int k;
+    double distanceSum;
+    long foundSum;
+
+    BenchmarkJob(): tree(), queryPoints(), firstQuery(), numberOfQueries(), k(), distanceSum(), foundSum() {}
+};
+
+static float
+randomCoordinate(unsigned int *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (float)((*seed >> 8) & 0xFFFF) / 65536.0f;
+}
+
+static void
+runQueries(BenchmarkJob *job) {
+    void **results = new void *[job->k];
+    float *distances = new float[job->k];
+
+    for ( int i = job->firstQuery; i < job->firstQuery + job->numberOfQueries; i++ ) {
+        float point[3] = {job->queryPoints[3 * i], job->queryPoints[3 * i + 1], job->queryPoints[3 * i + 2]};
+        int found = job->tree->query(point, job->k, results, distances, 0.01f);
+        job->foundSum += found;
+        for ( int j = 0; j < found; j++ ) {
+            job->distanceSum += distances[j];
+        }
+    }
+
+    delete[] results;
+    delete[] distances;
+}
+
+static double
+timeQueries(KDTree *tree, const float *queryPoints, int numberOfQueries, int k, int numberOfThreads) {
+    BenchmarkJob *jobs = new BenchmarkJob[numberOfThreads];
+    std::thread **workers = new std::thread *[numberOfThreads];
+    int perThread = numberOfQueries / numberOfThreads;
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        jobs[i].tree = tree;
+        jobs[i].queryPoints = queryPoints;
+        jobs[i].firstQuery = i * perThread;
+        jobs[i].numberOfQueries = i == numberOfThreads - 1 ? numberOfQueries - i * perThread : perThread;
+        jobs[i].k = k;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(runQueries, &jobs[i]);
+    }
+    runQueries(&jobs[0]);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double distanceSum = 0.0;
+    long foundSum = 0;
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        distanceSum += jobs[i].distanceSum;
+        foundSum += jobs[i].foundSum;
+    }
+    printf("%2d thread(s): %10.0f queries / sec (%ld points found, distance sum %.6g)\n",
+           numberOfThreads, numberOfQueries / seconds, foundSum, distanceSum);
+
+    delete[] workers;
+    delete[] jobs;
+    return seconds;
+}
+
+int
+main(int argc, char *argv[]) {
+    int numberOfPoints = argc > 1 ? atoi(argv[1]) : 200000;
+    int numberOfQueries = argc > 2 ? atoi(argv[2]) : 200000;
+    int k = argc > 3 ? atoi(argv[3]) : 50;
+    int numberOfThreads = argc > 4 ? atoi(argv[4]) : (int)std::thread::hardware_concurrency();
+    unsigned int seed = 1;
+
+    if ( numberOfThreads < 1 ) {
+        numberOfThreads = 1;
+    }
+
+    KDTree tree(sizeof(BenchmarkPoint), true);
+    BenchmarkPoint point{};
+    for ( int i = 0; i < numberOfPoints; i++ ) {
+        point.position[0] = randomCoordinate(&seed);
+        point.position[1] = randomCoordinate(&seed);
+        point.position[2] = randomCoordinate(&seed);
+        point.index = i;
+        tree.addPoint(&point, 0);
+    }
+    tree.balance();
+
+    float *queryPoints = new float[3 * numberOfQueries];
+    for ( int i = 0; i < 3 * numberOfQueries; i++ ) {
+        queryPoints[i] = randomCoordinate(&seed);
+    }
+
+    printf("%d points, %d queries, k = %d\n", numberOfPoints, numberOfQueries, k);
+    timeQueries(&tree, queryPoints, numberOfQueries, k, 1);
+    if ( numberOfThreads > 1 ) {
+        timeQueries(&tree, queryPoints, numberOfQueries, k, numberOfThreads);
+    }
+
+    delete[] queryPoints;
+    return 0;
+}
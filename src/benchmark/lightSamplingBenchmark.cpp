@@ -0,0 +1,148 @@
+/**
+Micro benchmark for light selection, as done by bidirectional path tracing. Puts
+the given numbers of small area lights with random power on a ceiling and reports
+samples per second for power sampling (LightList::sample()) and for importance
+sampling towards random points on the floor (LightList::sampleImportant()).
+
+Usage: lightSamplingBenchmark [samples] [lights] [lights] ...
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "java/util/ArrayList.txx"
+#include "material/Material.h"
+#include "skin/Vertex.h"
+#include "raycasting/bidirectionalRaytracing/LightList.h"
+
+static const float LIGHT_SIZE = 0.01f;
+
+class LightScene {
+  public:
+    java::ArrayList<Patch *> *patches;
+    java::ArrayList<Vertex *> *vertices;
+    java::ArrayList<Material *> *materials;
+
+    LightScene(): patches(new java::ArrayList<Patch *>()), vertices(new java::ArrayList<Vertex *>()),
+        materials(new java::ArrayList<Material *>()) {}
+};
+
+static double
+randomNumber(unsigned int *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (double)((*seed >> 8) & 0xFFFF) / 65536.0;
+}
+
+static Vertex *
+newVertex(LightScene *scene, float x, float y) {
+    Vector3D point(x, y, 1.0f);
+    Vector3D normal(0.0f, 0.0f, -1.0f);
+    Vertex *vertex = new Vertex(new Vector3D(point), new Vector3D(normal), nullptr, new java::ArrayList<Patch *>());
+    scene->vertices->add(vertex);
+    return vertex;
+}
+
+/**
+Square lights facing down from the plane z = 1, over the unit square
+*/
+static void
+createLights(LightScene *scene, int numberOfLights, unsigned int *seed) {
+    ColorRgb black;
+    black.clear();
+
+    for ( int i = 0; i < numberOfLights; i++ ) {
+        ColorRgb emittance;
+        emittance.setMonochrome((float)(0.1 + randomNumber(seed)));
+        Material *material = new Material(
+            "light", new PhongEmittanceDistributionFunction(&emittance, &black, 0.0), nullptr, true);
+        scene->materials->add(material);
+
+        float x = (float)randomNumber(seed) * (1.0f - LIGHT_SIZE);
+        float y = (float)randomNumber(seed) * (1.0f - LIGHT_SIZE);
+        Patch *patch = new Patch(
+            4,
+            newVertex(scene, x, y),
+            newVertex(scene, x, y + LIGHT_SIZE),
+            newVertex(scene, x + LIGHT_SIZE, y + LIGHT_SIZE),
+            newVertex(scene, x + LIGHT_SIZE, y));
+        patch->material = material;
+        scene->patches->add(patch);
+    }
+}
+
+static void
+deleteLights(LightScene *scene) {
+    for ( int i = 0; i < scene->patches->size(); i++ ) {
+        delete scene->patches->get(i);
+    }
+    for ( int i = 0; i < scene->vertices->size(); i++ ) {
+        Vertex *vertex = scene->vertices->get(i);
+        delete vertex->point;
+        delete vertex->normal;
+        delete vertex;
+    }
+    for ( int i = 0; i < scene->materials->size(); i++ ) {
+        delete scene->materials->get(i);
+    }
+    delete scene->patches;
+    delete scene->vertices;
+    delete scene->materials;
+}
+
+static void
+timeSampling(LightList *lightList, int numberOfLights, int numberOfSamples, unsigned int *seed) {
+    double pdfSum = 0.0;
+    int misses = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( int i = 0; i < numberOfSamples; i++ ) {
+        double x1 = randomNumber(seed);
+        double pdf;
+        if ( lightList->sample(&x1, &pdf) != nullptr ) {
+            pdfSum += pdf;
+        } else {
+            misses++;
+        }
+    }
+    double powerSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Vector3D normal(0.0f, 0.0f, 1.0f);
+    start = std::chrono::steady_clock::now();
+    for ( int i = 0; i < numberOfSamples; i++ ) {
+        Vector3D point((float)randomNumber(seed), (float)randomNumber(seed), 0.0f);
+        double x1 = randomNumber(seed);
+        double pdf;
+        if ( lightList->sampleImportant(&point, &normal, &x1, &pdf) != nullptr ) {
+            pdfSum += pdf;
+        } else {
+            misses++;
+        }
+    }
+    double importanceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%5d lights: sample %12.0f / sec, sampleImportant %12.0f / sec (%d misses, pdf sum %.6g)\n",
+           numberOfLights, numberOfSamples / powerSeconds, numberOfSamples / importanceSeconds, misses, pdfSum);
+}
+
+int
+main(int argc, char *argv[]) {
+    static const int DEFAULT_LIGHT_COUNTS[] = {8, 256, 1024};
+    int numberOfSamples = argc > 1 ? atoi(argv[1]) : 1000000;
+    int numberOfCounts = argc > 2 ? argc - 2 : 3;
+    unsigned int seed = 1;
+
+    printf("%d samples\n", numberOfSamples);
+    for ( int i = 0; i < numberOfCounts; i++ ) {
+        int numberOfLights = argc > 2 ? atoi(argv[2 + i]) : DEFAULT_LIGHT_COUNTS[i];
+        LightScene scene;
+        createLights(&scene, numberOfLights, &seed);
+
+        LightList *lightList = new LightList(scene.patches);
+        timeSampling(lightList, numberOfLights, numberOfSamples, &seed);
+        delete lightList;
+
+        deleteLights(&scene);
+    }
+    return 0;
+}
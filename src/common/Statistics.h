@@ -1,6 +1,8 @@
 #ifndef __STATISTICS__
 #define __STATISTICS__
 
+#include <atomic>
+
 #include "common/ColorRgb.h"
 
 class Statistics {
@@ -8,15 +10,15 @@ class Statistics {
     float totalArea;
     ColorRgb maxSelfEmittedRadiance;
     ColorRgb maxSelfEmittedPower;
-    int numberOfGeometries;
+    std::atomic<int> numberOfGeometries; // Shaft culling creates geometries while refining on several threads
     int numberOfCompounds;
     int numberOfSurfaces;
     int numberOfVertices;
     int numberOfPatches;
     int numberOfElements;
     int numberOfLightSources;
-    int numberOfShadowRays;
-    int numberOfShadowCacheHits;
+    std::atomic<int> numberOfShadowRays; // Counted while refining on several threads too
+    std::atomic<int> numberOfShadowCacheHits;
     double averageDirectPotential;
     double maxDirectPotential;
     double maxDirectImportance; // Potential times area
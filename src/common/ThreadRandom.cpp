@@ -0,0 +1,105 @@
+#include <cstdlib>
+
+#include "common/ThreadRandom.h"
+
+// drand48() linear congruential generator parameters, see man drand48
+static const unsigned long long MULTIPLIER = 0x5DEECE66DULL;
+static const unsigned long long ADDEND = 0xBULL;
+static const unsigned long long MASK_48_BITS = 0xFFFFFFFFFFFFULL;
+
+// Lower 16 bits of the state after srand48(), as defined by POSIX
+static const unsigned short SRAND48_LOW_BITS = 0x330E;
+
+// Base of the per pixel seeds
+static const unsigned long long PIXEL_SEED_BASE = 0xFE062134ULL;
+
+thread_local bool ThreadRandom::ownState = false;
+thread_local unsigned short ThreadRandom::state[3] = {0, 0, 0};
+thread_local unsigned short ThreadRandom::previousState[3] = {0, 0, 0};
+
+void
+ThreadRandom::setState(const unsigned long long value) {
+    state[0] = (unsigned short)(value & 0xFFFF);
+    state[1] = (unsigned short)((value >> 16) & 0xFFFF);
+    state[2] = (unsigned short)((value >> 32) & 0xFFFF);
+}
+
+/**
+Equivalent to drand48(): uniformly distributed in [0, 1)
+*/
+double
+ThreadRandom::nextDouble() {
+    if ( !ownState ) {
+        return drand48();
+    }
+
+    unsigned long long x = (unsigned long long)state[0]
+        | ((unsigned long long)state[1] << 16)
+        | ((unsigned long long)state[2] << 32);
+    x = (MULTIPLIER * x + ADDEND) & MASK_48_BITS;
+    setState(x);
+
+    // Exact, 48 bits fit on the double mantissa
+    return (double)x * (1.0 / 281474976710656.0);
+}
+
+/**
+Equivalent to srand48()
+*/
+void
+ThreadRandom::setSeed(const long seed) {
+    if ( !ownState ) {
+        srand48(seed);
+        return;
+    }
+    setState((((unsigned long long)seed & 0xFFFFFFFFULL) << 16) | SRAND48_LOW_BITS);
+}
+
+/**
+Equivalent to seed48(): sets the state and returns a pointer to the previous one
+*/
+unsigned short *
+ThreadRandom::seed48(unsigned short seed16v[3]) {
+    if ( !ownState ) {
+        return ::seed48(seed16v);
+    }
+    previousState[0] = state[0];
+    previousState[1] = state[1];
+    previousState[2] = state[2];
+    state[0] = seed16v[0];
+    state[1] = seed16v[1];
+    state[2] = seed16v[2];
+    return previousState;
+}
+
+/**
+Makes the calling thread draw from its own state, initialized from seed
+*/
+void
+ThreadRandom::useOwnState(const unsigned long long seed) {
+    ownState = true;
+
+    // Spread the seed bits (splitmix64 finalizer), so consecutive seeds give unrelated states
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    setState(z & MASK_48_BITS);
+}
+
+/**
+Makes the calling thread go back to the process wide drand48() sequence
+*/
+void
+ThreadRandom::useProcessState() {
+    ownState = false;
+}
+
+/**
+Sets the calling thread's own state to a fixed value for the given pixel, so the
+pixel gets the same random numbers whichever thread computes it
+*/
+void
+ThreadRandom::setPixelSeed(const int x, const int y) {
+    useOwnState(PIXEL_SEED_BASE ^ (((unsigned long long)(unsigned int)y << 32) | (unsigned int)x));
+}
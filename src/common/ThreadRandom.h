@@ -0,0 +1,34 @@
+/**
+Random numbers for code that may run on several threads at once, such as the
+per pixel work of the ray tracers.
+
+By default every thread draws from the process wide drand48() sequence, so single
+threaded runs behave exactly as before. A thread can switch to a private 48 bit
+linear congruential state (same generator as drand48(), so the numbers have the
+same quality) by calling useOwnState() or setPixelSeed(). Private states make the
+random sequence of a pixel independent from the thread and order in which pixels
+are computed
+*/
+
+#ifndef __THREAD_RANDOM__
+#define __THREAD_RANDOM__
+
+class ThreadRandom {
+  private:
+    static thread_local bool ownState;
+    static thread_local unsigned short state[3];
+    static thread_local unsigned short previousState[3];
+
+    static void setState(unsigned long long value);
+
+  public:
+    static double nextDouble();
+    static void setSeed(long seed);
+    static unsigned short *seed48(unsigned short seed16v[3]);
+
+    static void useOwnState(unsigned long long seed);
+    static void useProcessState();
+    static void setPixelSeed(int x, int y);
+};
+
+#endif
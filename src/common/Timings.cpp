@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "common/Timings.h"
+
+java::ArrayList<TimingPhase *> *Timings::phases = nullptr;
+int Timings::currentPhase = -1;
+
+TimingPhase::TimingPhase(const char *inName, int inIndex, int inParent, int inDepth):
+    name(inName),
+    index(inIndex),
+    parent(inParent),
+    depth(inDepth),
+    wallStart(),
+    threadCpuStart(),
+    processCpuStart(),
+    wallSeconds(),
+    threadCpuSeconds(),
+    processCpuSeconds()
+{
+}
+
+static double
+timingsCpuClock(clockid_t clockId) {
+    timespec time{};
+    if ( clock_gettime(clockId, &time) != 0 ) {
+        return 0.0;
+    }
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+/**
+Seconds on a monotonic clock, only differences are meaningful
+*/
+double
+Timings::wallClock() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+CPU seconds used by the calling thread
+*/
+double
+Timings::threadCpuClock() {
+    return timingsCpuClock(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/**
+CPU seconds used by all threads of the process
+*/
+double
+Timings::processCpuClock() {
+    return timingsCpuClock(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/**
+Starts a phase inside the currently open one. Returns the handle to pass to end()
+*/
+int
+Timings::begin(const char *name, int index) {
+    if ( phases == nullptr ) {
+        phases = new java::ArrayList<TimingPhase *>();
+    }
+
+    int depth = currentPhase >= 0 ? phases->get(currentPhase)->depth + 1 : 0;
+    TimingPhase *phase = new TimingPhase(name, index, currentPhase, depth);
+    phases->add(phase);
+    currentPhase = (int)phases->size() - 1;
+
+    phase->threadCpuStart = threadCpuClock();
+    phase->processCpuStart = processCpuClock();
+    phase->wallStart = wallClock();
+    return currentPhase;
+}
+
+/**
+Ends the phase, together with any phase inside it still open, which get the same
+end time. Returns its wall clock seconds. Ending a phase that was already ended
+changes nothing
+*/
+double
+Timings::end(int phase) {
+    if ( phases == nullptr || phase < 0 || phase >= phases->size() ) {
+        return 0.0;
+    }
+
+    // The open phases are the current one and its ancestors
+    bool open = false;
+    for ( int i = currentPhase; i >= 0 && !open; i = phases->get(i)->parent ) {
+        open = i == phase;
+    }
+    if ( !open ) {
+        return phases->get(phase)->wallSeconds;
+    }
+
+    double wall = wallClock();
+    double threadCpu = threadCpuClock();
+    double processCpu = processCpuClock();
+
+    for ( int i = currentPhase; i != phases->get(phase)->parent; i = phases->get(i)->parent ) {
+        TimingPhase *timingPhase = phases->get(i);
+        timingPhase->wallSeconds = wall - timingPhase->wallStart;
+        timingPhase->threadCpuSeconds = threadCpu - timingPhase->threadCpuStart;
+        timingPhase->processCpuSeconds = processCpu - timingPhase->processCpuStart;
+    }
+    currentPhase = phases->get(phase)->parent;
+
+    return phases->get(phase)->wallSeconds;
+}
+
+/**
+Phase names from the top level one down to the given phase, separated by '/'
+*/
+void
+Timings::printPath(FILE *fp, int phase) {
+    const TimingPhase *timingPhase = phases->get(phase);
+
+    if ( timingPhase->parent >= 0 ) {
+        printPath(fp, timingPhase->parent);
+        fputc('/', fp);
+    }
+    fprintf(fp, "%s", timingPhase->name);
+    if ( timingPhase->index >= 0 ) {
+        fprintf(fp, "[%d]", timingPhase->index);
+    }
+}
+
+/**
+Writes all phases recorded so far, in the order they were started. The file is
+written as CSV when its name ends in ".csv" and as JSON otherwise
+*/
+bool
+Timings::writeReport(const char *fileName) {
+    FILE *fp = fopen(fileName, "w");
+    if ( fp == nullptr ) {
+        logError("Timings::writeReport", "Can't open file '%s' for writing", fileName);
+        return false;
+    }
+
+    long numberOfPhases = phases != nullptr ? phases->size() : 0;
+    size_t length = strlen(fileName);
+    bool csv = length >= 4 && strcmp(fileName + length - 4, ".csv") == 0;
+
+    if ( csv ) {
+        fprintf(fp, "path,name,index,depth,wall_seconds,thread_cpu_seconds,process_cpu_seconds\n");
+        for ( int i = 0; i < numberOfPhases; i++ ) {
+            const TimingPhase *phase = phases->get(i);
+            printPath(fp, i);
+            fprintf(fp, ",%s,%d,%d,%.6f,%.6f,%.6f\n",
+                    phase->name,
+                    phase->index,
+                    phase->depth,
+                    phase->wallSeconds,
+                    phase->threadCpuSeconds,
+                    phase->processCpuSeconds);
+        }
+    } else {
+        fprintf(fp, "{\n  \"phases\": [");
+        for ( int i = 0; i < numberOfPhases; i++ ) {
+            const TimingPhase *phase = phases->get(i);
+            fprintf(fp, "%s\n    {\"path\": \"", i > 0 ? "," : "");
+            printPath(fp, i);
+            fprintf(fp, "\", \"name\": \"%s\", \"index\": %d, \"parent\": %d, \"depth\": %d, "
+                        "\"wallSeconds\": %.6f, \"threadCpuSeconds\": %.6f, \"processCpuSeconds\": %.6f}",
+                    phase->name,
+                    phase->index,
+                    phase->parent,
+                    phase->depth,
+                    phase->wallSeconds,
+                    phase->threadCpuSeconds,
+                    phase->processCpuSeconds);
+        }
+        fprintf(fp, "\n  ]\n}\n");
+    }
+
+    fclose(fp);
+    return true;
+}
+
+void
+Timings::freeMemory() {
+    if ( phases == nullptr ) {
+        return;
+    }
+    for ( int i = 0; i < phases->size(); i++ ) {
+        delete phases->get(i);
+    }
+    delete phases;
+    phases = nullptr;
+    currentPhase = -1;
+}
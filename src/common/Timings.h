@@ -0,0 +1,56 @@
+/**
+Wall clock and CPU time of the phases of a run (scene loading, radiance iterations,
+ray tracing, image saving, ...).
+
+Phases nest: a phase started while another one is open becomes its child. Each
+phase records monotonic wall clock time, CPU time of the thread that timed it and
+CPU time of the whole process, so multithreaded phases show both how long they
+took and how much work all threads did. Phases are started and ended from the main
+thread only; measuring costs a few clock reads per phase.
+
+The recorded phases can be written as a JSON or CSV report for comparing runs
+*/
+
+#ifndef __TIMINGS__
+#define __TIMINGS__
+
+#include <cstdio>
+
+#include "java/util/ArrayList.h"
+
+class TimingPhase {
+  public:
+    const char *name; // Not copied, must be a string literal or outlive the report
+    int index; // Iteration number or similar, -1 if not used
+    int parent; // Position of the enclosing phase, -1 for top level phases
+    int depth;
+    double wallStart;
+    double threadCpuStart;
+    double processCpuStart;
+    double wallSeconds;
+    double threadCpuSeconds;
+    double processCpuSeconds;
+
+    TimingPhase(const char *inName, int inIndex, int inParent, int inDepth);
+};
+
+class Timings {
+  private:
+    static java::ArrayList<TimingPhase *> *phases;
+    static int currentPhase;
+
+    static void printPath(FILE *fp, int phase);
+
+  public:
+    static double wallClock();
+    static double threadCpuClock();
+    static double processCpuClock();
+
+    static int begin(const char *name, int index = -1);
+    static double end(int phase);
+
+    static bool writeReport(const char *fileName);
+    static void freeMemory();
+};
+
+#endif
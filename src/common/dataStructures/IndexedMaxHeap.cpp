@@ -0,0 +1,147 @@
+#include "common/dataStructures/IndexedMaxHeap.h"
+
+IndexedMaxHeap::IndexedMaxHeap(int inNumberOfItems):
+    numberOfItems(inNumberOfItems),
+    size()
+{
+    heap = new int[numberOfItems > 0 ? numberOfItems : 1];
+    position = new int[numberOfItems > 0 ? numberOfItems : 1];
+    key = new float[numberOfItems > 0 ? numberOfItems : 1];
+    for ( int i = 0; i < numberOfItems; i++ ) {
+        position[i] = -1;
+        key[i] = 0.0f;
+    }
+}
+
+IndexedMaxHeap::~IndexedMaxHeap() {
+    delete[] heap;
+    delete[] position;
+    delete[] key;
+}
+
+bool
+IndexedMaxHeap::before(int item1, int item2) const {
+    return key[item1] > key[item2] || (key[item1] == key[item2] && item1 < item2);
+}
+
+void
+IndexedMaxHeap::place(int item, int heapPosition) {
+    heap[heapPosition] = item;
+    position[item] = heapPosition;
+}
+
+void
+IndexedMaxHeap::siftUp(int heapPosition) {
+    int item = heap[heapPosition];
+    while ( heapPosition > 0 ) {
+        int parentPosition = (heapPosition - 1) / 2;
+        if ( !before(item, heap[parentPosition]) ) {
+            break;
+        }
+        place(heap[parentPosition], heapPosition);
+        heapPosition = parentPosition;
+    }
+    place(item, heapPosition);
+}
+
+void
+IndexedMaxHeap::siftDown(int heapPosition) {
+    int item = heap[heapPosition];
+    while ( true ) {
+        int childPosition = 2 * heapPosition + 1;
+        if ( childPosition >= size ) {
+            break;
+        }
+        if ( childPosition + 1 < size && before(heap[childPosition + 1], heap[childPosition]) ) {
+            childPosition++;
+        }
+        if ( !before(heap[childPosition], item) ) {
+            break;
+        }
+        place(heap[childPosition], heapPosition);
+        heapPosition = childPosition;
+    }
+    place(item, heapPosition);
+}
+
+void
+IndexedMaxHeap::removeAt(int heapPosition) {
+    int item = heap[heapPosition];
+    position[item] = -1;
+    size--;
+    if ( heapPosition == size ) {
+        return;
+    }
+    int moved = heap[size];
+    place(moved, heapPosition);
+    siftUp(heapPosition);
+    if ( position[moved] == heapPosition ) {
+        siftDown(heapPosition);
+    }
+}
+
+int
+IndexedMaxHeap::getNumberOfItems() const {
+    return numberOfItems;
+}
+
+bool
+IndexedMaxHeap::isEmpty() const {
+    return size == 0;
+}
+
+/**
+Item with the largest key, -1 if the heap is empty
+*/
+int
+IndexedMaxHeap::top() const {
+    return size > 0 ? heap[0] : -1;
+}
+
+/**
+Removes the item with the largest key from the heap and returns it, -1 if the
+heap is empty. It comes back with the next update() giving it a positive key
+*/
+int
+IndexedMaxHeap::pop() {
+    if ( size == 0 ) {
+        return -1;
+    }
+    int item = heap[0];
+    removeAt(0);
+    return item;
+}
+
+/**
+Sets the key of the item, adding it to or removing it from the heap when
+it becomes positive or not
+*/
+void
+IndexedMaxHeap::update(int item, float newKey) {
+    int heapPosition = position[item];
+    if ( heapPosition < 0 ) {
+        key[item] = newKey;
+        if ( newKey > 0.0f ) {
+            place(item, size);
+            size++;
+            siftUp(size - 1);
+        }
+        return;
+    }
+
+    if ( newKey == key[item] ) {
+        return;
+    }
+    if ( !(newKey > 0.0f) ) {
+        key[item] = newKey;
+        removeAt(heapPosition);
+        return;
+    }
+    bool increased = newKey > key[item];
+    key[item] = newKey;
+    if ( increased ) {
+        siftUp(heapPosition);
+    } else {
+        siftDown(heapPosition);
+    }
+}
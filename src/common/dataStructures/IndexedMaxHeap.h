@@ -0,0 +1,36 @@
+#ifndef __INDEXED_MAX_HEAP__
+#define __INDEXED_MAX_HEAP__
+
+/**
+Binary max heap over the items 0 .. numberOfItems - 1, each with a float key.
+The position of every item in the heap is kept, so the key of any item can be
+changed in O(log n). Only items with a positive key are in the heap. Of items
+with the same key, the one with the lowest index comes first, so the top is the
+same item a linear scan for the first maximum would find
+*/
+class IndexedMaxHeap {
+  private:
+    int numberOfItems;
+    int size;
+    int *heap; // Items, in heap order
+    int *position; // Position of each item in the heap, -1 if not in the heap
+    float *key;
+
+    bool before(int item1, int item2) const;
+    void place(int item, int heapPosition);
+    void siftUp(int heapPosition);
+    void siftDown(int heapPosition);
+    void removeAt(int heapPosition);
+
+  public:
+    explicit IndexedMaxHeap(int inNumberOfItems);
+    ~IndexedMaxHeap();
+
+    int getNumberOfItems() const;
+    bool isEmpty() const;
+    int top() const;
+    int pop();
+    void update(int item, float newKey);
+};
+
+#endif
@@ -1,6 +1,11 @@
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
+#ifdef __SSE__
+    #include <xmmintrin.h>
+#endif
+
 #include "java/lang/Math.h"
 #include "common/error.h"
 #include "common/linealAlgebra/Numeric.h"
@@ -11,44 +16,6 @@
 
 const float KD_MAX_RADIUS = 1e10;
 
-// KD Tree with one data element per node
-float *KDTree::distances = nullptr;
-
-class KDQuery {
-  public:
-    float *point;
-    int wantedN;
-    int foundN;
-    bool notFilled;
-    float **results;
-    float *distances;
-    float maximumDistance;
-    float sqrRadius;
-    short excludeFlags;
-
-    KDQuery():
-        point(),
-        wantedN(),
-        foundN(),
-        notFilled(),
-        results(),
-        distances(),
-        maximumDistance(),
-        sqrRadius(),
-        excludeFlags()
-    {}
-
-    void print() const {
-        printf("Point X %g, Y %g, Z %g\n", point[0], point[1], point[2]);
-        printf("Wanted N: %i, found N: %i\n", wantedN, foundN);
-        printf("maximumDistance %g\n", maximumDistance);
-        printf("sqrRadius %g\n", sqrRadius);
-        printf("excludeFlags %x\n", (int) excludeFlags);
-    }
-};
-
-static KDQuery GLOBAL_qDatS;
-
 KDTree::KDTree(int inDataSize, bool CopyData) {
     dataSize = inDataSize;
     numberOfNodes = 0;
@@ -57,15 +24,18 @@ KDTree::KDTree(int inDataSize, bool CopyData) {
     root = nullptr;
 
     numBalanced = 0;
-    balancedRootNode = nullptr;
+    numberOfBuckets = 0;
+    splitValues = nullptr;
+    splitDiscriminators = nullptr;
+    bucketStart = nullptr;
+    balancedX = nullptr;
+    balancedY = nullptr;
+    balancedZ = nullptr;
+    balancedData = nullptr;
+    balancedFlags = nullptr;
+    balancedDataBlock = nullptr;
 
     copyData = CopyData;
-
-    if ( distances == nullptr ) {
-        // Maximum 1000!
-        distances = new float[1000];
-    }
-    firstLeaf = 0;
 }
 
 void
@@ -86,18 +56,39 @@ KDTree::deleteNodes(KDTreeNode *node, bool deleteData) {
 
 void
 KDTree::deleteBNodes(bool deleteData) {
-    if ( balancedRootNode == nullptr ) {
+    if ( balancedData == nullptr ) {
         return;
     }
 
-    if ( deleteData ) {
-        for ( int node = 0; node < numBalanced; node++ ) {
-            free(balancedRootNode[node].m_data);
+    if ( balancedDataBlock != nullptr ) {
+        if ( deleteData ) {
+            free(balancedDataBlock);
+        }
+    } else if ( deleteData ) {
+        for ( int i = 0; i < numBalanced; i++ ) {
+            free(balancedData[i]);
         }
     }
 
-    delete[] balancedRootNode;
-    balancedRootNode = nullptr;
+    delete[] splitValues;
+    delete[] splitDiscriminators;
+    delete[] bucketStart;
+    delete[] balancedX;
+    delete[] balancedY;
+    delete[] balancedZ;
+    delete[] balancedData;
+    delete[] balancedFlags;
+
+    splitValues = nullptr;
+    splitDiscriminators = nullptr;
+    bucketStart = nullptr;
+    balancedX = nullptr;
+    balancedY = nullptr;
+    balancedZ = nullptr;
+    balancedData = nullptr;
+    balancedFlags = nullptr;
+    balancedDataBlock = nullptr;
+    numberOfBuckets = 0;
 }
 
 KDTree::~KDTree() {
@@ -211,10 +202,38 @@ KDTree::iterateNodes(void (*callBack)(void *, void *), void *data) {
     }
 
     for ( int i = 0; i < numBalanced; i++ ) {
-        callBack(data, balancedRootNode[i].m_data);
+        callBack(data, balancedData[i]);
     }
 }
 
+KDQuery::KDQuery(
+    float *inPoint,
+    int N,
+    void *inResults,
+    float *inDistances,
+    float radius,
+    short inExcludeFlags):
+    point(inPoint),
+    wantedN(N),
+    foundN(0),
+    notFilled(true),
+    results((float **)inResults),
+    distances(inDistances),
+    maximumDistance(radius),
+    sqrRadius(radius),
+    excludeFlags(inExcludeFlags)
+{
+}
+
+void
+KDQuery::print() const {
+    printf("Point X %g, Y %g, Z %g\n", point[0], point[1], point[2]);
+    printf("Wanted N: %i, found N: %i\n", wantedN, foundN);
+    printf("maximumDistance %g\n", maximumDistance);
+    printf("sqrRadius %g\n", sqrRadius);
+    printf("excludeFlags %x\n", (int) excludeFlags);
+}
+
 /**
 Query the kd tree : both balanced and unbalanced parts taken into
 account ! (The balanced part is searched first)
@@ -226,46 +245,42 @@ KDTree::query(
     void *results,
     float *inDistances,
     float radius,
-    short excludeFlags)
+    short excludeFlags) const
 {
-    int numberFound;
-    float *usedDistances;
+    // Distances are needed for the max heap even when the caller does not want them
+    float localDistances[KD_MAXIMUM_QUERY_RESULTS];
+    float *usedDistances = inDistances;
 
     if ( inDistances == nullptr ) {
-        if ( N > 1000 ) {
+        if ( N > KD_MAXIMUM_QUERY_RESULTS ) {
             logError("KDTree::query", "Too many nodes requested");
             return 0;
         }
-        usedDistances = inDistances;
-    } else {
-        usedDistances = inDistances;
+        usedDistances = localDistances;
     }
 
-    // Fill in static class data
-    GLOBAL_qDatS.point = point;
-    GLOBAL_qDatS.wantedN = N;
-    GLOBAL_qDatS.foundN = 0;
-    GLOBAL_qDatS.results = (float **) results;
-    GLOBAL_qDatS.distances = usedDistances;
-    GLOBAL_qDatS.maximumDistance = radius;
-    GLOBAL_qDatS.sqrRadius = radius;
-    GLOBAL_qDatS.excludeFlags = excludeFlags;
-    GLOBAL_qDatS.notFilled = true;
+    KDQuery context(point, N, results, usedDistances, radius, excludeFlags);
+    return query(&context);
+}
 
+/**
+Query with a caller owned context. The tree is only read, so several threads can
+query it at the same time, each one with its own context
+*/
+int
+KDTree::query(KDQuery *context) const {
     // First query balanced part
-    if ( balancedRootNode != nullptr ) {
-        balancedQueryRec(0);
+    if ( balancedData != nullptr ) {
+        balancedQueryRec(0, context);
     }
 
     // Now query unbalanced part using the already found nodes
     // from the balanced part
     if ( root ) {
-        queryRec(root);
+        queryRec(root, context);
     }
 
-    numberFound = GLOBAL_qDatS.foundN;
-
-    return numberFound;
+    return context->foundN;
 }
 
 /**
@@ -289,30 +304,30 @@ sqrDistance3D(const float *a, const float *b) {
 }
 
 /**
-Max heap stuff, using static GLOBAL_qDatS (fastest !!)
+Max heap stuff, on the query context results and distances arrays
 Adapted from patched POVRAY (megasrc), who took it from Sejwick
 */
 inline static void
-fixUp() {
-    // Ripple the node (qdat_s.foundN) upward. There are qdat_s.foundN + 1 nodes
+fixUp(KDQuery *q) {
+    // Ripple the node (q->foundN) upward. There are q->foundN + 1 nodes
     // in the tree
     int son;
     int parent;
     float tmpDist;
     float *tmpData;
 
-    son = GLOBAL_qDatS.foundN;
+    son = q->foundN;
     parent = (son - 1) >> 1;  // Root of tree == index 0 so parent = any son - 1 / 2
 
-    while ( (son > 0) && GLOBAL_qDatS.distances[parent] < GLOBAL_qDatS.distances[son] ) {
-        tmpDist = GLOBAL_qDatS.distances[parent];
-        tmpData = GLOBAL_qDatS.results[parent];
+    while ( (son > 0) && q->distances[parent] < q->distances[son] ) {
+        tmpDist = q->distances[parent];
+        tmpData = q->results[parent];
 
-        GLOBAL_qDatS.distances[parent] = GLOBAL_qDatS.distances[son];
-        GLOBAL_qDatS.results[parent] = GLOBAL_qDatS.results[son];
+        q->distances[parent] = q->distances[son];
+        q->results[parent] = q->results[son];
 
-        GLOBAL_qDatS.distances[son] = tmpDist;
-        GLOBAL_qDatS.results[son] = tmpData;
+        q->distances[son] = tmpDist;
+        q->results[son] = tmpData;
 
         son = parent;
         parent = (son - 1) >> 1;
@@ -320,53 +335,53 @@ fixUp() {
 }
 
 inline static void
-mhInsert(float *data, float dist) {
-    GLOBAL_qDatS.distances[GLOBAL_qDatS.foundN] = dist;
-    GLOBAL_qDatS.results[GLOBAL_qDatS.foundN] = data;
+mhInsert(KDQuery *q, float *data, float dist) {
+    q->distances[q->foundN] = dist;
+    q->results[q->foundN] = data;
 
-    fixUp();
+    fixUp(q);
 
     // If all the photons are filled, we can use the actual maximum distance
-    if ( ++GLOBAL_qDatS.foundN == GLOBAL_qDatS.wantedN ) {
-        GLOBAL_qDatS.maximumDistance = GLOBAL_qDatS.distances[0];
-        GLOBAL_qDatS.notFilled = false;
+    if ( ++q->foundN == q->wantedN ) {
+        q->maximumDistance = q->distances[0];
+        q->notFilled = false;
     }
 }
 
 inline static void
-fixDown() {
+fixDown(KDQuery *q) {
     // Ripple the top node, which may not be max anymore downwards
-    // There are qdat_s.foundN nodes in the tree, starting at index 0
+    // There are q->foundN nodes in the tree, starting at index 0
     int son;
     int parent;
     float tmpDist;
     float *tmpData;
 
-    int max = GLOBAL_qDatS.foundN;
+    int max = q->foundN;
 
     parent = 0;
     son = 1;
 
     while ( son < max ) {
-        if ( GLOBAL_qDatS.distances[son] <= GLOBAL_qDatS.distances[parent] ) {
-            if ((++son >= max) || GLOBAL_qDatS.distances[son] <= GLOBAL_qDatS.distances[parent] ) {
+        if ( q->distances[son] <= q->distances[parent] ) {
+            if ((++son >= max) || q->distances[son] <= q->distances[parent] ) {
                 return; // Node in place, left son and right son smaller
             }
         } else {
-            if ((son + 1 < max) && GLOBAL_qDatS.distances[son + 1] > GLOBAL_qDatS.distances[son] ) {
+            if ((son + 1 < max) && q->distances[son + 1] > q->distances[son] ) {
                 son++; // Take maximum of the two sons
             }
         }
 
         // Swap because son > parent
-        tmpDist = GLOBAL_qDatS.distances[parent];
-        tmpData = GLOBAL_qDatS.results[parent];
+        tmpDist = q->distances[parent];
+        tmpData = q->results[parent];
 
-        GLOBAL_qDatS.distances[parent] = GLOBAL_qDatS.distances[son];
-        GLOBAL_qDatS.results[parent] = GLOBAL_qDatS.results[son];
+        q->distances[parent] = q->distances[son];
+        q->results[parent] = q->results[son];
 
-        GLOBAL_qDatS.distances[son] = tmpDist;
-        GLOBAL_qDatS.results[son] = tmpData;
+        q->distances[son] = tmpDist;
+        q->results[son] = tmpData;
 
         parent = son;
         son = (parent << 1) + 1;
@@ -374,44 +389,44 @@ fixDown() {
 }
 
 inline static void
-mhReplaceMax(float *data, float dist) {
+mhReplaceMax(KDQuery *q, float *data, float dist) {
     // Top = maximum element. Replace it with new and ripple down
     // The heap is full (foundN == wantedN), but this is not required
 
-    *GLOBAL_qDatS.distances = dist; // Top
-    *GLOBAL_qDatS.results = data;
+    *q->distances = dist; // Top
+    *q->results = data;
 
-    fixDown();
+    fixDown(q);
 
-    GLOBAL_qDatS.maximumDistance = *GLOBAL_qDatS.distances; // Max = top of heap
+    q->maximumDistance = *q->distances; // Max = top of heap
 }
 
 /**
 Query_rec for the unbalanced kd tree part
 */
 void
-KDTree::queryRec(const KDTreeNode *node) {
+KDTree::queryRec(const KDTreeNode *node, KDQuery *q) const {
     int discriminator = node->discriminator();
     float dist;
     const KDTreeNode *nearNode;
     const KDTreeNode *farNode;
 
-    dist = sqrDistance3D((float *) node->m_data, GLOBAL_qDatS.point);
+    dist = sqrDistance3D((float *) node->m_data, q->point);
 
-    if ( dist < GLOBAL_qDatS.maximumDistance ) {
-        if ( GLOBAL_qDatS.notFilled ) {
+    if ( dist < q->maximumDistance ) {
+        if ( q->notFilled ) {
             // Add this point anyway, because we haven't got enough positions yet.
             // We have to check for the radius only here, since if N positions
             // are added, maximumDistance <= radius
-            mhInsert((float *) node->m_data, dist);
+            mhInsert(q, (float *) node->m_data, dist);
         } else {
             // Add point if distance < maximumDistance
-            mhReplaceMax((float *) node->m_data, dist);
+            mhReplaceMax(q, (float *) node->m_data, dist);
         }
     }
 
     // Reuse distance
-    dist = ((float *) node->m_data)[discriminator] - GLOBAL_qDatS.point[discriminator];
+    dist = ((float *) node->m_data)[discriminator] - q->point[discriminator];
 
     if ( dist >= 0.0 ) {
         nearNode = node->loson;
@@ -423,71 +438,102 @@ KDTree::queryRec(const KDTreeNode *node) {
 
     // Always call near node recursively
     if ( nearNode ) {
-        queryRec(nearNode);
+        queryRec(nearNode, q);
     }
 
     dist *= dist; // Square distance to the separator plane
-    if ( farNode && (((GLOBAL_qDatS.foundN < GLOBAL_qDatS.wantedN) &&
-                        (dist < GLOBAL_qDatS.sqrRadius)) ||
-                       (dist < GLOBAL_qDatS.maximumDistance)) ) {
+    if ( farNode && (((q->foundN < q->wantedN) &&
+                        (dist < q->sqrRadius)) ||
+                       (dist < q->maximumDistance)) ) {
         // Discriminator line closer than maximumDistance : nearer positions can lie
         // on the far side. Or there are still not enough nodes found
-        queryRec(farNode);
+        queryRec(farNode, q);
     }
 }
 
 /**
-Query_rec for the unbalanced kd tree part
+Squared distances from point to the points of a bucket, returns the number of
+points in the bucket. distances must have room for KD_MAXIMUM_BUCKET_SIZE values
 */
-void
-KDTree::balancedQueryRec(int index) {
-    const BalancedKDTreeNode &node = balancedRootNode[index];
-    int discr = node.discriminator();
-    float dist;
-    int nearIndex;
-    int farIndex;
-
-    // Recursive call to the child nodes
-
-    // Test discr (reuse distance)
-    if ( index < firstLeaf ) {
-        dist = ((float *) node.m_data)[discr] - GLOBAL_qDatS.point[discr];
+int
+KDTree::bucketSquaredDistances(int bucket, const float *point, float *distances) const {
+    int first = bucketStart[bucket];
+    int count = bucketStart[bucket + 1] - first;
+
+#ifdef __SSE__
+    // Four points at a time, the coordinate arrays are padded for the last group
+    __m128 px = _mm_set1_ps(point[0]);
+    __m128 py = _mm_set1_ps(point[1]);
+    __m128 pz = _mm_set1_ps(point[2]);
+
+    for ( int i = 0; i < count; i += 4 ) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(balancedX + first + i), px);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(balancedY + first + i), py);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(balancedZ + first + i), pz);
+        __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(distances + i, result);
+    }
+#else
+    for ( int i = 0; i < count; i++ ) {
+        float dx = balancedX[first + i] - point[0];
+        float dy = balancedY[first + i] - point[1];
+        float dz = balancedZ[first + i] - point[2];
+        distances[i] = dx * dx + dy * dy + dz * dz;
+    }
+#endif
+
+    return count;
+}
 
-        if ( dist >= 0.0 ) {
-            nearIndex = (index << 1) + 1; // node loson
-            farIndex = nearIndex + 1; // node hison
-        } else {
-            farIndex = (index << 1) + 1; // node loson
-            nearIndex = farIndex + 1; // node hison
+/**
+Query_rec for the balanced kd tree part
+*/
+void
+KDTree::balancedQueryRec(int index, KDQuery *q) const {
+    if ( index >= numberOfBuckets - 1 ) {
+        // Bucket: test all its points
+        float distances[KD_MAXIMUM_BUCKET_SIZE];
+        int bucket = index - (numberOfBuckets - 1);
+        int first = bucketStart[bucket];
+        int count = bucketSquaredDistances(bucket, q->point, distances);
+
+        for ( int i = 0; i < count; i++ ) {
+            if ( distances[i] < q->maximumDistance ) {
+                if ( q->notFilled ) {
+                    // Add this point anyway, because we haven't got enough positions yet.
+                    // We have to check for the radius only here, since if N positions
+                    // are added, maximumDistance <= radius
+                    mhInsert(q, (float *)balancedData[first + i], distances[i]);
+                } else {
+                    // Add point if distance < maximumDistance
+                    mhReplaceMax(q, (float *)balancedData[first + i], distances[i]);
+                }
+            }
         }
+        return;
+    }
 
-        // Always call near node recursively
-        if ( nearIndex < numBalanced ) {
-            balancedQueryRec(nearIndex);
-        }
+    int discr = splitDiscriminators[index];
+    float dist = splitValues[index] - q->point[discr];
+    int nearIndex;
+    int farIndex;
 
-        dist *= dist; // Square distance to the separator plane
-        if ((farIndex < numBalanced) && (((GLOBAL_qDatS.notFilled) && // qdat_s.foundN < qdat_s.wantedN
-                                            (dist < GLOBAL_qDatS.sqrRadius)) ||
-                                         (dist < GLOBAL_qDatS.maximumDistance)) ) {
-            // Discriminator line closer than maximumDistance : nearer positions can lie
-            // on the far side. Or there are still not enough nodes found
-            balancedQueryRec(farIndex);
-        }
+    if ( dist >= 0.0 ) {
+        nearIndex = (index << 1) + 1; // Low side
+        farIndex = nearIndex + 1; // High side
+    } else {
+        farIndex = (index << 1) + 1;
+        nearIndex = farIndex + 1;
     }
 
-    dist = sqrDistance3D((float *)node.m_data, GLOBAL_qDatS.point);
+    // Always call near node recursively
+    balancedQueryRec(nearIndex, q);
 
-    if ( dist < GLOBAL_qDatS.maximumDistance ) {
-        if ( GLOBAL_qDatS.notFilled ) {
-            // Add this point anyway, because we haven't got enough positions yet.
-            // We have to check for the radius only here, since if N positions
-            // are added, maximumDistance <= radius
-            mhInsert((float *) node.m_data, dist);
-        } else {
-            // Add point if distance < maximumDistance
-            mhReplaceMax((float *) node.m_data, dist);
-        }
+    dist *= dist; // Square distance to the separator plane
+    if ( ((q->notFilled) && (dist < q->sqrRadius)) || (dist < q->maximumDistance) ) {
+        // Discriminator line closer than maximumDistance : nearer positions can lie
+        // on the far side. Or there are still not enough nodes found
+        balancedQueryRec(farIndex, q);
     }
 }
 
@@ -523,51 +569,21 @@ bkdval(BalancedKDTreeNode root[], int index, int discr) {
     return ((float *)root[index].m_data)[discr];
 }
 
-int
-getBalancedMedian(int low, int high) {
-    int N = high - low + 1;  // High inclusive
-
-    if ( N <= 1 ) {
-        return low;
-    }
-
-    int FL;
-    // Add 0.1 because integer powers of 2 sometimes gave a smaller FL (8 -> 2)
-    FL = (int) (java::Math::log(N + 0.1) / M_LN2);
-
-    int P2FL = (1 << FL); // 2^FL
-    int LASTN = N - (P2FL - 1);  // Number of elements on last level
-    int LASTS_2 = P2FL / 2; // Half the room for elements on last level
-    int left;
-
-    if ( LASTN < LASTS_2 ) {
-        // All in left subtree
-        left = LASTN + (LASTS_2 - 1);
-    } else {
-        // Full bottom level in left subtree
-        left = LASTS_2 + LASTS_2 - 1;
-        // Rest in right subtree
-    }
-
-    return low + left;
-}
-
 /**
-Return index of median element
+Puts on position median the element that would be there if broot[low..high] was
+sorted on coordinate discr, smaller or equal elements before it and greater or
+equal ones after it
 */
-static int
-quickSelect(BalancedKDTreeNode broot[], int low, int high, int discr) {
-    int median;
+static void
+quickSelect(BalancedKDTreeNode broot[], int low, int high, int median, int discr) {
     int middle;
     int ll;
     int hh;
 
-    median = getBalancedMedian(low, high);
-
     for ( ;; ) {
         if ( high <= low ) {
             // One element only
-            return median;
+            return;
         }
 
         if ( high == low + 1 ) {
@@ -575,7 +591,7 @@ quickSelect(BalancedKDTreeNode broot[], int low, int high, int discr) {
             if ( E_VAL(low) > E_VAL(high) ) {
                 E_SWAP(low, high);
             }
-            return median;
+            return;
         }
 
         // Find median of low, middle and high volumeListsOfItems; swap into position low
@@ -686,38 +702,76 @@ bestDiscriminator(BalancedKDTreeNode broot[], int low, int high) {
 }
 
 /**
-balance the tree recursively
+Splits broot[low..high] (high inclusive) for inner node nodeIndex, on the coordinate
+with largest spread at the median. Partitioning is done in place, so at the end
+broot is in bucket order
 */
 void
-KDTree::balanceRec(
-    BalancedKDTreeNode broot[],
-    BalancedKDTreeNode dest[],
-    int destIndex,
-    int low,
-    int high) // High inclusive!
-{
-    if ( low == high ) {
-        // Put it in dest
-        dest[destIndex] = broot[low];
-        dest[destIndex].setDiscriminator(0); // Don't care
+KDTree::balanceRec(BalancedKDTreeNode broot[], int nodeIndex, int low, int high) {
+    if ( nodeIndex >= numberOfBuckets - 1 ) {
+        bucketStart[nodeIndex - (numberOfBuckets - 1)] = low;
         return;
     }
 
-    int discr = bestDiscriminator(broot, low, high);
-    // Find the balance median element
-    int median = quickSelect(broot, low, high, discr);
+    int discr = 0;
+    int median = (low + high + 1) / 2; // First element of the high side
 
-    // Put it in dest
-    dest[destIndex] = broot[median];
-    dest[destIndex].setDiscriminator(discr);
+    if ( low <= high ) {
+        discr = bestDiscriminator(broot, low, high);
+        quickSelect(broot, low, high, median, discr);
+    }
+
+    splitDiscriminators[nodeIndex] = (unsigned char)discr;
+    splitValues[nodeIndex] = median <= high ? bkdval(broot, median, discr) : 0.0f;
 
-    // Recurse low and high array
-    if ( low < median ) {
-        // High inclusive!
-        balanceRec(broot, dest, (destIndex << 1) + 1, low, median - 1);
+    balanceRec(broot, (nodeIndex << 1) + 1, low, median - 1);
+    balanceRec(broot, (nodeIndex << 1) + 2, median, high);
+}
+
+static inline bool
+isInBlock(const void *data, const char *block, long blockSize) {
+    return block != nullptr && (const char *)data >= block && (const char *)data < block + blockSize;
+}
+
+/**
+Fills the point arrays from broot, which is in bucket order. Owned data is moved
+to one contiguous block in the same order
+*/
+void
+KDTree::storeBalanced(const BalancedKDTreeNode broot[]) {
+    int padding = 4;
+
+    balancedX = new float[numBalanced + padding];
+    balancedY = new float[numBalanced + padding];
+    balancedZ = new float[numBalanced + padding];
+    balancedData = new void *[numBalanced];
+    balancedFlags = new int[numBalanced];
+
+    if ( copyData ) {
+        balancedDataBlock = (char *)malloc(numBalanced * dataSize);
+    }
+
+    for ( int i = 0; i < numBalanced; i++ ) {
+        const float *point = (const float *)broot[i].m_data;
+
+        balancedX[i] = point[0];
+        balancedY[i] = point[1];
+        balancedZ[i] = point[2];
+        balancedFlags[i] = broot[i].m_flags;
+
+        if ( copyData ) {
+            balancedData[i] = balancedDataBlock + i * dataSize;
+            memcpy(balancedData[i], broot[i].m_data, dataSize);
+        } else {
+            balancedData[i] = broot[i].m_data;
+        }
+    }
+
+    for ( int i = numBalanced; i < numBalanced + padding; i++ ) {
+        balancedX[i] = KD_MAX_RADIUS;
+        balancedY[i] = KD_MAX_RADIUS;
+        balancedZ[i] = KD_MAX_RADIUS;
     }
-    if ( high > median )
-        balanceRec(broot, dest, (destIndex << 1) + 2, median + 1, high);  // High inclusive!
 }
 
 /**
@@ -733,41 +787,57 @@ KDTree::balance() {
 
     fprintf(stderr, "Balancing kd-tree: %i nodes...\n", numberOfNodes);
 
-    BalancedKDTreeNode *broot = new BalancedKDTreeNode[numberOfNodes + 1];
-
-    broot[numberOfNodes].m_data = nullptr;
-    broot[numberOfNodes].m_flags = 128;
+    BalancedKDTreeNode *broot = new BalancedKDTreeNode[numberOfNodes];
 
     int index = 0;
 
     // Copy balanced
     for ( int i = 0; i < numBalanced; i++ ) {
-        broot[index++] = balancedRootNode[i];
+        broot[index].m_data = balancedData[i];
+        broot[index].m_flags = balancedFlags[i];
+        index++;
     }
 
     // Copy unbalanced
     copyUnbalancedRec(root, broot, &index);
 
-    // Clear old balanced and unbalanced part (but no data delete)
+    // Keep the old data block until its contents are copied, the tree arrays can go
+    char *oldDataBlock = balancedDataBlock;
+    long oldDataBlockSize = numBalanced * dataSize;
+    balancedDataBlock = nullptr;
+    deleteBNodes(false);
+
     deleteNodes(root, false);
     root = nullptr;
     numUnbalanced = 0;
 
-    deleteBNodes(false);
-
     numBalanced = numberOfNodes;
-    BalancedKDTreeNode *dest = new BalancedKDTreeNode[numberOfNodes + 1]; // Could we do with just 1 array???
+    numberOfBuckets = 1;
+    while ( numberOfBuckets * KD_MAXIMUM_BUCKET_SIZE < numBalanced ) {
+        numberOfBuckets <<= 1;
+    }
 
-    dest[numberOfNodes].m_data = nullptr;
-    dest[numberOfNodes].m_flags = 64;
+    splitValues = new float[numberOfBuckets];
+    splitDiscriminators = new unsigned char[numberOfBuckets];
+    bucketStart = new int[numberOfBuckets + 1];
+    bucketStart[numberOfBuckets] = numBalanced;
 
     // Now balance the tree recursively
-    balanceRec(broot, dest, 0, 0, numberOfNodes - 1);  // High inclusive!
+    balanceRec(broot, 0, 0, numBalanced - 1);  // High inclusive!
 
-    balancedRootNode = dest;
-    delete[] broot;
+    storeBalanced(broot);
 
-    firstLeaf = (numBalanced + 1) / 2;
+    if ( copyData ) {
+        // Data of points added since the last balancing was allocated one by one
+        for ( int i = 0; i < numBalanced; i++ ) {
+            if ( !isInBlock(broot[i].m_data, oldDataBlock, oldDataBlockSize) ) {
+                free(broot[i].m_data);
+            }
+        }
+        free(oldDataBlock);
+    }
+
+    delete[] broot;
 
     fprintf(stderr, "done\n");
 }
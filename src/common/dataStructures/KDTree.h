@@ -24,8 +24,8 @@ virtual KDTree void )
  
 Interrogation :
 
-virtual int query(const float *point, int N, void *results,
-	     float *distances = nullptr, float radius = HUGE_DOUBLE_VALUE)
+int query(const float *point, int N, void *results,
+	     float *distances = nullptr, float radius = HUGE_DOUBLE_VALUE) const
 
  Gives a maximum of N positions that are closest to the query point
  ('point'). An optional radius defines the maximum distance
@@ -54,6 +54,39 @@ Ref : - Bentley, J.L. (1975) Multidimensional search trees used for
 // Not HUGE_DOUBLE_VALUE, since we need to square it
 extern const float KD_MAX_RADIUS;
 
+// Maximum N for queries that do not supply a distances array
+#define KD_MAXIMUM_QUERY_RESULTS 1000
+
+// Maximum number of points on a bucket of the balanced tree part
+#define KD_MAXIMUM_BUCKET_SIZE 8
+
+/**
+State of one nearest neighbours query: parameters and the max heap of points found
+so far, kept on the caller supplied results and distances arrays
+*/
+class KDQuery {
+  public:
+    float *point;
+    int wantedN;
+    int foundN;
+    bool notFilled;
+    float **results;
+    float *distances;
+    float maximumDistance;
+    float sqrRadius;
+    short excludeFlags;
+
+    KDQuery(
+        float *inPoint,
+        int N,
+        void *inResults,
+        float *inDistances,
+        float radius = KD_MAX_RADIUS,
+        short inExcludeFlags = 0);
+
+    void print() const;
+};
+
 class KDTreeNode {
   public:
     KDTreeNode *loson;
@@ -78,8 +111,7 @@ class KDTreeNode {
 };
 
 /**
-Node for a balanced kd tree, nodes are placed in arrays
-and no loson, hison pointers are necessary
+Point of the kd tree while it is being balanced
 */
 class BalancedKDTreeNode {
   public:
@@ -100,24 +132,46 @@ class BalancedKDTreeNode {
     }
 };
 
+/**
+The balanced part of the tree is a complete binary tree of split planes over
+buckets of at most KD_MAXIMUM_BUCKET_SIZE points. Inner nodes are stored in heap
+order (children of node i at 2i + 1 and 2i + 2) and are followed by the buckets.
+Point coordinates are kept as separate x, y and z arrays in bucket order, so the
+points of a bucket are contiguous and are tested several at a time. The data
+pointers are in the same order, and when the tree owns the data the blocks are
+moved to one contiguous array too
+*/
 class KDTree {
   protected:
     int numberOfNodes;
     long dataSize;
     int numUnbalanced;
     KDTreeNode *root;  // Start of non balanced part of the kd tree
-    int numBalanced;
-    int firstLeaf; // (numBalanced+1) / 2 : index of first leaf element
-    BalancedKDTreeNode *balancedRootNode; // Start of balanced part of the kd tree
     bool copyData;
-    static float *distances;
+
+    // Balanced part of the kd tree
+    int numBalanced;
+    int numberOfBuckets; // A power of two, there are numberOfBuckets - 1 inner nodes
+    float *splitValues;
+    unsigned char *splitDiscriminators;
+    int *bucketStart; // numberOfBuckets + 1 entries, indices on the point arrays
+    float *balancedX; // Padded so buckets can always be read in groups of 4
+    float *balancedY;
+    float *balancedZ;
+    void **balancedData;
+    int *balancedFlags;
+    char *balancedDataBlock; // Owned data, in bucket order (only when copyData)
+
+    int bucketSquaredDistances(int bucket, const float *point, float *distances) const;
 
   private:
     void *assignData(void *data) const;
     void deleteNodes(KDTreeNode *node, bool deleteData);
     void deleteBNodes(bool deleteData);
-    void queryRec(const KDTreeNode *node); // Unbalanced part
-    void balancedQueryRec(int node); // Balanced part
+    void queryRec(const KDTreeNode *node, KDQuery *q) const; // Unbalanced part
+    void balancedQueryRec(int node, KDQuery *q) const; // Balanced part
+    void balanceRec(BalancedKDTreeNode broot[], int nodeIndex, int low, int high);
+    void storeBalanced(const BalancedKDTreeNode broot[]);
 
   public:
     explicit KDTree(int dataSize, bool CopyData = true);
@@ -134,15 +188,9 @@ class KDTree {
         void *results,
         float *inDistances = nullptr,
         float radius = KD_MAX_RADIUS,
-        short excludeFlags = 0);
-
-    void
-    balanceRec(
-        BalancedKDTreeNode broot[],
-        BalancedKDTreeNode dest[],
-        int destIndex,
-        int low,
-        int high);
+        short excludeFlags = 0) const;
+
+    int query(KDQuery *context) const;
 };
 
 #endif
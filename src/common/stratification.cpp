@@ -1,4 +1,5 @@
 #include "java/lang/Math.h"
+#include "common/ThreadRandom.h"
 #include "common/stratification.h"
 
 StratifiedSampling2D::StratifiedSampling2D(int nrSamples): xMaxStratum(), yMaxStratum() {
@@ -10,8 +11,8 @@ StratifiedSampling2D::StratifiedSampling2D(int nrSamples): xMaxStratum(), yMaxSt
 void
 StratifiedSampling2D::sample(double *x1, double *x2) {
     if ( yStratum < yMaxStratum ) {
-        *x1 = ((xStratum + drand48()) / (double) xMaxStratum);
-        *x2 = ((yStratum + drand48()) / (double) yMaxStratum);
+        *x1 = ((xStratum + ThreadRandom::nextDouble()) / (double) xMaxStratum);
+        *x2 = ((yStratum + ThreadRandom::nextDouble()) / (double) yMaxStratum);
 
         if ( (++xStratum) == xMaxStratum ) {
             xStratum = 0;
@@ -19,8 +20,8 @@ StratifiedSampling2D::sample(double *x1, double *x2) {
         }
     } else {
         // All strata sampled -> now just uniform sampling
-        *x1 = drand48();
-        *x2 = drand48();
+        *x1 = ThreadRandom::nextDouble();
+        *x2 = ThreadRandom::nextDouble();
     }
 }
 
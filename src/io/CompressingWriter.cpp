@@ -0,0 +1,134 @@
+#include "common/error.h"
+#include "io/CompressingWriter.h"
+
+CompressingWriter::CompressingWriter(FILE *inCompressedFile, CompressionFormat inFormat):
+    compressedFile(inCompressedFile),
+    format(inFormat),
+    gzipStream()
+{
+    output = new unsigned char[OUTPUT_BUFFER_SIZE];
+#ifdef ZSTD_ENABLED
+    zstdContext = nullptr;
+#endif
+}
+
+/**
+Opens the file with the given fopen() mode ("w" or "a") and starts a compressed stream
+in it. Returns nullptr when the file can't be opened or the format is not supported
+by this build
+*/
+CompressingWriter *
+CompressingWriter::open(const char *fileName, const char *openMode, CompressionFormat format) {
+#ifndef ZSTD_ENABLED
+    if ( format == CompressionFormat::ZSTD_COMPRESSION ) {
+        logError(nullptr, "Can't write '%s': zstd compression is not supported by this build", fileName);
+        return nullptr;
+    }
+#endif
+    FILE *compressedFile = fopen(fileName, *openMode == 'a' ? "ab" : "wb");
+    if ( compressedFile == nullptr ) {
+        return nullptr;
+    }
+
+    CompressingWriter *writer = new CompressingWriter(compressedFile, format);
+    bool started;
+    if ( format == CompressionFormat::GZIP_COMPRESSION ) {
+        // Window size 15, plus 16 to write a gzip header
+        started = deflateInit2(&writer->gzipStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    } else {
+#ifdef ZSTD_ENABLED
+        writer->zstdContext = ZSTD_createCCtx();
+        started = writer->zstdContext != nullptr;
+#else
+        started = false;
+#endif
+    }
+    if ( !started ) {
+        logError(nullptr, "Can't start compressing file '%s'", fileName);
+        delete writer;
+        return nullptr;
+    }
+    return writer;
+}
+
+CompressingWriter::~CompressingWriter() {
+    if ( compressedFile != nullptr ) {
+        fclose(compressedFile);
+    }
+    if ( format == CompressionFormat::GZIP_COMPRESSION ) {
+        deflateEnd(&gzipStream);
+    }
+#ifdef ZSTD_ENABLED
+    ZSTD_freeCCtx(zstdContext);
+#endif
+    delete[] output;
+}
+
+bool
+CompressingWriter::deflateGzip(const char *data, long size, bool end) {
+    int status;
+
+    gzipStream.next_in = (unsigned char *)data;
+    gzipStream.avail_in = (unsigned int)size;
+    do {
+        gzipStream.next_out = output;
+        gzipStream.avail_out = OUTPUT_BUFFER_SIZE;
+        status = deflate(&gzipStream, end ? Z_FINISH : Z_NO_FLUSH);
+        if ( status == Z_STREAM_ERROR ) {
+            return false;
+        }
+        size_t compressedSize = OUTPUT_BUFFER_SIZE - gzipStream.avail_out;
+        if ( fwrite(output, 1, compressedSize, compressedFile) != compressedSize ) {
+            return false;
+        }
+    } while ( gzipStream.avail_out == 0 );
+    return !end || status == Z_STREAM_END;
+}
+
+bool
+CompressingWriter::compressZstd(const char *data, long size, bool end) {
+#ifdef ZSTD_ENABLED
+    ZSTD_inBuffer in = {data, (size_t)size, 0};
+    bool done;
+
+    do {
+        ZSTD_outBuffer out = {output, OUTPUT_BUFFER_SIZE, 0};
+        size_t remaining = ZSTD_compressStream2(zstdContext, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+        if ( ZSTD_isError(remaining) || fwrite(output, 1, out.pos, compressedFile) != out.pos ) {
+            return false;
+        }
+        done = end ? remaining == 0 : in.pos == in.size;
+    } while ( !done );
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+Compresses and writes size bytes of data. Returns false on write errors
+*/
+bool
+CompressingWriter::write(const char *data, long size) {
+    if ( format == CompressionFormat::GZIP_COMPRESSION ) {
+        return deflateGzip(data, size, false);
+    }
+    return compressZstd(data, size, false);
+}
+
+/**
+Ends the compressed stream and closes the file. Returns false on write errors
+*/
+bool
+CompressingWriter::close() {
+    bool written;
+
+    if ( format == CompressionFormat::GZIP_COMPRESSION ) {
+        written = deflateGzip(nullptr, 0, true);
+    } else {
+        written = compressZstd(nullptr, 0, true);
+    }
+    written = fclose(compressedFile) == 0 && written;
+    compressedFile = nullptr;
+    return written;
+}
@@ -0,0 +1,41 @@
+#ifndef __COMPRESSING_WRITER__
+#define __COMPRESSING_WRITER__
+
+#include <cstdio>
+#include <zlib.h>
+#ifdef ZSTD_ENABLED
+    #include <zstd.h>
+#endif
+
+#include "io/CompressionFormat.h"
+
+/**
+Writes a gzip or zstd compressed file in process, compressing the data as it is
+written
+*/
+class CompressingWriter {
+  private:
+    static const int OUTPUT_BUFFER_SIZE = 1 << 16;
+
+    FILE *compressedFile;
+    CompressionFormat format;
+    unsigned char *output;
+    z_stream gzipStream;
+#ifdef ZSTD_ENABLED
+    ZSTD_CCtx *zstdContext;
+#endif
+
+    CompressingWriter(FILE *inCompressedFile, CompressionFormat inFormat);
+
+    bool deflateGzip(const char *data, long size, bool end);
+    bool compressZstd(const char *data, long size, bool end);
+
+  public:
+    static CompressingWriter *open(const char *fileName, const char *openMode, CompressionFormat format);
+    ~CompressingWriter();
+
+    bool write(const char *data, long size);
+    bool close();
+};
+
+#endif
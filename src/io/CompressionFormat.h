@@ -0,0 +1,14 @@
+#ifndef __COMPRESSION_FORMAT__
+#define __COMPRESSION_FORMAT__
+
+/**
+Compressed file formats read and written in process, see DecompressingReader and
+CompressingWriter
+*/
+enum CompressionFormat {
+    NO_COMPRESSION,
+    GZIP_COMPRESSION,
+    ZSTD_COMPRESSION
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include <cstring>
+#include <zlib.h>
+#ifdef ZSTD_ENABLED
+    #include <zstd.h>
+#endif
+
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "io/DecompressingReader.h"
+
+DecompressingReader::DecompressingReader(FILE *inCompressedFile, CompressionFormat inFormat, const char *inFileName):
+    compressedFile(inCompressedFile),
+    format(inFormat),
+    fileName(),
+    decompressedSize(),
+    finished(false),
+    failed(false),
+    stopping(false),
+    thread(),
+    writeOffset(BLOCK_SIZE),
+    position(),
+    readBlock(),
+    readBlockStart(),
+    readBlockEnd(),
+    failureReported(false)
+{
+    strncpy(fileName, inFileName, sizeof(fileName) - 1);
+    blocks = new java::ArrayList<char *>();
+}
+
+/**
+Opens the compressed file and starts decompressing it. Returns nullptr when the file
+can't be opened or the format is not supported by this build
+*/
+DecompressingReader *
+DecompressingReader::open(const char *fileName, CompressionFormat format) {
+#ifndef ZSTD_ENABLED
+    if ( format == CompressionFormat::ZSTD_COMPRESSION ) {
+        logError(nullptr, "Can't read '%s': zstd compression is not supported by this build", fileName);
+        return nullptr;
+    }
+#endif
+    FILE *compressedFile = fopen(fileName, "rb");
+    if ( compressedFile == nullptr ) {
+        return nullptr;
+    }
+
+    DecompressingReader *reader = new DecompressingReader(compressedFile, format, fileName);
+    reader->thread = new std::thread(&DecompressingReader::decompress, reader);
+    return reader;
+}
+
+/**
+Stops decompressing when the data is not needed anymore
+*/
+DecompressingReader::~DecompressingReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    thread->join();
+    delete thread;
+    fclose(compressedFile);
+    for ( int i = 0; i < blocks->size(); i++ ) {
+        delete[] blocks->get(i);
+    }
+    delete blocks;
+}
+
+/**
+Free space at the end of the decompressed data, a new block is started when the last
+one is full
+*/
+unsigned char *
+DecompressingReader::outputSpace(unsigned int *size) {
+    if ( writeOffset == BLOCK_SIZE ) {
+        char *block = new char[BLOCK_SIZE];
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks->add(block);
+        writeOffset = 0;
+    }
+    *size = (unsigned int)(BLOCK_SIZE - writeOffset);
+    return (unsigned char *)blocks->get(blocks->size() - 1) + writeOffset;
+}
+
+/**
+Makes the bytes just decompressed at the end of the last block available to the reader.
+Returns false when the reader is deleted
+*/
+bool
+DecompressingReader::publish(long size) {
+    writeOffset += size;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decompressedSize += size;
+        if ( stopping ) {
+            return false;
+        }
+    }
+    if ( size > 0 ) {
+        dataDecompressed.notify_all();
+    }
+    return true;
+}
+
+/**
+Decompresses gzip files, including the ones made of several concatenated members
+*/
+bool
+DecompressingReader::inflateGzip(unsigned char *input) {
+    z_stream stream{};
+    int status = Z_OK;
+    bool outputFull = false;
+
+    // Window size 15, plus 32 to detect the gzip header
+    if ( inflateInit2(&stream, 15 + 32) != Z_OK ) {
+        return false;
+    }
+    for ( ;; ) {
+        // A call filling the block may leave output for the input it already has
+        if ( stream.avail_in == 0 && (!outputFull || status == Z_STREAM_END) ) {
+            stream.next_in = input;
+            stream.avail_in = (unsigned int)fread(input, 1, INPUT_BUFFER_SIZE, compressedFile);
+            if ( stream.avail_in == 0 ) {
+                break;
+            }
+        }
+        if ( status == Z_STREAM_END ) {
+            inflateReset(&stream);
+        }
+        stream.next_out = outputSpace(&stream.avail_out);
+        unsigned int outputSize = stream.avail_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+        outputFull = stream.avail_out == 0;
+        if ( status == Z_BUF_ERROR ) {
+            // The block filled just as the input ran out: no progress without more input
+            status = Z_OK;
+            outputFull = false;
+        }
+        if ( !publish(outputSize - stream.avail_out) || (status != Z_OK && status != Z_STREAM_END) ) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return status == Z_STREAM_END && stream.avail_in == 0 && !ferror(compressedFile);
+}
+
+/**
+Decompresses zstd files, including the ones made of several frames
+*/
+bool
+DecompressingReader::decompressZstd(unsigned char *input) {
+#ifdef ZSTD_ENABLED
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    ZSTD_inBuffer in = {input, 0, 0};
+    size_t status = 1; // Zero once a frame is complete
+    bool outputFull = false;
+
+    for ( ;; ) {
+        if ( in.pos == in.size && (!outputFull || status == 0) ) {
+            in.size = fread(input, 1, INPUT_BUFFER_SIZE, compressedFile);
+            in.pos = 0;
+            if ( in.size == 0 ) {
+                break;
+            }
+        }
+        unsigned int outputSize;
+        ZSTD_outBuffer out = {nullptr, 0, 0};
+        out.dst = outputSpace(&outputSize);
+        out.size = outputSize;
+        status = ZSTD_decompressStream(context, &out, &in);
+        outputFull = out.pos == out.size;
+        if ( !publish((long)out.pos) || ZSTD_isError(status) ) {
+            break;
+        }
+    }
+    ZSTD_freeDCtx(context);
+    return status == 0 && in.pos == in.size && !ferror(compressedFile);
+#else
+    return false;
+#endif
+}
+
+/**
+Body of the decompressing thread
+*/
+void
+DecompressingReader::decompress() {
+    unsigned char *input = new unsigned char[INPUT_BUFFER_SIZE];
+    bool decompressed;
+
+    if ( format == CompressionFormat::GZIP_COMPRESSION ) {
+        decompressed = inflateGzip(input);
+    } else {
+        decompressed = decompressZstd(input);
+    }
+    delete[] input;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        failed = !decompressed && !stopping;
+    }
+    dataDecompressed.notify_all();
+}
+
+/**
+Waits until there are at least size bytes of decompressed data or the whole file is
+decompressed. Returns false when there is less data than that
+*/
+bool
+DecompressingReader::waitForSize(long size) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    dataDecompressed.wait(lock, [this, size] { return finished || decompressedSize >= size; });
+    if ( decompressedSize >= size ) {
+        return true;
+    }
+    if ( failed && !failureReported ) {
+        logError(nullptr, "File '%s' is not a valid compressed file or is truncated", fileName);
+        failureReported = true;
+    }
+    return false;
+}
+
+/**
+Decompressed bytes from the current position on, in the same block. Returns nullptr
+at the end of the data
+*/
+const char *
+DecompressingReader::nextBytes(long *size) {
+    if ( readBlock == nullptr || position < readBlockStart || position >= readBlockEnd ) {
+        if ( !waitForSize(position + 1) ) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        long blockIndex = position / BLOCK_SIZE;
+        readBlock = blocks->get((int)blockIndex);
+        readBlockStart = blockIndex * BLOCK_SIZE;
+        readBlockEnd = decompressedSize < readBlockStart + BLOCK_SIZE ? decompressedSize : readBlockStart + BLOCK_SIZE;
+    }
+    *size = readBlockEnd - position;
+    return readBlock + (position - readBlockStart);
+}
+
+/**
+Reads the next line with the same results as fgets(): up to size - 1 bytes, stopping
+after a new line. Returns the number of bytes read, 0 at the end of the file
+*/
+int
+DecompressingReader::readLine(char *line, int size) {
+    int length = 0;
+    long available;
+    const char *bytes;
+
+    while ( length < size - 1 && (bytes = nextBytes(&available)) != nullptr ) {
+        if ( available > size - 1 - length ) {
+            available = size - 1 - length;
+        }
+        const char *end = (const char *)memchr(bytes, '\n', available);
+        long n = end != nullptr ? end - bytes + 1 : available;
+        memcpy(line + length, bytes, n);
+        length += (int)n;
+        position += n;
+        if ( end != nullptr ) {
+            break;
+        }
+    }
+    line[length] = '\0';
+    return length;
+}
+
+/**
+Reads up to size bytes. Returns the number of bytes read, 0 at the end of the file
+*/
+long
+DecompressingReader::read(char *buffer, long size) {
+    long length = 0;
+    long available;
+    const char *bytes;
+
+    while ( length < size && (bytes = nextBytes(&available)) != nullptr ) {
+        if ( available > size - length ) {
+            available = size - length;
+        }
+        memcpy(buffer + length, bytes, available);
+        length += available;
+        position += available;
+    }
+    return length;
+}
+
+long
+DecompressingReader::getPosition() const {
+    return position;
+}
+
+/**
+Goes to the given offset in the decompressed data. Returns false when the file is
+not that large
+*/
+bool
+DecompressingReader::setPosition(long offset) {
+    if ( offset < 0 || !waitForSize(offset) ) {
+        return false;
+    }
+    position = offset;
+    return true;
+}
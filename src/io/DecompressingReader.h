@@ -0,0 +1,70 @@
+#ifndef __DECOMPRESSING_READER__
+#define __DECOMPRESSING_READER__
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "java/util/ArrayList.h"
+#include "io/CompressionFormat.h"
+
+/**
+Reads a gzip or zstd compressed file, decompressing it in process on a background
+thread while the caller consumes the data, e.g. while the MGF parser handles the
+lines read before.
+
+The decompressed data is kept in blocks until the reader is deleted, so positions
+are offsets in the decompressed data and the reader can go back to any of them, as
+the MGF parser does for transform arrays
+*/
+class DecompressingReader {
+  private:
+    static const int BLOCK_SIZE = 1 << 20;
+    static const int INPUT_BUFFER_SIZE = 1 << 16;
+
+    FILE *compressedFile;
+    CompressionFormat format;
+    char fileName[256];
+
+    // Shared with the decompressing thread, guarded by the mutex
+    std::mutex mutex;
+    std::condition_variable dataDecompressed;
+    java::ArrayList<char *> *blocks;
+    long decompressedSize;
+    bool finished;
+    bool failed;
+    bool stopping;
+    std::thread *thread;
+
+    // Decompressing thread state
+    long writeOffset; // In the last block
+
+    // Reading state
+    long position;
+    const char *readBlock;
+    long readBlockStart;
+    long readBlockEnd; // Decompressed data of the block available to the reader
+    bool failureReported;
+
+    DecompressingReader(FILE *inCompressedFile, CompressionFormat inFormat, const char *inFileName);
+
+    unsigned char *outputSpace(unsigned int *size);
+    bool publish(long size);
+    bool inflateGzip(unsigned char *input);
+    bool decompressZstd(unsigned char *input);
+    void decompress();
+    bool waitForSize(long size);
+    const char *nextBytes(long *size);
+
+  public:
+    static DecompressingReader *open(const char *fileName, CompressionFormat format);
+    ~DecompressingReader();
+
+    int readLine(char *line, int size);
+    long read(char *buffer, long size);
+    long getPosition() const;
+    bool setPosition(long offset);
+};
+
+#endif
@@ -2,13 +2,149 @@
 #include <cstdlib>
 
 #include "common/error.h"
+#include "io/DecompressingReader.h"
+#include "io/CompressingWriter.h"
 #include "io/FileUncompressWrapper.h"
 
+/**
+Format of the files compressed and decompressed in process, from the file name extension
+*/
+CompressionFormat
+compressionFormatOfFileName(const char *fileName) {
+    const char *ext = strrchr(fileName, '.');
+
+    if ( ext != nullptr && strcmp(ext, ".gz") == 0 ) {
+        return CompressionFormat::GZIP_COMPRESSION;
+    }
+    if ( ext != nullptr && strcmp(ext, ".zst") == 0 ) {
+        return CompressionFormat::ZSTD_COMPRESSION;
+    }
+    return CompressionFormat::NO_COMPRESSION;
+}
+
+#ifdef __APPLE__
+static int
+readCompressedFile(void *cookie, char *buffer, int size) {
+    return (int)((DecompressingReader *)cookie)->read(buffer, size);
+}
+
+static fpos_t
+seekCompressedFile(void *cookie, fpos_t offset, int whence) {
+    DecompressingReader *reader = (DecompressingReader *)cookie;
+
+    if ( whence == SEEK_CUR ) {
+        offset += reader->getPosition();
+    }
+    if ( whence == SEEK_END || !reader->setPosition(offset) ) {
+        return -1;
+    }
+    return offset;
+}
+
+static int
+closeCompressedInputFile(void *cookie) {
+    delete (DecompressingReader *)cookie;
+    return 0;
+}
+
+static int
+writeCompressedFile(void *cookie, const char *data, int size) {
+    return ((CompressingWriter *)cookie)->write(data, size) ? size : -1;
+}
+
+static int
+closeCompressedOutputFile(void *cookie) {
+    CompressingWriter *writer = (CompressingWriter *)cookie;
+    bool written = writer->close();
+    delete writer;
+    return written ? 0 : EOF;
+}
+#else
+static ssize_t
+readCompressedFile(void *cookie, char *buffer, size_t size) {
+    return ((DecompressingReader *)cookie)->read(buffer, (long)size);
+}
+
+static int
+seekCompressedFile(void *cookie, off64_t *offset, int whence) {
+    DecompressingReader *reader = (DecompressingReader *)cookie;
+    long position = (long)*offset;
+
+    if ( whence == SEEK_CUR ) {
+        position += reader->getPosition();
+    }
+    if ( whence == SEEK_END || !reader->setPosition(position) ) {
+        return -1;
+    }
+    *offset = position;
+    return 0;
+}
+
+static int
+closeCompressedInputFile(void *cookie) {
+    delete (DecompressingReader *)cookie;
+    return 0;
+}
+
+static ssize_t
+writeCompressedFile(void *cookie, const char *data, size_t size) {
+    return ((CompressingWriter *)cookie)->write(data, (long)size) ? (ssize_t)size : -1;
+}
+
+static int
+closeCompressedOutputFile(void *cookie) {
+    CompressingWriter *writer = (CompressingWriter *)cookie;
+    bool written = writer->close();
+    delete writer;
+    return written ? 0 : EOF;
+}
+#endif
+
+/**
+Opens a gzip or zstd compressed file as a stdio stream, (de)compressing it in process
+*/
+static FILE *
+openCompressedFile(const char *fileName, const char *openMode, CompressionFormat format) {
+    if ( *openMode == 'r' ) {
+        DecompressingReader *reader = DecompressingReader::open(fileName, format);
+        if ( reader == nullptr ) {
+            return nullptr;
+        }
+#ifdef __APPLE__
+        FILE *fp = funopen(reader, readCompressedFile, nullptr, seekCompressedFile, closeCompressedInputFile);
+#else
+        cookie_io_functions_t functions = {readCompressedFile, nullptr, seekCompressedFile, closeCompressedInputFile};
+        FILE *fp = fopencookie(reader, "r", functions);
+#endif
+        if ( fp == nullptr ) {
+            delete reader;
+        }
+        return fp;
+    }
+
+    CompressingWriter *writer = CompressingWriter::open(fileName, openMode, format);
+    if ( writer == nullptr ) {
+        return nullptr;
+    }
+#ifdef __APPLE__
+    FILE *fp = funopen(writer, nullptr, writeCompressedFile, nullptr, closeCompressedOutputFile);
+#else
+    cookie_io_functions_t functions = {nullptr, writeCompressedFile, nullptr, closeCompressedOutputFile};
+    FILE *fp = fopencookie(writer, openMode, functions);
+#endif
+    if ( fp == nullptr ) {
+        writer->close();
+        delete writer;
+    }
+    return fp;
+}
+
 /**
 Opens a file with given name and fopen() open_mode ("w" or "r" e.g.). Returns the
 FILE * or nullptr if opening the file was not succesful. Returns in isPipe whether
-or not the file has been opened through a pipe. File extensions
-.Z, .gz, .bz and .bz2 are recognised and lead to piped input/output with the
+or not the file has been opened through a pipe. Files with extensions .gz and .zst
+are decompressed or compressed in process, see openCompressedFile(). File extensions
+.Z, .bz and .bz2 are recognised and lead to piped input/output with the
 proper compress/uncompress commands. Also if the first character of the file name is
 equal to '|', the file name is opened as a pipe.
 */
@@ -29,14 +165,9 @@ openFileCompressWrapper(const char *fileName, const char *open_mode, int *isPipe
             snprintf(command, n, "%s", fileName + 1);
             fp = popen(command, open_mode);
             *isPipe = true;
-        } else if ( ext && strcmp(ext, ".gz") == 0 ) {
-            if ( *open_mode == 'r' ) {
-                snprintf(command, n, "gunzip < %s", fileName);
-            } else {
-                snprintf(command, n, "gzip > %s", fileName);
-            }
-            fp = popen(command, open_mode);
-            *isPipe = true;
+        } else if ( compressionFormatOfFileName(fileName) != CompressionFormat::NO_COMPRESSION ) {
+            fp = openCompressedFile(fileName, open_mode, compressionFormatOfFileName(fileName));
+            *isPipe = false;
         } else if ( ext && strcmp(ext, ".Z") == 0 ) {
             if ( *open_mode == 'r' ) {
                 snprintf(command, n, "uncompress < %s", fileName);
@@ -91,3 +222,15 @@ closeFile(FILE *fp, int isPipe) {
         }
     }
 }
+
+/**
+True when openFileCompressWrapper() opens the file with the given name through a pipe
+*/
+bool
+isPipedFileName(const char *fileName) {
+    const char *ext = strrchr(fileName, '.');
+
+    return fileName[0] == '|'
+        || (ext != nullptr
+            && (strcmp(ext, ".Z") == 0 || strcmp(ext, ".bz") == 0 || strcmp(ext, ".bz2") == 0));
+}
@@ -3,7 +3,11 @@
 
 #include <cstdio>
 
+#include "io/CompressionFormat.h"
+
 extern FILE *openFileCompressWrapper(const char *fileName, const char *open_mode, int *isPipe);
 extern void closeFile(FILE *fp, int isPipe);
+extern bool isPipedFileName(const char *fileName);
+extern CompressionFormat compressionFormatOfFileName(const char *fileName);
 
 #endif
@@ -0,0 +1,327 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "io/RadianceCheckpoint.h"
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+/**
+64 bit FNV-1a hash of the bytes, continuing from the given hash
+*/
+static uint64_t
+radianceCheckpointHashBytes(uint64_t hash, const void *bytes, size_t size) {
+    const unsigned char *byte = (const unsigned char *)bytes;
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= byte[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+RadianceCheckpoint::RadianceCheckpoint(const char *inFileName):
+    fileName(inFileName),
+    data(),
+    dataSize(),
+    cursor(),
+    readError(),
+    output(),
+    temporaryFileName(),
+    outputSize(),
+    outputHash(),
+    writeError()
+{
+}
+
+RadianceCheckpoint::~RadianceCheckpoint() {
+    if ( output != nullptr ) {
+        fclose(output);
+        remove(temporaryFileName);
+    }
+    delete[] temporaryFileName;
+    delete[] data;
+}
+
+bool
+RadianceCheckpoint::isEnabled() const {
+    return fileName != nullptr && fileName[0] != '\0';
+}
+
+/**
+Identifies the scene by its patches: the same scene read again gives the same
+patches, in the same order and with the same vertex positions
+*/
+uint64_t
+RadianceCheckpoint::sceneHash(const Scene *scene) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+        const Patch *patch = scene->patchList->get(i);
+        int32_t numberOfVertices = patch->numberOfVertices;
+        hash = radianceCheckpointHashBytes(hash, &numberOfVertices, sizeof(numberOfVertices));
+        for ( int j = 0; j < patch->numberOfVertices; j++ ) {
+            const Vector3D *point = patch->vertex[j]->point;
+            float coordinates[3] = {point->x, point->y, point->z};
+            hash = radianceCheckpointHashBytes(hash, coordinates, sizeof(coordinates));
+        }
+    }
+    return hash;
+}
+
+/**
+Copies the next bytes of the checkpoint. Reading past the end gives zeros and
+flags the error
+*/
+void
+RadianceCheckpoint::readBytes(void *target, size_t size) {
+    if ( readError || size > dataSize - cursor ) {
+        readError = true;
+        memset(target, 0, size);
+        return;
+    }
+    memcpy(target, data + cursor, size);
+    cursor += size;
+}
+
+/**
+Reads the checkpoint file and checks it is complete and was written by this
+version for the same radiance method and scene. The number of iterations done
+is returned in iterationNumber and the random number generator is set back to
+its state when the checkpoint was written. The method state follows, to be read
+with RadianceMethod::readCheckpoint()
+*/
+bool
+RadianceCheckpoint::openForReading(const char *methodName, const Scene *scene, int *iterationNumber) {
+    FILE *input = fopen(fileName, "rb");
+    if ( input == nullptr ) {
+        return false;
+    }
+
+    delete[] data;
+    data = nullptr;
+    dataSize = 0;
+    if ( fseek(input, 0, SEEK_END) == 0 ) {
+        long size = ftell(input);
+        if ( size >= (long)HEADER_SIZE && fseek(input, 0, SEEK_SET) == 0 ) {
+            data = new char[size];
+            dataSize = fread(data, 1, size, input);
+        }
+    }
+    fclose(input);
+    cursor = 0;
+    readError = false;
+
+    uint32_t magic;
+    uint32_t version;
+    readBytes(&magic, sizeof(magic));
+    readBytes(&version, sizeof(version));
+    uint64_t payloadSize = readLong();
+    uint64_t payloadHash = readLong();
+    if ( readError || magic != MAGIC || version != VERSION || payloadSize != dataSize - HEADER_SIZE ) {
+        logWarning("RadianceCheckpoint", "'%s' is not a complete checkpoint of this version", fileName);
+        return false;
+    }
+    if ( radianceCheckpointHashBytes(FNV_OFFSET_BASIS, data + HEADER_SIZE, payloadSize) != payloadHash ) {
+        logWarning("RadianceCheckpoint", "Corrupted checkpoint file '%s'", fileName);
+        return false;
+    }
+
+    int length = readInt();
+    bool sameMethod = length == (int)strlen(methodName)
+        && (size_t)length <= dataSize - cursor
+        && strncmp(data + cursor, methodName, length) == 0;
+    cursor += sameMethod ? length : 0;
+    if ( !sameMethod ) {
+        logWarning("RadianceCheckpoint", "'%s' was written by another radiance method", fileName);
+        return false;
+    }
+
+    int numberOfPatches = scene->patchList != nullptr ? (int)scene->patchList->size() : 0;
+    if ( readInt() != numberOfPatches || readLong() != sceneHash(scene) ) {
+        logWarning("RadianceCheckpoint", "'%s' was written for another scene", fileName);
+        return false;
+    }
+
+    *iterationNumber = readInt();
+    unsigned short randomState[3];
+    readBytes(randomState, sizeof(randomState));
+    if ( readError ) {
+        return false;
+    }
+    seed48(randomState);
+    return true;
+}
+
+/**
+Returns true when all the checkpoint was read without errors
+*/
+bool
+RadianceCheckpoint::finishReading() {
+    bool success = !readError && cursor == dataSize;
+    delete[] data;
+    data = nullptr;
+    dataSize = 0;
+    return success;
+}
+
+bool
+RadianceCheckpoint::hasReadError() const {
+    return readError;
+}
+
+int
+RadianceCheckpoint::readInt() {
+    int32_t value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+uint64_t
+RadianceCheckpoint::readLong() {
+    uint64_t value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+float
+RadianceCheckpoint::readFloat() {
+    float value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+ColorRgb
+RadianceCheckpoint::readColor() {
+    ColorRgb color;
+    color.r = readFloat();
+    color.g = readFloat();
+    color.b = readFloat();
+    return color;
+}
+
+void
+RadianceCheckpoint::readColors(ColorRgb *colors, int numberOfColors) {
+    for ( int i = 0; i < numberOfColors; i++ ) {
+        colors[i] = readColor();
+    }
+}
+
+/**
+Starts writing a checkpoint after iterationNumber iterations. The method state
+is to be written next with RadianceMethod::writeCheckpoint()
+*/
+bool
+RadianceCheckpoint::openForWriting(const char *methodName, const Scene *scene, int iterationNumber) {
+    delete[] temporaryFileName;
+    int n = (int)strlen(fileName) + 5;
+    temporaryFileName = new char[n];
+    snprintf(temporaryFileName, n, "%s.tmp", fileName);
+
+    output = fopen(temporaryFileName, "wb");
+    if ( output == nullptr ) {
+        logWarning("RadianceCheckpoint", "Can't open file '%s' for writing", temporaryFileName);
+        return false;
+    }
+    writeError = false;
+
+    // Header, completed at the end
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    writeBytes(&magic, sizeof(magic));
+    writeBytes(&version, sizeof(version));
+    writeLong(0);
+    writeLong(0);
+    outputSize = 0;
+    outputHash = FNV_OFFSET_BASIS;
+
+    writeString(methodName);
+    writeInt(scene->patchList != nullptr ? (int)scene->patchList->size() : 0);
+    writeLong(sceneHash(scene));
+    writeInt(iterationNumber);
+
+    // The current state of drand48(), seed48() gives it back after setting it
+    unsigned short randomState[3] = {0, 0, 0};
+    unsigned short *previousState = seed48(randomState);
+    memcpy(randomState, previousState, sizeof(randomState));
+    seed48(randomState);
+    writeBytes(randomState, sizeof(randomState));
+
+    return !writeError;
+}
+
+/**
+Completes the header and replaces the previous checkpoint with the new one.
+Returns false, keeping the previous checkpoint, if it could not be written
+*/
+bool
+RadianceCheckpoint::finishWriting() {
+    if ( output == nullptr ) {
+        return false;
+    }
+
+    uint64_t payloadSize = outputSize;
+    uint64_t payloadHash = outputHash;
+    if ( fseek(output, 2 * sizeof(uint32_t), SEEK_SET) != 0
+      || fwrite(&payloadSize, sizeof(payloadSize), 1, output) != 1
+      || fwrite(&payloadHash, sizeof(payloadHash), 1, output) != 1 ) {
+        writeError = true;
+    }
+    if ( fclose(output) != 0 ) {
+        writeError = true;
+    }
+    output = nullptr;
+
+    if ( writeError || rename(temporaryFileName, fileName) != 0 ) {
+        remove(temporaryFileName);
+        logWarning("RadianceCheckpoint", "Could not write the checkpoint '%s'", fileName);
+        return false;
+    }
+    return true;
+}
+
+void
+RadianceCheckpoint::writeBytes(const void *bytes, size_t size) {
+    if ( fwrite(bytes, 1, size, output) != size ) {
+        writeError = true;
+    }
+    outputSize += size;
+    outputHash = radianceCheckpointHashBytes(outputHash, bytes, size);
+}
+
+void
+RadianceCheckpoint::writeString(const char *string) {
+    int length = (int)strlen(string);
+    writeInt(length);
+    writeBytes(string, length);
+}
+
+void
+RadianceCheckpoint::writeInt(int value) {
+    int32_t written = value;
+    writeBytes(&written, sizeof(written));
+}
+
+void
+RadianceCheckpoint::writeLong(uint64_t value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void
+RadianceCheckpoint::writeFloat(float value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void
+RadianceCheckpoint::writeColor(const ColorRgb &color) {
+    writeFloat(color.r);
+    writeFloat(color.g);
+    writeFloat(color.b);
+}
+
+void
+RadianceCheckpoint::writeColors(const ColorRgb *colors, int numberOfColors) {
+    for ( int i = 0; i < numberOfColors; i++ ) {
+        writeColor(colors[i]);
+    }
+}
@@ -0,0 +1,84 @@
+/**
+Binary checkpoint of a world-space radiance computation, so a batch run can be
+resumed or extended with more iterations instead of starting over.
+
+The file holds a header identifying the radiance method, the scene (number of
+patches and a hash of their vertex positions), the number of finished iterations
+and the state of the process wide drand48() random number generator, followed by
+whatever the method writes with RadianceMethod::writeCheckpoint(). The payload is
+hashed as in the scene cache, so truncated or corrupted checkpoints are rejected.
+
+The per-thread ThreadRandom states are not saved: none outlives a threaded job.
+Worker threads seed their own state from a value the job draws from drand48() when
+it starts, so restoring the drand48() state also gives them the same sequences as
+in an uninterrupted run, on any number of threads. The world-space methods draw
+their random numbers on the calling thread or from the quasi random ray indices
+stored with the elements. Only threaded pixel rendering without
+-raytracing-fixed-seeds differs between runs, resumed or not, since which thread
+computes which tile depends on the scheduling.
+
+Checkpoints are written to a temporary file that replaces the previous checkpoint
+only when complete, so a run killed while writing leaves the last good one
+*/
+
+#ifndef __RADIANCE_CHECKPOINT__
+#define __RADIANCE_CHECKPOINT__
+
+#include <cstdio>
+#include <cstdint>
+
+#include "common/ColorRgb.h"
+#include "scene/Scene.h"
+
+class RadianceCheckpoint {
+  private:
+    static const uint32_t MAGIC = 0x50434b52; // "RKCP"
+    static const int VERSION = 1;
+    static const size_t HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+    const char *fileName;
+
+    // Reading state
+    char *data;
+    size_t dataSize;
+    size_t cursor;
+    bool readError;
+
+    // Writing state
+    FILE *output;
+    char *temporaryFileName;
+    uint64_t outputSize;
+    uint64_t outputHash;
+    bool writeError;
+
+    static uint64_t sceneHash(const Scene *scene);
+
+    void readBytes(void *target, size_t size);
+    void writeBytes(const void *bytes, size_t size);
+    void writeString(const char *string);
+
+  public:
+    explicit RadianceCheckpoint(const char *inFileName);
+    ~RadianceCheckpoint();
+
+    bool isEnabled() const;
+
+    bool openForReading(const char *methodName, const Scene *scene, int *iterationNumber);
+    bool finishReading();
+    bool hasReadError() const;
+    int readInt();
+    uint64_t readLong();
+    float readFloat();
+    ColorRgb readColor();
+    void readColors(ColorRgb *colors, int numberOfColors);
+
+    bool openForWriting(const char *methodName, const Scene *scene, int iterationNumber);
+    bool finishWriting();
+    void writeInt(int value);
+    void writeLong(uint64_t value);
+    void writeFloat(float value);
+    void writeColor(const ColorRgb &color);
+    void writeColors(const ColorRgb *colors, int numberOfColors);
+};
+
+#endif
@@ -0,0 +1,1023 @@
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "common/Statistics.h"
+#include "skin/Compound.h"
+#include "skin/MeshSurface.h"
+#include "skin/PatchSet.h"
+#include "io/SceneCache.h"
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static const int GEOMETRY_MESH = 0;
+static const int GEOMETRY_COMPOUND = 1;
+
+// Maximum number of sub-clusters of a cluster, see PatchClusterOctreeNode
+static const int MAXIMUM_CLUSTER_CHILDREN = 8;
+
+/**
+Position of an object in the cache, looked up by the address of the object when
+writing
+*/
+class SceneCacheEntry {
+  public:
+    const void *object;
+    int index;
+};
+
+static int
+sceneCacheCompareEntries(const void *a, const void *b) {
+    const void *objectA = ((const SceneCacheEntry *)a)->object;
+    const void *objectB = ((const SceneCacheEntry *)b)->object;
+    if ( objectA < objectB ) {
+        return -1;
+    }
+    return objectA > objectB ? 1 : 0;
+}
+
+/**
+Returns the position of the object in the sorted entries, -1 for a null object
+and -2 for an object that is not in the cache
+*/
+static int
+sceneCacheFindEntry(const SceneCacheEntry *entries, int numberOfEntries, const void *object) {
+    if ( object == nullptr ) {
+        return -1;
+    }
+    SceneCacheEntry key{};
+    key.object = object;
+    const SceneCacheEntry *found = (const SceneCacheEntry *)bsearch(
+        &key, entries, numberOfEntries, sizeof(SceneCacheEntry), sceneCacheCompareEntries);
+    return found != nullptr ? found->index : -2;
+}
+
+SceneCache::SceneCache(const char *inCacheFileName, const Material *inDefaultMaterial, ClusterHierarchyType inClusterHierarchyType):
+    cacheFileName(inCacheFileName),
+    defaultMaterial(inDefaultMaterial),
+    clusterHierarchyType(inClusterHierarchyType),
+    data(),
+    dataSize(),
+    cursor(),
+    readError(),
+    points(),
+    numberOfPoints(),
+    normals(),
+    numberOfNormals(),
+    vertices(),
+    numberOfVertices(),
+    patches(),
+    numberOfPatches(),
+    output(),
+    outputSize(),
+    outputHash(),
+    writeError()
+{
+}
+
+SceneCache::~SceneCache() {
+    unmapFile();
+    delete[] points;
+    delete[] normals;
+    delete[] vertices;
+    delete[] patches;
+}
+
+bool
+SceneCache::isEnabled() const {
+    return cacheFileName != nullptr && cacheFileName[0] != '\0';
+}
+
+/**
+64 bit FNV-1a hash of the bytes, continuing from the given hash
+*/
+uint64_t
+SceneCache::hashBytes(uint64_t hash, const void *bytes, size_t size) {
+    const unsigned char *byte = (const unsigned char *)bytes;
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= byte[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+Size and content hash of the file, returns false if it can not be read
+*/
+bool
+SceneCache::hashFile(const char *fileName, uint64_t *size, uint64_t *hash) {
+    FILE *input = fopen(fileName, "rb");
+    if ( input == nullptr ) {
+        return false;
+    }
+
+    unsigned char buffer[64 * 1024];
+    size_t bytesRead;
+    *size = 0;
+    *hash = FNV_OFFSET_BASIS;
+    while ( (bytesRead = fread(buffer, 1, sizeof(buffer), input)) > 0 ) {
+        *size += bytesRead;
+        *hash = hashBytes(*hash, buffer, bytesRead);
+    }
+
+    bool success = ferror(input) == 0;
+    fclose(input);
+    return success;
+}
+
+bool
+SceneCache::mapFile() {
+    int fileDescriptor = open(cacheFileName, O_RDONLY);
+    if ( fileDescriptor < 0 ) {
+        return false;
+    }
+
+    struct stat status{};
+    if ( fstat(fileDescriptor, &status) != 0 || (size_t)status.st_size < HEADER_SIZE ) {
+        close(fileDescriptor);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if ( mapping == MAP_FAILED ) {
+        return false;
+    }
+
+    data = (const char *)mapping;
+    dataSize = (size_t)status.st_size;
+    cursor = 0;
+    readError = false;
+    return true;
+}
+
+void
+SceneCache::unmapFile() {
+    if ( data != nullptr ) {
+        munmap((void *)data, dataSize);
+        data = nullptr;
+        dataSize = 0;
+    }
+}
+
+/**
+Copies the next bytes of the cache. Reading past the end gives zeros and flags
+the error
+*/
+void
+SceneCache::readBytes(void *target, size_t size) {
+    if ( readError || size > dataSize - cursor ) {
+        readError = true;
+        memset(target, 0, size);
+        return;
+    }
+    memcpy(target, data + cursor, size);
+    cursor += size;
+}
+
+int
+SceneCache::readInt() {
+    int32_t value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+uint64_t
+SceneCache::readLong() {
+    uint64_t value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+float
+SceneCache::readFloat() {
+    float value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+ColorRgb
+SceneCache::readColor() {
+    ColorRgb color;
+    color.r = readFloat();
+    color.g = readFloat();
+    color.b = readFloat();
+    return color;
+}
+
+/**
+Returns a new string or nullptr
+*/
+char *
+SceneCache::readString() {
+    int length = readInt();
+    if ( length < 0 || readError ) {
+        return nullptr;
+    }
+    if ( (size_t)length > dataSize - cursor ) {
+        readError = true;
+        return nullptr;
+    }
+    char *string = new char[length + 1];
+    readBytes(string, length);
+    string[length] = '\0';
+    return string;
+}
+
+/**
+Reads the index of a position or normal in the given table
+*/
+Vector3D *
+SceneCache::readVector(const Vector3D *const *table, int tableSize) {
+    int index = readInt();
+    if ( index < 0 || index >= tableSize ) {
+        if ( index != -1 ) {
+            readError = true;
+        }
+        return nullptr;
+    }
+    return (Vector3D *)table[index];
+}
+
+/**
+Checks the cache was written by this version for the same scene files, not
+changed since then, and with the same options
+*/
+bool
+SceneCache::readHeader(const char *sceneFileName, const MgfContext *context) {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+
+    readBytes(&magic, sizeof(magic));
+    readBytes(&version, sizeof(version));
+    payloadSize = readLong();
+    payloadHash = readLong();
+    if ( magic != MAGIC || version != VERSION || payloadSize != dataSize - HEADER_SIZE ) {
+        return false;
+    }
+    if ( hashBytes(FNV_OFFSET_BASIS, data + HEADER_SIZE, payloadSize) != payloadHash ) {
+        logWarning("SceneCache", "Corrupted scene cache file '%s'", cacheFileName);
+        return false;
+    }
+
+    if ( readInt() != context->numberOfQuarterCircleDivisions
+      || readInt() != (int)context->singleSided
+      || readInt() != (int)context->monochrome
+      || readInt() != (int)clusterHierarchyType ) {
+        return false;
+    }
+
+    int numberOfFiles = readInt();
+    for ( int i = 0; i < numberOfFiles && !readError; i++ ) {
+        char *fileName = readString();
+        uint64_t cachedSize = readLong();
+        uint64_t cachedHash = readLong();
+        uint64_t size;
+        uint64_t hash;
+        bool upToDate = fileName != nullptr
+            && (i > 0 || strcmp(fileName, sceneFileName) == 0)
+            && hashFile(fileName, &size, &hash)
+            && size == cachedSize
+            && hash == cachedHash;
+        delete[] fileName;
+        if ( !upToDate ) {
+            return false;
+        }
+    }
+
+    return numberOfFiles > 0 && !readError;
+}
+
+Material *
+SceneCache::readMaterial() {
+    char *name = readString();
+    bool sided = readInt() != 0;
+
+    PhongEmittanceDistributionFunction *edf = nullptr;
+    if ( readInt() != 0 ) {
+        ColorRgb Kd = readColor();
+        ColorRgb Ks = readColor();
+        float Ns = readFloat();
+        edf = new PhongEmittanceDistributionFunction(&Kd, &Ks, Ns);
+    }
+
+    PhongBidirectionalScatteringDistributionFunction *bsdf = nullptr;
+    if ( readInt() != 0 ) {
+        PhongBidirectionalReflectanceDistributionFunction *brdf = nullptr;
+        if ( readInt() != 0 ) {
+            ColorRgb Kd = readColor();
+            ColorRgb Ks = readColor();
+            float Ns = readFloat();
+            brdf = new PhongBidirectionalReflectanceDistributionFunction(&Kd, &Ks, Ns);
+        }
+
+        PhongBidirectionalTransmittanceDistributionFunction *btdf = nullptr;
+        if ( readInt() != 0 ) {
+            ColorRgb Kd = readColor();
+            ColorRgb Ks = readColor();
+            float Ns = readFloat();
+            float nr = readFloat();
+            float ni = readFloat();
+            btdf = new PhongBidirectionalTransmittanceDistributionFunction(&Kd, &Ks, Ns, nr, ni);
+        }
+        bsdf = new PhongBidirectionalScatteringDistributionFunction(brdf, btdf, nullptr);
+    }
+
+    Material *material = new Material(name != nullptr ? name : "", edf, bsdf, sided);
+    delete[] name;
+    return material;
+}
+
+/**
+Creates the model of the scene from the cache, as readMgf() does from the scene
+file. Returns false, without changing the context, when there is no usable cache
+for the scene or when the cache file turns out to be incomplete or damaged: the
+scene is then parsed as if there was no cache
+*/
+bool
+SceneCache::readModel(const char *sceneFileName, MgfContext *context) {
+    if ( !isEnabled() || !mapFile() ) {
+        return false;
+    }
+    if ( !readHeader(sceneFileName, context) ) {
+        fprintf(stderr, "Scene cache '%s' is out of date\n", cacheFileName);
+        unmapFile();
+        return false;
+    }
+
+    // Ids and counters the created objects change, restored if the cache is damaged
+    int nextPatchId = Patch::getNextId();
+    int nextGeometryId = Geometry::nextGeometryId;
+    int numberOfGeometriesBefore = GLOBAL_statistics.numberOfGeometries;
+    int numberOfCompoundsBefore = GLOBAL_statistics.numberOfCompounds;
+    int numberOfSurfacesBefore = GLOBAL_statistics.numberOfSurfaces;
+    int numberOfVerticesBefore = GLOBAL_statistics.numberOfVertices;
+    int numberOfElementsBefore = GLOBAL_statistics.numberOfElements;
+
+    // Materials
+    if ( context->materials == nullptr ) {
+        context->materials = new java::ArrayList<Material *>();
+    }
+    int firstMaterial = (int)context->materials->size();
+    int numberOfMaterials = readInt();
+    for ( int i = 0; i < numberOfMaterials && !readError; i++ ) {
+        context->materials->add(readMaterial());
+    }
+
+    // Positions and normals
+    numberOfPoints = readInt();
+    points = new Vector3D *[numberOfPoints > 0 ? numberOfPoints : 1];
+    for ( int i = 0; i < numberOfPoints; i++ ) {
+        float x = readFloat();
+        float y = readFloat();
+        float z = readFloat();
+        points[i] = new Vector3D(x, y, z);
+    }
+
+    numberOfNormals = readInt();
+    normals = new Vector3D *[numberOfNormals > 0 ? numberOfNormals : 1];
+    for ( int i = 0; i < numberOfNormals; i++ ) {
+        float x = readFloat();
+        float y = readFloat();
+        float z = readFloat();
+        normals[i] = new Vector3D(x, y, z);
+    }
+
+    // Vertices, the back vertices are connected when all vertices are there
+    numberOfVertices = readInt();
+    vertices = new Vertex *[numberOfVertices > 0 ? numberOfVertices : 1];
+    int *backVertices = new int[numberOfVertices > 0 ? numberOfVertices : 1];
+    for ( int i = 0; i < numberOfVertices; i++ ) {
+        int id = readInt();
+        Vector3D *point = readVector(points, numberOfPoints);
+        Vector3D *normal = readVector(normals, numberOfNormals);
+        vertices[i] = new Vertex(point, normal, nullptr, new java::ArrayList<Patch *>());
+        vertices[i]->id = id;
+        backVertices[i] = readInt();
+    }
+    for ( int i = 0; i < numberOfVertices; i++ ) {
+        if ( backVertices[i] >= 0 && backVertices[i] < numberOfVertices ) {
+            vertices[i]->back = vertices[backVertices[i]];
+        }
+    }
+    delete[] backVertices;
+
+    // Patches, in order of their id, so the vertices list the patches sharing them in
+    // the same order as after parsing
+    numberOfPatches = readInt();
+    patches = new Patch *[numberOfPatches > 0 ? numberOfPatches : 1];
+    int *twins = new int[numberOfPatches > 0 ? numberOfPatches : 1];
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        patches[i] = nullptr;
+        twins[i] = -1;
+    }
+    for ( int i = 0; i < numberOfPatches && !readError; i++ ) {
+        int numberOfPatchVertices = readInt();
+        Vertex *patchVertices[MAXIMUM_VERTICES_PER_PATCH];
+        for ( int j = 0; j < MAXIMUM_VERTICES_PER_PATCH; j++ ) {
+            int index = readInt();
+            patchVertices[j] = index >= 0 && index < numberOfVertices ? vertices[index] : nullptr;
+        }
+        // The patch constructor exits on what it can not handle
+        if ( (numberOfPatchVertices != 3 && numberOfPatchVertices != 4)
+          || patchVertices[0] == nullptr || patchVertices[1] == nullptr || patchVertices[2] == nullptr
+          || (numberOfPatchVertices == 4 && patchVertices[3] == nullptr) ) {
+            readError = true;
+            break;
+        }
+        patches[i] = new Patch(
+            numberOfPatchVertices, patchVertices[0], patchVertices[1], patchVertices[2], patchVertices[3]);
+        twins[i] = readInt();
+    }
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        if ( twins[i] >= 0 && twins[i] < numberOfPatches ) {
+            patches[i]->twin = patches[twins[i]];
+        }
+    }
+    delete[] twins;
+
+    // Surfaces and compounds, each one after the geometries it contains
+    int numberOfGeometries = readInt();
+    int firstGeometry = (int)context->allGeometries->size();
+    int numberOfGeometriesRead = 0;
+    int nextPoint = 0;
+    int nextNormal = 0;
+    int nextVertex = 0;
+    for ( int i = 0; i < numberOfGeometries && !readError; i++ ) {
+        int type = readInt();
+        int id = readInt();
+        Geometry *geometry;
+
+        if ( type == GEOMETRY_MESH ) {
+            char *objectName = readString();
+            int materialIndex = readInt();
+            Material *material = (Material *)defaultMaterial;
+            if ( materialIndex >= 0 && materialIndex < numberOfMaterials ) {
+                material = context->materials->get(firstMaterial + materialIndex);
+            }
+
+            java::ArrayList<Vector3D *> *meshPoints = new java::ArrayList<Vector3D *>();
+            java::ArrayList<Vector3D *> *meshNormals = new java::ArrayList<Vector3D *>();
+            java::ArrayList<Vertex *> *meshVertices = new java::ArrayList<Vertex *>();
+            java::ArrayList<Patch *> *meshFaces = new java::ArrayList<Patch *>();
+            int count = readInt();
+            for ( int j = 0; j < count && nextPoint < numberOfPoints; j++ ) {
+                meshPoints->add(points[nextPoint++]);
+            }
+            count = readInt();
+            for ( int j = 0; j < count && nextNormal < numberOfNormals; j++ ) {
+                meshNormals->add(normals[nextNormal++]);
+            }
+            count = readInt();
+            for ( int j = 0; j < count && nextVertex < numberOfVertices; j++ ) {
+                meshVertices->add(vertices[nextVertex++]);
+            }
+            count = readInt();
+            for ( int j = 0; j < count; j++ ) {
+                int index = readInt();
+                if ( index >= 0 && index < numberOfPatches && patches[index] != nullptr ) {
+                    meshFaces->add(patches[index]);
+                }
+            }
+
+            geometry = new MeshSurface(
+                objectName,
+                material,
+                meshPoints,
+                meshNormals,
+                nullptr,
+                meshVertices,
+                meshFaces,
+                MaterialColorFlags::NO_COLORS);
+        } else {
+            java::ArrayList<Geometry *> *children = new java::ArrayList<Geometry *>();
+            int count = readInt();
+            for ( int j = 0; j < count; j++ ) {
+                int index = readInt();
+                if ( index >= 0 && index < i ) {
+                    children->add(context->allGeometries->get(firstGeometry + index));
+                }
+            }
+            Compound *compound = new Compound(children);
+            geometry = new Geometry(nullptr, compound, GeometryClassId::COMPOUND);
+        }
+        geometry->id = id;
+        context->allGeometries->add(geometry);
+        numberOfGeometriesRead++;
+    }
+
+    // Toplevel geometries
+    java::ArrayList<Geometry *> *geometryList = new java::ArrayList<Geometry *>();
+    int numberOfTopLevelGeometries = readInt();
+    for ( int i = 0; i < numberOfTopLevelGeometries && !readError; i++ ) {
+        int index = readInt();
+        if ( index >= 0 && index < numberOfGeometriesRead ) {
+            geometryList->add(context->allGeometries->get(firstGeometry + index));
+        }
+    }
+
+    // Counters as they were after parsing
+    int geometryIdAfterParsing = readInt();
+    int numberOfVerticesAfterParsing = readInt();
+
+    if ( readError ) {
+        // Undo what was added to the context and the counters, so the scene can be
+        // parsed instead. The objects created so far reference each other in an
+        // unfinished state and are not freed
+        logError("SceneCache", "Scene cache file '%s' is incomplete, reading the scene instead", cacheFileName);
+        delete geometryList;
+        while ( (int)context->allGeometries->size() > firstGeometry ) {
+            context->allGeometries->remove(context->allGeometries->size() - 1);
+        }
+        while ( (int)context->materials->size() > firstMaterial ) {
+            context->materials->remove(context->materials->size() - 1);
+        }
+        Patch::setNextId(nextPatchId);
+        Geometry::nextGeometryId = nextGeometryId;
+        GLOBAL_statistics.numberOfGeometries = numberOfGeometriesBefore;
+        GLOBAL_statistics.numberOfCompounds = numberOfCompoundsBefore;
+        GLOBAL_statistics.numberOfSurfaces = numberOfSurfacesBefore;
+        GLOBAL_statistics.numberOfVertices = numberOfVerticesBefore;
+        GLOBAL_statistics.numberOfElements = numberOfElementsBefore;
+        unmapFile();
+        return false;
+    }
+
+    context->currentGeometryList = geometryList;
+    context->geometries = geometryList;
+    Geometry::nextGeometryId = geometryIdAfterParsing;
+    GLOBAL_statistics.numberOfVertices = numberOfVerticesAfterParsing;
+    return true;
+}
+
+PatchClusterOctreeNode *
+SceneCache::readClusterNode() {
+    PatchClusterOctreeNode *cluster = new PatchClusterOctreeNode();
+
+    int numberOfClusterPatches = readInt();
+    for ( int i = 0; i < numberOfClusterPatches && !readError; i++ ) {
+        int index = readInt();
+        if ( index >= 0 && index < numberOfPatches ) {
+            cluster->clusterAddPatch(patches[index]);
+        }
+    }
+
+    int numberOfChildren = readInt();
+    for ( int i = 0; i < numberOfChildren && i < MAXIMUM_CLUSTER_CHILDREN && !readError; i++ ) {
+        cluster->children[i] = readClusterNode();
+    }
+
+    return cluster;
+}
+
+/**
+Creates the cluster hierarchy from the cache, as sceneBuilderCreateClusterHierarchy()
+does by splitting clusters, after the model was read with readModel(). Returns
+nullptr, without creating any geometry, when the cache file turns out to be
+incomplete or damaged: the hierarchy is then to be built from the patches
+*/
+Geometry *
+SceneCache::readClusterHierarchy() {
+    PatchClusterOctreeNode *rootCluster = readClusterNode();
+    Geometry *rootGeometry = nullptr;
+
+    if ( readError ) {
+        logError("SceneCache", "Scene cache file '%s' is incomplete, building the cluster hierarchy instead",
+                 cacheFileName);
+    } else {
+        rootGeometry = rootCluster->convertClusterToGeometry();
+    }
+    delete rootCluster;
+    unmapFile();
+    return rootGeometry;
+}
+
+void
+SceneCache::writeBytes(const void *bytes, size_t size) {
+    if ( fwrite(bytes, 1, size, output) != size ) {
+        writeError = true;
+    }
+    outputSize += size;
+    outputHash = hashBytes(outputHash, bytes, size);
+}
+
+void
+SceneCache::writeInt(int value) {
+    int32_t written = value;
+    writeBytes(&written, sizeof(written));
+}
+
+void
+SceneCache::writeLong(uint64_t value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void
+SceneCache::writeFloat(float value) {
+    writeBytes(&value, sizeof(value));
+}
+
+void
+SceneCache::writeString(const char *string) {
+    if ( string == nullptr ) {
+        writeInt(-1);
+        return;
+    }
+    int length = (int)strlen(string);
+    writeInt(length);
+    writeBytes(string, length);
+}
+
+void
+SceneCache::writeColor(const ColorRgb &color) {
+    writeFloat(color.r);
+    writeFloat(color.g);
+    writeFloat(color.b);
+}
+
+void
+SceneCache::writeMaterial(const Material *material) {
+    writeString(material->getName());
+    writeInt(material->isSided() ? 1 : 0);
+
+    const PhongEmittanceDistributionFunction *edf = material->getEdf();
+    writeInt(edf != nullptr ? 1 : 0);
+    if ( edf != nullptr ) {
+        writeColor(edf->getKd());
+        writeColor(edf->getKs());
+        writeFloat(edf->getNs());
+    }
+
+    const PhongBidirectionalScatteringDistributionFunction *bsdf = material->getBsdf();
+    writeInt(bsdf != nullptr ? 1 : 0);
+    if ( bsdf == nullptr ) {
+        return;
+    }
+    if ( bsdf->getTexture() != nullptr ) {
+        // Textures do not come from MGF files
+        writeError = true;
+    }
+
+    const PhongBidirectionalReflectanceDistributionFunction *brdf = bsdf->getBrdf();
+    writeInt(brdf != nullptr ? 1 : 0);
+    if ( brdf != nullptr ) {
+        writeColor(brdf->getKd());
+        writeColor(brdf->getKs());
+        writeFloat(brdf->getNs());
+    }
+
+    const PhongBidirectionalTransmittanceDistributionFunction *btdf = bsdf->getBtdf();
+    writeInt(btdf != nullptr ? 1 : 0);
+    if ( btdf != nullptr ) {
+        writeColor(btdf->getKd());
+        writeColor(btdf->getKs());
+        writeFloat(btdf->getNs());
+        writeFloat(btdf->getRefractionIndex().getNr());
+        writeFloat(btdf->getRefractionIndex().getNi());
+    }
+}
+
+/**
+Writes a cluster as created by PatchClusterOctreeNode::convertClusterToGeometry(): a
+compound with the patches of the cluster as a first patch set child, if it has
+patches, followed by the sub-clusters
+*/
+void
+SceneCache::writeClusterNode(const Geometry *geometry) {
+    if ( writeError || geometry->className != GeometryClassId::COMPOUND || geometry->compoundData == nullptr ) {
+        writeError = true;
+        return;
+    }
+
+    const java::ArrayList<Geometry *> *children = geometry->compoundData->children;
+    int firstChild = 0;
+    if ( children->size() > 0 && children->get(0)->className == GeometryClassId::PATCH_SET ) {
+        const java::ArrayList<Patch *> *clusterPatches = ((const PatchSet *)children->get(0))->getPatchList();
+        writeInt((int)clusterPatches->size());
+        for ( int i = 0; i < clusterPatches->size(); i++ ) {
+            writeInt((int)clusterPatches->get(i)->id - 1);
+        }
+        firstChild = 1;
+    } else {
+        writeInt(0);
+    }
+
+    int numberOfChildren = (int)children->size() - firstChild;
+    if ( numberOfChildren > MAXIMUM_CLUSTER_CHILDREN ) {
+        writeError = true;
+        return;
+    }
+    writeInt(numberOfChildren);
+    for ( int i = firstChild; i < children->size(); i++ ) {
+        writeClusterNode(children->get(i));
+    }
+}
+
+/**
+Writes the scene read with readMgf() and its cluster hierarchy to the cache. The cache
+is written to a temporary file first, which replaces the cache when complete, so an
+interrupted run never leaves a partial cache behind. Scenes using objects that can
+not be cached are not written
+*/
+void
+SceneCache::write(const char *sceneFileName, const MgfContext *context, const Geometry *clusteredRootGeometry) {
+    if ( !isEnabled() || context->readFileNames->size() == 0
+      || strcmp(context->readFileNames->get(0), sceneFileName) != 0 ) {
+        return;
+    }
+
+    // Number the positions, normals and vertices of the surfaces in order
+    const java::ArrayList<Geometry *> *geometries = context->allGeometries;
+    int totalPoints = 0;
+    int totalNormals = 0;
+    int totalVertices = 0;
+    for ( int i = 0; i < geometries->size(); i++ ) {
+        if ( geometries->get(i)->className == GeometryClassId::SURFACE_MESH ) {
+            const MeshSurface *mesh = (const MeshSurface *)geometries->get(i);
+            totalPoints += (int)mesh->positions->size();
+            totalNormals += (int)mesh->normals->size();
+            totalVertices += (int)mesh->vertices->size();
+        }
+    }
+
+    SceneCacheEntry *pointEntries = new SceneCacheEntry[totalPoints + 1];
+    SceneCacheEntry *normalEntries = new SceneCacheEntry[totalNormals + 1];
+    SceneCacheEntry *vertexEntries = new SceneCacheEntry[totalVertices + 1];
+    SceneCacheEntry *geometryEntries = new SceneCacheEntry[geometries->size() + 1];
+    int totalPatches = Patch::getNextId() - 1;
+    const Patch **patchesById = new const Patch *[totalPatches + 1]();
+    bool complete = true;
+    int point = 0;
+    int normal = 0;
+    int vertex = 0;
+    for ( int i = 0; i < geometries->size(); i++ ) {
+        geometryEntries[i].object = geometries->get(i);
+        geometryEntries[i].index = i;
+        if ( geometries->get(i)->className != GeometryClassId::SURFACE_MESH ) {
+            continue;
+        }
+        const MeshSurface *mesh = (const MeshSurface *)geometries->get(i);
+        for ( int j = 0; j < mesh->positions->size(); j++, point++ ) {
+            pointEntries[point].object = mesh->positions->get(j);
+            pointEntries[point].index = point;
+        }
+        for ( int j = 0; j < mesh->normals->size(); j++, normal++ ) {
+            normalEntries[normal].object = mesh->normals->get(j);
+            normalEntries[normal].index = normal;
+        }
+        for ( int j = 0; j < mesh->vertices->size(); j++, vertex++ ) {
+            vertexEntries[vertex].object = mesh->vertices->get(j);
+            vertexEntries[vertex].index = vertex;
+        }
+        for ( int j = 0; j < mesh->faces->size(); j++ ) {
+            const Patch *patch = mesh->faces->get(j);
+            if ( patch->id < 1 || (int)patch->id > totalPatches || patchesById[patch->id - 1] != nullptr ) {
+                complete = false;
+            } else {
+                patchesById[patch->id - 1] = patch;
+            }
+        }
+    }
+    for ( int i = 0; i < totalPatches; i++ ) {
+        if ( patchesById[i] == nullptr ) {
+            complete = false;
+        }
+    }
+    int numberOfGeometries = (int)geometries->size();
+    qsort(pointEntries, totalPoints, sizeof(SceneCacheEntry), sceneCacheCompareEntries);
+    qsort(normalEntries, totalNormals, sizeof(SceneCacheEntry), sceneCacheCompareEntries);
+    qsort(vertexEntries, totalVertices, sizeof(SceneCacheEntry), sceneCacheCompareEntries);
+    qsort(geometryEntries, numberOfGeometries, sizeof(SceneCacheEntry), sceneCacheCompareEntries);
+
+    int n = (int)strlen(cacheFileName) + 5;
+    char *temporaryFileName = new char[n];
+    snprintf(temporaryFileName, n, "%s.tmp", cacheFileName);
+    output = complete ? fopen(temporaryFileName, "wb") : nullptr;
+    if ( output != nullptr ) {
+        outputSize = 0;
+        outputHash = FNV_OFFSET_BASIS;
+        writeError = false;
+
+        // Header, completed at the end
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        writeBytes(&magic, sizeof(magic));
+        writeBytes(&version, sizeof(version));
+        writeLong(0);
+        writeLong(0);
+        outputSize = 0;
+        outputHash = FNV_OFFSET_BASIS;
+
+        writeInt(context->numberOfQuarterCircleDivisions);
+        writeInt((int)context->singleSided);
+        writeInt((int)context->monochrome);
+        writeInt((int)clusterHierarchyType);
+
+        // Scene files, skipping files included more than once
+        int numberOfFiles = 0;
+        for ( int i = 0; i < context->readFileNames->size(); i++ ) {
+            int j = 0;
+            while ( j < i && strcmp(context->readFileNames->get(j), context->readFileNames->get(i)) != 0 ) {
+                j++;
+            }
+            if ( j == i ) {
+                numberOfFiles++;
+            }
+        }
+        writeInt(numberOfFiles);
+        for ( int i = 0; i < context->readFileNames->size() && !writeError; i++ ) {
+            int j = 0;
+            while ( j < i && strcmp(context->readFileNames->get(j), context->readFileNames->get(i)) != 0 ) {
+                j++;
+            }
+            if ( j < i ) {
+                continue;
+            }
+            uint64_t size;
+            uint64_t hash;
+            if ( !hashFile(context->readFileNames->get(i), &size, &hash) ) {
+                writeError = true;
+            }
+            writeString(context->readFileNames->get(i));
+            writeLong(size);
+            writeLong(hash);
+        }
+
+        // Materials
+        int numberOfMaterials = context->materials != nullptr ? (int)context->materials->size() : 0;
+        writeInt(numberOfMaterials);
+        for ( int i = 0; i < numberOfMaterials; i++ ) {
+            writeMaterial(context->materials->get(i));
+        }
+
+        // Positions and normals
+        writeInt(totalPoints);
+        for ( int i = 0; i < geometries->size(); i++ ) {
+            if ( geometries->get(i)->className == GeometryClassId::SURFACE_MESH ) {
+                const MeshSurface *mesh = (const MeshSurface *)geometries->get(i);
+                for ( int j = 0; j < mesh->positions->size(); j++ ) {
+                    writeFloat(mesh->positions->get(j)->x);
+                    writeFloat(mesh->positions->get(j)->y);
+                    writeFloat(mesh->positions->get(j)->z);
+                }
+            }
+        }
+        writeInt(totalNormals);
+        for ( int i = 0; i < geometries->size(); i++ ) {
+            if ( geometries->get(i)->className == GeometryClassId::SURFACE_MESH ) {
+                const MeshSurface *mesh = (const MeshSurface *)geometries->get(i);
+                for ( int j = 0; j < mesh->normals->size(); j++ ) {
+                    writeFloat(mesh->normals->get(j)->x);
+                    writeFloat(mesh->normals->get(j)->y);
+                    writeFloat(mesh->normals->get(j)->z);
+                }
+            }
+        }
+
+        // Vertices
+        writeInt(totalVertices);
+        for ( int i = 0; i < geometries->size(); i++ ) {
+            if ( geometries->get(i)->className != GeometryClassId::SURFACE_MESH ) {
+                continue;
+            }
+            const MeshSurface *mesh = (const MeshSurface *)geometries->get(i);
+            for ( int j = 0; j < mesh->vertices->size(); j++ ) {
+                const Vertex *meshVertex = mesh->vertices->get(j);
+                int pointIndex = sceneCacheFindEntry(pointEntries, totalPoints, meshVertex->point);
+                int normalIndex = sceneCacheFindEntry(normalEntries, totalNormals, meshVertex->normal);
+                int backIndex = sceneCacheFindEntry(vertexEntries, totalVertices, meshVertex->back);
+                if ( pointIndex < -1 || normalIndex < -1 || backIndex < -1 || meshVertex->textureCoordinates != nullptr ) {
+                    writeError = true;
+                }
+                writeInt(meshVertex->id);
+                writeInt(pointIndex);
+                writeInt(normalIndex);
+                writeInt(backIndex);
+            }
+        }
+
+        // Patches
+        writeInt(totalPatches);
+        for ( int i = 0; i < totalPatches; i++ ) {
+            const Patch *patch = patchesById[i];
+            writeInt(patch->numberOfVertices);
+            for ( int j = 0; j < MAXIMUM_VERTICES_PER_PATCH; j++ ) {
+                int vertexIndex = sceneCacheFindEntry(vertexEntries, totalVertices, patch->vertex[j]);
+                if ( vertexIndex < -1 ) {
+                    writeError = true;
+                }
+                writeInt(vertexIndex);
+            }
+            writeInt(patch->twin != nullptr ? (int)patch->twin->id - 1 : -1);
+        }
+
+        // Surfaces and compounds
+        writeInt(numberOfGeometries);
+        for ( int i = 0; i < numberOfGeometries; i++ ) {
+            const Geometry *geometry = geometries->get(i);
+            if ( geometry->className == GeometryClassId::SURFACE_MESH ) {
+                const MeshSurface *mesh = (const MeshSurface *)geometry;
+                int materialIndex = -1;
+                if ( mesh->material != defaultMaterial ) {
+                    materialIndex = -2;
+                    for ( int j = 0; j < numberOfMaterials; j++ ) {
+                        if ( context->materials->get(j) == mesh->material ) {
+                            materialIndex = j;
+                            break;
+                        }
+                    }
+                }
+                if ( materialIndex < -1 ) {
+                    writeError = true;
+                }
+                writeInt(GEOMETRY_MESH);
+                writeInt(mesh->id);
+                writeString(mesh->objectName);
+                writeInt(materialIndex);
+                writeInt((int)mesh->positions->size());
+                writeInt((int)mesh->normals->size());
+                writeInt((int)mesh->vertices->size());
+                writeInt((int)mesh->faces->size());
+                for ( int j = 0; j < mesh->faces->size(); j++ ) {
+                    writeInt((int)mesh->faces->get(j)->id - 1);
+                }
+            } else if ( geometry->className == GeometryClassId::COMPOUND && geometry->compoundData != nullptr ) {
+                const java::ArrayList<Geometry *> *children = geometry->compoundData->children;
+                writeInt(GEOMETRY_COMPOUND);
+                writeInt(geometry->id);
+                writeInt((int)children->size());
+                for ( int j = 0; j < children->size(); j++ ) {
+                    // Geometries are read in order, children have to be there before their compound
+                    int childIndex = sceneCacheFindEntry(geometryEntries, numberOfGeometries, children->get(j));
+                    if ( childIndex < 0 || childIndex >= i ) {
+                        writeError = true;
+                    }
+                    writeInt(childIndex);
+                }
+            } else {
+                writeError = true;
+            }
+        }
+
+        // Toplevel geometries
+        writeInt((int)context->geometries->size());
+        int maximumGeometryId = -1;
+        for ( int i = 0; i < context->geometries->size(); i++ ) {
+            int index = sceneCacheFindEntry(geometryEntries, numberOfGeometries, context->geometries->get(i));
+            if ( index < 0 ) {
+                writeError = true;
+            }
+            writeInt(index);
+        }
+        for ( int i = 0; i < numberOfGeometries; i++ ) {
+            if ( geometries->get(i)->id > maximumGeometryId ) {
+                maximumGeometryId = geometries->get(i)->id;
+            }
+        }
+        writeInt(maximumGeometryId + 1);
+        writeInt(GLOBAL_statistics.numberOfVertices);
+
+        // Cluster hierarchy
+        writeClusterNode(clusteredRootGeometry);
+
+        // Complete the header
+        uint64_t payloadSize = outputSize;
+        uint64_t payloadHash = outputHash;
+        if ( fseek(output, 2 * sizeof(uint32_t), SEEK_SET) != 0
+          || fwrite(&payloadSize, sizeof(payloadSize), 1, output) != 1
+          || fwrite(&payloadHash, sizeof(payloadHash), 1, output) != 1 ) {
+            writeError = true;
+        }
+        if ( fclose(output) != 0 ) {
+            writeError = true;
+        }
+        output = nullptr;
+
+        if ( writeError || rename(temporaryFileName, cacheFileName) != 0 ) {
+            remove(temporaryFileName);
+            complete = false;
+        }
+        if ( !complete ) {
+            logWarning("SceneCache", "Could not write the scene cache '%s'", cacheFileName);
+        }
+    } else if ( complete ) {
+        logWarning("SceneCache", "Can't open file '%s' for writing", temporaryFileName);
+    } else {
+        logWarning("SceneCache", "The scene in '%s' can not be cached", sceneFileName);
+    }
+
+    delete[] temporaryFileName;
+    delete[] pointEntries;
+    delete[] normalEntries;
+    delete[] vertexEntries;
+    delete[] geometryEntries;
+    delete[] patchesById;
+}
@@ -0,0 +1,96 @@
+/**
+Binary cache of a loaded scene, so repeated runs on the same scene skip the MGF
+parsing and the cluster hierarchy construction.
+
+The cache file holds the materials, the vertex positions and normals, the vertices,
+the patches, the surface and compound geometries and the patch cluster hierarchy of
+the scene, all pointers being replaced by indices. It is read with a single memory
+mapping and the objects are created through the same constructors and in the same
+order as when parsing, so ids, bounding boxes and everything derived from them come
+out exactly the same.
+
+The cache is only used when it was written by this version, with the same options
+changing the geometry (-nqcdivs, -force-onesided, -monochromatic) and the same
+-cluster-hierarchy, and when every file read for the scene (the main file and its
+includes) still has the size and content hash recorded in it. Otherwise the scene
+is parsed and the cache written again. The ray intersection acceleration structure
+is not cached: it is built in a small fraction of the load time
+*/
+
+#ifndef __SCENE_CACHE__
+#define __SCENE_CACHE__
+
+#include <cstdio>
+#include <cstdint>
+
+#include "java/util/ArrayList.h"
+#include "io/mgf/MgfContext.h"
+#include "scene/PatchClusterOctreeNode.h"
+#include "scene/ClusterHierarchyType.h"
+
+class SceneCache {
+  private:
+    static const uint32_t MAGIC = 0x43534b52; // "RKSC"
+    static const int VERSION = 2;
+    static const size_t HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+    const char *cacheFileName;
+    const Material *defaultMaterial; // Material of the surfaces defined before any material
+    ClusterHierarchyType clusterHierarchyType;
+
+    // Reading state
+    const char *data; // Memory mapped cache file
+    size_t dataSize;
+    size_t cursor;
+    bool readError;
+    Vector3D **points;
+    int numberOfPoints;
+    Vector3D **normals;
+    int numberOfNormals;
+    Vertex **vertices;
+    int numberOfVertices;
+    Patch **patches; // Indexed by patch id - 1
+    int numberOfPatches;
+
+    // Writing state
+    FILE *output;
+    uint64_t outputSize;
+    uint64_t outputHash;
+    bool writeError;
+
+    static uint64_t hashBytes(uint64_t hash, const void *bytes, size_t size);
+    static bool hashFile(const char *fileName, uint64_t *size, uint64_t *hash);
+
+    bool mapFile();
+    void unmapFile();
+    void readBytes(void *target, size_t size);
+    int readInt();
+    uint64_t readLong();
+    float readFloat();
+    ColorRgb readColor();
+    char *readString();
+    Vector3D *readVector(const Vector3D *const *table, int tableSize);
+    bool readHeader(const char *sceneFileName, const MgfContext *context);
+    Material *readMaterial();
+    PatchClusterOctreeNode *readClusterNode();
+
+    void writeBytes(const void *bytes, size_t size);
+    void writeInt(int value);
+    void writeLong(uint64_t value);
+    void writeFloat(float value);
+    void writeString(const char *string);
+    void writeColor(const ColorRgb &color);
+    void writeMaterial(const Material *material);
+    void writeClusterNode(const Geometry *geometry);
+
+  public:
+    explicit SceneCache(const char *inCacheFileName, const Material *inDefaultMaterial, ClusterHierarchyType inClusterHierarchyType);
+    ~SceneCache();
+
+    bool isEnabled() const;
+    bool readModel(const char *sceneFileName, MgfContext *context);
+    Geometry *readClusterHierarchy();
+    void write(const char *sceneFileName, const MgfContext *context, const Geometry *clusteredRootGeometry);
+};
+
+#endif
@@ -76,7 +76,7 @@ ImageOutputHandle::writeRadianceRGB(ColorRgb *rgbRadiance) {
 }
 
 /**
-Returns file name extension. Understands extra suffixes ".Z", ".gz",
+Returns file name extension. Understands extra suffixes ".Z", ".gz", ".zst",
 ".bz", and ".bz2".
 */
 const char *
@@ -89,6 +89,7 @@ imageFileExtension(const char *fileName) {
 
     if ( !strcmp(fileExtension, ".Z") ||
          !strcmp(fileExtension, ".gz") ||
+         !strcmp(fileExtension, ".zst") ||
          !strcmp(fileExtension, ".bz") ||
          !strcmp(fileExtension, ".bz2") ) {
         fileExtension--; // Before '.'
@@ -127,7 +128,7 @@ createRadianceImageOutputHandle(
                 return nullptr;
             }
 
-            return new PicOutputHandle(fileName, width, height);
+            return new PicOutputHandle(fileDescriptor, width, height);
         } else {
             logError("createRadianceImageOutputHandle",
                      "Can't save high dynamic range image to a '%s' file, format not supported.",
@@ -1,10 +1,14 @@
 #include "io/image/dkcolor.h"
 #include "io/image/pic.h"
 
-PicOutputHandle::PicOutputHandle(const char *filename, int w, int h) {
+/**
+Writes to a file opened by the caller, so compressed files are written like other ones.
+The caller also closes it
+*/
+PicOutputHandle::PicOutputHandle(FILE *inFileDescriptor, int w, int h) {
     ImageOutputHandle::init("high dynamic range PIC", w, h);
 
-    fileDescriptor = fopen(filename, "wb");
+    fileDescriptor = inFileDescriptor;
     if ( fileDescriptor == nullptr ) {
         fprintf(stderr, "Can't open PIC output");
         return;
@@ -14,9 +18,6 @@ PicOutputHandle::PicOutputHandle(const char *filename, int w, int h) {
 }
 
 PicOutputHandle::~PicOutputHandle() {
-    if ( fileDescriptor != nullptr ) {
-        fclose(fileDescriptor);
-    }
     fileDescriptor = nullptr;
 }
 
@@ -15,7 +15,7 @@ class PicOutputHandle final : public ImageOutputHandle {
     void writeHeader();
 
   public:
-    PicOutputHandle(const char *filename, int w, int h);
+    PicOutputHandle(FILE *inFileDescriptor, int w, int h);
     ~PicOutputHandle() final;
     int writeRadianceRGB(ColorRgb *rgbRadiance) final;
 };
@@ -8,6 +8,7 @@ MgfContext::MgfContext():
     singleSided(),
     currentVertexName(),
     numberOfQuarterCircleDivisions(),
+    numberOfThreads(1),
     monochrome(),
     entityNames(),
     errorCodeMessages(),
@@ -80,6 +81,8 @@ MgfContext::MgfContext():
     *vertexLookUpTable = LOOK_UP_INIT(lookUpRemove, lookUpRemove);
 
     allGeometries = new java::ArrayList<Geometry *>();
+    readFileNames = new java::ArrayList<char *>();
+    fileLoader = nullptr;
     currentObjectName = nullptr;
 }
 
@@ -87,4 +90,8 @@ MgfContext::~MgfContext() {
     delete unNamedColorContext;
     delete vertexLookUpTable;
     delete allGeometries;
+    for ( int i = 0; i < readFileNames->size(); i++ ) {
+        delete[] readFileNames->get(i);
+    }
+    delete readFileNames;
 }
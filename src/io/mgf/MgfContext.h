@@ -12,6 +12,7 @@
 class MgfTransformContext;
 class MgfColorContext;
 class LookUpTable;
+class MgfFileLoader;
 
 class MgfContext {
   public:
@@ -20,6 +21,7 @@ class MgfContext {
     bool singleSided;
     char *currentVertexName;
     int numberOfQuarterCircleDivisions;
+    int numberOfThreads; // Threads reading the files of the scene, see MgfFileLoader
     bool monochrome;
     Material *currentMaterial;
 
@@ -48,6 +50,8 @@ class MgfContext {
     bool inComplex;
     LookUpTable *vertexLookUpTable;
     java::ArrayList<Geometry *> *allGeometries;
+    java::ArrayList<char *> *readFileNames; // Every file opened while reading, see SceneCache
+    MgfFileLoader *fileLoader; // Reads files ahead of the parser when there are several threads
 
     // Return model
     java::ArrayList<Geometry *> *geometries;
@@ -0,0 +1,127 @@
+#include <cstring>
+
+#include "java/util/ArrayList.txx"
+#include "io/mgf/mgfDefinitions.h"
+#include "io/mgf/MgfFileLoader.h"
+
+MgfFileLoader::MgfFileLoader(const char *mainFileName, const char *inIncludeEntityName, int numberOfThreads):
+    nextFileToPrepare(),
+    stopping(false),
+    includeEntityName(inIncludeEntityName)
+{
+    files = new java::ArrayList<MgfPreparedFile *>();
+    files->add(new MgfPreparedFile(mainFileName));
+    threads = new java::ArrayList<std::thread *>();
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        threads->add(new std::thread(&MgfFileLoader::prepareFiles, this));
+    }
+}
+
+/**
+Files not started yet are not read anymore, the parser is done
+*/
+MgfFileLoader::~MgfFileLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    fileAdded.notify_all();
+    for ( int i = 0; i < threads->size(); i++ ) {
+        threads->get(i)->join();
+        delete threads->get(i);
+    }
+    delete threads;
+    for ( int i = 0; i < files->size(); i++ ) {
+        delete files->get(i);
+    }
+    delete files;
+}
+
+MgfPreparedFile *
+MgfFileLoader::findFile(const char *fileName) const {
+    for ( int i = 0; i < files->size(); i++ ) {
+        if ( strcmp(files->get(i)->fileName, fileName) == 0 ) {
+            return files->get(i);
+        }
+    }
+    return nullptr;
+}
+
+/**
+Queues the files included by the given one, with the names the parser gives them
+*/
+void
+MgfFileLoader::addIncludedFiles(const MgfPreparedFile *file) {
+    char fileName[sizeof(file->fileName)];
+    bool added = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for ( int i = 0; i < file->numberOfLines; i++ ) {
+        const MgfPreparedLine *line = &file->lines[i];
+        if ( line->numberOfWords < 2
+             || strcmp(file->words + file->wordOffsets[line->firstWord], includeEntityName) != 0 ) {
+            continue;
+        }
+        const char *includedName = file->words + file->wordOffsets[line->firstWord + 1];
+        if ( strlen(file->fileName) + strlen(includedName) >= sizeof(fileName)
+             || !mgfIncludedFileName(fileName, file->fileName, includedName)
+             || findFile(fileName) != nullptr ) {
+            continue;
+        }
+        files->add(new MgfPreparedFile(fileName));
+        added = true;
+    }
+    lock.unlock();
+    if ( added ) {
+        fileAdded.notify_all();
+    }
+}
+
+/**
+Body of the loader threads: prepares the queued files until the loader is deleted
+*/
+void
+MgfFileLoader::prepareFiles() {
+    for ( ;; ) {
+        MgfPreparedFile *file;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fileAdded.wait(lock, [this] { return stopping || nextFileToPrepare < files->size(); });
+            if ( stopping ) {
+                return;
+            }
+            file = files->get(nextFileToPrepare++);
+        }
+
+        file->prepare();
+        if ( !file->failed ) {
+            addIncludedFiles(file);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            file->ready = true;
+        }
+        fileReady.notify_all();
+    }
+}
+
+/**
+Returns the prepared file with the given name, waiting for a loader thread to finish
+it if needed. Returns nullptr for files the loader does not know or could not read:
+the parser then opens them itself
+*/
+const MgfPreparedFile *
+MgfFileLoader::getFile(const char *fileName) {
+    std::unique_lock<std::mutex> lock(mutex);
+    MgfPreparedFile *file = findFile(fileName);
+
+    if ( file == nullptr ) {
+        return nullptr;
+    }
+    fileReady.wait(lock, [file] { return file->ready; });
+    if ( file->failed ) {
+        return nullptr;
+    }
+    return file;
+}
@@ -0,0 +1,45 @@
+#ifndef __MGF_FILE_LOADER__
+#define __MGF_FILE_LOADER__
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "java/util/ArrayList.h"
+#include "io/mgf/MgfPreparedFile.h"
+
+/**
+Reads the files of an MGF scene ahead of the parser, on several threads. Starting
+from the main file, each file is mapped and split into lines and words, and the files
+it includes ('i' entities) are queued for the next free thread, so the included files
+are prepared concurrently while the parser works on the ones before them.
+
+Only the reading is concurrent: the parser handles the entities of all files on its
+own thread and in file order, as included files depend on the materials, vertices
+and transforms defined before them and define new ones for the files after them.
+Patch ids, materials and geometries are therefore exactly the same as when the files
+are read one after the other
+*/
+class MgfFileLoader {
+  private:
+    std::mutex mutex;
+    std::condition_variable fileAdded;
+    std::condition_variable fileReady;
+    java::ArrayList<MgfPreparedFile *> *files; // In the order they were found
+    int nextFileToPrepare;
+    bool stopping;
+    java::ArrayList<std::thread *> *threads;
+    const char *includeEntityName;
+
+    MgfPreparedFile *findFile(const char *fileName) const;
+    void addIncludedFiles(const MgfPreparedFile *file);
+    void prepareFiles();
+
+  public:
+    explicit MgfFileLoader(const char *mainFileName, const char *inIncludeEntityName, int numberOfThreads);
+    ~MgfFileLoader();
+
+    const MgfPreparedFile *getFile(const char *fileName);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/FileUncompressWrapper.h"
+#include "io/mgf/readmgf.h"
+#include "io/mgf/MgfPreparedFile.h"
+
+MgfPreparedFile::MgfPreparedFile(const char *inFileName):
+    fileName(),
+    ready(false),
+    failed(false),
+    content(),
+    contentSize(),
+    lines(),
+    numberOfLines(),
+    words(),
+    wordOffsets(),
+    numberOfWords(),
+    wordOffsetsSize()
+{
+    strncpy(fileName, inFileName, sizeof(fileName) - 1);
+}
+
+MgfPreparedFile::~MgfPreparedFile() {
+    if ( content != nullptr ) {
+        munmap((void *)content, (size_t)contentSize);
+    }
+    delete[] lines;
+    delete[] words;
+    delete[] wordOffsets;
+}
+
+void
+MgfPreparedFile::addWordOffset(int offset) {
+    if ( numberOfWords == wordOffsetsSize ) {
+        wordOffsetsSize = wordOffsetsSize == 0 ? 1024 : 2 * wordOffsetsSize;
+        int *newOffsets = new int[wordOffsetsSize];
+        if ( numberOfWords > 0 ) {
+            memcpy(newOffsets, wordOffsets, numberOfWords * sizeof(int));
+        }
+        delete[] wordOffsets;
+        wordOffsets = newOffsets;
+    }
+    wordOffsets[numberOfWords++] = offset;
+}
+
+/**
+Maps the file and splits it with the same functions the parser uses on files it
+reads itself, so the lines, line numbers and words are exactly the same
+*/
+void
+MgfPreparedFile::prepare() {
+    struct stat status{};
+
+    if ( isPipedFileName(fileName) || compressionFormatOfFileName(fileName) != CompressionFormat::NO_COMPRESSION ) {
+        failed = true;
+        return;
+    }
+    int fileDescriptor = open(fileName, O_RDONLY);
+    if ( fileDescriptor < 0 ) {
+        failed = true;
+        return;
+    }
+    if ( fstat(fileDescriptor, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0 ) {
+        close(fileDescriptor);
+        failed = true;
+        return;
+    }
+    void *mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if ( mapping == MAP_FAILED ) {
+        failed = true;
+        return;
+    }
+    content = (const char *)mapping;
+    contentSize = (long)status.st_size;
+
+    // Lines longer than the input line are split in several ones
+    long maximumNumberOfLines = contentSize / (MGF_MAXIMUM_INPUT_LINE_LENGTH - 1) + 2;
+    for ( const char *cp = content; (cp = (const char *)memchr(cp, '\n', content + contentSize - cp)) != nullptr; cp++ ) {
+        maximumNumberOfLines++;
+    }
+    lines = new MgfPreparedLine[maximumNumberOfLines];
+    words = new char[contentSize + maximumNumberOfLines];
+
+    MgfReaderContext *reader = new MgfReaderContext();
+    const char *argv[MGF_MAXIMUM_ARGUMENT_COUNT];
+    char *word = words;
+    int length;
+
+    reader->fileContent = content;
+    reader->fileContentSize = contentSize;
+    reader->fileContentPosition = 0;
+    reader->lineNumber = 0;
+    for ( long offset = 0; (length = mgfReadNextMappedLine(reader)) > 0; offset = reader->fileContentPosition ) {
+        MgfPreparedLine *line = &lines[numberOfLines++];
+        line->offset = offset;
+        line->length = length;
+        line->lineNumber = reader->lineNumber;
+        line->firstWord = numberOfWords;
+        line->numberOfWords = mgfSplitWords(reader->inputLine, word, argv);
+        for ( int i = 0; i < line->numberOfWords; i++ ) {
+            addWordOffset((int)(argv[i] - words));
+        }
+        if ( line->numberOfWords > 0 ) {
+            const char *lastWord = argv[line->numberOfWords - 1];
+            word = (char *)lastWord + strlen(lastWord) + 1;
+        }
+    }
+    delete reader;
+}
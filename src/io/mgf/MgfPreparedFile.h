@@ -0,0 +1,47 @@
+#ifndef __MGF_PREPARED_FILE__
+#define __MGF_PREPARED_FILE__
+
+#include "io/mgf/MgfReaderContext.h"
+
+/**
+A line of an MgfPreparedFile, as mgfReadNextLine() reads it: continuation lines
+are part of it
+*/
+class MgfPreparedLine {
+  public:
+    long offset; // Start of the line in the file content
+    int length; // Bytes copied to the input line
+    int lineNumber; // Line number once the line is read
+    int firstWord; // Index of the first word offset in MgfPreparedFile::wordOffsets
+    int numberOfWords; // -1 when the line has more words than the parser accepts
+};
+
+/**
+An MGF file mapped in memory and split into lines and words by one of the threads of
+the MgfFileLoader, ahead of the parser. The parser then only copies the line for error
+messages and object names and passes the words to the entity handlers
+*/
+class MgfPreparedFile {
+  private:
+    void addWordOffset(int offset);
+
+  public:
+    char fileName[96];
+    bool ready; // Set once prepare() finished, the loader mutex guards it
+    bool failed; // The file could not be mapped, the parser reads it itself
+    const char *content;
+    long contentSize;
+    MgfPreparedLine *lines;
+    int numberOfLines;
+    char *words; // Words of all lines, each one ended by '\0'
+    int *wordOffsets;
+    int numberOfWords;
+    int wordOffsetsSize;
+
+    explicit MgfPreparedFile(const char *inFileName);
+    ~MgfPreparedFile();
+
+    void prepare();
+};
+
+#endif
@@ -4,10 +4,19 @@
 #define MGF_MAXIMUM_INPUT_LINE_LENGTH 4096
 #define MGF_MAXIMUM_ARGUMENT_COUNT (MGF_MAXIMUM_INPUT_LINE_LENGTH / 4)
 
+class MgfPreparedFile;
+class DecompressingReader;
+
 class MgfReaderContext {
   public:
     char fileName[96];
     FILE *fp; // stream pointer
+    const char *fileContent; // Memory mapped file, lines are read through fp when nullptr
+    long fileContentSize;
+    long fileContentPosition;
+    const MgfPreparedFile *preparedFile; // Lines and words split by the file loader, nullptr when not used
+    int preparedLineIndex;
+    DecompressingReader *compressedFile; // Decompressed on a background thread, nullptr when not used
     int fileContextId;
     char inputLine[MGF_MAXIMUM_INPUT_LINE_LENGTH];
     int lineNumber;
@@ -1,8 +1,13 @@
 #include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "java/util/ArrayList.txx"
 #include "common/error.h"
 #include "io/FileUncompressWrapper.h"
+#include "io/DecompressingReader.h"
 #include "io/mgf/lookup.h"
+#include "io/mgf/MgfFileLoader.h"
 #include "io/mgf/MgfReaderFilePosition.h"
 #include "io/mgf/mgfDefinitions.h"
 
@@ -35,7 +40,15 @@ void
 mgfGetFilePosition(MgfReaderFilePosition *pos, MgfContext *context) {
     pos->fid = context->readerContext->fileContextId;
     pos->lineno = context->readerContext->lineNumber;
-    pos->offset = ftell(context->readerContext->fp);
+    if ( context->readerContext->preparedFile != nullptr ) {
+        pos->offset = context->readerContext->preparedLineIndex;
+    } else if ( context->readerContext->fileContent != nullptr ) {
+        pos->offset = context->readerContext->fileContentPosition;
+    } else if ( context->readerContext->compressedFile != nullptr ) {
+        pos->offset = context->readerContext->compressedFile->getPosition();
+    } else {
+        pos->offset = ftell(context->readerContext->fp);
+    }
 }
 
 /**
@@ -49,6 +62,29 @@ mgfGoToFilePosition(const MgfReaderFilePosition *pos, MgfContext *context) {
     if ( pos->lineno == context->readerContext->lineNumber ) {
         return MgfErrorCode::MGF_OK;
     }
+    if ( context->readerContext->preparedFile != nullptr ) {
+        if ( pos->offset < 0 || pos->offset > context->readerContext->preparedFile->numberOfLines ) {
+            return MgfErrorCode::MGF_ERROR_FILE_SEEK_ERROR;
+        }
+        context->readerContext->preparedLineIndex = (int)pos->offset;
+        context->readerContext->lineNumber = pos->lineno;
+        return MgfErrorCode::MGF_OK;
+    }
+    if ( context->readerContext->fileContent != nullptr ) {
+        if ( pos->offset < 0 || pos->offset > context->readerContext->fileContentSize ) {
+            return MgfErrorCode::MGF_ERROR_FILE_SEEK_ERROR;
+        }
+        context->readerContext->fileContentPosition = pos->offset;
+        context->readerContext->lineNumber = pos->lineno;
+        return MgfErrorCode::MGF_OK;
+    }
+    if ( context->readerContext->compressedFile != nullptr ) {
+        if ( !context->readerContext->compressedFile->setPosition(pos->offset) ) {
+            return MgfErrorCode::MGF_ERROR_FILE_SEEK_ERROR;
+        }
+        context->readerContext->lineNumber = pos->lineno;
+        return MgfErrorCode::MGF_OK;
+    }
     if ( context->readerContext->fp == stdin || context->readerContext->isPipe ) {
         // Cannot seek on standard input
         return MgfErrorCode::MGF_ERROR_FILE_SEEK_ERROR;
@@ -107,6 +143,50 @@ mgfHandle(int entityIndex, int argc, const char **argv, MgfContext *context) {
     return (*context->handleCallbacks[entityIndex])(argc, argv, context); // Assigned handler
 }
 
+/**
+Maps a regular file in memory, so lines are found and copied without going through
+the stdio buffers. Pipes and standard input keep being read with fgets
+*/
+static void
+mgfMapFile(MgfReaderContext *readerContext) {
+    struct stat status{};
+
+    readerContext->fileContent = nullptr;
+    readerContext->fileContentSize = 0;
+    readerContext->fileContentPosition = 0;
+    if ( readerContext->isPipe
+         || fstat(fileno(readerContext->fp), &status) != 0
+         || !S_ISREG(status.st_mode)
+         || status.st_size <= 0 ) {
+        return;
+    }
+
+    void *mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fileno(readerContext->fp), 0);
+    if ( mapping == MAP_FAILED ) {
+        return;
+    }
+    madvise(mapping, (size_t)status.st_size, MADV_SEQUENTIAL);
+    readerContext->fileContent = (const char *)mapping;
+    readerContext->fileContentSize = (long)status.st_size;
+}
+
+/**
+Name of a file included from the file includingFileName: the included name is relative
+to the directory of the including file. Returns false, leaving target unchanged, when
+the including file name has no directory
+*/
+bool
+mgfIncludedFileName(char *target, const char *includingFileName, const char *fileName) {
+    const char *cp = strrchr(includingFileName, '/');
+
+    if ( cp == nullptr ) {
+        return false;
+    }
+    strcpy(target, includingFileName);
+    strcpy(target + (cp - includingFileName + 1), fileName);
+    return true;
+}
+
 /**
 shaftCullOpen new input file
 */
@@ -117,6 +197,9 @@ mgfOpen(MgfReaderContext *readerContext, const char *functionCallback, MgfContex
     readerContext->fileContextId = ++numberOfFileIds;
     readerContext->lineNumber = 0;
     readerContext->isPipe = 0;
+    readerContext->fileContent = nullptr;
+    readerContext->preparedFile = nullptr;
+    readerContext->compressedFile = nullptr;
     if ( functionCallback == nullptr ) {
         strcpy(readerContext->fileName, "<stdin>");
         readerContext->fp = stdin;
@@ -127,23 +210,40 @@ mgfOpen(MgfReaderContext *readerContext, const char *functionCallback, MgfContex
 
     // Get name relative to this context
     if ( context->readerContext != nullptr ) {
-        const char *cp = strrchr(context->readerContext->fileName, '/');
-        if ( cp != nullptr ) {
-            strcpy(readerContext->fileName, context->readerContext->fileName);
-            strcpy(readerContext->fileName + (cp - context->readerContext->fileName + 1), functionCallback);
-        }
+        mgfIncludedFileName(readerContext->fileName, context->readerContext->fileName, functionCallback);
     } else {
         strcpy(readerContext->fileName, functionCallback);
     }
 
-    int isPipe;
-    readerContext->fp = openFileCompressWrapper(readerContext->fileName, "r", &isPipe);
-    readerContext->isPipe = (char)isPipe;
+    if ( context->fileLoader != nullptr ) {
+        readerContext->preparedFile = context->fileLoader->getFile(readerContext->fileName);
+    }
+    if ( readerContext->preparedFile != nullptr ) {
+        readerContext->fp = nullptr;
+        readerContext->preparedLineIndex = 0;
+    } else if ( compressionFormatOfFileName(readerContext->fileName) != CompressionFormat::NO_COMPRESSION ) {
+        readerContext->fp = nullptr;
+        readerContext->compressedFile = DecompressingReader::open(
+            readerContext->fileName, compressionFormatOfFileName(readerContext->fileName));
+        if ( readerContext->compressedFile == nullptr ) {
+            return MgfErrorCode::MGF_ERROR_CAN_NOT_OPEN_INPUT_FILE;
+        }
+    } else {
+        int isPipe;
+        readerContext->fp = openFileCompressWrapper(readerContext->fileName, "r", &isPipe);
+        readerContext->isPipe = (char)isPipe;
 
-    if ( readerContext->fp == nullptr ) {
-        return MgfErrorCode::MGF_ERROR_CAN_NOT_OPEN_INPUT_FILE;
+        if ( readerContext->fp == nullptr ) {
+            return MgfErrorCode::MGF_ERROR_CAN_NOT_OPEN_INPUT_FILE;
+        }
+        mgfMapFile(readerContext);
     }
 
+    // Remember the file, the scene cache depends on it
+    char *readFileName = new char[strlen(readerContext->fileName) + 1];
+    strcpy(readFileName, readerContext->fileName);
+    context->readFileNames->add(readFileName);
+
     readerContext->prev = context->readerContext; // Establish new context
     context->readerContext = readerContext;
     return MgfErrorCode::MGF_OK;
@@ -157,7 +257,15 @@ mgfClose(MgfContext *context) {
     MgfReaderContext *ctx = context->readerContext;
 
     context->readerContext = ctx->prev; // Restore enclosing context
-    if ( ctx->fp != stdin ) {
+    if ( ctx->fileContent != nullptr ) {
+        munmap((void *)ctx->fileContent, (size_t)ctx->fileContentSize);
+        ctx->fileContent = nullptr;
+    }
+    if ( ctx->compressedFile != nullptr ) {
+        delete ctx->compressedFile;
+        ctx->compressedFile = nullptr;
+    }
+    if ( ctx->fp != nullptr && ctx->fp != stdin ) {
         // Close file if it's a file
         closeFile(ctx->fp, ctx->isPipe);
     }
@@ -9,6 +9,7 @@ class MgfReaderFilePosition;
 
 typedef int (*HandleCallBack)(int, const char **, MgfContext *);
 
+extern bool mgfIncludedFileName(char *target, const char *includingFileName, const char *fileName);
 extern int mgfOpen(MgfReaderContext *readerContext, const char *functionCallback, MgfContext *context);
 extern void mgfClose(MgfContext *context);
 extern void doError(const char *errmsg, MgfContext *context);
@@ -50,10 +50,9 @@ mgfEntitySphere(int ac, const char **av, MgfContext *context) {
     if ( cv == nullptr) {
         return MgfErrorCode::MGF_ERROR_UNDEFINED_REFERENCE;
     }
-    if ( !isFloatWords(av[2]) ) {
+    if ( !readFloatWords(av[2], &rad) ) {
         return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
     }
-    rad = strtod(av[2], nullptr);
 
     // Initialize
     globalWarpConeEnds = true;
@@ -144,12 +143,10 @@ mgfEntityTorus(int ac, const char **av, MgfContext *context) {
     if ( cv->n.isNull(Numeric::EPSILON) ) {
         return MgfErrorCode::MGF_ERROR_ILLEGAL_ARGUMENT_VALUE;
     }
-    if ( !isFloatWords(av[2]) || !isFloatWords(av[3]) ) {
+    if ( !readFloatWords(av[2], &minRad) || !readFloatWords(av[3], &maxRad) ) {
         return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
     }
-    minRad = strtod(av[2], nullptr);
     Numeric::roundDeltaToZero(minRad, Numeric::EPSILON);
-    maxRad = strtod(av[3], nullptr);
 
     // Check orientation
     int sign;
@@ -357,12 +354,10 @@ mgfEntityRing(int ac, const char **av, MgfContext *context) {
     if ( vertexContext->n.isNull(Numeric::EPSILON) ) {
         return MgfErrorCode::MGF_ERROR_ILLEGAL_ARGUMENT_VALUE;
     }
-    if ( !isFloatWords(av[2]) || !isFloatWords(av[3]) ) {
+    if ( !readFloatWords(av[2], &minRad) || !readFloatWords(av[3], &maxRad) ) {
         return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
     }
-    minRad = strtod(av[2], nullptr);
     Numeric::roundDeltaToZero(minRad, Numeric::EPSILON);
-    maxRad = strtod(av[3], nullptr);
     if ( minRad < 0.0 || maxRad <= minRad ) {
         return MgfErrorCode::MGF_ERROR_ILLEGAL_ARGUMENT_VALUE;
     }
@@ -559,14 +554,14 @@ mgfEntityCone(int ac, const char **av, MgfContext *context) {
         return MgfErrorCode::MGF_ERROR_UNDEFINED_REFERENCE;
     }
     v1n = av[1];
-    if ( !isFloatWords(av[2]) || !isFloatWords(av[4]) ) {
+    double radius1;
+    double radius2;
+    if ( !readFloatWords(av[2], &radius1) || !readFloatWords(av[4], &radius2) ) {
         return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
     }
 
     // Set up (radius1, radius2)
-    double radius1 = strtod(av[2], nullptr);
     Numeric::roundDeltaToZero(radius1, Numeric::EPSILON);
-    double radius2 = strtod(av[4], nullptr);
     Numeric::roundDeltaToZero(radius2, Numeric::EPSILON);
 
     if ( radius1 == 0.0 ) {
@@ -869,10 +864,9 @@ mgfEntityPrism(int ac, const char **av, MgfContext *context) {
     if ( ac < 5 ) {
         return MgfErrorCode::MGF_ERROR_WRONG_NUMBER_OF_ARGUMENTS;
     }
-    if ( !isFloatWords(av[ac - 1]) ) {
+    if ( !readFloatWords(av[ac - 1], &length) ) {
         return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
     }
-    length = strtod(av[ac - 1], nullptr);
     if ( length <= Numeric::EPSILON && length >= -Numeric::EPSILON ) {
         return MgfErrorCode::MGF_ERROR_ILLEGAL_ARGUMENT_VALUE;
     }
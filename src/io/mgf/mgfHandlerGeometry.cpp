@@ -779,6 +779,9 @@ Handle a vertex entity
 int
 handleVertexEntity(int ac, const char **av, MgfContext *context) {
     LookUpEntity *lp;
+    double x;
+    double y;
+    double z;
 
     switch ( mgfEntity(av[0], context) ) {
         case MgfEntity::VERTEX:
@@ -848,12 +851,12 @@ handleVertexEntity(int ac, const char **av, MgfContext *context) {
             if ( ac != 4 ) {
                 return MgfErrorCode::MGF_ERROR_WRONG_NUMBER_OF_ARGUMENTS;
             }
-            if ( !isFloatWords(av[1]) || !isFloatWords(av[2]) || !isFloatWords(av[3]) ) {
+            if ( !readFloatWords(av[1], &x) || !readFloatWords(av[2], &y) || !readFloatWords(av[3], &z) ) {
                 return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
             }
-            globalMgfCurrentVertex->p.x = strtod(av[1], nullptr);
-            globalMgfCurrentVertex->p.y = strtod(av[2], nullptr);
-            globalMgfCurrentVertex->p.z = strtod(av[3], nullptr);
+            globalMgfCurrentVertex->p.x = x;
+            globalMgfCurrentVertex->p.y = y;
+            globalMgfCurrentVertex->p.z = z;
             globalMgfCurrentVertex->clock++;
             return MgfErrorCode::MGF_OK;
         case MgfEntity::MGF_NORMAL:
@@ -861,12 +864,12 @@ handleVertexEntity(int ac, const char **av, MgfContext *context) {
             if ( ac != 4 ) {
                 return MgfErrorCode::MGF_ERROR_WRONG_NUMBER_OF_ARGUMENTS;
             }
-            if ( !isFloatWords(av[1]) || !isFloatWords(av[2]) || !isFloatWords(av[3]) ) {
+            if ( !readFloatWords(av[1], &x) || !readFloatWords(av[2], &y) || !readFloatWords(av[3], &z) ) {
                 return MgfErrorCode::MGF_ERROR_ARGUMENT_TYPE;
             }
-            globalMgfCurrentVertex->n.x = strtod(av[1], nullptr);
-            globalMgfCurrentVertex->n.y = strtod(av[2], nullptr);
-            globalMgfCurrentVertex->n.z = strtod(av[3], nullptr);
+            globalMgfCurrentVertex->n.x = x;
+            globalMgfCurrentVertex->n.y = y;
+            globalMgfCurrentVertex->n.z = z;
             globalMgfCurrentVertex->n.normalizeAndGivePreviousNorm(Numeric::EPSILON);
             globalMgfCurrentVertex->clock++;
             return MgfErrorCode::MGF_OK;
@@ -3,6 +3,7 @@
 
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
+#include "io/DecompressingReader.h"
 #include "io/mgf/vectoroctree.h"
 #include "io/mgf/MgfColorContext.h"
 #include "io/mgf/MgfTransformContext.h"
@@ -12,6 +13,7 @@
 #include "io/mgf/mgfGeometry.h"
 #include "io/mgf/mgfHandlerColor.h"
 #include "io/mgf/mgfHandlerMaterial.h"
+#include "io/mgf/MgfFileLoader.h"
 #include "io/mgf/readmgf.h"
 #include "io/mgf/mgfDefinitions.h"
 
@@ -50,6 +52,54 @@ noted in some fashion, and we therefore keep another array of
 parallel support handlers to assist in this effort.
 */
 
+/**
+Read next line from a memory mapped file, with the same results as fgets() on it
+*/
+int
+mgfReadNextMappedLine(MgfReaderContext *readerContext) {
+    int len = 0;
+
+    do {
+        long bytesLeft = readerContext->fileContentSize - readerContext->fileContentPosition;
+        if ( bytesLeft <= 0 ) {
+            return len;
+        }
+        const char *start = readerContext->fileContent + readerContext->fileContentPosition;
+        const char *end = (const char *)memchr(start, '\n', bytesLeft);
+        long size = end != nullptr ? end - start + 1 : bytesLeft;
+        if ( size > MGF_MAXIMUM_INPUT_LINE_LENGTH - 1 - len ) {
+            size = MGF_MAXIMUM_INPUT_LINE_LENGTH - 1 - len;
+        }
+        memcpy(readerContext->inputLine + len, start, size);
+        len += (int)size;
+        readerContext->inputLine[len] = '\0';
+        readerContext->fileContentPosition += size;
+        if ( len >= MGF_MAXIMUM_INPUT_LINE_LENGTH - 1 ) {
+            return len;
+        }
+        readerContext->lineNumber++;
+    } while ( len > 1 && readerContext->inputLine[len - 2] == '\\' );
+
+    return len;
+}
+
+/**
+Read next line of a file split by the file loader
+*/
+static int
+mgfReadNextPreparedLine(MgfReaderContext *readerContext) {
+    const MgfPreparedFile *file = readerContext->preparedFile;
+
+    if ( readerContext->preparedLineIndex >= file->numberOfLines ) {
+        return 0;
+    }
+    const MgfPreparedLine *line = &file->lines[readerContext->preparedLineIndex++];
+    memcpy(readerContext->inputLine, file->content + line->offset, line->length);
+    readerContext->inputLine[line->length] = '\0';
+    readerContext->lineNumber = line->lineNumber;
+    return line->length;
+}
+
 /**
 Read next line from file
 */
@@ -57,12 +107,28 @@ static int
 mgfReadNextLine(MgfContext *context) {
     int len = 0;
 
+    if ( context->readerContext->preparedFile != nullptr ) {
+        return mgfReadNextPreparedLine(context->readerContext);
+    }
+    if ( context->readerContext->fileContent != nullptr ) {
+        return mgfReadNextMappedLine(context->readerContext);
+    }
+
     do {
-        if ( fgets(context->readerContext->inputLine + len,
-                   MGF_MAXIMUM_INPUT_LINE_LENGTH - len, context->readerContext->fp) == nullptr) {
-            return len;
+        if ( context->readerContext->compressedFile != nullptr ) {
+            int n = context->readerContext->compressedFile->readLine(
+                context->readerContext->inputLine + len, MGF_MAXIMUM_INPUT_LINE_LENGTH - len);
+            if ( n == 0 ) {
+                return len;
+            }
+            len += n;
+        } else {
+            if ( fgets(context->readerContext->inputLine + len,
+                       MGF_MAXIMUM_INPUT_LINE_LENGTH - len, context->readerContext->fp) == nullptr) {
+                return len;
+            }
+            len += (int)strlen(context->readerContext->inputLine + len);
         }
-        len += (int)strlen(context->readerContext->inputLine + len);
         if ( len >= MGF_MAXIMUM_INPUT_LINE_LENGTH - 1 ) {
             return len;
         }
@@ -73,46 +139,77 @@ mgfReadNextLine(MgfContext *context) {
 }
 
 /**
-Parse current input line
+True for the characters separating words: white space and escaped new lines
+*/
+static inline bool
+mgfIsWordSeparator(const char *cp) {
+    return isspace((unsigned char)*cp) || (cp[0] == '\\' && cp[1] == '\n');
+}
+
+/**
+Splits a line into words, copied to buffer, which should be as large as the line.
+The words are split while they are copied, in a single pass over the line. Returns
+the number of words, or -1 when there are more than fit in argv
+*/
+int
+mgfSplitWords(const char *line, char *buffer, const char **argv) {
+    const char *cp = line;
+    char *word = buffer;
+    int argc = 0;
+
+    for ( ;; ) {
+        while ( mgfIsWordSeparator(cp) ) {
+            cp++;
+        }
+        if ( *cp == '\0' ) {
+            break;
+        }
+        if ( argc >= MGF_MAXIMUM_ARGUMENT_COUNT - 1 ) {
+            return -1;
+        }
+        argv[argc++] = word;
+        do {
+            *word++ = *cp++;
+        } while ( *cp != '\0' && !mgfIsWordSeparator(cp) );
+        *word++ = '\0';
+    }
+    argv[argc] = nullptr;
+    return argc;
+}
+
+/**
+Parse current input line. The input line itself is kept as read, for error messages
+and object names
 */
 static int
 mgfParseCurrentLine(MgfContext *context) {
     char buffer[MGF_MAXIMUM_INPUT_LINE_LENGTH];
     const char *argv[MGF_MAXIMUM_ARGUMENT_COUNT];
-    char *cp;
-    const char *cp2;
-    const char **ap;
-
-    // Copy line, removing escape chars
-    cp = buffer;
-    cp2 = context->readerContext->inputLine;
-    while ( (*cp++ = *cp2++) ) {
-        if ( cp2[0] == '\n' && cp2[-1] == '\\' ) {
-            cp--;
+    const MgfPreparedFile *preparedFile = context->readerContext->preparedFile;
+    int argc;
+
+    if ( preparedFile != nullptr ) {
+        // Words already split by the file loader
+        const MgfPreparedLine *line = &preparedFile->lines[context->readerContext->preparedLineIndex - 1];
+        argc = line->numberOfWords;
+        for ( int i = 0; i < argc; i++ ) {
+            argv[i] = preparedFile->words + preparedFile->wordOffsets[line->firstWord + i];
         }
-    }
-    cp = buffer;
-    ap = argv; // Break into words
-    for ( ;; ) {
-        while ( isspace(*cp) ) {
-            *cp++ = '\0';
-        }
-        if ( !*cp ) {
-            break;
+        if ( argc >= 0 ) {
+            argv[argc] = nullptr;
         }
-        if ( ap - argv >= MGF_MAXIMUM_ARGUMENT_COUNT - 1 ) {
-            return MgfErrorCode::MGF_ERROR_WRONG_NUMBER_OF_ARGUMENTS;
-        }
-        *ap++ = cp;
-        while ( *++cp && !isspace(*cp) );
+    } else {
+        argc = mgfSplitWords(context->readerContext->inputLine, buffer, argv);
+    }
+    if ( argc < 0 ) {
+        return MgfErrorCode::MGF_ERROR_WRONG_NUMBER_OF_ARGUMENTS;
     }
-    if ( ap == argv ) {
+    if ( argc == 0 ) {
         // No words in line
         return MgfErrorCode::MGF_OK;
     }
-    *ap = nullptr;
     // Else handle it
-    return mgfHandle(-1, (int)(ap - argv), argv, context);
+    return mgfHandle(-1, argc, argv, context);
 }
 
 /**
@@ -518,6 +615,11 @@ readMgf(const char *filename, MgfContext *context) {
     if ( filename[0] == '#' ) {
         status = mgfOpen(&mgfReaderContext, nullptr, context);
     } else {
+        if ( context->numberOfThreads > 1 ) {
+            // The parser thread is one of them
+            context->fileLoader = new MgfFileLoader(
+                filename, context->entityNames[MgfEntity::INCLUDE], context->numberOfThreads - 1);
+        }
         status = mgfOpen(&mgfReaderContext, filename, context);
     }
     if ( status ) {
@@ -532,6 +634,10 @@ readMgf(const char *filename, MgfContext *context) {
         mgfClose(context);
     }
     mgfClear(context);
+    if ( context->fileLoader != nullptr ) {
+        delete context->fileLoader;
+        context->fileLoader = nullptr;
+    }
 
     if ( context->inSurface ) {
         mgfObjectSurfaceDone(context);
@@ -5,5 +5,7 @@
 
 extern void readMgf(const char *filename, MgfContext *context);
 extern void mgfFreeMemory(MgfContext *context);
+extern int mgfReadNextMappedLine(MgfReaderContext *readerContext);
+extern int mgfSplitWords(const char *line, char *buffer, const char **argv);
 
 #endif
@@ -3,6 +3,7 @@ Routines for recognizing and moving about words in strings.
 */
 
 #include <cctype>
+#include <cstdlib>
 #include <cstring>
 
 #include "io/mgf/words.h"
@@ -92,6 +93,89 @@ isFloatWords(const char *s)
     return cp != nullptr && *cp == '\0';
 }
 
+/**
+Check float format as isFloatWords() and convert it in the same pass. Numbers with
+at most 19 significant digits and a mantissa and power of ten that are exact as
+doubles are converted with a single multiplication or division, which rounds
+correctly. Other numbers are left to strtod(), so the value is always the same as
+the one strtod() gives
+*/
+int
+readFloatWords(const char *s, double *value)
+{
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *cp = s;
+    unsigned long long mantissa = 0;
+    int significantDigits = 0;
+    int numberOfDigits = 0;
+    long exponent = 0;
+    bool negative = false;
+
+    while ( isspace(*cp) ) {
+        cp++;
+    }
+    if ( *cp == '-' || *cp == '+' ) {
+        negative = *cp == '-';
+        cp++;
+    }
+    for ( ; isdigit(*cp); cp++ ) {
+        numberOfDigits++;
+        if ( mantissa != 0 || *cp != '0' ) {
+            mantissa = mantissa * 10 + (*cp - '0');
+            significantDigits++;
+        }
+    }
+    if ( *cp == '.' ) {
+        for ( cp++; isdigit(*cp); cp++ ) {
+            numberOfDigits++;
+            if ( mantissa != 0 || *cp != '0' ) {
+                mantissa = mantissa * 10 + (*cp - '0');
+                significantDigits++;
+            }
+            exponent--;
+        }
+    }
+    if ( numberOfDigits == 0 ) {
+        return 0;
+    }
+    if ( *cp == 'e' || *cp == 'E' ) {
+        const char *exponentEnd = isSkipWords(cp + 1);
+        if ( exponentEnd == nullptr ) {
+            return 0;
+        }
+        if ( isspace(cp[1]) || exponentEnd - cp > 6 ) {
+            // Not read by strtod() as an exponent, or far out of the exact range
+            significantDigits = 20;
+        } else {
+            exponent += strtol(cp + 1, nullptr, 10);
+        }
+        cp = exponentEnd;
+    }
+    if ( *cp != '\0' ) {
+        return 0;
+    }
+
+    if ( significantDigits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22
+         && (mantissa != 0 || !negative) ) {
+        // Negative zero is left to strtod(), -ffast-math does not keep the sign of zeros
+        *value = (double)mantissa;
+        if ( exponent < 0 ) {
+            *value /= powersOfTen[-exponent];
+        } else {
+            *value *= powersOfTen[exponent];
+        }
+        if ( negative ) {
+            *value = -*value;
+        }
+    } else {
+        *value = strtod(s, nullptr);
+    }
+    return 1;
+}
+
 /**
 Check integer format with delimiter set
 */
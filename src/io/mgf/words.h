@@ -4,6 +4,7 @@
 extern int isIntDWords(const char *s, const char *ds);
 extern int isFloatDWords(const char *s, const char *ds);
 extern int isFloatWords(const char *s);
+extern int readFloatWords(const char *s, double *value);
 extern int isIntWords(const char *s);
 extern int isNameWords(const char *s);
 
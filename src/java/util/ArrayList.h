@@ -1,25 +1,44 @@
 #ifndef __ArrayList__
 #define __ArrayList__
 
+#include <cstddef>
 #include <cstdlib>
 #include "java/lang/Object.h"
 
 namespace java {
+    /**
+    Growable array of trivially copyable values (pointers, numbers).
+
+    Up to INLINE_BYTES worth of elements are kept inside the list itself, so the
+    many short lists (voxel cells, element interactions and sub-elements) need
+    no heap allocation. Beyond that the storage doubles when full, so adding n
+    elements costs O(n) copying. Lists can be moved but not copied
+    */
     template<class T>
     class ArrayList final : public Object {
     private:
-        long int increaseChunk;
+        static const long int INLINE_BYTES = 32;
+        static const long int INLINE_CAPACITY = INLINE_BYTES / sizeof(T) > 0 ? INLINE_BYTES / sizeof(T) : 1;
+
         long int currentSize;
         long int maxSize;
-        T *Data;
+        T *Data; // Points to inlineData or to heap storage
+        alignas(T) char inlineData[INLINE_CAPACITY * sizeof(T)];
 
         void init();
+        bool isInline() const;
+        bool reserve(long int capacity);
 
     public:
         ArrayList();
-        explicit ArrayList(long i);
+        explicit ArrayList(long capacityHint);
+        ArrayList(ArrayList &&other) noexcept;
+        ArrayList(const ArrayList &) = delete;
         ~ArrayList();
 
+        ArrayList &operator=(ArrayList &&other) noexcept;
+        ArrayList &operator=(const ArrayList &) = delete;
+
         long int size() const;
         T get(long int i) const;
 
@@ -30,6 +49,8 @@ namespace java {
         void remove(long int pos);
         void remove(T data);
         void set(long int pos, T elem);
+
+        size_t getMemoryUsage() const;
     };
 }
 
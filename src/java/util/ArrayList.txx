@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <cstring>
 
 #include "java/util/ArrayList.h"
 
@@ -6,45 +7,101 @@ namespace java {
 
 template <class T>
 ArrayList<T>::ArrayList() {
-    currentSize = 0;
-    increaseChunk = 100;
-    maxSize = increaseChunk;
     init();
 };
 
+/**
+The capacity hint is the number of elements expected: storage for them is only
+allocated up front when they do not fit inline
+*/
 template <class T>
-ArrayList<T>::ArrayList(long i) {
-    currentSize = 0;
-    increaseChunk = i;
-    maxSize = increaseChunk;
+ArrayList<T>::ArrayList(long capacityHint) {
+    init();
+    if ( capacityHint > maxSize ) {
+        reserve(capacityHint);
+    }
+}
+
+template <class T>
+ArrayList<T>::ArrayList(ArrayList &&other) noexcept {
     init();
+    *this = static_cast<ArrayList &&>(other);
 }
 
 template <class T>
 ArrayList<T>::~ArrayList() {
-    if ( Data ) {
+    if ( !isInline() ) {
         free(Data);
-        Data = nullptr;
     }
+    Data = nullptr;
     currentSize = 0;
     maxSize = -1;
 }
 
+template <class T> ArrayList<T> &
+ArrayList<T>::operator=(ArrayList &&other) noexcept {
+    if ( this == &other ) {
+        return *this;
+    }
+    if ( !isInline() ) {
+        free(Data);
+    }
+    if ( other.isInline() ) {
+        Data = (T *)inlineData;
+        maxSize = INLINE_CAPACITY;
+        memcpy(inlineData, other.inlineData, sizeof(T) * other.currentSize);
+    } else {
+        Data = other.Data;
+        maxSize = other.maxSize;
+    }
+    currentSize = other.currentSize;
+    other.init();
+    return *this;
+}
+
 template <class T> void
 ArrayList<T>::init() {
-    Data = (T *) malloc(sizeof(T) * maxSize);
+    Data = (T *)inlineData;
+    maxSize = INLINE_CAPACITY;
     currentSize = 0;
 }
 
+template <class T> bool
+ArrayList<T>::isInline() const {
+    return Data == (const T *)inlineData;
+}
+
+/**
+Makes room for at least capacity elements, moving them out of the inline
+storage when needed
+*/
+template <class T> bool
+ArrayList<T>::reserve(long int capacity) {
+    if ( capacity <= maxSize ) {
+        return true;
+    }
+    T *newData;
+    if ( isInline() ) {
+        newData = (T *)malloc(sizeof(T) * capacity);
+        if ( newData != nullptr ) {
+            memcpy(newData, Data, sizeof(T) * currentSize);
+        }
+    } else {
+        newData = (T *)realloc(Data, sizeof(T) * capacity);
+    }
+    if ( newData == nullptr ) {
+        return false;
+    }
+    Data = newData;
+    maxSize = capacity;
+    return true;
+}
+
 template <class T> bool
 ArrayList<T>::add(T voxelData)
 {
-    if ( currentSize >= maxSize ) {
-        Data = (T *)realloc(Data, sizeof(T) * (maxSize + increaseChunk));
-        if ( !Data ) {
-            return false;
-        }
-        maxSize += increaseChunk;
+    if ( currentSize >= maxSize && !reserve(maxSize < 4 ? 8 : 2 * maxSize) ) {
+        return false;
     }
     Data[currentSize] = voxelData;
     currentSize++;
@@ -124,4 +181,12 @@ ArrayList<T>::set(long int pos, T elem) {
     Data[pos] = elem;
 }
 
+/**
+Bytes used by the list: the list itself and its heap storage, if any
+*/
+template <class T> size_t
+ArrayList<T>::getMemoryUsage() const {
+    return sizeof(*this) + (isInline() ? 0 : sizeof(T) * maxSize);
+}
+
 }
@@ -26,6 +26,21 @@ public:
     explicit PhongBidirectionalReflectanceDistributionFunction(const ColorRgb *Kd, const ColorRgb *Ks, double Ns);
     virtual ~PhongBidirectionalReflectanceDistributionFunction();
 
+    inline ColorRgb
+    getKd() const {
+        return Kd;
+    }
+
+    inline ColorRgb
+    getKs() const {
+        return Ks;
+    }
+
+    inline float
+    getNs() const {
+        return Ns;
+    }
+
     ColorRgb reflectance(char flags) const;
     ColorRgb evaluate(const Vector3D *in, const Vector3D *out, const Vector3D *normal, char flags) const;
 
@@ -71,6 +71,21 @@ public:
     explicit PhongBidirectionalScatteringDistributionFunction(PhongBidirectionalReflectanceDistributionFunction *brdf, PhongBidirectionalTransmittanceDistributionFunction *btdf, Texture *texture);
     virtual ~PhongBidirectionalScatteringDistributionFunction();
 
+    inline PhongBidirectionalReflectanceDistributionFunction *
+    getBrdf() const {
+        return brdf;
+    }
+
+    inline PhongBidirectionalTransmittanceDistributionFunction *
+    getBtdf() const {
+        return btdf;
+    }
+
+    inline Texture *
+    getTexture() const {
+        return texture;
+    }
+
     static bool bsdfShadingFrame(
         const RayHit *hit,
         const Vector3D *X,
@@ -26,6 +26,26 @@ class PhongBidirectionalTransmittanceDistributionFunction {
     explicit PhongBidirectionalTransmittanceDistributionFunction(const ColorRgb *inKd, const ColorRgb *inKs, float inNs, float inNr, float inNi);
     virtual ~PhongBidirectionalTransmittanceDistributionFunction();
 
+    inline ColorRgb
+    getKd() const {
+        return Kd;
+    }
+
+    inline ColorRgb
+    getKs() const {
+        return Ks;
+    }
+
+    inline float
+    getNs() const {
+        return Ns;
+    }
+
+    inline RefractionIndex
+    getRefractionIndex() const {
+        return refractionIndex;
+    }
+
     ColorRgb transmittance(char flags) const;
 
     ColorRgb
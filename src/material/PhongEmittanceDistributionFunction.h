@@ -21,6 +21,21 @@ public:
     explicit PhongEmittanceDistributionFunction(const ColorRgb *KdParameter, const ColorRgb *KsParameter, double NsParameter);
     virtual ~PhongEmittanceDistributionFunction();
 
+    inline ColorRgb
+    getKd() const {
+        return Kd;
+    }
+
+    inline ColorRgb
+    getKs() const {
+        return Ks;
+    }
+
+    inline float
+    getNs() const {
+        return Ns;
+    }
+
     static bool edfIsTextured();
 
     static bool
@@ -4,6 +4,9 @@
 
 #include <cstring>
 
+#include "java/lang/Math.h"
+#include "common/error.h"
+#include "common/ThreadRandom.h"
 #include "common/stratification.h"
 #include "raycasting/common/raytools.h"
 #include "raycasting/raytracing/eyesampler.h"
@@ -71,6 +74,105 @@ BidirectionalPathRaytracer::initialize(const java::ArrayList<Patch *> *lightPatc
     GLOBAL_lightList = new LightList(lightPatches);
 }
 
+/**
+Creates the eye and light path samplers of a configuration
+*/
+static void
+bpInitSamplers(BidirectionalPathTracingConfiguration *config) {
+    // Eye and light path sampling config
+    config->eyeConfig.pointSampler = new CEyeSampler;
+    config->eyeConfig.dirSampler = new CPixelSampler;
+    config->eyeConfig.surfaceSampler = new CBsdfSampler;
+    config->eyeConfig.surfaceSampler->SetComputeFromNextPdf(true);
+    config->eyeConfig.surfaceSampler->SetComputeBsdfComponents(GLOBAL_rayTracing_biDirectionalPath.baseConfig.useSpars);
+
+    if ( GLOBAL_rayTracing_biDirectionalPath.baseConfig.sampleImportantLights ) {
+        config->eyeConfig.neSampler = new ImportantLightSampler;
+    } else {
+        config->eyeConfig.neSampler = new UniformLightSampler;
+    }
+
+    config->eyeConfig.minDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.minimumPathDepth;
+
+    if ( GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumEyePathDepth < 1 ) {
+        fprintf(stderr, "Maximum Eye Path Length too small (<1), using 1\n");
+        config->eyeConfig.maxDepth = 1;
+    } else {
+        config->eyeConfig.maxDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumEyePathDepth;
+    }
+
+    config->lightConfig.pointSampler = new UniformLightSampler;
+    config->lightConfig.dirSampler = new LightDirSampler;
+    config->lightConfig.surfaceSampler = new CBsdfSampler;
+    config->lightConfig.surfaceSampler->SetComputeFromNextPdf(true);
+    config->lightConfig.surfaceSampler->SetComputeBsdfComponents(GLOBAL_rayTracing_biDirectionalPath.baseConfig.useSpars);
+
+    config->lightConfig.minDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.minimumPathDepth;
+    config->lightConfig.maxDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumLightPathDepth;
+    config->lightConfig.neSampler = nullptr; // eyeSampler ?
+}
+
+static void
+bpDeletePath(SimpleRaytracingPathNode *node) {
+    while ( node != nullptr ) {
+        SimpleRaytracingPathNode *next = node->next();
+        delete node;
+        node = next;
+    }
+}
+
+static void
+bpReleaseSamplers(BidirectionalPathTracingConfiguration *config) {
+    delete config->eyeConfig.pointSampler;
+    delete config->eyeConfig.dirSampler;
+    delete config->eyeConfig.surfaceSampler;
+    delete config->eyeConfig.neSampler;
+    delete config->lightConfig.pointSampler;
+    delete config->lightConfig.dirSampler;
+    delete config->lightConfig.surfaceSampler;
+}
+
+/**
+Computes the image in tiles. Each thread gets its own samplers and path nodes and
+records its screen additions, light path splats included, to be replayed in tile order
+*/
+void
+BidirectionalPathRaytracer::doBptTiled(Scene *scene, const BidirectionalPathTracingConfiguration *config) {
+    int numberOfThreads = java::Math::max(1, GLOBAL_screenIterate_numberOfThreads);
+    BidirectionalPathTracingConfiguration **threadConfigs = new BidirectionalPathTracingConfiguration *[numberOfThreads];
+    ScreenSplatList **splats = new ScreenSplatList *[numberOfThreads];
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        BidirectionalPathTracingConfiguration *threadConfig = new BidirectionalPathTracingConfiguration();
+        threadConfig->baseConfig = config->baseConfig; // Read only while tracing
+        bpInitSamplers(threadConfig);
+        threadConfig->screen = config->screen;
+        threadConfig->splats = new ScreenSplatList();
+        threadConfigs[i] = threadConfig;
+        splats[i] = threadConfig->splats;
+    }
+
+    screenIterateTiled(
+        scene->camera,
+        scene->accelerationStructure,
+        scene->background,
+        (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+        (void **)threadConfigs,
+        numberOfThreads);
+
+    ScreenSplatList::replay(splats, numberOfThreads, screenIterateNumberOfTiles(scene->camera), config->screen);
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        bpReleaseSamplers(threadConfigs[i]);
+        bpDeletePath(threadConfigs[i]->eyePath);
+        bpDeletePath(threadConfigs[i]->lightPath);
+        delete threadConfigs[i]->splats;
+        delete threadConfigs[i];
+    }
+    delete[] threadConfigs;
+    delete[] splats;
+}
+
 /**
 Raytrace the current scene as seen with the current camera. If fp
 is not a nullptr pointer, write the ray traced image to the file
@@ -94,37 +196,7 @@ BidirectionalPathRaytracer::execute(
 
     config.dBuffer = nullptr;
 
-    // Eye and light path sampling config
-    config.eyeConfig.pointSampler = new CEyeSampler;
-    config.eyeConfig.dirSampler = new CPixelSampler;
-    config.eyeConfig.surfaceSampler = new CBsdfSampler;
-    config.eyeConfig.surfaceSampler->SetComputeFromNextPdf(true);
-    config.eyeConfig.surfaceSampler->SetComputeBsdfComponents(GLOBAL_rayTracing_biDirectionalPath.baseConfig.useSpars);
-
-    if ( GLOBAL_rayTracing_biDirectionalPath.baseConfig.sampleImportantLights ) {
-        config.eyeConfig.neSampler = new ImportantLightSampler;
-    } else {
-        config.eyeConfig.neSampler = new UniformLightSampler;
-    }
-
-    config.eyeConfig.minDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.minimumPathDepth;
-
-    if ( GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumEyePathDepth < 1 ) {
-        fprintf(stderr, "Maximum Eye Path Length too small (<1), using 1\n");
-        config.eyeConfig.maxDepth = 1;
-    } else {
-        config.eyeConfig.maxDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumEyePathDepth;
-    }
-
-    config.lightConfig.pointSampler = new UniformLightSampler;
-    config.lightConfig.dirSampler = new LightDirSampler;
-    config.lightConfig.surfaceSampler = new CBsdfSampler;
-    config.lightConfig.surfaceSampler->SetComputeFromNextPdf(true);
-    config.lightConfig.surfaceSampler->SetComputeBsdfComponents(GLOBAL_rayTracing_biDirectionalPath.baseConfig.useSpars);
-
-    config.lightConfig.minDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.minimumPathDepth;
-    config.lightConfig.maxDepth = GLOBAL_rayTracing_biDirectionalPath.baseConfig.maximumLightPathDepth;
-    config.lightConfig.neSampler = nullptr; // eyeSampler ?
+    bpInitSamplers(&config);
 
     config.screen = new ScreenBuffer(nullptr, scene->camera);
     config.screen->setFactor(1.0); // We're storing plain radiance
@@ -157,23 +229,36 @@ BidirectionalPathRaytracer::execute(
         config.sparList->add(ldSpar);
     }
 
+    bool useTiles = screenIterateUseTiles();
+
+    if ( useTiles
+      && (GLOBAL_rayTracing_biDirectionalPath.saveSubsequentImages
+          || config.baseConfig->doDensityEstimation
+          || config.baseConfig->useSpars) ) {
+        logWarning("Bidirectional path tracing",
+                   "Subsequent images, density estimation and SPaR are single threaded, ignoring -raytracing-threads");
+        useTiles = false;
+    }
+
     if ( GLOBAL_rayTracing_biDirectionalPath.saveSubsequentImages ) {
-        doBptAndSubsequentImages(scene->camera, scene->voxelGrid, scene->background, &config);
+        doBptAndSubsequentImages(scene->camera, scene->accelerationStructure, scene->background, &config);
     } else if ( config.baseConfig->doDensityEstimation ) {
-        doBptDensityEstimation(scene->camera, scene->voxelGrid, scene->background, &config);
+        doBptDensityEstimation(scene->camera, scene->accelerationStructure, scene->background, &config);
+    } else if ( useTiles ) {
+        doBptTiled(scene, &config);
     } else if ( !GLOBAL_rayTracing_biDirectionalPath.baseConfig.progressiveTracing ) {
         screenIterateSequential(
                 scene->camera,
-                scene->voxelGrid,
+                scene->accelerationStructure,
                 scene->background,
-                (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+                (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
                 &config);
     } else {
         screenIterateProgressive(
                 scene->camera,
-                scene->voxelGrid,
+                scene->accelerationStructure,
                 scene->background,
-                (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+                (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
                 &config);
     }
 
@@ -194,13 +279,7 @@ BidirectionalPathRaytracer::execute(
         delete ldSpar;
     }
 
-    delete config.eyeConfig.pointSampler;
-    delete config.eyeConfig.dirSampler;
-    delete config.eyeConfig.surfaceSampler;
-    delete config.eyeConfig.neSampler;
-    delete config.lightConfig.pointSampler;
-    delete config.lightConfig.dirSampler;
-    delete config.lightConfig.surfaceSampler;
+    bpReleaseSamplers(&config);
 
     if ( config.dBuffer ) {
         delete config.dBuffer;
@@ -246,6 +325,15 @@ spikeCheck(ColorRgb color) {
     return false;
 }
 
+static inline void
+addToScreen(BidirectionalPathTracingConfiguration *config, int nx, int ny, ColorRgb f) {
+    if ( config->splats != nullptr ) {
+        config->splats->add(nx, ny, f);
+    } else {
+        config->screen->add(nx, ny, f);
+    }
+}
+
 static void
 addWithSpikeCheck(
     BidirectionalPathTracingConfiguration *config,
@@ -303,13 +391,13 @@ addWithSpikeCheck(
 
     if ( config->baseConfig->eliminateSpikes ) {
         if ( !spikeCheck(f) ) {
-            config->screen->add(nx, ny, f);
+            addToScreen(config, nx, ny, f);
         } else {
             // Wanna see the spikes !
             //  config->screen->Add(config->nx, config->ny, f);
         }
     } else {
-        config->screen->add(nx, ny, f);
+        addToScreen(config, nx, ny, f);
     }
 }
 
@@ -550,7 +638,7 @@ light size >= 1
 static void
 handlePathXx(
     Camera *camera,
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     Background *sceneBackground,
     BidirectionalPathTracingConfiguration *config,
     CBiPath *path)
@@ -588,13 +676,13 @@ handlePathXx(
 
         if ( !config->eyeConfig.neSampler->sample(
             camera,
-            sceneWorldVoxelGrid,
+            sceneWorldAccelerationStructure,
             sceneBackground,
             nullptr,
             path->m_eyeEndNode,
             &newLightNode,
-            drand48(),
-            drand48()) ) {
+            ThreadRandom::nextDouble(),
+            ThreadRandom::nextDouble()) ) {
             // No light point sampled, no contribution possible
 
             path->m_lightPath = oldLightPath;
@@ -609,7 +697,7 @@ handlePathXx(
         path->m_lightEndNode = &newLightNode;
     }
 
-    if ( pathNodesVisible(sceneWorldVoxelGrid, path->m_eyeEndNode, path->m_lightEndNode) ) {
+    if ( pathNodesVisible(sceneWorldAccelerationStructure, path->m_eyeEndNode, path->m_lightEndNode) ) {
         f = computeNeFluxEstimate(camera, config, path, &pdf, &weight, &fRad);
 
         float factor = (float)config->fluxToRadFactor / (float)config->baseConfig->samplesPerPixel;
@@ -636,7 +724,7 @@ handlePathXx(
 static void
 handlePath1X(
     Camera *camera,
-    const VoxelGrid *sceneVoxelGrid,
+    const AccelerationStructure *sceneAccelerationStructure,
     BidirectionalPathTracingConfiguration *config,
     CBiPath *path)
 {
@@ -656,7 +744,7 @@ handlePath1X(
     float pixY;
     if ( eyeNodeVisible(
             camera,
-            sceneVoxelGrid,
+            sceneAccelerationStructure,
             path->m_eyeEndNode,
             path->m_lightEndNode,
             &pixX,
@@ -691,7 +779,7 @@ handlePath1X(
 static void
 bpCombinePaths(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     BidirectionalPathTracingConfiguration *config)
 {
@@ -759,13 +847,13 @@ bpCombinePaths(
                 path.m_eyeEndNode = eyeEndNode;
                 path.m_lightSize = lightSize;
                 path.m_lightEndNode = lightEndNode;
-                handlePathXx(camera, sceneVoxelGrid, sceneBackground, config, &path);
+                handlePathXx(camera, sceneAccelerationStructure, sceneBackground, config, &path);
             } else {
                 path.m_eyeSize = eyeSize;
                 path.m_eyeEndNode = eyeEndNode;
                 path.m_lightSize = lightSize;
                 path.m_lightEndNode = lightEndNode;
-                handlePath1X(camera, sceneVoxelGrid, config, &path);
+                handlePath1X(camera, sceneAccelerationStructure, config, &path);
             }
 
             if ( lightEndNode->ends() ) {
@@ -788,7 +876,7 @@ bpCombinePaths(
 ColorRgb
 BidirectionalPathRaytracer::bpCalcPixel(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     int nx,
     int ny,
@@ -803,12 +891,16 @@ BidirectionalPathRaytracer::bpCalcPixel(
 
     result.clear();
 
+    if ( config->splats != nullptr ) {
+        config->splats->setTile(screenIterateTileIndex(camera, nx, ny));
+    }
+
     // We sample the eye here since it's always the same point
     if ( config->eyePath == nullptr ) {
         config->eyePath = new SimpleRaytracingPathNode;
     }
 
-    config->eyeConfig.pointSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, nullptr, config->eyePath, 0, 0);
+    config->eyeConfig.pointSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, nullptr, config->eyePath, 0, 0);
     ((CPixelSampler *) config->eyeConfig.dirSampler)->SetPixel(camera, nx, ny, nullptr);
 
     // Provide a node for the pixel sampling
@@ -840,9 +932,9 @@ BidirectionalPathRaytracer::bpCalcPixel(
             config->xSample = tmpVec2D.u; // pix_x + (camera.pixelWidth * x1)
             config->ySample = tmpVec2D.v; // pix_y + (camera.pixelHeight * x2)
 
-            if ( config->eyeConfig.dirSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, config->eyePath, pixNode, x1, x2) ) {
+            if ( config->eyeConfig.dirSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, config->eyePath, pixNode, x1, x2) ) {
                 pixNode->assignBsdfAndNormal();
-                config->eyeConfig.tracePath(camera, sceneVoxelGrid, sceneBackground, nextNode);
+                config->eyeConfig.tracePath(camera, sceneAccelerationStructure, sceneBackground, nextNode);
             }
         } else {
             config->eyePath->m_rayType = PathRayType::STOPS;
@@ -850,14 +942,14 @@ BidirectionalPathRaytracer::bpCalcPixel(
 
         // Generate a light path
         if ( config->lightConfig.maxDepth > 0 ) {
-            config->lightPath = config->lightConfig.tracePath(camera, sceneVoxelGrid, sceneBackground, config->lightPath);
+            config->lightPath = config->lightConfig.tracePath(camera, sceneAccelerationStructure, sceneBackground, config->lightPath);
         } else {
             // Normally this is already so, so no delete necessary ?!
             config->lightPath = nullptr;
         }
 
         // Connect all endpoints and compute contribution
-        bpCombinePaths(camera, sceneVoxelGrid, sceneBackground, config);
+        bpCombinePaths(camera, sceneAccelerationStructure, sceneBackground, config);
     }
 
     // Radiance contributions are added to the screen buffer directly
@@ -877,7 +969,7 @@ BidirectionalPathRaytracer::bpCalcPixel(
 void
 BidirectionalPathRaytracer::doBptAndSubsequentImages(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     BidirectionalPathTracingConfiguration *config)
 {
@@ -938,9 +1030,9 @@ BidirectionalPathRaytracer::doBptAndSubsequentImages(
 
         screenIterateSequential(
             camera,
-            sceneVoxelGrid,
+            sceneAccelerationStructure,
             sceneBackground,
-            (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+            (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
             config);
 
         config->screen->render();
@@ -970,7 +1062,7 @@ BidirectionalPathRaytracer::doBptAndSubsequentImages(
 void
 BidirectionalPathRaytracer::doBptDensityEstimation(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     BidirectionalPathTracingConfiguration *config)
 {
@@ -1009,9 +1101,9 @@ BidirectionalPathRaytracer::doBptDensityEstimation(
     // Do the run
     screenIterateSequential(
         camera,
-        sceneVoxelGrid,
+        sceneAccelerationStructure,
         sceneBackground,
-        (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+        (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
         config);
 
     // Now we have a noisy screen in dest and hits in double buffer
@@ -1094,9 +1186,9 @@ BidirectionalPathRaytracer::doBptDensityEstimation(
 
         screenIterateSequential(
             camera,
-            sceneVoxelGrid,
+            sceneAccelerationStructure,
             sceneBackground,
-            (ColorRgb(*)(Camera* , VoxelGrid *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
+            (ColorRgb(*)(Camera* , AccelerationStructure *, Background *, int, int, void *))BidirectionalPathRaytracer::bpCalcPixel,
             config);
 
         // Render screen & write
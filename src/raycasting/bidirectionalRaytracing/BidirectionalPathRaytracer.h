@@ -15,21 +15,23 @@ class BidirectionalPathRaytracer final : public RayTracer {
     static void
     doBptAndSubsequentImages(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         BidirectionalPathTracingConfiguration *config);
 
     static void
     doBptDensityEstimation(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         BidirectionalPathTracingConfiguration *config);
 
+    static void doBptTiled(Scene *scene, const BidirectionalPathTracingConfiguration *config);
+
     static ColorRgb
     bpCalcPixel(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         int nx,
         int ny,
@@ -9,6 +9,7 @@ BidirectionalPathTracingConfiguration::BidirectionalPathTracingConfiguration():
     eyeConfig(),
     lightConfig(),
     screen(),
+    splats(),
     fluxToRadFactor(),
     nx(),
     ny(),
@@ -7,6 +7,7 @@
 
 #include "render/ScreenBuffer.h"
 #include "raycasting/raytracing/samplertools.h"
+#include "raycasting/raytracing/ScreenSplatList.h"
 #include "raycasting/bidirectionalRaytracing/DensityBuffer.h"
 #include "raycasting/bidirectionalRaytracing/densitykernel.h"
 #include "raycasting/bidirectionalRaytracing/BidirectionalPathRaytracerConfig.h"
@@ -26,6 +27,7 @@ class BidirectionalPathTracingConfiguration {
 
     // Internal vars
     ScreenBuffer *screen;
+    ScreenSplatList *splats; // Per thread configurations add to these instead of to the screen
     double fluxToRadFactor;
     int nx;
     int ny;
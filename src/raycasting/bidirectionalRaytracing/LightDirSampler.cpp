@@ -13,7 +13,7 @@ sample : newNode gets filled, others may change
 bool
 LightDirSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -45,7 +45,7 @@ LightDirSampler::sample(
     newNode->m_inBsdf = thisNode->m_outBsdf; // Light can be placed in a medium
 
     // Transfer
-    if ( !sampleTransfer(sceneVoxelGrid, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
+    if ( !sampleTransfer(sceneAccelerationStructure, sceneBackground, thisNode, newNode, &dir, pdfDir) ) {
         thisNode->m_rayType = PathRayType::STOPS;
         return false;
     }
@@ -17,7 +17,7 @@ public:
     bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
@@ -1,17 +1,55 @@
 #include "java/util/ArrayList.txx"
+#include "java/lang/Math.h"
 #include "common/error.h"
 #include "raycasting/bidirectionalRaytracing/LightList.h"
 
 LightList *GLOBAL_lightList = nullptr;
 
-LightList::LightList(const java::ArrayList<Patch *> *list, bool includeVirtualPatches) {
+/**
+Importance of each light of the last light tree leaf evaluated on the calling
+thread, in leaf order
+*/
+class LightImportanceBuffer {
+  public:
+    float *importance;
+    int size;
+
+    LightImportanceBuffer(): importance(), size() {}
+
+    ~LightImportanceBuffer() {
+        delete[] importance;
+    }
+
+    float *
+    reserve(int n) {
+        if ( n > size ) {
+            delete[] importance;
+            importance = new float[n];
+            size = n;
+        }
+        return importance;
+    }
+};
+
+static thread_local LightImportanceBuffer globalImportanceBuffer;
+
+LightList::LightList(const java::ArrayList<Patch *> *list, bool includeVirtualPatches):
+    lights(),
+    lightIndexByPatchId(),
+    numberOfPatchIds(),
+    aliasProbability(),
+    alias(),
+    treeNodes(),
+    numberOfTreeNodes(),
+    treeLights(),
+    leafOfLight()
+{
     LightInfo info{};
     ColorRgb lightColor;
 
     totalFlux = 0.0;
     lightCount = 0;
     includeVirtual = includeVirtualPatches;
-    totalImp = 0.0;
 
     for ( int i = 0; list != nullptr && i < list->size(); i++ ) {
         Patch *light = list->get(i);
@@ -34,63 +72,346 @@ LightList::LightList(const java::ArrayList<Patch *> *list, bool includeVirtualPa
             }
 
             totalFlux += info.emittedFlux;
+            info.index = lightCount;
             lightCount++;
             append(info);
         }
     }
+
+    lights = new LightInfo[lightCount];
+    CircularListIterator<LightInfo> iterator(*this);
+    const LightInfo *listInfo;
+    while ( (listInfo = iterator.nextOnSequence()) != nullptr ) {
+        lights[listInfo->index] = *listInfo;
+        numberOfPatchIds = java::Math::max(numberOfPatchIds, (int)listInfo->light->id + 1);
+    }
+
+    lightIndexByPatchId = new int[numberOfPatchIds];
+    for ( int i = 0; i < numberOfPatchIds; i++ ) {
+        lightIndexByPatchId[i] = -1;
+    }
+    for ( int i = 0; i < lightCount; i++ ) {
+        lightIndexByPatchId[lights[i].light->id] = i;
+    }
+
+    buildAliasTable();
+    buildTree();
 }
 
 LightList::~LightList() {
     removeAll();
+    delete[] lights;
+    delete[] lightIndexByPatchId;
+    delete[] aliasProbability;
+    delete[] alias;
+    delete[] treeNodes;
+    delete[] treeLights;
+    delete[] leafOfLight;
 }
 
 /**
-Returns sampled patch, scales x_1 back to a random in 0..1
+Alias table for sampling the lights proportional to their emitted flux, built with
+Vose's method
 */
-Patch *
-LightList::sample(double *x1, double *pdf) {
-    LightInfo *info;
-    LightInfo *lastInfo;
-    CircularListIterator<LightInfo> iterator(*this);
+void
+LightList::buildAliasTable() {
+    aliasProbability = new double[lightCount];
+    alias = new int[lightCount];
+
+    int *small = new int[lightCount];
+    int *large = new int[lightCount];
+    int numberOfSmall = 0;
+    int numberOfLarge = 0;
+
+    for ( int i = 0; i < lightCount; i++ ) {
+        if ( totalFlux > 0.0 ) {
+            aliasProbability[i] = (double)lights[i].emittedFlux * lightCount / totalFlux;
+        } else {
+            aliasProbability[i] = 1.0;
+        }
+        alias[i] = i;
+
+        if ( aliasProbability[i] < 1.0 ) {
+            small[numberOfSmall++] = i;
+        } else {
+            large[numberOfLarge++] = i;
+        }
+    }
 
-    double rnd = *x1 * totalFlux;
-    double currentSum;
+    while ( numberOfSmall > 0 && numberOfLarge > 0 ) {
+        int lessLikely = small[--numberOfSmall];
+        int moreLikely = large[numberOfLarge - 1];
 
-    info = iterator.nextOnSequence();
-    while ( (info != nullptr) && (info->light->hasZeroVertices()) && (!includeVirtual) ) {
-        info = iterator.nextOnSequence();
+        alias[lessLikely] = moreLikely;
+        aliasProbability[moreLikely] -= 1.0 - aliasProbability[lessLikely];
+        if ( aliasProbability[moreLikely] < 1.0 ) {
+            numberOfLarge--;
+            small[numberOfSmall++] = moreLikely;
+        }
     }
 
-    if ( info == nullptr ) {
-        logWarning("CLightList::sample", "No lights available");
-        return nullptr;
+    // What is left is 1 up to rounding errors
+    while ( numberOfLarge > 0 ) {
+        aliasProbability[large[--numberOfLarge]] = 1.0;
+    }
+    while ( numberOfSmall > 0 ) {
+        aliasProbability[small[--numberOfSmall]] = 1.0;
     }
 
-    currentSum = info->emittedFlux;
+    delete[] small;
+    delete[] large;
+}
 
-    while ( (rnd > currentSum) && (info != nullptr) ) {
-        lastInfo = info;
-        info = iterator.nextOnSequence();
-        while ((info != nullptr) && (info->light->hasZeroVertices()) && (!includeVirtual) ) {
-            info = iterator.nextOnSequence();
+static inline float
+lightTreeAxisValue(const Vector3D *v, const int axis) {
+    if ( axis == 0 ) {
+        return v->x;
+    }
+    return axis == 1 ? v->y : v->z;
+}
+
+static inline float
+lightTreeAngle(const Vector3D *a, const Vector3D *b) {
+    float cosAngle = a->dotProduct(*b);
+    if ( cosAngle >= 1.0f ) {
+        return 0.0f;
+    }
+    if ( cosAngle <= -1.0f ) {
+        return (float)M_PI;
+    }
+    return java::Math::acos(cosAngle);
+}
+
+/**
+Builds the light tree over the real lights. Virtual lights have no position, so
+they all go on one leaf next to the tree. With up to MAXIMUM_LIGHTS_PER_LEAF lights
+the whole tree is one leaf with the lights in list order
+*/
+void
+LightList::buildTree() {
+    treeNodes = new LightTreeNode[2 * lightCount + 1];
+    treeLights = new int[lightCount];
+    leafOfLight = new int[lightCount];
+    numberOfTreeNodes = 0;
+
+    if ( lightCount == 0 ) {
+        return;
+    }
+
+    if ( lightCount <= MAXIMUM_LIGHTS_PER_LEAF ) {
+        for ( int i = 0; i < lightCount; i++ ) {
+            treeLights[i] = i;
         }
+        numberOfTreeNodes = 1;
+        setTreeLeaf(0, 0, lightCount, -1);
+        return;
+    }
 
-        if ( info != nullptr ) {
-            currentSum += info->emittedFlux;
+    // Real lights first, virtual ones at the end
+    int numberOfRealLights = 0;
+    for ( int i = 0; i < lightCount; i++ ) {
+        if ( !lights[i].light->hasZeroVertices() ) {
+            treeLights[numberOfRealLights++] = i;
+        }
+    }
+    int next = numberOfRealLights;
+    for ( int i = 0; i < lightCount; i++ ) {
+        if ( lights[i].light->hasZeroVertices() ) {
+            treeLights[next++] = i;
+        }
+    }
+
+    Vector3D *centroids = new Vector3D[lightCount];
+    BoundingBox *bounds = new BoundingBox[lightCount];
+    float *coneAngles = new float[lightCount];
+
+    for ( int i = 0; i < numberOfRealLights; i++ ) {
+        const Patch *light = lights[treeLights[i]].light;
+
+        centroids[treeLights[i]] = light->midPoint;
+        coneAngles[treeLights[i]] = 0.0f;
+        for ( int j = 0; j < light->numberOfVertices; j++ ) {
+            bounds[treeLights[i]].enlargeToIncludePoint(light->vertex[j]->point);
+            if ( light->vertex[j]->normal != nullptr ) {
+                float angle = lightTreeAngle(&light->normal, light->vertex[j]->normal);
+                coneAngles[treeLights[i]] = java::Math::max(coneAngles[treeLights[i]], angle);
+            }
+        }
+    }
+
+    if ( numberOfRealLights == 0 ) {
+        numberOfTreeNodes = 1;
+        setTreeLeaf(0, 0, lightCount, -1);
+    } else if ( numberOfRealLights == lightCount ) {
+        buildTreeRecursive(centroids, bounds, coneAngles, 0, lightCount, -1, 0);
+    } else {
+        // Root with the real light tree as first child and the virtual lights as second
+        numberOfTreeNodes = 1;
+        treeNodes[0].parent = -1;
+        treeNodes[0].numberOfLights = 0;
+        buildTreeRecursive(centroids, bounds, coneAngles, 0, numberOfRealLights, 0, 1);
+        treeNodes[0].childOrFirstLight = numberOfTreeNodes;
+        numberOfTreeNodes++;
+        setTreeLeaf(treeNodes[0].childOrFirstLight, numberOfRealLights, lightCount - numberOfRealLights, 0);
+    }
+
+    delete[] centroids;
+    delete[] bounds;
+    delete[] coneAngles;
+}
+
+void
+LightList::setTreeLeaf(int nodeIndex, int first, int count, int parent) {
+    LightTreeNode *node = &treeNodes[nodeIndex];
+
+    node->parent = parent;
+    node->childOrFirstLight = first;
+    node->numberOfLights = count;
+    node->emittedFlux = 0.0f;
+    for ( int i = first; i < first + count; i++ ) {
+        leafOfLight[treeLights[i]] = nodeIndex;
+        node->emittedFlux += lights[treeLights[i]].emittedFlux;
+    }
+}
+
+/**
+Builds the subtree for the lights treeLights[first .. first + count - 1] in depth
+first order, splitting at the middle of the widest axis of the light centroids.
+Returns the index of the subtree root
+*/
+int
+LightList::buildTreeRecursive(
+    const Vector3D *centroids,
+    const BoundingBox *bounds,
+    const float *coneAngles,
+    const int first,
+    const int count,
+    const int parent,
+    const int depth)
+{
+    int nodeIndex = numberOfTreeNodes;
+    numberOfTreeNodes++;
+
+    // Bounding sphere, flux and orientation cone
+    BoundingBox nodeBounds;
+    BoundingBox centroidBounds;
+    Vector3D axis(0.0f, 0.0f, 0.0f);
+    float flux = 0.0f;
+
+    for ( int i = first; i < first + count; i++ ) {
+        const LightInfo *info = &lights[treeLights[i]];
+        nodeBounds.enlarge(&bounds[treeLights[i]]);
+        centroidBounds.enlargeToIncludePoint(&centroids[treeLights[i]]);
+        axis.addition(axis, info->light->normal);
+        flux += info->emittedFlux;
+    }
+
+    LightTreeNode *node = &treeNodes[nodeIndex];
+    node->center.set(
+        0.5f * (nodeBounds.coordinates[MIN_X] + nodeBounds.coordinates[MAX_X]),
+        0.5f * (nodeBounds.coordinates[MIN_Y] + nodeBounds.coordinates[MAX_Y]),
+        0.5f * (nodeBounds.coordinates[MIN_Z] + nodeBounds.coordinates[MAX_Z]));
+    Vector3D halfDiagonal(
+        0.5f * (nodeBounds.coordinates[MAX_X] - nodeBounds.coordinates[MIN_X]),
+        0.5f * (nodeBounds.coordinates[MAX_Y] - nodeBounds.coordinates[MIN_Y]),
+        0.5f * (nodeBounds.coordinates[MAX_Z] - nodeBounds.coordinates[MIN_Z]));
+    node->radius = halfDiagonal.norm();
+    node->emittedFlux = flux;
+
+    float axisLength = axis.norm();
+    if ( axisLength < Numeric::EPSILON_FLOAT ) {
+        node->axis = lights[treeLights[first]].light->normal;
+        node->coneAngle = (float)M_PI;
+    } else {
+        node->axis.inverseScaledCopy(axisLength, axis, Numeric::EPSILON_FLOAT);
+        node->coneAngle = 0.0f;
+        for ( int i = first; i < first + count; i++ ) {
+            float angle = lightTreeAngle(&node->axis, &lights[treeLights[i]].light->normal) + coneAngles[treeLights[i]];
+            node->coneAngle = java::Math::min((float)M_PI, java::Math::max(node->coneAngle, angle));
+        }
+    }
+
+    if ( count <= MAXIMUM_LIGHTS_PER_LEAF || depth >= MAXIMUM_DEPTH - 1 ) {
+        setTreeLeaf(nodeIndex, first, count, parent);
+        return nodeIndex;
+    }
+
+    // Partition around the middle of the widest centroid axis
+    int splitAxis = 0;
+    float extent = centroidBounds.coordinates[MAX_X] - centroidBounds.coordinates[MIN_X];
+    for ( int axisIndex = 1; axisIndex < 3; axisIndex++ ) {
+        float axisExtent = centroidBounds.coordinates[MAX_X + axisIndex] - centroidBounds.coordinates[MIN_X + axisIndex];
+        if ( axisExtent > extent ) {
+            extent = axisExtent;
+            splitAxis = axisIndex;
+        }
+    }
+    float splitPosition = 0.5f * (centroidBounds.coordinates[MIN_X + splitAxis] + centroidBounds.coordinates[MAX_X + splitAxis]);
+
+    int middle = first;
+    int right = first + count - 1;
+    while ( middle <= right ) {
+        if ( lightTreeAxisValue(&centroids[treeLights[middle]], splitAxis) < splitPosition ) {
+            middle++;
         } else {
-            info = lastInfo;
-            rnd = currentSum - 1.0; // :-(  Damn float inaccuracies
+            int swap = treeLights[middle];
+            treeLights[middle] = treeLights[right];
+            treeLights[right] = swap;
+            right--;
         }
     }
+    if ( middle == first || middle == first + count ) {
+        // Coincident centroids
+        middle = first + count / 2;
+    }
+
+    node->parent = parent;
+    node->numberOfLights = 0;
+    buildTreeRecursive(centroids, bounds, coneAngles, first, middle - first, nodeIndex, depth + 1);
+    int secondChild = buildTreeRecursive(centroids, bounds, coneAngles, middle, first + count - middle, nodeIndex, depth + 1);
+
+    // The node array is preallocated, so node pointers stay valid during recursion
+    treeNodes[nodeIndex].childOrFirstLight = secondChild;
+    return nodeIndex;
+}
+
+int
+LightList::findLight(const Patch *light) const {
+    if ( light == nullptr || (int)light->id >= numberOfPatchIds ) {
+        return -1;
+    }
+    int index = lightIndexByPatchId[light->id];
+    if ( index >= 0 && lights[index].light != light ) {
+        return -1;
+    }
+    return index;
+}
 
-    if ( info != nullptr ) {
-        *x1 = ((*x1 - ((currentSum - info->emittedFlux) / totalFlux)) /
-               (info->emittedFlux / totalFlux));
-        *pdf = info->emittedFlux / totalFlux;
-        return (info->light);
+/**
+Returns sampled patch, scales x_1 back to a random in 0..1
+*/
+Patch *
+LightList::sample(double *x1, double *pdf) {
+    if ( lightCount == 0 ) {
+        logWarning("CLightList::sample", "No lights available");
+        return nullptr;
     }
 
-    return nullptr;
+    double scaled = *x1 * lightCount;
+    int column = java::Math::min((int)scaled, lightCount - 1);
+    double u = scaled - column;
+    const LightInfo *info;
+
+    if ( u < aliasProbability[column] ) {
+        info = &lights[column];
+        *x1 = u / aliasProbability[column];
+    } else {
+        info = &lights[alias[column]];
+        *x1 = (u - aliasProbability[column]) / (1.0 - aliasProbability[column]);
+    }
+
+    *pdf = info->emittedFlux / totalFlux;
+    return info->light;
 }
 
 double
@@ -239,95 +560,176 @@ LightList::computeOneLightImportance(
     }
 }
 
-void
-LightList::computeLightImportance(const Vector3D *point, const Vector3D *normal) {
-    if ((point->equals(lastPoint, Numeric::EPSILON_FLOAT)) &&
-        (normal->equals(lastNormal, Numeric::EPSILON_FLOAT)) ) {
-        return; // Still ok !!
+/**
+Upper bound of the importance of the lights below an inner node for the given
+point, from the bounding sphere and orientation cone of the node. For leaves the
+sum of the exact importances of their lights is returned
+*/
+double
+LightList::treeNodeImportance(const LightTreeNode *node, const Vector3D *point, const Vector3D *normal) const {
+    if ( node->numberOfLights > 0 ) {
+        float totalImp;
+        computeLeafImportance(node, point, normal, &totalImp);
+        return totalImp;
     }
 
+    Vector3D toCenter;
+    toCenter.subtraction(node->center, *point);
+    double dist2 = toCenter.norm2();
+    double radius2 = (double)node->radius * node->radius;
 
-    LightInfo *info;
-    CircularListIterator<LightInfo> iterator(*this);
-    double imp;
+    if ( dist2 <= radius2 ) {
+        // Point inside the bounding sphere: any direction is possible
+        return node->emittedFlux / (M_PI * radius2);
+    }
 
-    totalImp = 0.0;
+    double dist = java::Math::sqrt(dist2);
+    double boundingAngle = java::Math::acos(java::Math::sqrt(1.0 - radius2 / dist2));
 
-    // next
-    info = iterator.nextOnSequence();
-    while ((info != nullptr) && (info->light->hasZeroVertices()) && (!includeVirtual) ) {
-        info = iterator.nextOnSequence();
+    // Smallest angle between the normal at the point and the directions to the node
+    double cosine = normal->dotProduct(toCenter) / dist;
+    double receiverAngle = java::Math::acos(cosine > 1.0 ? 1.0 : (cosine < -1.0 ? -1.0 : cosine)) - boundingAngle;
+    if ( receiverAngle >= M_PI / 2.0 ) {
+        return 0.0;
     }
 
-    while ( info ) {
-        imp = computeOneLightImportance(info->light, point, normal,
-                                        info->emittedFlux);
-        totalImp += (float)imp;
-        info->importance = (float)imp;
-
-        // next
-        info = iterator.nextOnSequence();
-        while ( (info != nullptr) && (info->light->hasZeroVertices()) && (!includeVirtual) ) {
-            info = iterator.nextOnSequence();
-        }
+    // Smallest angle between the light normals and the directions to the point
+    cosine = -node->axis.dotProduct(toCenter) / dist;
+    double emitterAngle = java::Math::acos(cosine > 1.0 ? 1.0 : (cosine < -1.0 ? -1.0 : cosine))
+        - node->coneAngle - boundingAngle;
+    if ( emitterAngle >= M_PI / 2.0 ) {
+        return 0.0;
     }
-}
 
-Patch *
-LightList::sampleImportant(const Vector3D *point, const Vector3D *normal, double *x1, double *pdf) {
-    const LightInfo *info;
-    const LightInfo *lastInfo;
-    CircularListIterator<LightInfo> iterator(*this);
-    double rnd;
-    double currentSum;
+    double cosReceiver = receiverAngle > 0.0 ? java::Math::cos(receiverAngle) : 1.0;
+    double cosEmitter = emitterAngle > 0.0 ? java::Math::cos(emitterAngle) : 1.0;
 
-    computeLightImportance(point, normal);
+    return cosReceiver * cosEmitter * node->emittedFlux / (M_PI * dist2);
+}
 
-    if ( totalImp == 0 ) {
-        // No light is important, but we must return one (->optimize ?)
-        return (sample(x1, pdf));
+/**
+Computes the importance of every light on the leaf for the given point on the
+calling thread's buffer, which is returned. The sum is left on totalImp
+*/
+float *
+LightList::computeLeafImportance(
+    const LightTreeNode *leaf,
+    const Vector3D *point,
+    const Vector3D *normal,
+    float *totalImp) const
+{
+    float *importance = globalImportanceBuffer.reserve(leaf->numberOfLights);
+
+    *totalImp = 0.0;
+    for ( int i = 0; i < leaf->numberOfLights; i++ ) {
+        const LightInfo *info = &lights[treeLights[leaf->childOrFirstLight + i]];
+        double imp = computeOneLightImportance(info->light, point, normal, info->emittedFlux);
+        *totalImp += (float)imp;
+        importance[i] = (float)imp;
     }
 
-    rnd = *x1 * totalImp;
+    return importance;
+}
 
-    // Next
-    info = iterator.nextOnSequence();
-    while ( (info != nullptr) && (info->light->hasZeroVertices()) && (!includeVirtual) ) {
-        info = iterator.nextOnSequence();
+/**
+Probability of going to the first child of the inner node. The importance of both
+children is summed on sumOfImportance; when it is zero the children are weighted
+by their flux
+*/
+double
+LightList::childProbability(
+    const LightTreeNode *node,
+    const Vector3D *point,
+    const Vector3D *normal,
+    double *sumOfImportance) const
+{
+    const LightTreeNode *firstChild = node + 1;
+    const LightTreeNode *secondChild = &treeNodes[node->childOrFirstLight];
+    double firstImportance = treeNodeImportance(firstChild, point, normal);
+    double secondImportance = treeNodeImportance(secondChild, point, normal);
+
+    *sumOfImportance = firstImportance + secondImportance;
+    if ( *sumOfImportance > 0.0 ) {
+        return firstImportance / *sumOfImportance;
     }
 
-    if ( info == nullptr ) {
-        logWarning("CLightList::sample", "No lights available");
-        return nullptr;
+    double flux = (double)firstChild->emittedFlux + secondChild->emittedFlux;
+    return flux > 0.0 ? firstChild->emittedFlux / flux : 0.5;
+}
+
+Patch *
+LightList::sampleImportant(const Vector3D *point, const Vector3D *normal, double *x1, double *pdf) {
+    if ( numberOfTreeNodes == 0 ) {
+        return sample(x1, pdf);
     }
 
-    currentSum = info->importance;
+    // Go down the tree
+    const LightTreeNode *node = &treeNodes[0];
+    double nodePdf = 1.0;
 
-    while ( (rnd > currentSum) && (info != nullptr) ) {
-        lastInfo = info;
+    while ( node->numberOfLights == 0 ) {
+        double sumOfImportance;
+        double probability = childProbability(node, point, normal, &sumOfImportance);
 
-        // next
-        info = iterator.nextOnSequence();
-        while ( info != nullptr && info->light->hasZeroVertices() && !includeVirtual ) {
-            info = iterator.nextOnSequence();
+        if ( node == &treeNodes[0] && sumOfImportance == 0 ) {
+            // No light is important, but we must return one (->optimize ?)
+            return sample(x1, pdf);
         }
 
-        if ( info != nullptr ) {
-            currentSum += info->importance;
+        if ( *x1 < probability ) {
+            *x1 /= probability;
+            nodePdf *= probability;
+            node = node + 1;
         } else {
-            info = lastInfo;
-            rnd = currentSum - 1.0; // :-(  Damn float inaccuracies
+            *x1 = (*x1 - probability) / (1.0 - probability);
+            nodePdf *= 1.0 - probability;
+            node = &treeNodes[node->childOrFirstLight];
         }
     }
 
-    if ( info != nullptr ) {
-        *x1 = ((*x1 - ((currentSum - info->importance) / totalImp)) /
-               (info->importance / totalImp));
-        *pdf = info->importance / totalImp;
-        return (info->light);
+    // Choose a light on the leaf
+    float totalImp;
+    const float *importance = computeLeafImportance(node, point, normal, &totalImp);
+    const LightInfo *info;
+
+    if ( totalImp == 0 ) {
+        if ( node == &treeNodes[0] ) {
+            // No light is important, but we must return one (->optimize ?)
+            return sample(x1, pdf);
+        }
+
+        // Weight by flux, as in the nodes above
+        double rnd = *x1 * node->emittedFlux;
+        double currentSum = 0.0;
+        int i = 0;
+        while ( i < node->numberOfLights - 1 && rnd >= currentSum + lights[treeLights[node->childOrFirstLight + i]].emittedFlux ) {
+            currentSum += lights[treeLights[node->childOrFirstLight + i]].emittedFlux;
+            i++;
+        }
+        info = &lights[treeLights[node->childOrFirstLight + i]];
+        double probability = node->emittedFlux > 0.0f ? info->emittedFlux / node->emittedFlux : 0.0;
+        *x1 = probability > 0.0 ? (*x1 - currentSum / node->emittedFlux) / probability : 0.0;
+        *pdf = nodePdf * probability;
+        return info->light;
+    }
+
+    double rnd = *x1 * totalImp;
+    int i = 0;
+    double currentSum = importance[0];
+
+    while ( rnd > currentSum ) {
+        if ( i == node->numberOfLights - 1 ) {
+            break; // :-(  Damn float inaccuracies
+        }
+        i++;
+        currentSum += importance[i];
     }
 
-    return nullptr;
+    info = &lights[treeLights[node->childOrFirstLight + i]];
+    *x1 = ((*x1 - ((currentSum - importance[i]) / totalImp)) /
+           (importance[i] / totalImp));
+    *pdf = nodePdf * (importance[i] / totalImp);
+    return info->light;
 }
 
 double
@@ -337,27 +739,57 @@ LightList::evalPdfImportant(
     const Vector3D *litPoint,
     const Vector3D *normal)
 {
-    double pdf;
-    const LightInfo *info;
-    CircularListIterator<LightInfo> iterator(*this);
+    int lightIndex = findLight(light);
+
+    if ( lightIndex < 0 ) {
+        logWarning("CLightList::evalPdfImportant", "Could not find light");
+        return 0.0;
+    }
 
-    computeLightImportance(litPoint, normal);
+    // Path from the root to the leaf of the light
+    int path[MAXIMUM_DEPTH + 1];
+    int pathLength = 1;
+    path[0] = leafOfLight[lightIndex];
+    for ( int nodeIndex = treeNodes[path[0]].parent; nodeIndex >= 0; nodeIndex = treeNodes[nodeIndex].parent ) {
+        path[pathLength++] = nodeIndex;
+    }
 
-    // Search the light in the list :-(
+    double pdf = 1.0;
+    for ( int i = pathLength - 1; i > 0; i-- ) {
+        double sumOfImportance;
+        const LightTreeNode *node = &treeNodes[path[i]];
+        double probability = childProbability(node, litPoint, normal, &sumOfImportance);
 
-    while ( (info = iterator.nextOnSequence()) && info->light != light );
+        if ( i == pathLength - 1 && sumOfImportance < Numeric::EPSILON ) {
+            return 0.0;
+        }
 
-    if ( info == nullptr ) {
-        logWarning("CLightList::evalPdfImportant", "Could not find light");
+        if ( path[i - 1] == path[i] + 1 ) {
+            pdf *= probability;
+        } else {
+            pdf *= 1.0 - probability;
+        }
+    }
+
+    // Prob for choosing this light on the leaf
+    const LightTreeNode *leaf = &treeNodes[path[0]];
+    float totalImp;
+    const float *importance = computeLeafImportance(leaf, litPoint, normal, &totalImp);
+
+    if ( pathLength == 1 && totalImp < Numeric::EPSILON ) {
         return 0.0;
     }
 
-    // Prob for choosing this light
-    if ( totalImp < Numeric::EPSILON ) {
-        pdf = 0.0;
-    } else {
-        pdf = info->importance / totalImp;
+    if ( totalImp == 0 ) {
+        // Weighted by flux, see sampleImportant()
+        return leaf->emittedFlux > 0.0f ? pdf * lights[lightIndex].emittedFlux / leaf->emittedFlux : 0.0;
     }
 
-    return pdf;
+    for ( int i = 0; i < leaf->numberOfLights; i++ ) {
+        if ( treeLights[leaf->childOrFirstLight + i] == lightIndex ) {
+            return pdf * (importance[i] / totalImp);
+        }
+    }
+
+    return 0.0;
 }
@@ -8,26 +8,117 @@ this class can be used for sampling lights
 
 #include "java/util/ArrayList.h"
 #include "common/dataStructures/CircularList.h"
+#include "skin/BoundingBox.h"
 #include "skin/Patch.h"
 
 class LightInfo {
 public:
     float emittedFlux;
-    float importance; // Cumulative probability : for importance sampling
+    int index; // Position on the list, for the per thread importance buffer
     Patch *light;
 };
 
+/**
+Node of the light tree, flattened as the bounding volume hierarchy of the scene:
+inner nodes store their first child right after themselves and the index of the
+second child on childOrFirstLight. Leaf nodes store the position of their first
+light on the tree light order
+*/
+class LightTreeNode {
+  public:
+    Vector3D center; // Bounding sphere of the light vertices
+    float radius;
+    Vector3D axis; // Orientation cone containing the normals of the lights
+    float coneAngle;
+    float emittedFlux;
+    int parent;
+    int childOrFirstLight;
+    int numberOfLights; // 0 for inner nodes
+};
+
 
 class LightListIterator;
 
+/**
+Light sampling proportional to the emitted flux uses an alias table, so it takes
+constant time whatever the number of lights [WALK1977], [VOSE1991].
+
+Light sampling proportional to the importance of the lights for a point uses a
+tree of light clusters [CONT2018]. At each inner node a child is chosen with
+probability proportional to an upper bound of its importance, computed from its
+bounding sphere, orientation cone and flux; the lights on a leaf are chosen by
+their exact importance. With up to MAXIMUM_LIGHTS_PER_LEAF lights the tree is a
+single leaf and every light is weighted exactly, as without the tree.
+evalPdfImportant() follows the same path from the root to the leaf of the light,
+so it returns the probability the light is sampled with.
+
+References:
+- [WALK1977] A. J. Walker, "An Efficient Method for Generating Discrete Random
+  Variables with General Distributions", ACM Trans. Math. Softw. 3(3), 1977
+- [VOSE1991] M. D. Vose, "A Linear Algorithm for Generating Random Numbers with a
+  Given Distribution", IEEE Trans. Softw. Eng. 17(9), 1991
+- [CONT2018] A. Conty Estevez, C. Kulla, "Importance Sampling of Many Lights with
+  Adaptive Tree Splitting", Proc. ACM Comput. Graph. Interact. Tech. 1(2), 2018
+*/
 class LightList final : private CircularList<LightInfo> {
   private:
+    static const int MAXIMUM_LIGHTS_PER_LEAF = 8;
+    static const int MAXIMUM_DEPTH = 64;
+
     // Total flux ( sum(L * A * PI))
     float totalFlux;
-    float totalImp;
     bool includeVirtual;
     int lightCount;
 
+    LightInfo *lights; // Indexed by LightInfo::index
+    int *lightIndexByPatchId; // -1 for patches that are not on the list
+    int numberOfPatchIds;
+
+    // Alias table: column i gives light i with probability aliasProbability[i], otherwise light alias[i]
+    double *aliasProbability;
+    int *alias;
+
+    LightTreeNode *treeNodes;
+    int numberOfTreeNodes;
+    int *treeLights; // Light indices in leaf order
+    int *leafOfLight; // Tree leaf of each light
+
+    void buildAliasTable();
+    void buildTree();
+
+    int
+    buildTreeRecursive(
+        const Vector3D *centroids,
+        const BoundingBox *bounds,
+        const float *coneAngles,
+        int first,
+        int count,
+        int parent,
+        int depth);
+
+    void setTreeLeaf(int nodeIndex, int first, int count, int parent);
+    int findLight(const Patch *light) const;
+
+    double
+    treeNodeImportance(
+        const LightTreeNode *node,
+        const Vector3D *point,
+        const Vector3D *normal) const;
+
+    float *
+    computeLeafImportance(
+        const LightTreeNode *leaf,
+        const Vector3D *point,
+        const Vector3D *normal,
+        float *totalImp) const;
+
+    double
+    childProbability(
+        const LightTreeNode *node,
+        const Vector3D *point,
+        const Vector3D *normal,
+        double *sumOfImportance) const;
+
   public:
     // Iteration over lights, not multi-thread!
 
@@ -51,11 +142,6 @@ class LightList final : private CircularList<LightInfo> {
     double evalPdfImportant(const Patch *light, const Vector3D *, const Vector3D *litPoint, const Vector3D *normal);
 
   private:
-    Vector3D lastPoint;
-    Vector3D lastNormal;
-
-    void computeLightImportance(const Vector3D *point, const Vector3D *normal);
-
     static double
     computeOneLightImportance(
         const Patch *light,
@@ -42,7 +42,7 @@ bool UniformLightSampler::ActivateNextUnit() {
 bool
 UniformLightSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -183,7 +183,7 @@ Important light sampler : attach weights to each lamp
 bool
 ImportantLightSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -29,7 +29,7 @@ class UniformLightSampler final : public CNextEventSampler {
     bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
@@ -55,7 +55,7 @@ class ImportantLightSampler final : public CNextEventSampler {
     bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
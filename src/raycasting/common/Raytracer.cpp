@@ -2,7 +2,7 @@
 #include "raycasting/common/Raytracer.h"
 
 double GLOBAL_raytracer_totalTime = 0.0;
-long GLOBAL_raytracer_rayCount = 0;
+thread_local long GLOBAL_raytracer_rayCount = 0;
 long GLOBAL_raytracer_pixelCount = 0;
 RayTracer *GLOBAL_rayTracer = nullptr;
 
@@ -43,7 +43,7 @@ class RayTracer {
 
 extern RayTracer *GLOBAL_rayTracer;
 extern double GLOBAL_raytracer_totalTime; // Statistics: raytracing time
-extern long GLOBAL_raytracer_rayCount; // Statistics: number of rays traced
+extern thread_local long GLOBAL_raytracer_rayCount; // Statistics: number of rays traced by this thread
 extern long GLOBAL_raytracer_pixelCount; // Statistics: number of pixels drawn
 
 extern void
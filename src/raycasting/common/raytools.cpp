@@ -13,14 +13,14 @@ pathFrontHitFlags() {
 
 static RayHit *
 traceWorld(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     Ray *ray,
     Patch *patch,
     unsigned int flags,
     Patch *extraPatch = nullptr,
     RayHit *hitStore = nullptr)
 {
-    static RayHit myHitStore;
+    static thread_local RayHit myHitStore;
     float dist;
     RayHit *result;
     if ( !hitStore ) {
@@ -29,7 +29,7 @@ traceWorld(
 
     dist = Numeric::HUGE_FLOAT_VALUE;
     Patch::dontIntersect(3, patch, patch ? patch->twin : nullptr, extraPatch);
-    result = sceneWorldVoxelGrid->gridIntersect(ray, 0.0, &dist, (int)flags, hitStore);
+    result = sceneWorldAccelerationStructure->intersect(ray, 0.0, &dist, (int)flags, hitStore);
 
     if ( result ) {
         // Compute shading frame (Z-axis = shading normal) at intersection point
@@ -43,7 +43,7 @@ traceWorld(
 
 RayHit *
 findRayIntersection(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     Ray *ray,
     Patch *patch,
     const PhongBidirectionalScatteringDistributionFunction *currentBsdf,
@@ -60,7 +60,7 @@ findRayIntersection(
     }
 
     // Trace the ray
-    newHit = traceWorld(sceneWorldVoxelGrid, ray, patch, hitFlags, nullptr, hitStore);
+    newHit = traceWorld(sceneWorldAccelerationStructure, ray, patch, hitFlags, nullptr, hitStore);
     GLOBAL_raytracer_rayCount++; // statistics
 
     // Robustness test : If a back is hit, check the current
@@ -69,7 +69,7 @@ findRayIntersection(
     if ( newHit != nullptr && (newHit->getFlags() & RayHitFlag::BACK) &&
          newHit->getPatch()->material->getBsdf() != currentBsdf ) {
         // Whoops, intersected with wrong patch (accuracy problem)
-        newHit = traceWorld(sceneWorldVoxelGrid, ray, patch, hitFlags, newHit->getPatch(), hitStore);
+        newHit = traceWorld(sceneWorldAccelerationStructure, ray, patch, hitFlags, newHit->getPatch(), hitStore);
         GLOBAL_raytracer_rayCount++; // Statistics
     }
 
@@ -77,24 +77,21 @@ findRayIntersection(
 }
 
 /**
-pathNodesVisible : send a shadow ray
+Sets up the shadow ray from node1 to node2. Returns false when the nodes cannot
+see each other whatever lies in between, so no ray needs to be traced
 */
-bool
-pathNodesVisible(
-    const VoxelGrid *sceneWorldVoxelGrid,
+static bool
+pathNodesShadowRay(
     const SimpleRaytracingPathNode *node1,
-    const SimpleRaytracingPathNode *node2)
+    const SimpleRaytracingPathNode *node2,
+    Ray *ray,
+    float *fDistance)
 {
     Vector3D dir;
-    Ray ray;
-    const RayHit *hit;
-    RayHit hitStore;
     double cosRay1;
     double cosRay2;
     double dist;
     double dist2;
-    float fDistance;
-    bool visible;
     bool doTest;
 
     // Determines visibility between two nodes,
@@ -113,8 +110,8 @@ pathNodesVisible(
 
     dist = dist * (1 - Numeric::EPSILON);
 
-    ray.pos = node1->m_hit.getPoint();
-    ray.dir.copy(dir);
+    ray->pos = node1->m_hit.getPoint();
+    ray->dir.copy(dir);
 
     cosRay1 = dir.dotProduct(node1->m_normal);
     cosRay2 = -dir.dotProduct(node2->m_normal);
@@ -145,17 +142,37 @@ pathNodesVisible(
 
     if ( doTest ) {
         if ( node2->m_hit.getPatch()->hasZeroVertices() ) {
-            fDistance = Numeric::HUGE_FLOAT_VALUE;
+            *fDistance = Numeric::HUGE_FLOAT_VALUE;
         } else {
-            fDistance = (float) dist;
+            *fDistance = (float) dist;
         }
+    }
+
+    return doTest;
+}
+
+/**
+pathNodesVisible : send a shadow ray
+*/
+bool
+pathNodesVisible(
+    const AccelerationStructure *sceneWorldAccelerationStructure,
+    const SimpleRaytracingPathNode *node1,
+    const SimpleRaytracingPathNode *node2)
+{
+    Ray ray;
+    const RayHit *hit;
+    RayHit hitStore;
+    float fDistance;
+    bool visible;
 
+    if ( pathNodesShadowRay(node1, node2, &ray, &fDistance) ) {
         Patch::dontIntersect(
             3,
             node2->m_hit.getPatch(),
             node1->m_hit.getPatch(),
             node1->m_hit.getPatch() != nullptr ? node1->m_hit.getPatch()->twin : nullptr);
-        hit = sceneWorldVoxelGrid->gridIntersect(
+        hit = sceneWorldAccelerationStructure->intersect(
             &ray,
             0.0,
             &fDistance,
@@ -172,13 +189,56 @@ pathNodesVisible(
     return visible;
 }
 
+/**
+Shadow rays from node1 to several nodes, traced together as one packet. On input
+visible[i] tells whether nodes2[i] is to be tested, on output whether it is visible
+from node1. At most RayPacket::MAXIMUM_SIZE nodes
+*/
+void
+pathNodesVisible(
+    const AccelerationStructure *sceneWorldAccelerationStructure,
+    const SimpleRaytracingPathNode *node1,
+    const SimpleRaytracingPathNode *nodes2,
+    int numberOfNodes,
+    bool *visible)
+{
+    RayPacket packet;
+    int rayIndex[RayPacket::MAXIMUM_SIZE];
+    Ray ray;
+    float fDistance;
+
+    for ( int i = 0; i < numberOfNodes; i++ ) {
+        rayIndex[i] = -1;
+        if ( visible[i] && pathNodesShadowRay(node1, &nodes2[i], &ray, &fDistance) ) {
+            rayIndex[i] = packet.add(&ray, 0.0f, fDistance, nodes2[i].m_hit.getPatch());
+        }
+    }
+
+    if ( packet.size > 0 ) {
+        Patch::dontIntersect(
+            2,
+            node1->m_hit.getPatch(),
+            node1->m_hit.getPatch() != nullptr ? node1->m_hit.getPatch()->twin : nullptr);
+        sceneWorldAccelerationStructure->intersectPacket(
+            &packet,
+            RayHitFlag::FRONT | RayHitFlag::BACK | RayHitFlag::ANY);
+        Patch::dontIntersect(0);
+
+        GLOBAL_raytracer_rayCount += packet.size; // Statistics
+    }
+
+    for ( int i = 0; i < numberOfNodes; i++ ) {
+        visible[i] = rayIndex[i] >= 0 && packet.hit[rayIndex[i]] == nullptr;
+    }
+}
+
 /**
 Can the eye see the node ?  If so, pix_x and pix_y are filled in
 */
 bool
 eyeNodeVisible(
     const Camera *camera,
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const SimpleRaytracingPathNode *eyeNode,
     const SimpleRaytracingPathNode *node,
     float *pixX,
@@ -237,7 +297,7 @@ eyeNodeVisible(
                     Patch::dontIntersect(
                         3, node->m_hit.getPatch(), eyeNode->m_hit.getPatch(),
                          eyeNode->m_hit.getPatch() ? eyeNode->m_hit.getPatch()->twin : nullptr);
-                    hit = sceneWorldVoxelGrid->gridIntersect(&ray,
+                    hit = sceneWorldAccelerationStructure->intersect(&ray,
                                                              0.0, &fDistance,
                                                              RayHitFlag::FRONT | RayHitFlag::ANY, &hitStore);
                     Patch::dontIntersect(0);
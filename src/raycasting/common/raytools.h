@@ -9,12 +9,12 @@ Some utility routines for ray intersections and for statistics
 #include "material/PhongBidirectionalScatteringDistributionFunction.h"
 #include "skin/Patch.h"
 #include "scene/Camera.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "raycasting/common/pathnode.h"
 
 extern RayHit *
 findRayIntersection(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     Ray *ray,
     Patch *patch,
     const PhongBidirectionalScatteringDistributionFunction *currentBsdf,
@@ -22,14 +22,22 @@ findRayIntersection(
 
 extern bool
 pathNodesVisible(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const SimpleRaytracingPathNode *node1,
     const SimpleRaytracingPathNode *node2);
 
+extern void
+pathNodesVisible(
+    const AccelerationStructure *sceneWorldAccelerationStructure,
+    const SimpleRaytracingPathNode *node1,
+    const SimpleRaytracingPathNode *nodes2,
+    int numberOfNodes,
+    bool *visible);
+
 extern bool
 eyeNodeVisible(
     const Camera *camera,
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const SimpleRaytracingPathNode *eyeNode,
     const SimpleRaytracingPathNode *node,
     float *pixX,
@@ -0,0 +1,101 @@
+#include "raycasting/raytracing/ScreenSplatList.h"
+
+#ifdef RAYTRACING_ENABLED
+
+static const int INITIAL_CAPACITY = 1024;
+
+ScreenSplatList::ScreenSplatList():
+    splats(),
+    numberOfSplats(),
+    capacity(),
+    currentTile()
+{
+}
+
+ScreenSplatList::~ScreenSplatList() {
+    delete[] splats;
+}
+
+/**
+Sets the tile the following additions belong to
+*/
+void
+ScreenSplatList::setTile(int tile) {
+    currentTile = tile;
+}
+
+void
+ScreenSplatList::add(int x, int y, ColorRgb radiance) {
+    if ( numberOfSplats == capacity ) {
+        int newCapacity = capacity > 0 ? 2 * capacity : INITIAL_CAPACITY;
+        ScreenSplat *newSplats = new ScreenSplat[newCapacity];
+        for ( int i = 0; i < numberOfSplats; i++ ) {
+            newSplats[i] = splats[i];
+        }
+        delete[] splats;
+        splats = newSplats;
+        capacity = newCapacity;
+    }
+
+    ScreenSplat *splat = &splats[numberOfSplats];
+    splat->tile = currentTile;
+    splat->x = x;
+    splat->y = y;
+    splat->radiance = radiance;
+    numberOfSplats++;
+}
+
+void
+ScreenSplatList::clear() {
+    numberOfSplats = 0;
+}
+
+/**
+Adds the splats of all lists to the screen buffer, sorted by tile (counting sort,
+keeping the order of additions inside each tile), and clears the lists
+*/
+void
+ScreenSplatList::replay(
+    ScreenSplatList **lists,
+    int numberOfLists,
+    int numberOfTiles,
+    ScreenBuffer *screen)
+{
+    int totalSplats = 0;
+    int *tileStart = new int[numberOfTiles + 1];
+
+    for ( int i = 0; i <= numberOfTiles; i++ ) {
+        tileStart[i] = 0;
+    }
+    for ( int i = 0; i < numberOfLists; i++ ) {
+        for ( int j = 0; j < lists[i]->numberOfSplats; j++ ) {
+            tileStart[lists[i]->splats[j].tile + 1]++;
+        }
+        totalSplats += lists[i]->numberOfSplats;
+    }
+    for ( int i = 0; i < numberOfTiles; i++ ) {
+        tileStart[i + 1] += tileStart[i];
+    }
+
+    const ScreenSplat **sorted = new const ScreenSplat *[totalSplats];
+    for ( int i = 0; i < numberOfLists; i++ ) {
+        for ( int j = 0; j < lists[i]->numberOfSplats; j++ ) {
+            const ScreenSplat *splat = &lists[i]->splats[j];
+            sorted[tileStart[splat->tile]] = splat;
+            tileStart[splat->tile]++;
+        }
+    }
+
+    for ( int i = 0; i < totalSplats; i++ ) {
+        screen->add(sorted[i]->x, sorted[i]->y, sorted[i]->radiance);
+    }
+
+    delete[] sorted;
+    delete[] tileStart;
+
+    for ( int i = 0; i < numberOfLists; i++ ) {
+        lists[i]->clear();
+    }
+}
+
+#endif
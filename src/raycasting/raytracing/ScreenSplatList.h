@@ -0,0 +1,54 @@
+#ifndef __SCREEN_SPLAT_LIST__
+#define __SCREEN_SPLAT_LIST__
+
+#include "common/RenderOptions.h"
+
+#ifdef RAYTRACING_ENABLED
+
+#include "common/ColorRgb.h"
+#include "render/ScreenBuffer.h"
+
+class ScreenSplat {
+  public:
+    int tile;
+    int x;
+    int y;
+    ColorRgb radiance;
+};
+
+/**
+Screen buffer additions made by one thread of a tiled screen iteration. Each
+addition is tagged with the tile being computed when it was made (which for light
+paths is not the tile of the pixel it lands on).
+
+When all tiles are done the lists of all threads are replayed on the screen buffer
+tile by tile. A tile is always computed from start to end by one thread, so the
+additions reach the screen buffer in the same order whatever the number of threads
+and the order in which tiles were taken
+*/
+class ScreenSplatList {
+  private:
+    ScreenSplat *splats;
+    int numberOfSplats;
+    int capacity;
+    int currentTile;
+
+  public:
+    ScreenSplatList();
+    ~ScreenSplatList();
+
+    void setTile(int tile);
+    void add(int x, int y, ColorRgb radiance);
+    void clear();
+
+    static void
+    replay(
+        ScreenSplatList **lists,
+        int numberOfLists,
+        int numberOfTiles,
+        ScreenBuffer *screen);
+};
+
+#endif
+
+#endif
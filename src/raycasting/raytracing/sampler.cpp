@@ -16,7 +16,7 @@ or if a shading normal anomaly occurs
 */
 bool
 Sampler::sampleTransfer(
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *thisNode,
     SimpleRaytracingPathNode *newNode,
@@ -31,7 +31,7 @@ Sampler::sampleTransfer(
     newNode->m_depth = thisNode->m_depth + 1;
     newNode->m_rayType = PathRayType::STOPS;
     const RayHit *hit = findRayIntersection(
-        sceneVoxelGrid,
+        sceneAccelerationStructure,
         &ray,
         thisNode->m_hit.getPatch(),
         newNode->m_inBsdf,
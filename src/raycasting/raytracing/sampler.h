@@ -16,13 +16,13 @@ path nodes and have to possible actions :
 #include "material/PhongBidirectionalScatteringDistributionFunction.h"
 #include "raycasting/common/pathnode.h"
 #include "scene/Background.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "scene/Camera.h"
 
 class Sampler {
   protected:
     virtual bool sampleTransfer(
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *thisNode,
         SimpleRaytracingPathNode *newNode,
@@ -39,7 +39,7 @@ public:
     virtual bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
@@ -143,7 +143,7 @@ class CSurfaceSampler : public Sampler {
     virtual bool
     sample(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *prevNode,
         SimpleRaytracingPathNode *thisNode,
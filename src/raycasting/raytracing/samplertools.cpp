@@ -3,6 +3,7 @@
 #ifdef RAYTRACING_ENABLED
 
 #include "common/error.h"
+#include "common/ThreadRandom.h"
 #include "skin/Patch.h"
 #include "common/quasiMonteCarlo/Niederreiter31.h"
 #include "raycasting/raytracing/samplertools.h"
@@ -29,21 +30,21 @@ CSamplerConfig::init(bool useQMC, int qmcDepth) {
 void
 CSamplerConfig::getRand(int depth, double *x1, double *x2) const {
     if ( !m_useQMC || depth >= m_qmcDepth ) {
-        *x1 = drand48();
-        *x2 = drand48();
+        *x1 = ThreadRandom::nextDouble();
+        *x2 = ThreadRandom::nextDouble();
     } else {
         // Niederreiter
         if ( depth == 0 || depth == 2 ) {
-            *x1 = drand48();
-            *x2 = drand48();
+            *x1 = ThreadRandom::nextDouble();
+            *x2 = ThreadRandom::nextDouble();
         } else if ( depth == 1 ) {
             const unsigned *nrs = niederreiter31(m_qmcSeed[1]++);
             *x1 = nrs[0] * RECIP;
             *x2 = nrs[1] * RECIP;
         } else {
             printf("Hmmmm MD %i D%i\n", m_qmcDepth, depth);
-            *x1 = drand48();
-            *x2 = drand48();
+            *x1 = ThreadRandom::nextDouble();
+            *x2 = ThreadRandom::nextDouble();
         }
     }
 }
@@ -59,7 +60,7 @@ RETURNS:
 SimpleRaytracingPathNode *
 CSamplerConfig::traceNode(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *nextNode,
     double x1,
@@ -76,14 +77,14 @@ CSamplerConfig::traceNode(
 
     if ( lastNode == nullptr ) {
         // Fill in first node
-        if ( !pointSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, nullptr, nextNode, x1, x2) ) {
+        if ( !pointSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, nullptr, nextNode, x1, x2) ) {
             logWarning("CSamplerConfig::traceNode", "Point sampler failed");
             return nullptr;
         }
     } else if ( lastNode->m_depth == 0 ) {
         // Fill in second node : dir sampler
         if ( (lastNode->m_depth + 1) < maxDepth ) {
-            if ( !dirSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, lastNode, nextNode, x1, x2) ) {
+            if ( !dirSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, lastNode, nextNode, x1, x2) ) {
                 // No point !
                 lastNode->m_rayType = PathRayType::STOPS;
                 return nullptr;
@@ -97,7 +98,7 @@ CSamplerConfig::traceNode(
         if ( (lastNode->m_depth + 1) < maxDepth ) {
             if ( !surfaceSampler->sample(
                 camera,
-                sceneVoxelGrid,
+                sceneAccelerationStructure,
                 sceneBackground,
                 lastNode->previous(),
                 lastNode,
@@ -127,7 +128,7 @@ CSamplerConfig::traceNode(
 SimpleRaytracingPathNode *
 CSamplerConfig::tracePath(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *nextNode,
     char flags)
@@ -141,13 +142,13 @@ CSamplerConfig::tracePath(
         getRand(nextNode->previous()->m_depth + 1, &x1, &x2);
     }
 
-    nextNode = traceNode(camera, sceneVoxelGrid, sceneBackground, nextNode, x1, x2, flags);
+    nextNode = traceNode(camera, sceneAccelerationStructure, sceneBackground, nextNode, x1, x2, flags);
 
     if ( nextNode != nullptr ) {
         nextNode->ensureNext();
 
         // Recursive call
-        tracePath(camera, sceneVoxelGrid, sceneBackground, nextNode->next(), flags);
+        tracePath(camera, sceneAccelerationStructure, sceneBackground, nextNode->next(), flags);
     }
 
     return nextNode;
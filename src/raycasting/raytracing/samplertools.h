@@ -100,7 +100,7 @@ class CSamplerConfig {
     SimpleRaytracingPathNode *
     traceNode(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *nextNode,
         double x1,
@@ -115,7 +115,7 @@ class CSamplerConfig {
     SimpleRaytracingPathNode *
     tracePath(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         SimpleRaytracingPathNode *nextNode,
         char flags = BSDF_ALL_COMPONENTS);
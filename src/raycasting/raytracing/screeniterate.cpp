@@ -1,10 +1,13 @@
 #include <ctime>
+#include <atomic>
+#include <thread>
 
 #include "java/lang/Math.h"
 #include "common/ColorRgb.h"
 #include "scene/Camera.h"
 #include "tonemap/ToneMap.h"
 #include "render/opengl.h"
+#include "common/ThreadRandom.h"
 #include "raycasting/common/Raytracer.h"
 #include "raycasting/raytracing/screeniterate.h"
 
@@ -27,6 +30,48 @@ ScreenIterateState::ScreenIterateState():
 
 static ScreenIterateState iState;
 
+int GLOBAL_screenIterate_numberOfThreads = 1;
+int GLOBAL_screenIterate_tileSize = 16;
+int GLOBAL_screenIterate_fixedPixelSeeds = false;
+
+/**
+Shared state of a tiled screen iteration. Tiles are handed out in order from an
+atomic counter, so fast threads take more tiles
+*/
+class ScreenIterateTiledJob {
+  public:
+    Camera *camera;
+    AccelerationStructure *sceneAccelerationStructure;
+    Background *sceneBackground;
+    SCREEN_ITERATE_CALLBACK callback;
+    void **threadData;
+    ColorRgb *rgb;
+    int tilesPerRow;
+    int numberOfTiles;
+    unsigned long long seed; // Worker thread sequences start from seed + thread index
+    std::atomic<int> nextTile;
+    long *pixelCount; // One per thread
+    long *rayCount; // One per thread
+
+    ScreenIterateTiledJob();
+};
+
+ScreenIterateTiledJob::ScreenIterateTiledJob():
+    camera(),
+    sceneAccelerationStructure(),
+    sceneBackground(),
+    callback(),
+    threadData(),
+    rgb(),
+    tilesPerRow(),
+    numberOfTiles(),
+    seed(),
+    nextTile(0),
+    pixelCount(),
+    rayCount()
+{
+}
+
 /**
 For counting how much CPU time was used for the computations
 */
@@ -57,7 +102,7 @@ ScreenIterateFinish() {
 void
 screenIterateSequential(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SCREEN_ITERATE_CALLBACK callback, void *data)
 {
@@ -75,7 +120,7 @@ screenIterateSequential(
     // Shoot rays through all the pixels
     for ( int i = 0; i < height; i++ ) {
         for ( int j = 0; j < width; j++ ) {
-            col = callback(camera, sceneVoxelGrid, sceneBackground, j, i, data);
+            col = callback(camera, sceneAccelerationStructure, sceneBackground, j, i, data);
             radianceToRgb(col, &rgb[j]);
             GLOBAL_raytracer_pixelCount++;
         }
@@ -111,7 +156,7 @@ fillRect(
 void
 screenIterateProgressive(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SCREEN_ITERATE_CALLBACK callback,
     void *data)
@@ -179,7 +224,7 @@ screenIterateProgressive(
                 }
 
                 if ( !skip || (ySteps & 1) || (xSteps & 1) ) {
-                    col = callback(camera, sceneVoxelGrid, sceneBackground, x0, height - y0 - 1, data);
+                    col = callback(camera, sceneAccelerationStructure, sceneBackground, x0, height - y0 - 1, data);
                     radianceToRgb(col, &pixelRGB);
                     fillRect(camera, x0, y0, x1, y1, pixelRGB, rgb);
 
@@ -218,3 +263,148 @@ screenIterateProgressive(
 
     ScreenIterateFinish();
 }
+
+/**
+True when screen iteration should go through screenIterateTiled(), that is when
+more than one thread was asked for or pixels must get fixed random sequences
+*/
+bool
+screenIterateUseTiles() {
+    return GLOBAL_screenIterate_numberOfThreads > 1 || GLOBAL_screenIterate_fixedPixelSeeds;
+}
+
+static int
+screenIterateTilesPerRow(const Camera *camera) {
+    return (camera->xSize + GLOBAL_screenIterate_tileSize - 1) / GLOBAL_screenIterate_tileSize;
+}
+
+int
+screenIterateNumberOfTiles(const Camera *camera) {
+    int tilesPerColumn = (camera->ySize + GLOBAL_screenIterate_tileSize - 1) / GLOBAL_screenIterate_tileSize;
+    return screenIterateTilesPerRow(camera) * tilesPerColumn;
+}
+
+/**
+Index of the tile containing pixel (nx, ny), in the coordinates given to the callback
+*/
+int
+screenIterateTileIndex(const Camera *camera, int nx, int ny) {
+    return (ny / GLOBAL_screenIterate_tileSize) * screenIterateTilesPerRow(camera)
+        + nx / GLOBAL_screenIterate_tileSize;
+}
+
+static void
+screenIterateTileWorker(ScreenIterateTiledJob *job, int threadIndex) {
+    Camera *camera = job->camera;
+    int tileSize = GLOBAL_screenIterate_tileSize;
+    long pixelCount = 0;
+
+    if ( threadIndex > 0 && !GLOBAL_screenIterate_fixedPixelSeeds ) {
+        // The main thread keeps the process wide sequence
+        ThreadRandom::useOwnState(job->seed + (unsigned long long)threadIndex);
+    }
+
+    for ( int tile = job->nextTile++; tile < job->numberOfTiles; tile = job->nextTile++ ) {
+        int x0 = (tile % job->tilesPerRow) * tileSize;
+        int y0 = (tile / job->tilesPerRow) * tileSize;
+        int x1 = java::Math::min(x0 + tileSize, camera->xSize);
+        int y1 = java::Math::min(y0 + tileSize, camera->ySize);
+
+        for ( int i = y0; i < y1; i++ ) {
+            for ( int j = x0; j < x1; j++ ) {
+                if ( GLOBAL_screenIterate_fixedPixelSeeds ) {
+                    ThreadRandom::setPixelSeed(j, i);
+                }
+                ColorRgb col = job->callback(
+                    camera,
+                    job->sceneAccelerationStructure,
+                    job->sceneBackground,
+                    j,
+                    i,
+                    job->threadData[threadIndex]);
+                radianceToRgb(col, &job->rgb[i * camera->xSize + j]);
+                pixelCount++;
+            }
+        }
+    }
+
+    job->pixelCount[threadIndex] = pixelCount;
+    job->rayCount[threadIndex] = GLOBAL_raytracer_rayCount;
+}
+
+/**
+Computes the screen in square tiles on GLOBAL_screenIterate_numberOfThreads threads
+(the calling one included). threadData holds the callback data for each thread, so
+each thread can keep its own samplers and scratch state; at most numberOfThreadData
+threads are used. The image is displayed when all tiles are done
+*/
+void
+screenIterateTiled(
+    Camera *camera,
+    AccelerationStructure *sceneAccelerationStructure,
+    Background *sceneBackground,
+    SCREEN_ITERATE_CALLBACK callback,
+    void **threadData,
+    int numberOfThreadData)
+{
+    ScreenIterateTiledJob job;
+    int width;
+    int height;
+    int numberOfThreads;
+
+    ScreenIterateInit();
+
+    width = camera->xSize;
+    height = camera->ySize;
+
+    job.camera = camera;
+    job.sceneAccelerationStructure = sceneAccelerationStructure;
+    job.sceneBackground = sceneBackground;
+    job.callback = callback;
+    job.threadData = threadData;
+    job.rgb = new ColorRgb[width * height];
+    job.tilesPerRow = screenIterateTilesPerRow(camera);
+    job.numberOfTiles = screenIterateNumberOfTiles(camera);
+
+    numberOfThreads = java::Math::min(GLOBAL_screenIterate_numberOfThreads, numberOfThreadData);
+    numberOfThreads = java::Math::max(1, java::Math::min(numberOfThreads, job.numberOfTiles));
+    job.pixelCount = new long[numberOfThreads];
+    job.rayCount = new long[numberOfThreads];
+    if ( numberOfThreads > 1 && !GLOBAL_screenIterate_fixedPixelSeeds ) {
+        // Derived from the process sequence, so -seed changes the worker threads too
+        job.seed = (unsigned long long)(drand48() * 281474976710656.0);
+    }
+
+    std::thread **workers = new std::thread *[numberOfThreads];
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(screenIterateTileWorker, &job, i);
+    }
+    screenIterateTileWorker(&job, 0);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
+
+    if ( GLOBAL_screenIterate_fixedPixelSeeds ) {
+        ThreadRandom::useProcessState();
+    }
+
+    // Main thread ray count is already on GLOBAL_raytracer_rayCount
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        GLOBAL_raytracer_pixelCount += job.pixelCount[i];
+        if ( i > 0 ) {
+            GLOBAL_raytracer_rayCount += job.rayCount[i];
+        }
+    }
+
+    for ( int i = 0; i < height; i++ ) {
+        softRenderPixels(width, 1, job.rgb + i * width);
+    }
+
+    delete[] job.pixelCount;
+    delete[] job.rayCount;
+    delete[] job.rgb;
+
+    ScreenIterateFinish();
+}
@@ -11,12 +11,16 @@ Several functions are provided for different iterating schemes
 #include "common/ColorRgb.h"
 #include "scene/Background.h"
 
-typedef ColorRgb(*SCREEN_ITERATE_CALLBACK)(Camera *, VoxelGrid *, Background *, int, int, void *);
+typedef ColorRgb(*SCREEN_ITERATE_CALLBACK)(Camera *, AccelerationStructure *, Background *, int, int, void *);
+
+extern int GLOBAL_screenIterate_numberOfThreads; // Threads used by screenIterateTiled()
+extern int GLOBAL_screenIterate_tileSize; // Tile width and height in pixels
+extern int GLOBAL_screenIterate_fixedPixelSeeds; // Random sequence fixed per pixel, not per thread
 
 void
 screenIterateSequential(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SCREEN_ITERATE_CALLBACK callback,
     void *data);
@@ -24,9 +28,22 @@ screenIterateSequential(
 void
 screenIterateProgressive(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SCREEN_ITERATE_CALLBACK callback,
     void *data);
 
+bool screenIterateUseTiles();
+int screenIterateNumberOfTiles(const Camera *camera);
+int screenIterateTileIndex(const Camera *camera, int nx, int ny);
+
+void
+screenIterateTiled(
+    Camera *camera,
+    AccelerationStructure *sceneAccelerationStructure,
+    Background *sceneBackground,
+    SCREEN_ITERATE_CALLBACK callback,
+    void **threadData,
+    int numberOfThreadData);
+
 #endif
@@ -10,7 +10,7 @@
 bool
 CSpecularSampler::sample(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     SimpleRaytracingPathNode *thisNode,
@@ -93,7 +93,7 @@ CSpecularSampler::sample(
 
     // Transfer
     if ( !sampleTransfer(
-            sceneVoxelGrid,
+            sceneAccelerationStructure,
             sceneBackground,
             thisNode,
             newNode,
@@ -68,7 +68,7 @@ RayMatter::execute(
         delete globalRayMatter;
     }
     globalRayMatter = new RayMatter(nullptr, scene->camera);
-    globalRayMatter->doMatting(scene->camera, scene->voxelGrid);
+    globalRayMatter->doMatting(scene->camera, scene->accelerationStructure);
     if ( ip && globalRayMatter != nullptr ) {
         globalRayMatter->save(ip);
     }
@@ -114,7 +114,7 @@ RayMatter::createFilter() {
 }
 
 void
-RayMatter::doMatting(const Camera *camera, const VoxelGrid *sceneWorldVoxelGrid) {
+RayMatter::doMatting(const Camera *camera, const AccelerationStructure *sceneWorldAccelerationStructure) {
     clock_t t = clock();
 
     createFilter();
@@ -123,6 +123,7 @@ RayMatter::doMatting(const Camera *camera, const VoxelGrid *sceneWorldVoxelGrid)
     for ( int y = 0; y < camera->ySize; y++ ) {
         for ( int x = 0; x < camera->xSize; x++ ) {
             float hits = 0;
+            RayPacket packet;
 
             for ( int i = 0; i < GLOBAL_rayCasting_rayMatterState.samplesPerPixel; i++ ) {
                 // Uniform random var
@@ -139,10 +140,14 @@ RayMatter::doMatting(const Camera *camera, const VoxelGrid *sceneWorldVoxelGrid)
                 ray.pos = camera->eyePosition;
                 ray.dir = screenBuffer->getPixelVector(x, y, (float)dx, (float)dy);
                 ray.dir.normalize(Numeric::EPSILON_FLOAT);
-
-                // Check if hit
-                if ( findRayIntersection(sceneWorldVoxelGrid, &ray, nullptr, nullptr, nullptr) != nullptr ) {
-                    hits++;
+                packet.add(&ray, 0.0f, Numeric::HUGE_FLOAT_VALUE);
+
+                // Check if hit, the rays of a pixel are traced together
+                if ( packet.isFull() || i == GLOBAL_rayCasting_rayMatterState.samplesPerPixel - 1 ) {
+                    Patch::dontIntersect(0);
+                    hits += (float)sceneWorldAccelerationStructure->intersectPacket(
+                        &packet, RayHitFlag::FRONT | RayHitFlag::ANY);
+                    packet.clear();
                 }
             }
 
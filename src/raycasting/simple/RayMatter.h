@@ -30,7 +30,7 @@ class RayMatter final : public RayTracer {
     ~RayMatter() final;
 
     void createFilter();
-    void doMatting(const Camera *camera, const VoxelGrid *sceneWorldVoxelGrid);
+    void doMatting(const Camera *camera, const AccelerationStructure *sceneWorldAccelerationStructure);
     void display();
     void save(ImageOutputHandle *ip);
 
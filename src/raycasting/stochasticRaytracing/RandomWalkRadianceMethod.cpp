@@ -256,7 +256,7 @@ randomWalkRadiosityShootingUpdate(const Patch *P, double w) {
 
 static void
 randomWalkRadiosityDoShootingIteration(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches)
 {
     long numberOfWalks;
@@ -275,7 +275,7 @@ randomWalkRadiosityDoShootingIteration(
                 (1.0 - GLOBAL_statistics.averageReflectivity.maximumComponent())));
 
     tracePaths(
-        sceneWorldVoxelGrid,
+        sceneWorldAccelerationStructure,
         numberOfWalks,
         randomWalkRadiosityScalarSourcePower,
         randomWalkRadiosityScalarReflectance,
@@ -397,7 +397,7 @@ Returns true when converged and false if not
 */
 static void
 randomWalkRadiosityDoGatheringIteration(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches)
 {
     long numberOfWalks = GLOBAL_stochasticRaytracing_monteCarloRadiosityState.initialNumberOfRays;
@@ -420,7 +420,7 @@ randomWalkRadiosityDoGatheringIteration(
         numberOfWalks, (long) floor((double) numberOfWalks / (1.0 - GLOBAL_statistics.averageReflectivity.maximumComponent())));
 
     tracePaths(
-        sceneWorldVoxelGrid,
+        sceneWorldAccelerationStructure,
         numberOfWalks,
         randomWalkRadiosityPatchArea,
         randomWalkRadiosityScalarReflectance,
@@ -439,14 +439,14 @@ randomWalkRadiosityUpdateSourceIllumination(StochasticRadiosityElement *elem, do
 
 static void
 randomWalkRadiosityDoFirstShot(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches,
     RenderOptions *renderOptions)
 {
     long numberOfRays = GLOBAL_stochasticRaytracing_monteCarloRadiosityState.initialNumberOfRays *
         GLOBAL_stochasticRadiosity_approxDesc[GLOBAL_stochasticRaytracing_monteCarloRadiosityState.approximationOrderType].basis_size;
     fprintf(stderr, "First shot (%ld rays):\n", numberOfRays);
-    doStochasticJacobiIteration(sceneWorldVoxelGrid, numberOfRays, randomWalkRadiosityGetSelfEmittedRadiance, nullptr,
+    doStochasticJacobiIteration(sceneWorldAccelerationStructure, numberOfRays, randomWalkRadiosityGetSelfEmittedRadiance, nullptr,
                                 randomWalkRadiosityUpdateSourceIllumination, scenePatches, renderOptions);
     randomWalkRadiosityPrintStats();
 }
@@ -462,15 +462,15 @@ RandomWalkRadianceMethod::doStep(Scene *scene, RenderOptions *renderOptions) {
 
     if ( GLOBAL_stochasticRaytracing_monteCarloRadiosityState.currentIteration == 1
         && GLOBAL_stochasticRaytracing_monteCarloRadiosityState.indirectOnly ) {
-        randomWalkRadiosityDoFirstShot(scene->voxelGrid, scene->patchList, renderOptions);
+        randomWalkRadiosityDoFirstShot(scene->accelerationStructure, scene->patchList, renderOptions);
     }
 
     switch ( GLOBAL_stochasticRaytracing_monteCarloRadiosityState.randomWalkEstimatorType ) {
         case RandomWalkEstimatorType::RW_SHOOTING:
-            randomWalkRadiosityDoShootingIteration(scene->voxelGrid, scene->patchList);
+            randomWalkRadiosityDoShootingIteration(scene->accelerationStructure, scene->patchList);
             break;
         case RandomWalkEstimatorType::RW_GATHERING:
-            randomWalkRadiosityDoGatheringIteration(scene->voxelGrid, scene->patchList);
+            randomWalkRadiosityDoGatheringIteration(scene->accelerationStructure, scene->patchList);
             break;
         default:
             logFatal(-1, "randomWalkRadiosityDoStep", "Unknown random walk estimator type %d",
@@ -484,6 +484,23 @@ RandomWalkRadianceMethod::doStep(Scene *scene, RenderOptions *renderOptions) {
     return false; // Never converged
 }
 
+bool
+RandomWalkRadianceMethod::writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const {
+    monteCarloRadiosityWriteCheckpoint(checkpoint, scene->patchList);
+    return true;
+}
+
+bool
+RandomWalkRadianceMethod::readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions *renderOptions) {
+    if ( !monteCarloRadiosityReadCheckpoint(checkpoint, scene, renderOptions) ) {
+        return false;
+    }
+    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+        monteCarloRadiosityPatchComputeNewColor(scene->patchList->get(i));
+    }
+    return true;
+}
+
 #define STRING_LENGTH 2000
 
 char *
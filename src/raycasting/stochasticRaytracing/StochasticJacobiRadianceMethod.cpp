@@ -218,7 +218,7 @@ stochasticRelaxationRadiosityDoIncrementalRadianceIterations(
                 stepNumber, 100. * unShotFraction);
 
         doStochasticJacobiIteration(
-            scene->voxelGrid,
+            scene->accelerationStructure,
             numberOfRays,
             stochasticRelaxationRadiosityElementUnShotRadiance,
             nullptr,
@@ -265,7 +265,7 @@ stochasticRelaxationRadiosityPrintIncrementalImportanceStats() {
 
 static void
 stochasticRelaxationRadiosityDoIncrementalImportanceIterations(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches,
     RenderOptions *renderOptions)
 {
@@ -301,7 +301,7 @@ stochasticRelaxationRadiosityDoIncrementalImportanceIterations(
                 stepNumber, 100.0 * unShotFraction);
 
         doStochasticJacobiIteration(
-            sceneWorldVoxelGrid,
+            sceneWorldAccelerationStructure,
             numberOfRays,
             nullptr,
             stochasticRelaxationRadiosityElementUnShotImportance,
@@ -376,13 +376,13 @@ stochasticRelaxationRadiosityPrintRegularStats() {
 
 static void
 stochasticRelaxationRadiosityDoRegularRadianceIteration(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches,
     RenderOptions *renderOptions)
 {
     fprintf(stderr, "Regular radiance iteration %d:\n", GLOBAL_stochasticRaytracing_monteCarloRadiosityState.currentIteration);
     doStochasticJacobiIteration(
-        sceneWorldVoxelGrid,
+        sceneWorldAccelerationStructure,
         GLOBAL_stochasticRaytracing_monteCarloRadiosityState.raysPerIteration,
         stochasticRelaxationRadiosityElementRadiance,
         nullptr,
@@ -409,7 +409,7 @@ stochasticRelaxationRadiosityElementUpdateImportance(StochasticRadiosityElement
 
 static void
 stochasticRelaxationRadiosityDoRegularImportanceIteration(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches,
     RenderOptions *renderOptions)
 {
@@ -425,7 +425,7 @@ stochasticRelaxationRadiosityDoRegularImportanceIteration(
     fprintf(stderr, "Regular importance iteration %d:\n", GLOBAL_stochasticRaytracing_monteCarloRadiosityState.currentIteration);
 
     doStochasticJacobiIteration(
-        sceneWorldVoxelGrid,
+        sceneWorldAccelerationStructure,
         numberOfRays,
         nullptr,
         stochasticRelaxationRadiosityElementImportance,
@@ -509,7 +509,7 @@ StochasticJacobiRadianceMethod::doStep(Scene *scene, RenderOptions *renderOption
                     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceUpdated = false;
 
                     // Propagate importance changes
-                    stochasticRelaxationRadiosityDoIncrementalImportanceIterations(scene->voxelGrid, scene->patchList, renderOptions);
+                    stochasticRelaxationRadiosityDoIncrementalImportanceIterations(scene->accelerationStructure, scene->patchList, renderOptions);
                     if ( GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceUpdatedFromScratch ) {
                         GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceRaysPerIteration = GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays;
                     }
@@ -530,15 +530,15 @@ StochasticJacobiRadianceMethod::doStep(Scene *scene, RenderOptions *renderOption
                 GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceUpdated = false;
 
                 // Propagate importance changes
-                stochasticRelaxationRadiosityDoIncrementalImportanceIterations(scene->voxelGrid, scene->patchList, renderOptions);
+                stochasticRelaxationRadiosityDoIncrementalImportanceIterations(scene->accelerationStructure, scene->patchList, renderOptions);
                 if ( GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceUpdatedFromScratch ) {
                     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceRaysPerIteration = GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays;
                 }
             } else {
-                stochasticRelaxationRadiosityDoRegularImportanceIteration(scene->voxelGrid, scene->patchList, renderOptions);
+                stochasticRelaxationRadiosityDoRegularImportanceIteration(scene->accelerationStructure, scene->patchList, renderOptions);
             }
         }
-        stochasticRelaxationRadiosityDoRegularRadianceIteration(scene->voxelGrid, scene->patchList, renderOptions);
+        stochasticRelaxationRadiosityDoRegularRadianceIteration(scene->accelerationStructure, scene->patchList, renderOptions);
     }
 
     stochasticRelaxationRadiosityRecomputeDisplayColors(scene->patchList);
@@ -547,4 +547,19 @@ StochasticJacobiRadianceMethod::doStep(Scene *scene, RenderOptions *renderOption
 
     return false; // Always continue computing (never fully converged)
 }
+bool
+StochasticJacobiRadianceMethod::writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const {
+    monteCarloRadiosityWriteCheckpoint(checkpoint, scene->patchList);
+    return true;
+}
+
+bool
+StochasticJacobiRadianceMethod::readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions *renderOptions) {
+    if ( !monteCarloRadiosityReadCheckpoint(checkpoint, scene, renderOptions) ) {
+        return false;
+    }
+    stochasticRelaxationRadiosityRecomputeDisplayColors(scene->patchList);
+    return true;
+}
+
 #endif
@@ -18,6 +18,8 @@ class StochasticJacobiRadianceMethod final : public RadianceMethod {
     char *getStats() final;
     void renderScene(const Scene *scene, const RenderOptions *renderOptions) const final;
     void writeVRML(const Camera *camera, FILE *fp, const RenderOptions *renderOptions) const final;
+    bool writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const final;
+    bool readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions *renderOptions) final;
 };
 
 #endif
@@ -190,6 +190,7 @@ createElement() {
     elem->flags = 0x00;
 
     GLOBAL_stochasticRaytracing_hierarchy.nr_elements++;
+    GLOBAL_stochasticRaytracing_hierarchy.structureVersion++;
 
     return elem;
 }
@@ -891,6 +892,7 @@ monteCarloRadiosityDestroyElement(StochasticRadiosityElement *elem) {
         GLOBAL_stochasticRaytracing_hierarchy.nr_clusters--;
     }
     GLOBAL_stochasticRaytracing_hierarchy.nr_elements--;
+    GLOBAL_stochasticRaytracing_hierarchy.structureVersion++;
 
     if ( elem->irregularSubElements ) {
         for ( int j = 0; elem->irregularSubElements != nullptr && j < elem->irregularSubElements->size(); j++ ) {
@@ -2,6 +2,9 @@
 
 #ifdef RAYTRACING_ENABLED
 
+#include "java/lang/Math.h"
+#include "common/error.h"
+#include "common/ThreadRandom.h"
 #include "common/stratification.h"
 #include "raycasting/bidirectionalRaytracing/LightList.h"
 #include "PHOTONMAP/PhotonMapRadianceMethod.h"
@@ -76,6 +79,51 @@ StochasticRaytracer::initialize(const java::ArrayList<Patch *> *lightPatches) co
     GLOBAL_lightList = new LightList(lightPatches);
 }
 
+/**
+Photon map reconstruction keeps the photons found by each query on the photon map
+itself, so those modes always use one thread
+*/
+static bool
+stochasticRaytracerCanUseThreads(const StochasticRaytracingConfiguration *config) {
+    if ( config->radMode == RayTracingRadMode::STORED_PHOTON_MAP
+      || config->reflectionSampling == RayTracingSamplingMode::PHOTON_MAP_SAMPLING ) {
+        logWarning("Stochastic raytracing", "Photon map readout is single threaded, ignoring -raytracing-threads");
+        return false;
+    }
+    return true;
+}
+
+/**
+Computes the image in tiles, each thread with its own copy of the configuration
+*/
+void
+StochasticRaytracer::executeTiled(Scene *scene, StochasticRaytracingConfiguration *config) {
+    int numberOfThreads = java::Math::max(1, GLOBAL_screenIterate_numberOfThreads);
+    StochasticRaytracingConfiguration **threadConfigs = new StochasticRaytracingConfiguration *[numberOfThreads];
+    ScreenSplatList **splats = new ScreenSplatList *[numberOfThreads];
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        threadConfigs[i] = new StochasticRaytracingConfiguration(config);
+        splats[i] = threadConfigs[i]->splats;
+    }
+
+    screenIterateTiled(
+        scene->camera,
+        scene->accelerationStructure,
+        scene->background,
+        (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))StochasticRaytracer::calcPixel,
+        (void **)threadConfigs,
+        numberOfThreads);
+
+    ScreenSplatList::replay(splats, numberOfThreads, screenIterateNumberOfTiles(scene->camera), config->screen);
+
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        delete threadConfigs[i];
+    }
+    delete[] threadConfigs;
+    delete[] splats;
+}
+
 /**
 Raytrace the current scene as seen with the current camera. If fp
 is not a nullptr pointer, write the ray-traced image to the file
@@ -92,22 +140,24 @@ StochasticRaytracer::execute(
 
     // Frame Coherent sampling : init fixed seed
     if ( GLOBAL_raytracing_state.doFrameCoherent ) {
-        srand48(GLOBAL_raytracing_state.baseSeed);
+        ThreadRandom::setSeed(GLOBAL_raytracing_state.baseSeed);
     }
 
-    if ( !GLOBAL_raytracing_state.progressiveTracing ) {
+    if ( screenIterateUseTiles() && stochasticRaytracerCanUseThreads(&config) ) {
+        executeTiled(scene, &config);
+    } else if ( !GLOBAL_raytracing_state.progressiveTracing ) {
         screenIterateSequential(
                 scene->camera,
-                scene->voxelGrid,
+                scene->accelerationStructure,
                 scene->background,
-                (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))StochasticRaytracer::calcPixel,
+                (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))StochasticRaytracer::calcPixel,
                 &config);
     } else {
         screenIterateProgressive(
                 scene->camera,
-                scene->voxelGrid,
+                scene->accelerationStructure,
                 scene->background,
-                (ColorRgb(*)(Camera *, VoxelGrid *, Background *, int, int, void *))StochasticRaytracer::calcPixel,
+                (ColorRgb(*)(Camera *, AccelerationStructure *, Background *, int, int, void *))StochasticRaytracer::calcPixel,
                 &config);
     }
 
@@ -150,7 +200,7 @@ StochasticRaytracer::terminate() const {
 static ColorRgb
 stochasticRaytracerGetRadiance(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *thisNode,
     StochasticRaytracingConfiguration *config,
@@ -162,7 +212,7 @@ stochasticRaytracerGetRadiance(
 static ColorRgb
 stochasticRaytracerGetScatteredRadiance(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background * sceneBackground,
     SimpleRaytracingPathNode *thisNode,
     StochasticRaytracingConfiguration *config,
@@ -236,7 +286,7 @@ stochasticRaytracerGetScatteredRadiance(
                 // Surface sampling
                 if ( config->samplerConfig.surfaceSampler->sample(
                         camera,
-                        sceneVoxelGrid,
+                        sceneAccelerationStructure,
                         sceneBackground,
                         thisNode->previous(),
                         thisNode,
@@ -258,7 +308,7 @@ stochasticRaytracerGetScatteredRadiance(
                         // Storage bounce
                         radiance = stochasticRaytracerGetRadiance(
                                 camera,
-                                sceneVoxelGrid,
+                                sceneAccelerationStructure,
                                 sceneBackground,
                                 &newNode,
                                 config,
@@ -269,7 +319,7 @@ stochasticRaytracerGetScatteredRadiance(
                     } else {
                         radiance = stochasticRaytracerGetRadiance(
                                 camera,
-                                sceneVoxelGrid,
+                                sceneAccelerationStructure,
                                 sceneBackground,
                                 &newNode,
                                 config,
@@ -307,7 +357,7 @@ stochasticRaytracerGetScatteredRadiance(
 static ColorRgb
 srGetDirectRadiance(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *prevNode,
     StochasticRaytracingConfiguration *config,
@@ -330,7 +380,8 @@ srGetDirectRadiance(
     if ( (nes != nullptr) &&
         (config->nextEventSamples > 0) &&
         (prevNode->m_depth + 1 < config->samplerConfig.maxDepth) ) {
-        SimpleRaytracingPathNode lightNode;
+        SimpleRaytracingPathNode lightNodes[RayPacket::MAXIMUM_SIZE];
+        bool visible[RayPacket::MAXIMUM_SIZE];
         double x1;
         double x2;
         double geom;
@@ -349,22 +400,33 @@ srGetDirectRadiance(
         while ( lightsToDo ) {
             StratifiedSampling2D stratified(config->nextEventSamples);
 
-            for ( int i = 0; i < config->nextEventSamples; i++ ) {
-                // Light sampling
-                stratified.sample(&x1, &x2);
+            for ( int first = 0; first < config->nextEventSamples; first += RayPacket::MAXIMUM_SIZE ) {
+                int numberOfSamples = java::Math::min(config->nextEventSamples - first, RayPacket::MAXIMUM_SIZE);
+
+                // Light sampling, the shadow rays to the sampled points are traced together
+                for ( int i = 0; i < numberOfSamples; i++ ) {
+                    stratified.sample(&x1, &x2);
+                    visible[i] = config->samplerConfig.neSampler->sample(
+                        camera,
+                        sceneAccelerationStructure,
+                        sceneBackground,
+                        prevNode->previous(),
+                        prevNode,
+                        &lightNodes[i],
+                        x1,
+                        x2,
+                        true,
+                        BSDF_ALL_COMPONENTS);
+                }
+                pathNodesVisible(sceneAccelerationStructure, prevNode, lightNodes, numberOfSamples, visible);
+
+                for ( int i = 0; i < numberOfSamples; i++ ) {
+                    if ( !visible[i] ) {
+                        continue;
+                    }
+
+                    SimpleRaytracingPathNode &lightNode = lightNodes[i];
 
-                if ( config->samplerConfig.neSampler->sample(
-                    camera,
-                    sceneVoxelGrid,
-                    sceneBackground,
-                    prevNode->previous(),
-                    prevNode,
-                    &lightNode,
-                    x1,
-                    x2,
-                    true,
-                    BSDF_ALL_COMPONENTS)
-                    && ( pathNodesVisible(sceneVoxelGrid, prevNode, &lightNode) ) ) {
                     // Now connect for all applicable scatter-info's
                     // If no weighting between reflection sampling and
                     // next event estimation were used, only one connect
@@ -462,7 +524,7 @@ srGetDirectRadiance(
 static ColorRgb
 stochasticRaytracerGetRadiance(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     SimpleRaytracingPathNode *thisNode,
     StochasticRaytracingConfiguration *config,
@@ -571,13 +633,13 @@ stochasticRaytracerGetRadiance(
             result.add(result, radiance);
         }
 
-        radiance = srGetDirectRadiance(camera, sceneVoxelGrid, sceneBackground, thisNode, config, readout);
+        radiance = srGetDirectRadiance(camera, sceneAccelerationStructure, sceneBackground, thisNode, config, readout);
         result.add(result, radiance);
 
         // Scattered light
         radiance = stochasticRaytracerGetScatteredRadiance(
                 camera,
-                sceneVoxelGrid,
+                sceneAccelerationStructure,
                 sceneBackground,
                 thisNode,
                 config,
@@ -647,7 +709,7 @@ stochasticRaytracerGetRadiance(
 ColorRgb
 StochasticRaytracer::calcPixel(
     Camera *camera,
-    VoxelGrid *sceneVoxelGrid,
+    AccelerationStructure *sceneAccelerationStructure,
     Background *sceneBackground,
     int nx,
     int ny,
@@ -665,20 +727,24 @@ StochasticRaytracer::calcPixel(
 
     result.clear();
 
+    if ( config->splats != nullptr ) {
+        config->splats->setTile(screenIterateTileIndex(camera, nx, ny));
+    }
+
     // Frame coherent & correlated sampling
     if ( GLOBAL_raytracing_state.doFrameCoherent || GLOBAL_raytracing_state.doCorrelatedSampling ) {
         if ( GLOBAL_raytracing_state.doCorrelatedSampling ) {
             // Correlated : start each pixel with same seed
-            srand48(GLOBAL_raytracing_state.baseSeed);
+            ThreadRandom::setSeed(GLOBAL_raytracing_state.baseSeed);
         }
-        drand48(); // (randomize seed, gives new seed for uncorrelated sampling)
+        ThreadRandom::nextDouble(); // (randomize seed, gives new seed for uncorrelated sampling)
         config->seedConfig.save(0);
     }
 
     // Calc pixel data
 
     // Sample eye node
-    config->samplerConfig.pointSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, nullptr, &eyeNode, 0, 0);
+    config->samplerConfig.pointSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, nullptr, &eyeNode, 0, 0);
     ((CPixelSampler *) config->samplerConfig.dirSampler)->SetPixel(camera, nx, ny, nullptr);
 
     eyeNode.attach(&pixelNode);
@@ -687,7 +753,7 @@ StochasticRaytracer::calcPixel(
     for ( int i = 0; i < config->samplesPerPixel; i++ ) {
         stratified.sample(&x1, &x2);
 
-        if ( config->samplerConfig.dirSampler->sample(camera, sceneVoxelGrid, sceneBackground, nullptr, &eyeNode, &pixelNode, x1, x2)
+        if ( config->samplerConfig.dirSampler->sample(camera, sceneAccelerationStructure, sceneBackground, nullptr, &eyeNode, &pixelNode, x1, x2)
              && ((pixelNode.m_rayType != PathRayType::ENVIRONMENT) || (config->backgroundDirect)) ) {
             pixelNode.assignBsdfAndNormal();
 
@@ -698,7 +764,7 @@ StochasticRaytracer::calcPixel(
 
             col = stochasticRaytracerGetRadiance(
                     camera,
-                    sceneVoxelGrid,
+                    sceneAccelerationStructure,
                     sceneBackground,
                     &pixelNode,
                     config,
@@ -728,7 +794,11 @@ StochasticRaytracer::calcPixel(
     double factor = (computeFluxToRadFactor(camera, nx, ny) / (float)config->samplesPerPixel);
 
     result.scale((float)factor);
-    config->screen->add(nx, ny, result);
+    if ( config->splats != nullptr ) {
+        config->splats->add(nx, ny, result);
+    } else {
+        config->screen->add(nx, ny, result);
+    }
 
     // Frame coherent & correlated sampling
     if ( GLOBAL_raytracing_state.doFrameCoherent || GLOBAL_raytracing_state.doCorrelatedSampling ) {
@@ -13,10 +13,12 @@ class StochasticRaytracer final : public RayTracer {
   private:
     static char name[];
 
+    static void executeTiled(Scene *scene, StochasticRaytracingConfiguration *config);
+
     static ColorRgb
     calcPixel(
         Camera *camera,
-        VoxelGrid *sceneVoxelGrid,
+        AccelerationStructure *sceneAccelerationStructure,
         Background *sceneBackground,
         int nx,
         int ny,
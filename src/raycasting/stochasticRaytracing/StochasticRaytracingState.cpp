@@ -14,6 +14,7 @@ StochasticRelaxation::StochasticRelaxation():
     totalYmp(),
     sourceYmp(),
     rayUnitsPerIt(),
+    numberOfThreads(),
     bidirectionalTransfers(),
     constantControlVariate(),
     controlRadiance(),
@@ -27,6 +27,7 @@ class StochasticRelaxation {
     float totalYmp; // Sum over all patches of area * importance
     float sourceYmp;
     int rayUnitsPerIt; // To increase or decrease initial nr of rays
+    int numberOfThreads; // For shooting the rays of a stochastic Jacobi iteration
     int bidirectionalTransfers; // For bidirectional energy transfers
     int constantControlVariate; // For constant control variate variance reduction
     ColorRgb controlRadiance; // Constant control radiance value
@@ -63,6 +63,7 @@ class ElementHierarchyState {
     float minimumArea; // Minimum allowed element area
     long nr_elements; // Number of elements
     long nr_clusters; // Number of clusters
+    long structureVersion; // Changes whenever elements are created or destroyed
     int tvertex_elimination; // If doing T-vertex elimination for rendering
     HierarchyClusteringMode clustering; // Clustering mode, 0 => no clustering
     ORACLE oracle; // Refinement oracle to be used
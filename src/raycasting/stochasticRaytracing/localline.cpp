@@ -29,8 +29,8 @@ by the 4-dimensional sample vector xi
 */
 Ray
 mcrGenerateLocalLine(const Patch *patch, const double *xi) {
-    const static Patch *previousPatch = nullptr;
-    static CoordinateSystem coordSys;
+    static thread_local const Patch *previousPatch = nullptr;
+    static thread_local CoordinateSystem coordSys;
     Ray ray;
     double pdf;
 
@@ -52,7 +52,11 @@ In order to let the user have the impression that the computations are proceedin
 */
 static void
 someFeedback() {
-    if ( (GLOBAL_stochasticRaytracing_monteCarloRadiosityState.tracedRays + GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays) % 1000 == 0 ) {
+    // Counted per thread: the global ray counts are only updated when all threads are done
+    static thread_local long shotRays = 0;
+
+    shotRays++;
+    if ( shotRays % 1000 == 0 ) {
         fputc('.', stderr);
     }
 }
@@ -61,13 +65,13 @@ someFeedback() {
 Determines nearest intersection point and patch
 */
 RayHit *
-mcrShootRay(const VoxelGrid * sceneWorldVoxelGrid, Patch *P, Ray *ray, RayHit *hitStore) {
+mcrShootRay(const AccelerationStructure * sceneWorldAccelerationStructure, Patch *P, Ray *ray, RayHit *hitStore) {
     float distance = Numeric::HUGE_FLOAT_VALUE;
     RayHit *hit;
 
     // Reject self-intersections
     Patch::dontIntersect(2, P, P->twin);
-    hit = sceneWorldVoxelGrid->gridIntersect(
+    hit = sceneWorldAccelerationStructure->intersect(
         ray,
         Numeric::EPSILON_FLOAT < P->tolerance ? Numeric::EPSILON_FLOAT : P->tolerance,
         &distance,
@@ -8,6 +8,6 @@ Generate and trace a local line
 #include "common/Ray.h"
 
 extern Ray mcrGenerateLocalLine(const Patch *patch, const double *xi);
-extern RayHit *mcrShootRay(const VoxelGrid * sceneWorldVoxelGrid, Patch *P, Ray *ray, RayHit *hitStore);
+extern RayHit *mcrShootRay(const AccelerationStructure * sceneWorldAccelerationStructure, Patch *P, Ray *ray, RayHit *hitStore);
 
 #endif
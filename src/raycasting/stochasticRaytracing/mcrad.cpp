@@ -27,6 +27,7 @@ void
 monteCarloRadiosityDefaults() {
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.inited = false;
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.rayUnitsPerIt = 10;
+    GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads = 1;
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.bidirectionalTransfers = false;
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.constantControlVariate = false;
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.controlRadiance.clear();
@@ -361,6 +362,213 @@ monteCarloRadiosityTerminate(const java::ArrayList<Patch *> *scenePatches) {
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.inited = false;
 }
 
+/**
+Elements in the order they are written to a checkpoint: first the clusters, depth
+first from the top cluster, then for each patch its toplevel element and its
+regular sub-elements, depth first
+*/
+static void
+monteCarloRadiosityCollectClusters(StochasticRadiosityElement *cluster, java::ArrayList<StochasticRadiosityElement *> *elements) {
+    if ( cluster == nullptr || !cluster->isCluster() ) {
+        return;
+    }
+    elements->add(cluster);
+    for ( int i = 0; cluster->irregularSubElements != nullptr && i < cluster->irregularSubElements->size(); i++ ) {
+        monteCarloRadiosityCollectClusters((StochasticRadiosityElement *)cluster->irregularSubElements->get(i), elements);
+    }
+}
+
+static void
+monteCarloRadiosityWriteElement(RadianceCheckpoint *checkpoint, const StochasticRadiosityElement *element) {
+    int basisSize = element->basis != nullptr ? element->basis->size : 0;
+    checkpoint->writeInt(basisSize);
+    checkpoint->writeLong(element->rayIndex);
+    checkpoint->writeFloat(element->quality);
+    checkpoint->writeFloat(element->samplingProbability);
+    checkpoint->writeFloat(element->ng);
+    checkpoint->writeColor(element->sourceRad);
+    checkpoint->writeColors(element->radiance, basisSize);
+    checkpoint->writeColors(element->unShotRadiance, basisSize);
+    checkpoint->writeColors(element->receivedRadiance, basisSize);
+    checkpoint->writeFloat(element->importance);
+    checkpoint->writeFloat(element->unShotImportance);
+    checkpoint->writeFloat(element->receivedImportance);
+    checkpoint->writeFloat(element->sourceImportance);
+    checkpoint->writeLong(element->importanceRayIndex);
+}
+
+static void
+monteCarloRadiosityReadElement(RadianceCheckpoint *checkpoint, StochasticRadiosityElement *element) {
+    int basisSize = element->basis != nullptr ? element->basis->size : 0;
+    if ( checkpoint->readInt() != basisSize ) {
+        logFatal(-1, "monteCarloRadiosityReadCheckpoint", "Element %d does not match the checkpoint", element->id);
+    }
+    element->rayIndex = (NiederreiterIndex)checkpoint->readLong();
+    element->quality = checkpoint->readFloat();
+    element->samplingProbability = checkpoint->readFloat();
+    element->ng = checkpoint->readFloat();
+    element->sourceRad = checkpoint->readColor();
+    checkpoint->readColors(element->radiance, basisSize);
+    checkpoint->readColors(element->unShotRadiance, basisSize);
+    checkpoint->readColors(element->receivedRadiance, basisSize);
+    element->importance = checkpoint->readFloat();
+    element->unShotImportance = checkpoint->readFloat();
+    element->receivedImportance = checkpoint->readFloat();
+    element->sourceImportance = checkpoint->readFloat();
+    element->importanceRayIndex = (NiederreiterIndex)checkpoint->readLong();
+}
+
+static void
+monteCarloRadiosityWriteSurfaceElement(RadianceCheckpoint *checkpoint, const StochasticRadiosityElement *element) {
+    monteCarloRadiosityWriteElement(checkpoint, element);
+    checkpoint->writeInt(element->regularSubElements != nullptr);
+    if ( element->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            monteCarloRadiosityWriteSurfaceElement(checkpoint, (StochasticRadiosityElement *)element->regularSubElements[i]);
+        }
+    }
+}
+
+static void
+monteCarloRadiosityReadSurfaceElement(
+    RadianceCheckpoint *checkpoint,
+    StochasticRadiosityElement *element,
+    const RenderOptions *renderOptions)
+{
+    monteCarloRadiosityReadElement(checkpoint, element);
+    if ( checkpoint->readInt() != 0 && !checkpoint->hasReadError() ) {
+        StochasticRadiosityElement **subElements = stochasticRadiosityElementRegularSubdivideElement(element, renderOptions);
+        for ( int i = 0; i < 4; i++ ) {
+            monteCarloRadiosityReadSurfaceElement(checkpoint, subElements[i], renderOptions);
+        }
+    }
+}
+
+/**
+Writes the state of stochastic relaxation or random walk radiosity: the ray
+counters, the total and un-shot flux and the element hierarchy with the
+radiance and importance on every element
+*/
+void
+monteCarloRadiosityWriteCheckpoint(RadianceCheckpoint *checkpoint, const java::ArrayList<Patch *> *scenePatches) {
+    const StochasticRelaxation *state = &GLOBAL_stochasticRaytracing_monteCarloRadiosityState;
+
+    // Options the element hierarchy depends on
+    checkpoint->writeInt(state->method);
+    checkpoint->writeInt(state->approximationOrderType);
+    checkpoint->writeInt(state->sequence);
+    checkpoint->writeInt(state->importanceDriven);
+    checkpoint->writeInt(GLOBAL_stochasticRaytracing_hierarchy.do_h_meshing);
+    checkpoint->writeInt(GLOBAL_stochasticRaytracing_hierarchy.clustering);
+
+    checkpoint->writeInt(state->currentIteration);
+    checkpoint->writeColor(state->unShotFlux);
+    checkpoint->writeColor(state->totalFlux);
+    checkpoint->writeColor(state->indirectImportanceWeightedUnShotFlux);
+    checkpoint->writeFloat(state->unShotYmp);
+    checkpoint->writeFloat(state->totalYmp);
+    checkpoint->writeFloat(state->sourceYmp);
+    checkpoint->writeColor(state->controlRadiance);
+    checkpoint->writeInt(state->setSource);
+    checkpoint->writeInt(state->importanceUpdated);
+    checkpoint->writeInt(state->importanceUpdatedFromScratch);
+    checkpoint->writeLong(state->initialNumberOfRays);
+    checkpoint->writeLong(state->raysPerIteration);
+    checkpoint->writeLong(state->importanceRaysPerIteration);
+    checkpoint->writeLong(state->tracedRays);
+    checkpoint->writeLong(state->prevTracedRays);
+    checkpoint->writeLong(state->importanceTracedRays);
+    checkpoint->writeLong(state->prevImportanceTracedRays);
+    checkpoint->writeLong(state->tracedPaths);
+    checkpoint->writeLong(state->numberOfMisses);
+    checkpoint->writeFloat(state->cpuSeconds);
+
+    java::ArrayList<StochasticRadiosityElement *> *clusters = new java::ArrayList<StochasticRadiosityElement *>();
+    monteCarloRadiosityCollectClusters(GLOBAL_stochasticRaytracing_hierarchy.topCluster, clusters);
+    checkpoint->writeInt((int)clusters->size());
+    for ( int i = 0; i < clusters->size(); i++ ) {
+        const StochasticRadiosityElement *cluster = clusters->get(i);
+        checkpoint->writeInt(cluster->irregularSubElements != nullptr ? (int)cluster->irregularSubElements->size() : 0);
+        monteCarloRadiosityWriteElement(checkpoint, cluster);
+    }
+    delete clusters;
+
+    for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
+        monteCarloRadiosityWriteSurfaceElement(checkpoint, topLevelStochasticRadiosityElement(scenePatches->get(i)));
+    }
+}
+
+/**
+Continues from the state written by monteCarloRadiosityWriteCheckpoint(), doing
+the initialisations otherwise delayed to the first iteration step first. Returns
+false, without changing the computed state, if the checkpoint was written with
+other options. Once the elements are being changed, a checkpoint that does not
+fit the scene is a fatal error
+*/
+bool
+monteCarloRadiosityReadCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, const RenderOptions *renderOptions) {
+    StochasticRelaxation *state = &GLOBAL_stochasticRaytracing_monteCarloRadiosityState;
+    monteCarloRadiosityReInit(scene, renderOptions);
+
+    bool sameOptions = checkpoint->readInt() == state->method;
+    sameOptions = checkpoint->readInt() == state->approximationOrderType && sameOptions;
+    sameOptions = checkpoint->readInt() == state->sequence && sameOptions;
+    sameOptions = checkpoint->readInt() == state->importanceDriven && sameOptions;
+    sameOptions = checkpoint->readInt() == GLOBAL_stochasticRaytracing_hierarchy.do_h_meshing && sameOptions;
+    sameOptions = checkpoint->readInt() == GLOBAL_stochasticRaytracing_hierarchy.clustering && sameOptions;
+    if ( !sameOptions || checkpoint->hasReadError() ) {
+        logWarning("monteCarloRadiosityReadCheckpoint", "The checkpoint was written with other options");
+        return false;
+    }
+
+    state->currentIteration = checkpoint->readInt();
+    state->unShotFlux = checkpoint->readColor();
+    state->totalFlux = checkpoint->readColor();
+    state->indirectImportanceWeightedUnShotFlux = checkpoint->readColor();
+    state->unShotYmp = checkpoint->readFloat();
+    state->totalYmp = checkpoint->readFloat();
+    state->sourceYmp = checkpoint->readFloat();
+    state->controlRadiance = checkpoint->readColor();
+    state->setSource = checkpoint->readInt();
+    state->importanceUpdated = checkpoint->readInt();
+    state->importanceUpdatedFromScratch = checkpoint->readInt();
+    state->initialNumberOfRays = (long)checkpoint->readLong();
+    state->raysPerIteration = (long)checkpoint->readLong();
+    state->importanceRaysPerIteration = (long)checkpoint->readLong();
+    state->tracedRays = (long)checkpoint->readLong();
+    state->prevTracedRays = (long)checkpoint->readLong();
+    state->importanceTracedRays = (long)checkpoint->readLong();
+    state->prevImportanceTracedRays = (long)checkpoint->readLong();
+    state->tracedPaths = (long)checkpoint->readLong();
+    state->numberOfMisses = (long)checkpoint->readLong();
+    state->cpuSeconds = checkpoint->readFloat();
+
+    java::ArrayList<StochasticRadiosityElement *> *clusters = new java::ArrayList<StochasticRadiosityElement *>();
+    monteCarloRadiosityCollectClusters(GLOBAL_stochasticRaytracing_hierarchy.topCluster, clusters);
+    if ( checkpoint->readInt() != clusters->size() ) {
+        logFatal(-1, "monteCarloRadiosityReadCheckpoint", "The checkpoint was written with another cluster hierarchy");
+    }
+    for ( int i = 0; i < clusters->size(); i++ ) {
+        StochasticRadiosityElement *cluster = clusters->get(i);
+        int numberOfChildren = cluster->irregularSubElements != nullptr ? (int)cluster->irregularSubElements->size() : 0;
+        if ( checkpoint->readInt() != numberOfChildren ) {
+            logFatal(-1, "monteCarloRadiosityReadCheckpoint", "Cluster %d does not match the checkpoint", cluster->id);
+        }
+        monteCarloRadiosityReadElement(checkpoint, cluster);
+    }
+    delete clusters;
+
+    for ( int i = 0; scene->patchList != nullptr && i < scene->patchList->size(); i++ ) {
+        monteCarloRadiosityReadSurfaceElement(checkpoint, topLevelStochasticRadiosityElement(scene->patchList->get(i)), renderOptions);
+    }
+
+    if ( checkpoint->hasReadError() ) {
+        logFatal(-1, "monteCarloRadiosityReadCheckpoint", "The checkpoint does not match the scene");
+    }
+    state->lastClock = clock();
+    return true;
+}
+
 static ColorRgb
 monteCarloRadiosityDiffuseReflectanceAtPoint(Patch *patch, double u, double v) {
     RayHit hit;
@@ -405,9 +613,9 @@ vertexReflectance(const Vertex *v) {
 
 static ColorRgb
 monteCarloRadiosityInterpolatedReflectanceAtPoint(const StochasticRadiosityElement *leaf, double u, double v) {
-    static const StochasticRadiosityElement *cachedLeaf = nullptr;
-    static ColorRgb vrd[4];
-    static ColorRgb rd;
+    static thread_local const StochasticRadiosityElement *cachedLeaf = nullptr;
+    static thread_local ColorRgb vrd[4];
+    static thread_local ColorRgb rd;
 
     if ( leaf != nullptr ) {
         if ( leaf != cachedLeaf ) {
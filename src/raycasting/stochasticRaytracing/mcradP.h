@@ -4,6 +4,7 @@
 
 #include "java/util/ArrayList.h"
 #include "scene/Scene.h"
+#include "io/RadianceCheckpoint.h"
 #include "raycasting/stochasticRaytracing/StochasticRadiosityElement.h"
 #include "raycasting/stochasticRaytracing/coefficientsmcrad.h"
 
@@ -48,6 +49,8 @@ extern void monteCarloRadiosityUpdateViewImportance(Scene *scene, const RenderOp
 extern void monteCarloRadiosityReInit(Scene *scene, const RenderOptions *renderOptions);
 extern void monteCarloRadiosityPreStep(Scene *scene, const RenderOptions *renderOptions);
 extern void monteCarloRadiosityTerminate(const java::ArrayList<Patch *> *scenePatches);
+extern void monteCarloRadiosityWriteCheckpoint(RadianceCheckpoint *checkpoint, const java::ArrayList<Patch *> *scenePatches);
+extern bool monteCarloRadiosityReadCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, const RenderOptions *renderOptions);
 extern ColorRgb monteCarloRadiosityGetRadiance(Patch *patch, double u, double v, Vector3D dir, const RenderOptions *renderOptions);
 extern void doNonDiffuseFirstShot(const Scene *scene, const RadianceMethod *radianceMethod, const RenderOptions *renderOptions);
 
@@ -100,7 +100,7 @@ sampleLightRay(Patch *patch, ColorRgb *emitted_rad, double *point_selection_pdf,
 }
 
 static void
-sampleLight(const VoxelGrid * sceneWorldVoxelGrid, LightSourceTable *light, double light_selection_pdf) {
+sampleLight(const AccelerationStructure * sceneWorldAccelerationStructure, LightSourceTable *light, double light_selection_pdf) {
     ColorRgb rad;
     double pointSelectionPdf;
     double dirSelectionPdf;
@@ -109,7 +109,7 @@ sampleLight(const VoxelGrid * sceneWorldVoxelGrid, LightSourceTable *light, doub
     const RayHit *hit;
 
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.tracedRays++;
-    hit = mcrShootRay(sceneWorldVoxelGrid, light->patch, &ray, &hitStore);
+    hit = mcrShootRay(sceneWorldAccelerationStructure, light->patch, &ray, &hitStore);
     if ( hit ) {
         double pdf = light_selection_pdf * pointSelectionPdf * dirSelectionPdf;
         double outCos = ray.dir.dotProduct(light->patch->normal);
@@ -125,7 +125,7 @@ sampleLight(const VoxelGrid * sceneWorldVoxelGrid, LightSourceTable *light, doub
 }
 
 static void
-sampleLightSources(const VoxelGrid *sceneWorldVoxelGrid, int numberOfSamples) {
+sampleLightSources(const AccelerationStructure *sceneWorldAccelerationStructure, int numberOfSamples) {
     double rnd = drand48();
     int count = 0;
     double pCumulative = 0.0;
@@ -138,7 +138,7 @@ sampleLightSources(const VoxelGrid *sceneWorldVoxelGrid, int numberOfSamples) {
                 (int) floor((pCumulative + p) * (double) globalNumberOfSamples + rnd) - count;
 
         for ( int j = 0; j < samples_this_light; j++ ) {
-            sampleLight(sceneWorldVoxelGrid, &globalLights[i], p);
+            sampleLight(sceneWorldAccelerationStructure, &globalLights[i], p);
         }
 
         pCumulative += p;
@@ -185,7 +185,7 @@ void
 doNonDiffuseFirstShot(const Scene *scene, const RadianceMethod *radianceMethod, const RenderOptions *renderOptions) {
     makeLightSourceTable(scene->patchList, scene->lightSourcePatchList);
     sampleLightSources(
-        scene->voxelGrid,
+        scene->accelerationStructure,
         GLOBAL_stochasticRaytracing_monteCarloRadiosityState.initialLightSourceSamples * globalNumberOfLights);
     summarize(scene->patchList);
 
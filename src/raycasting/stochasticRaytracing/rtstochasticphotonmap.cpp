@@ -75,12 +75,46 @@ StochasticRaytracingConfiguration::init(
     initDependentVars(lightList, radianceMethod);
 }
 
-void
-StochasticRaytracingConfiguration::initDependentVars(
-    const java::ArrayList<Patch *> *lightList,
-    const RadianceMethod *radianceMethod)
+/**
+Configuration for one thread of a tiled screen iteration: same options as the main
+configuration, with its own samplers and seeds. Screen additions are recorded on a
+splat list, to be replayed on the main configuration screen
+*/
+StochasticRaytracingConfiguration::StochasticRaytracingConfiguration(
+    const StochasticRaytracingConfiguration *mainConfiguration):
+    samplesPerPixel(mainConfiguration->samplesPerPixel),
+    nextEventSamples(mainConfiguration->nextEventSamples),
+    lightMode(mainConfiguration->lightMode),
+    radMode(mainConfiguration->radMode),
+    scatterSamples(mainConfiguration->scatterSamples),
+    firstDGSamples(mainConfiguration->firstDGSamples),
+    reflectionSampling(mainConfiguration->reflectionSampling),
+    separateSpecular(mainConfiguration->separateSpecular),
+    backgroundIndirect(mainConfiguration->backgroundIndirect),
+    backgroundDirect(mainConfiguration->backgroundDirect),
+    backgroundSampling(mainConfiguration->backgroundSampling),
+    screen(mainConfiguration->screen),
+    splats(new ScreenSplatList()),
+    samplerConfig(),
+    seedConfig(),
+    siStorage(mainConfiguration->siStorage),
+    siOthers(),
+    siOthersCount(mainConfiguration->siOthersCount),
+    initialReadout(mainConfiguration->initialReadout)
 {
-    // Sampler configuration
+    for ( int i = 0; i < siOthersCount; i++ ) {
+        siOthers[i] = mainConfiguration->siOthers[i];
+    }
+
+    samplerConfig.minDepth = mainConfiguration->samplerConfig.minDepth;
+    samplerConfig.maxDepth = mainConfiguration->samplerConfig.maxDepth;
+    initSamplers();
+
+    seedConfig.init(samplerConfig.maxDepth);
+}
+
+void
+StochasticRaytracingConfiguration::initSamplers() {
     samplerConfig.pointSampler = new CEyeSampler;
     samplerConfig.dirSampler = new CPixelSampler;
 
@@ -95,7 +129,7 @@ StochasticRaytracingConfiguration::initDependentVars(
             samplerConfig.surfaceSampler = new CSpecularSampler;
             break;
         default:
-            logError("SR CONFIG::initDependentVars", "Wrong sampling mode");
+            logError("SR CONFIG::initSamplers", "Wrong sampling mode");
     }
 
     if ( lightMode == RayTracingLightMode::IMPORTANT_LIGHTS ) {
@@ -103,7 +137,15 @@ StochasticRaytracingConfiguration::initDependentVars(
     } else {
         samplerConfig.neSampler = new UniformLightSampler;
     }
+}
 
+void
+StochasticRaytracingConfiguration::initDependentVars(
+    const java::ArrayList<Patch *> *lightList,
+    const RadianceMethod *radianceMethod)
+{
+    // Sampler configuration
+    initSamplers();
 
     // Scatter info blocks
     // Storage block
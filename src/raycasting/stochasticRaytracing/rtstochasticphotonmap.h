@@ -6,7 +6,9 @@
 #ifdef RAYTRACING_ENABLED
 
 #include "java/util/ArrayList.h"
+#include "common/ThreadRandom.h"
 #include "raycasting/raytracing/samplertools.h"
+#include "raycasting/raytracing/ScreenSplatList.h"
 #include "raycasting/stochasticRaytracing/StochasticRayTracingState.h"
 #include "raycasting/stochasticRaytracing/StorageReadout.h"
 
@@ -81,7 +83,7 @@ class CSeedConfig {
     void
     save(int depth) {
         // Save the seed (supply dummy seed to seed48())
-        m_seeds[depth].SetSeed(seed48(m_seeds[depth].GetSeed()));
+        m_seeds[depth].SetSeed(ThreadRandom::seed48(m_seeds[depth].GetSeed()));
 
         //Generate a new seed, dependent on the current seed
         CSeed tmpSeed{};
@@ -92,13 +94,13 @@ class CSeedConfig {
         // because the supplied random numbers *are* the (truncated) seeds
         tmpSeed.XORSeed(xOrSeed);
         // Set the new seed and drand48 once, to be sure
-        seed48(tmpSeed.GetSeed());
-        drand48();
+        ThreadRandom::seed48(tmpSeed.GetSeed());
+        ThreadRandom::nextDouble();
     }
 
     // Restores seed for a certain depth
     void Restore(int depth) {
-        seed48(m_seeds[depth].GetSeed());
+        ThreadRandom::seed48(m_seeds[depth].GetSeed());
     }
 };
 
@@ -150,6 +152,7 @@ class StochasticRaytracingConfiguration {
 
     // Independent variables
     ScreenBuffer *screen;
+    ScreenSplatList *splats; // Per thread configurations add to these instead of to the screen
 
     // Variables derived from user options
     // All variables must not change during raytracing...
@@ -195,6 +198,7 @@ public:
             backgroundDirect(),
             backgroundSampling(),
             screen(),
+            splats(),
             samplerConfig(),
             seedConfig(),
             siStorage(),
@@ -205,11 +209,15 @@ public:
         init(defaultCamera, state, lightList, radianceMethod);
     }
 
+    explicit StochasticRaytracingConfiguration(const StochasticRaytracingConfiguration *mainConfiguration);
+
     ~StochasticRaytracingConfiguration() {
         samplerConfig.releaseVars();
+        delete splats;
     };
 
 private:
+    void initSamplers();
     void initDependentVars(const java::ArrayList<Patch *> *lightList, const RadianceMethod *radianceMethod);
 };
 
@@ -12,6 +12,8 @@ TODO: global lines and global line bundles.
 
 #ifdef RAYTRACING_ENABLED
 
+#include <thread>
+
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
 #include "raycasting/stochasticRaytracing/mcradP.h"
@@ -34,6 +36,171 @@ static int globalDoControlVariate; // If uses a constant control variate
 static int globalNumberOfRays; // Number of rays to shoot in the iteration
 static double globalSumOfProbabilities = 0.0; // Sum of un-normalised sampling "probabilities"
 
+/**
+Radiance and importance received by the toplevel surface elements from the rays shot
+by one thread, indexed by patch id. Only used without hierarchical refinement, when
+every receiver is a toplevel surface element. Added to the elements when all threads
+are done, in thread order
+*/
+class StochasticJacobiThreadAccumulator {
+  public:
+    ColorRgb *receivedRadiance; // basisSize coefficients per patch id
+    float *receivedImportance;
+    int basisSize;
+    long tracedRays;
+    long importanceTracedRays;
+    long numberOfMisses;
+
+    StochasticJacobiThreadAccumulator(int numberOfPatchIds, int inBasisSize);
+    ~StochasticJacobiThreadAccumulator();
+};
+
+StochasticJacobiThreadAccumulator::StochasticJacobiThreadAccumulator(int numberOfPatchIds, int inBasisSize):
+    basisSize(inBasisSize),
+    tracedRays(),
+    importanceTracedRays(),
+    numberOfMisses()
+{
+    // ColorRgb default constructor leaves black
+    receivedRadiance = new ColorRgb[numberOfPatchIds * basisSize];
+    receivedImportance = new float[numberOfPatchIds];
+    for ( int i = 0; i < numberOfPatchIds; i++ ) {
+        receivedImportance[i] = 0.0;
+    }
+}
+
+StochasticJacobiThreadAccumulator::~StochasticJacobiThreadAccumulator() {
+    delete[] receivedRadiance;
+    delete[] receivedImportance;
+}
+
+// Accumulator of the calling thread, nullptr when the received values go directly to the elements
+static thread_local StochasticJacobiThreadAccumulator *globalThreadAccumulator = nullptr;
+
+/**
+Leaf elements to shoot rays from, and the number of rays for each one. Threads
+take contiguous ranges of leaves with about the same number of rays
+*/
+class StochasticJacobiShootingJob {
+  public:
+    AccelerationStructure *sceneWorldAccelerationStructure;
+    RenderOptions *renderOptions;
+    java::ArrayList<StochasticRadiosityElement *> leaves;
+    java::ArrayList<int> raysPerLeaf;
+    int *firstLeaf; // One per thread plus one, range of thread i is [firstLeaf[i], firstLeaf[i + 1])
+    StochasticJacobiThreadAccumulator **accumulators; // One per thread
+
+    StochasticJacobiShootingJob(): sceneWorldAccelerationStructure(), renderOptions(), firstLeaf(), accumulators() {}
+};
+
+/**
+The element hierarchy below the top cluster flattened into arrays, depth first and
+with the children in the order of Element::traverseAllChildren(). The setup pass
+and the push-update-pull sweep of every iteration are loops over these arrays
+instead of recursive traversals through callbacks: pre-order to push received
+radiance down to the leaves, post-order to pull the new radiance up. The order
+is only built again when elements were created or destroyed since, see
+ElementHierarchyState::structureVersion
+
+The radiance, importance and area of the leaves stay in the elements rather
+than being copied to arrays in this order: the update of a leaf reads them right
+after the reflect callback wrote them, and the sampling pass gets the radiance
+through a callback that differs per caller
+*/
+class StochasticJacobiElementOrder {
+  public:
+    StochasticRadiosityElement **elements; // Pre-order
+    int *parentIndex; // Position of the parent in elements, -1 for the top cluster
+    int *postOrder; // Positions in elements, every element after its children
+    bool *isLeaf;
+    int numberOfElements;
+    int capacity;
+    long structureVersion; // Of the hierarchy the order was built for
+
+    StochasticJacobiElementOrder():
+        elements(), parentIndex(), postOrder(), isLeaf(), numberOfElements(), capacity(), structureVersion(-1) {}
+    ~StochasticJacobiElementOrder();
+
+    void update();
+
+  private:
+    void grow();
+    void add(StochasticRadiosityElement *element, int parent, int *numberInPostOrder);
+};
+
+StochasticJacobiElementOrder::~StochasticJacobiElementOrder() {
+    delete[] elements;
+    delete[] parentIndex;
+    delete[] postOrder;
+    delete[] isLeaf;
+}
+
+void
+StochasticJacobiElementOrder::grow() {
+    int newCapacity = java::Math::max(2 * capacity, (int)GLOBAL_stochasticRaytracing_hierarchy.nr_elements + 1);
+    StochasticRadiosityElement **newElements = new StochasticRadiosityElement *[newCapacity];
+    int *newParentIndex = new int[newCapacity];
+    int *newPostOrder = new int[newCapacity];
+    bool *newIsLeaf = new bool[newCapacity];
+    for ( int i = 0; i < numberOfElements; i++ ) {
+        newElements[i] = elements[i];
+        newParentIndex[i] = parentIndex[i];
+        newPostOrder[i] = postOrder[i];
+        newIsLeaf[i] = isLeaf[i];
+    }
+    delete[] elements;
+    delete[] parentIndex;
+    delete[] postOrder;
+    delete[] isLeaf;
+    elements = newElements;
+    parentIndex = newParentIndex;
+    postOrder = newPostOrder;
+    isLeaf = newIsLeaf;
+    capacity = newCapacity;
+}
+
+void
+StochasticJacobiElementOrder::add(StochasticRadiosityElement *element, int parent, int *numberInPostOrder) {
+    if ( numberOfElements == capacity ) {
+        grow();
+    }
+    int index = numberOfElements++;
+    elements[index] = element;
+    parentIndex[index] = parent;
+    isLeaf[index] = element->isLeaf();
+
+    if ( element->isCluster() ) {
+        for ( int i = 0; element->irregularSubElements != nullptr && i < element->irregularSubElements->size(); i++ ) {
+            add((StochasticRadiosityElement *)element->irregularSubElements->get(i), index, numberInPostOrder);
+        }
+    } else if ( element->regularSubElements != nullptr ) {
+        for ( int i = 0; i < 4; i++ ) {
+            if ( element->regularSubElements[i] != nullptr ) {
+                add((StochasticRadiosityElement *)element->regularSubElements[i], index, numberInPostOrder);
+            }
+        }
+    }
+    postOrder[(*numberInPostOrder)++] = index;
+}
+
+/**
+Builds the order again if the hierarchy changed
+*/
+void
+StochasticJacobiElementOrder::update() {
+    if ( structureVersion == GLOBAL_stochasticRaytracing_hierarchy.structureVersion ) {
+        return;
+    }
+    numberOfElements = 0;
+    int numberInPostOrder = 0;
+    if ( GLOBAL_stochasticRaytracing_hierarchy.topCluster != nullptr ) {
+        add(GLOBAL_stochasticRaytracing_hierarchy.topCluster, -1, &numberInPostOrder);
+    }
+    structureVersion = GLOBAL_stochasticRaytracing_hierarchy.structureVersion;
+}
+
+static StochasticJacobiElementOrder globalElementOrder;
+
 static void
 stochasticJacobiInitGlobals(
     int numberOfRays,
@@ -137,30 +304,27 @@ stochasticJacobiElementClearAccumulators(StochasticRadiosityElement *elem) {
 
 /**
 Clears received radiance and importance and accumulates the un-normalized
-sampling probabilities at leaf elements
+sampling probabilities at leaf elements. The probability of sampling a non-leaf
+element is the sum of the probabilities of sampling its sub-elements
 */
 static void
-stochasticJacobiElementSetup(Element *element) {
-    StochasticRadiosityElement *stochasticRadiosityElement = (StochasticRadiosityElement *)element;
-
-    if ( stochasticRadiosityElement == nullptr ) {
-        return;
+stochasticJacobiElementSetup(const StochasticJacobiElementOrder *order) {
+    for ( int i = 0; i < order->numberOfElements; i++ ) {
+        order->elements[i]->samplingProbability = 0.0;
     }
 
-    stochasticRadiosityElement->samplingProbability = 0.0;
-    if ( !stochasticRadiosityElement->traverseAllChildren(stochasticJacobiElementSetup) ) {
-        // Elem is a leaf element. We need to compute the sum of the un-normalized
-        // sampling "probabilities" at the leaf elements
-        stochasticRadiosityElement->samplingProbability = (float)stochasticJacobiProbability(stochasticRadiosityElement);
-        globalSumOfProbabilities += stochasticRadiosityElement->samplingProbability;
-    }
-    if ( stochasticRadiosityElement->parent ) {
-        // The probability of sampling a non-leaf element is the sum of the
-        // probabilities of sampling the sub-elements
-        ((StochasticRadiosityElement *)stochasticRadiosityElement->parent)->samplingProbability += stochasticRadiosityElement->samplingProbability;
+    for ( int k = 0; k < order->numberOfElements; k++ ) {
+        int i = order->postOrder[k];
+        StochasticRadiosityElement *element = order->elements[i];
+        if ( order->isLeaf[i] ) {
+            element->samplingProbability = (float)stochasticJacobiProbability(element);
+            globalSumOfProbabilities += element->samplingProbability;
+        }
+        if ( order->parentIndex[i] >= 0 ) {
+            order->elements[order->parentIndex[i]]->samplingProbability += element->samplingProbability;
+        }
+        stochasticJacobiElementClearAccumulators(element);
     }
-
-    stochasticJacobiElementClearAccumulators(stochasticRadiosityElement);
 }
 
 /**
@@ -175,7 +339,8 @@ stochasticJacobiSetup(const java::ArrayList<Patch *> *scenePatches) {
     }
 
     globalSumOfProbabilities = 0.0;
-    stochasticJacobiElementSetup(GLOBAL_stochasticRaytracing_hierarchy.topCluster);
+    globalElementOrder.update();
+    stochasticJacobiElementSetup(&globalElementOrder);
 
     if ( globalSumOfProbabilities < Numeric::EPSILON * Numeric::EPSILON ) {
         logWarning("Iteration", "No sources");
@@ -203,10 +368,15 @@ stochasticJacobiPropagateRadianceToSurface(
     double fraction,
     double /*weight*/)
 {
+    ColorRgb *receivedRadiance = rcv->receivedRadiance;
+    if ( globalThreadAccumulator != nullptr ) {
+        receivedRadiance = globalThreadAccumulator->receivedRadiance + rcv->patch->id * globalThreadAccumulator->basisSize;
+    }
+
     for ( int i = 0; i < rcv->basis->size; i++ ) {
         double dual = rcv->basis->dualFunction[i](ur, vr) / rcv->area;
         double w = dual * fraction / (double) globalNumberOfRays;
-        rcv->receivedRadiance[i].addScaled(rcv->receivedRadiance[i], (float) w, rayPower);
+        receivedRadiance[i].addScaled(receivedRadiance[i], (float) w, rayPower);
     }
 }
 
@@ -386,8 +556,13 @@ stochasticJacobiPropagateImportance(
     const Ray * /*ray*/,
     float /*dir*/)
 {
+    float *receivedImportance = &rcv->receivedImportance;
+    if ( globalThreadAccumulator != nullptr ) {
+        receivedImportance = globalThreadAccumulator->receivedImportance + rcv->patch->id;
+    }
+
     double w = globalSumOfProbabilities / (src_prob + rcv_prob) / rcv->area / (double) globalNumberOfRays;
-    rcv->receivedImportance += (float)(w * stochasticRadiosityElementScalarReflectance(src) * globalGetImportanceCallback(src));
+    *receivedImportance += (float)(w * stochasticRadiosityElementScalarReflectance(src) * globalGetImportanceCallback(src));
 
     if ( GLOBAL_stochasticRaytracing_hierarchy.do_h_meshing ||
          GLOBAL_stochasticRaytracing_hierarchy.clustering != HierarchyClusteringMode::NO_CLUSTERING ) {
@@ -556,19 +731,29 @@ hit patch (and back for bidirectional transfers)
 */
 static void
 stochasticJacobiElementShootRay(
-    const VoxelGrid * sceneWorldVoxelGrid,
+    const AccelerationStructure * sceneWorldAccelerationStructure,
     StochasticRadiosityElement *src,
     int nMostSignificantBit,
     NiederreiterIndex mostSignificantBit1,
     NiederreiterIndex rMostSignificantBit2,
     const RenderOptions *renderOptions)
 {
+    long *tracedRays = &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.tracedRays;
+    long *importanceTracedRays = &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays;
+    long *numberOfMisses = &GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfMisses;
+
+    if ( globalThreadAccumulator != nullptr ) {
+        tracedRays = &globalThreadAccumulator->tracedRays;
+        importanceTracedRays = &globalThreadAccumulator->importanceTracedRays;
+        numberOfMisses = &globalThreadAccumulator->numberOfMisses;
+    }
+
     if ( globalGetRadianceCallback != nullptr ) {
-        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.tracedRays++;
+        (*tracedRays)++;
     }
 
     if ( globalGetImportanceCallback != nullptr ) {
-        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays++;
+        (*importanceTracedRays)++;
     }
 
     double zeta[4];
@@ -576,7 +761,7 @@ stochasticJacobiElementShootRay(
                                stochasticJacobiNextSample(src, nMostSignificantBit, mostSignificantBit1, rMostSignificantBit2, zeta));
 
     RayHit hitStore;
-    const RayHit *hit = mcrShootRay(sceneWorldVoxelGrid, src->patch, &ray, &hitStore);
+    const RayHit *hit = mcrShootRay(sceneWorldAccelerationStructure, src->patch, &ray, &hitStore);
 
     if ( hit ) {
         double uHit = 0.0;
@@ -585,7 +770,7 @@ stochasticJacobiElementShootRay(
         stochasticJacobiRefineAndPropagate(topLevelStochasticRadiosityElement(src->patch), zeta[0], zeta[1],
                                            topLevelStochasticRadiosityElement(hit->getPatch()), uHit, vHit, &ray, renderOptions);
     } else {
-        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfMisses++;
+        (*numberOfMisses)++;
     }
 }
 
@@ -606,7 +791,7 @@ Determines nr of rays to shoot from element and shoots this number of rays
 */
 static void
 stochasticJacobiElementShootRays(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     StochasticRadiosityElement *element,
     int raysThisElem,
     const RenderOptions *renderOptions)
@@ -620,7 +805,7 @@ stochasticJacobiElementShootRays(
 
     // Shoot the rays
     for ( int i = 0; i < raysThisElem; i++ ) {
-        stochasticJacobiElementShootRay(sceneWorldVoxelGrid, element, sampleRange, mostSignificantBit1, rMostSignificantBit2, renderOptions);
+        stochasticJacobiElementShootRay(sceneWorldAccelerationStructure, element, sampleRange, mostSignificantBit1, rMostSignificantBit2, renderOptions);
     }
 
     if ( element != nullptr && !element->isLeaf() ) {
@@ -631,7 +816,7 @@ stochasticJacobiElementShootRays(
 
 static void
 stochasticJacobiShootRaysRecursive(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     StochasticRadiosityElement *element,
     double rnd,
     long *rayCount,
@@ -644,7 +829,7 @@ stochasticJacobiShootRaysRecursive(
                 (long)java::Math::floor((*cumulative + p) * (double) globalNumberOfRays + rnd) - *rayCount;
 
         if ( rays_this_leaf > 0 ) {
-            stochasticJacobiElementShootRays(sceneWorldVoxelGrid, element, (int)rays_this_leaf, renderOptions);
+            stochasticJacobiElementShootRays(sceneWorldAccelerationStructure, element, (int)rays_this_leaf, renderOptions);
         }
 
         *cumulative += p;
@@ -653,7 +838,7 @@ stochasticJacobiShootRaysRecursive(
         // Recursive case
         for ( int i = 0; i < 4; i++ ) {
             stochasticJacobiShootRaysRecursive(
-                sceneWorldVoxelGrid,
+                sceneWorldAccelerationStructure,
                 (StochasticRadiosityElement *)element->regularSubElements[i],
                 rnd,
                 rayCount,
@@ -663,12 +848,165 @@ stochasticJacobiShootRaysRecursive(
     }
 }
 
+/**
+Same ray distribution over the leaf elements as stochasticJacobiShootRaysRecursive(),
+but the rays are only counted: leaves with rays to shoot are appended to the job
+*/
+static void
+stochasticJacobiCollectLeavesRecursive(
+    StochasticJacobiShootingJob *job,
+    StochasticRadiosityElement *element,
+    double rnd,
+    long *rayCount,
+    double *cumulative)
+{
+    if ( element->regularSubElements == nullptr ) {
+        // Trivial case
+        double p = element->samplingProbability / globalSumOfProbabilities;
+        long rays_this_leaf =
+                (long)java::Math::floor((*cumulative + p) * (double) globalNumberOfRays + rnd) - *rayCount;
+
+        if ( rays_this_leaf > 0 ) {
+            job->leaves.add(element);
+            job->raysPerLeaf.add((int)rays_this_leaf);
+        }
+
+        *cumulative += p;
+        *rayCount += rays_this_leaf;
+    } else {
+        // Recursive case
+        for ( int i = 0; i < 4; i++ ) {
+            stochasticJacobiCollectLeavesRecursive(
+                job,
+                (StochasticRadiosityElement *)element->regularSubElements[i],
+                rnd,
+                rayCount,
+                cumulative);
+        }
+    }
+}
+
+static void
+stochasticJacobiShootRaysWorker(StochasticJacobiShootingJob *job, int threadIndex) {
+    globalThreadAccumulator = job->accumulators[threadIndex];
+    for ( int i = job->firstLeaf[threadIndex]; i < job->firstLeaf[threadIndex + 1]; i++ ) {
+        stochasticJacobiElementShootRays(
+            job->sceneWorldAccelerationStructure,
+            job->leaves.get(i),
+            job->raysPerLeaf.get(i),
+            job->renderOptions);
+    }
+    globalThreadAccumulator = nullptr;
+}
+
+/**
+Threads can only be used when the element hierarchy is not refined while shooting,
+so every ray only changes the received radiance or importance of toplevel surface
+elements and the ray index of the leaf it is shot from
+*/
+static bool
+stochasticJacobiCanUseThreads() {
+    return GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads > 1
+        && !GLOBAL_stochasticRaytracing_hierarchy.do_h_meshing;
+}
+
+/**
+Shoots the rays on GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads
+threads (the calling one included). Each leaf element gets the same rays as in a
+single threaded iteration
+*/
+static void
+stochasticJacobiShootRaysThreaded(
+    AccelerationStructure *sceneWorldAccelerationStructure,
+    const java::ArrayList<Patch *> *scenePatches,
+    double rnd,
+    RenderOptions *renderOptions)
+{
+    StochasticJacobiShootingJob job;
+    long rayCount = 0;
+    double cumulative = 0.0;
+
+    job.sceneWorldAccelerationStructure = sceneWorldAccelerationStructure;
+    job.renderOptions = renderOptions;
+    for ( int i = 0; i < scenePatches->size(); i++ ) {
+        stochasticJacobiCollectLeavesRecursive(
+            &job,
+            topLevelStochasticRadiosityElement(scenePatches->get(i)),
+            rnd,
+            &rayCount,
+            &cumulative);
+    }
+
+    int numberOfThreads = GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads;
+    numberOfThreads = java::Math::max(1, java::Math::min(numberOfThreads, (int)job.leaves.size()));
+
+    // Split the leaves in ranges with about the same number of rays
+    job.firstLeaf = new int[numberOfThreads + 1];
+    job.firstLeaf[0] = 0;
+    int leaf = 0;
+    long raysSoFar = 0;
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        long target = rayCount * i / numberOfThreads;
+        while ( leaf < job.leaves.size() && raysSoFar < target ) {
+            raysSoFar += job.raysPerLeaf.get(leaf);
+            leaf++;
+        }
+        job.firstLeaf[i] = leaf;
+    }
+    job.firstLeaf[numberOfThreads] = (int)job.leaves.size();
+
+    int numberOfPatchIds = Patch::getNextId();
+    int basisSize = GLOBAL_stochasticRadiosity_approxDesc[GLOBAL_stochasticRaytracing_monteCarloRadiosityState.approximationOrderType].basis_size;
+    job.accumulators = new StochasticJacobiThreadAccumulator *[numberOfThreads];
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        job.accumulators[i] = new StochasticJacobiThreadAccumulator(numberOfPatchIds, basisSize);
+    }
+
+    std::thread **workers = new std::thread *[numberOfThreads];
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i] = new std::thread(stochasticJacobiShootRaysWorker, &job, i);
+    }
+    stochasticJacobiShootRaysWorker(&job, 0);
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    delete[] workers;
+
+    // Reduce the accumulators on the toplevel surface elements, always in thread order
+    for ( int i = 0; i < numberOfThreads; i++ ) {
+        const StochasticJacobiThreadAccumulator *accumulator = job.accumulators[i];
+
+        for ( int j = 0; j < scenePatches->size(); j++ ) {
+            StochasticRadiosityElement *element = topLevelStochasticRadiosityElement(scenePatches->get(j));
+            const ColorRgb *received = accumulator->receivedRadiance + element->patch->id * basisSize;
+
+            if ( globalGetRadianceCallback ) {
+                for ( int k = 0; k < element->basis->size; k++ ) {
+                    element->receivedRadiance[k].add(element->receivedRadiance[k], received[k]);
+                }
+            }
+            if ( globalGetImportanceCallback ) {
+                element->receivedImportance += accumulator->receivedImportance[element->patch->id];
+            }
+        }
+
+        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.tracedRays += accumulator->tracedRays;
+        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceTracedRays += accumulator->importanceTracedRays;
+        GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfMisses += accumulator->numberOfMisses;
+        delete accumulator;
+    }
+
+    delete[] job.accumulators;
+    delete[] job.firstLeaf;
+}
+
 /**
 Fire off rays from the leaf elements, propagate radiance/importance
 */
 static void
 stochasticJacobiShootRays(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     const java::ArrayList<Patch *> *scenePatches,
     RenderOptions *renderOptions)
 {
@@ -676,10 +1014,16 @@ stochasticJacobiShootRays(
     long rayCount = 0;
     double cumulative = 0.0;
 
+    if ( scenePatches != nullptr && stochasticJacobiCanUseThreads() ) {
+        stochasticJacobiShootRaysThreaded(sceneWorldAccelerationStructure, scenePatches, rnd, renderOptions);
+        fprintf(stderr, "\n");
+        return;
+    }
+
     // Loop over all leaf elements in the element hierarchy
     for ( int i = 0; scenePatches != nullptr && i < scenePatches->size(); i++ ) {
         stochasticJacobiShootRaysRecursive(
-            sceneWorldVoxelGrid,
+            sceneWorldAccelerationStructure,
             topLevelStochasticRadiosityElement(scenePatches->get(i)),
             rnd,
             &rayCount,
@@ -771,54 +1115,67 @@ stochasticJacobiClearElement(StochasticRadiosityElement *parent) {
     }
 }
 
-static void stochasticJacobiPushUpdatePull(Element *elem);
-
-static void
-stochasticJacobiPushUpdatePullChild(Element *element) {
-    StochasticRadiosityElement *child = (StochasticRadiosityElement *)element;
-    StochasticRadiosityElement *parent = (StochasticRadiosityElement *)child->parent;
-    stochasticJacobiPush(parent, child);
-    stochasticJacobiPushUpdatePull(child);
-    stochasticJacobiPull(parent, child);
+/**
+Averages reflectance and self-emitted radiance of the sub-elements on clusters and
+on textured surface elements (refinement yields more accurate estimates on textured
+surfaces)
+*/
+static bool
+stochasticJacobiPullsRdEd(const StochasticRadiosityElement *element) {
+    return element->isCluster() || stochasticRadiosityElementIsTextured(element);
 }
 
 static void
-stochasticJacobiPushUpdatePull(Element *element) {
-    StochasticRadiosityElement *stochasticRadiosityElement = (StochasticRadiosityElement *)element;
-    if ( stochasticRadiosityElement != nullptr && stochasticRadiosityElement->isLeaf() ) {
-        stochasticJacobiUpdateElement(stochasticRadiosityElement);
-    } else if ( element != nullptr ) {
-        // Not a leaf element
-        stochasticJacobiClearElement(stochasticRadiosityElement);
-        element->traverseAllChildren(stochasticJacobiPushUpdatePullChild);
+stochasticJacobiPullRdEd(const StochasticJacobiElementOrder *order) {
+    for ( int i = 0; i < order->numberOfElements; i++ ) {
+        StochasticRadiosityElement *element = order->elements[i];
+        if ( !order->isLeaf[i] && stochasticJacobiPullsRdEd(element) ) {
+            element->Ed.clear();
+            element->Rd.clear();
+        }
     }
-}
-
-static void
-stochasticJacobiPullRdEd(StochasticRadiosityElement *element);
 
-static void
-stochasticJacobiPullRdEdFromChild(Element *element) {
-    StochasticRadiosityElement *child = (StochasticRadiosityElement *)element;
-    StochasticRadiosityElement *parent = (StochasticRadiosityElement *)child->parent;
-
-    stochasticJacobiPullRdEd(child);
-
-    parent->Ed.addScaled(parent->Ed, child->area / parent->area, child->Ed);
-    parent->Rd.addScaled(parent->Rd, child->area / parent->area, child->Rd);
-    if ( parent->isCluster() )
-        parent->Rd.setMonochrome(1.0);
+    for ( int k = 0; k < order->numberOfElements; k++ ) {
+        int i = order->postOrder[k];
+        if ( order->parentIndex[i] < 0 ) {
+            continue;
+        }
+        const StochasticRadiosityElement *child = order->elements[i];
+        StochasticRadiosityElement *parent = order->elements[order->parentIndex[i]];
+        if ( stochasticJacobiPullsRdEd(parent) ) {
+            parent->Ed.addScaled(parent->Ed, child->area / parent->area, child->Ed);
+            parent->Rd.addScaled(parent->Rd, child->area / parent->area, child->Rd);
+            if ( parent->isCluster() ) {
+                parent->Rd.setMonochrome(1.0);
+            }
+        }
+    }
 }
 
+/**
+Pushes received radiance and importance down to the leaf elements, converts them
+into new total and un-shot radiance and importance there and pulls these up again
+*/
 static void
-stochasticJacobiPullRdEd(StochasticRadiosityElement *element) {
-    if ( element == nullptr || element->isLeaf() || (!element->isCluster() && !stochasticRadiosityElementIsTextured(element)) ) {
-        return;
+stochasticJacobiPushUpdatePull(const StochasticJacobiElementOrder *order) {
+    for ( int i = 0; i < order->numberOfElements; i++ ) {
+        StochasticRadiosityElement *element = order->elements[i];
+        if ( order->parentIndex[i] >= 0 ) {
+            stochasticJacobiPush(order->elements[order->parentIndex[i]], element);
+        }
+        if ( order->isLeaf[i] ) {
+            stochasticJacobiUpdateElement(element);
+        } else {
+            stochasticJacobiClearElement(element);
+        }
     }
 
-    element->Ed.clear();
-    element->Rd.clear();
-    element->traverseAllChildren(stochasticJacobiPullRdEdFromChild);
+    for ( int k = 0; k < order->numberOfElements; k++ ) {
+        int i = order->postOrder[k];
+        if ( order->parentIndex[i] >= 0 ) {
+            stochasticJacobiPull(order->elements[order->parentIndex[i]], order->elements[i]);
+        }
+    }
 }
 
 static void
@@ -830,11 +1187,11 @@ stochasticJacobiPushUpdatePullSweep() {
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.totalYmp = 0.0;
     GLOBAL_stochasticRaytracing_monteCarloRadiosityState.indirectImportanceWeightedUnShotFlux.clear();
 
-    // Update reflectances and emittances (refinement yields more accurate estimates
-    // on textured surfaces)
-    stochasticJacobiPullRdEd(GLOBAL_stochasticRaytracing_hierarchy.topCluster);
+    // Shooting the rays may have refined the hierarchy
+    globalElementOrder.update();
 
-    stochasticJacobiPushUpdatePull(GLOBAL_stochasticRaytracing_hierarchy.topCluster);
+    stochasticJacobiPullRdEd(&globalElementOrder);
+    stochasticJacobiPushUpdatePull(&globalElementOrder);
 }
 
 /**
@@ -853,6 +1210,7 @@ The operation of this routine is further controlled by global parameters
 - GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceDriven: importance-driven radiance propagation
 - GLOBAL_stochasticRaytracing_monteCarloRadiosityState.radianceDriven: radiance-driven importance propagation
 - hierarchy.do_h_meshing, hierarchy.clustering: hierarchical refinement/clustering
+- GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads: threads shooting rays (without hierarchical refinement only)
 
 This routine updates global ray counts and total/un-shot power/importance statistics.
 
@@ -861,7 +1219,7 @@ propagation of importance and radiance does not work yet.
 */
 void
 doStochasticJacobiIteration(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     long numberOfRays,
     ColorRgb *(*getRadianceCallBack)(const StochasticRadiosityElement *),
     float (*getImportanceCallBack)(const StochasticRadiosityElement *),
@@ -874,7 +1232,7 @@ doStochasticJacobiIteration(
     if ( !stochasticJacobiSetup(scenePatches) ) {
         return;
     }
-    stochasticJacobiShootRays(sceneWorldVoxelGrid, scenePatches, renderOptions);
+    stochasticJacobiShootRays(sceneWorldAccelerationStructure, scenePatches, renderOptions);
     stochasticJacobiPushUpdatePullSweep();
 }
 
@@ -19,6 +19,7 @@ The operation of this routine is further controlled by global parameters
 - GLOBAL_stochasticRaytracing_monteCarloRadiosityState.importanceDriven: importance-driven radiance propagation
 - GLOBAL_stochasticRaytracing_monteCarloRadiosityState.radianceDriven: radiance-driven importance propagation
 - hierarchy.do_h_meshing, hierarchy.clustering: hierarchical refinement/clustering
+- GLOBAL_stochasticRaytracing_monteCarloRadiosityState.numberOfThreads: threads shooting rays (without hierarchical refinement only)
 
 This routine updates global ray counts and total/un-shot power/importance statistics.
 
@@ -27,7 +28,7 @@ propagation of importance and radiance does not work yet.
 */
 extern void
 doStochasticJacobiIteration(
-    VoxelGrid *sceneWorldVoxelGrid,
+    AccelerationStructure *sceneWorldAccelerationStructure,
     long numberOfRays,
     ColorRgb *(*getRadianceCallBack)(const StochasticRadiosityElement *),
     float (*getImportanceCallBack)(const StochasticRadiosityElement *),
@@ -92,7 +92,7 @@ when no longer needed
 */
 static PATH *
 tracePath(
-    const VoxelGrid * sceneWorldVoxelGrid,
+    const AccelerationStructure * sceneWorldAccelerationStructure,
     Patch *origin,
     double birth_prob,
     double (*survivalProbabilityCallBack)(const Patch *P),
@@ -119,7 +119,7 @@ tracePath(
         }
         path->nodes[path->numberOfNodes - 1].outpoint = ray.pos;
 
-        hit = mcrShootRay(sceneWorldVoxelGrid, P, &ray, &hitStore);
+        hit = mcrShootRay(sceneWorldAccelerationStructure, P, &ray, &hitStore);
         if ( !hit ) {
             // Path disappears into background
             break;
@@ -143,7 +143,7 @@ Traces 'numberOfPaths' paths with given birth probabilities
 */
 void
 tracePaths(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     long numberOfPaths,
     double (*birthProbabilityCallBack)(const Patch *P),
     double (*survivalProbabilityCallBack)(const Patch *P),
@@ -181,7 +181,7 @@ tracePaths(
         double p = birthProbabilityCallBack(patch) / globalSumProbabilities;
         long paths_this_patch = (int)java::Math::floor((pCumulative + p) * (double) numberOfPaths + rnd) - pathCount;
         for ( int j = 0; j < paths_this_patch; j++ ) {
-            tracePath(sceneWorldVoxelGrid, patch, p, survivalProbabilityCallBack, &path);
+            tracePath(sceneWorldAccelerationStructure, patch, p, survivalProbabilityCallBack, &path);
             scorePathCallBack(&path, numberOfPaths, patchNormalisedBirthProbability);
         }
         pCumulative += p;
@@ -34,7 +34,7 @@ class PATH {
 
 extern void
 tracePaths(
-    const VoxelGrid *sceneWorldVoxelGrid,
+    const AccelerationStructure *sceneWorldAccelerationStructure,
     long numberOfPaths,
     double (*birthProbabilityCallBack)(const Patch *P),
     double (*survivalProbabilityCallBack)(const Patch *P),
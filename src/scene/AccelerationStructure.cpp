@@ -0,0 +1,27 @@
+#include "skin/Patch.h"
+#include "scene/AccelerationStructure.h"
+
+AccelerationStructure::AccelerationStructure() {
+}
+
+AccelerationStructure::~AccelerationStructure() {
+}
+
+int
+AccelerationStructure::intersectPacket(RayPacket *packet, const int hitFlags) const {
+    int numberOfHits = 0;
+    for ( int i = 0; i < packet->size; i++ ) {
+        Patch *previous = Patch::setLastExcludedPatch(packet->excludedPatch[i]);
+        packet->hit[i] = intersect(
+            &packet->rays[i],
+            packet->minimumDistance[i],
+            &packet->maximumDistance[i],
+            hitFlags,
+            &packet->hitStore[i]);
+        Patch::setLastExcludedPatch(previous);
+        if ( packet->hit[i] != nullptr ) {
+            numberOfHits++;
+        }
+    }
+    return numberOfHits;
+}
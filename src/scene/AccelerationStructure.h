@@ -0,0 +1,45 @@
+#ifndef __ACCELERATION_STRUCTURE__
+#define __ACCELERATION_STRUCTURE__
+
+#include "common/Ray.h"
+#include "material/RayHit.h"
+#include "scene/RayPacket.h"
+
+/**
+Scene level ray intersection accelerator. Every ray caster, local line shooter and
+visibility test traces its rays through this interface, so the concrete structure
+(uniform voxel grid or bounding volume hierarchy) can be chosen on each run
+*/
+class AccelerationStructure {
+  public:
+    AccelerationStructure();
+    virtual ~AccelerationStructure();
+
+    /**
+    Returns the nearest intersection of the ray with the scene patches between
+    minimumDistance and *maximumDistance, or nullptr if there is none. On a hit,
+    *maximumDistance is set to the distance to the hit point. The hitFlags have the
+    same meaning as for Patch::intersect(); when RayHitFlag::ANY is set, any hit
+    may be returned instead of the nearest one
+    */
+    virtual RayHit *
+    intersect(
+        Ray *ray,
+        float minimumDistance,
+        float *maximumDistance,
+        int hitFlags,
+        RayHit *hitStore) const = 0;
+
+    /**
+    Intersects all rays of the packet, each one between its minimumDistance and
+    maximumDistance and skipping its own excludedPatch, and leaves the results on
+    packet->hit[] and packet->maximumDistance[]. The hitFlags are the same for all
+    rays. Returns how many rays hit something. This default version traces the rays
+    one by one; structures that can share work between the rays override it
+    */
+    virtual int intersectPacket(RayPacket *packet, int hitFlags) const;
+
+    virtual void print() const = 0;
+};
+
+#endif
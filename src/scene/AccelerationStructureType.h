@@ -0,0 +1,9 @@
+#ifndef __ACCELERATION_STRUCTURE_TYPE__
+#define __ACCELERATION_STRUCTURE_TYPE__
+
+enum AccelerationStructureType {
+    VOXEL_GRID,
+    BOUNDING_VOLUME_HIERARCHY
+};
+
+#endif
@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __SSE__
+    #include <xmmintrin.h>
+#endif
+
+#include "java/lang/Math.h"
+#include "common/linealAlgebra/Numeric.h"
+#include "java/util/ArrayList.txx"
+#include "skin/PatchIntersectionRecords.h"
+#include "scene/BoundingVolumeHierarchy.h"
+
+/**
+Inverse direction components are clamped to this magnitude, so rays parallel to a
+slab do not produce infinities (this code is compiled with -ffast-math)
+*/
+static const float MAXIMUM_INVERSE_DIRECTION = 1e20f;
+
+// Relative costs of a node traversal step and a ray-patch test, for the surface area heuristic
+static const float TRAVERSAL_COST = 1.0f;
+static const float INTERSECTION_COST = 1.0f;
+
+static inline float
+axisValue(const Vector3D *v, const int axis) {
+    if ( axis == 0 ) {
+        return v->x;
+    }
+    return axis == 1 ? v->y : v->z;
+}
+
+static inline float
+inverseDirection(const float d) {
+    if ( d > -1.0f / MAXIMUM_INVERSE_DIRECTION && d < 1.0f / MAXIMUM_INVERSE_DIRECTION ) {
+        return d < 0.0f ? -MAXIMUM_INVERSE_DIRECTION : MAXIMUM_INVERSE_DIRECTION;
+    }
+    return 1.0f / d;
+}
+
+/**
+Slab test of the ray against the node bounds, restricted to [tMin, tMax]
+*/
+static inline bool
+nodeHit(
+    const BoundingVolumeHierarchyNode *node,
+    const Vector3D *origin,
+    const Vector3D *inverseDir,
+    const int *directionIsNegative,
+    float tMin,
+    float tMax)
+{
+    float t0 = (node->bounds[MIN_X + 3 * directionIsNegative[0]] - origin->x) * inverseDir->x;
+    float t1 = (node->bounds[MAX_X - 3 * directionIsNegative[0]] - origin->x) * inverseDir->x;
+    tMin = t0 > tMin ? t0 : tMin;
+    tMax = t1 < tMax ? t1 : tMax;
+
+    t0 = (node->bounds[MIN_Y + 3 * directionIsNegative[1]] - origin->y) * inverseDir->y;
+    t1 = (node->bounds[MAX_Y - 3 * directionIsNegative[1]] - origin->y) * inverseDir->y;
+    tMin = t0 > tMin ? t0 : tMin;
+    tMax = t1 < tMax ? t1 : tMax;
+
+    t0 = (node->bounds[MIN_Z + 3 * directionIsNegative[2]] - origin->z) * inverseDir->z;
+    t1 = (node->bounds[MAX_Z - 3 * directionIsNegative[2]] - origin->z) * inverseDir->z;
+    tMin = t0 > tMin ? t0 : tMin;
+    tMax = t1 < tMax ? t1 : tMax;
+
+    return tMin <= tMax;
+}
+
+/**
+Packet rays in structure of arrays layout, padded to a multiple of 4 so the slab
+tests can run 4 rays at a time. Padding rays have an empty [tMin, tMax] interval
+and never hit a node
+*/
+class BoundingVolumeHierarchyPacketRays {
+  public:
+    alignas(16) float originX[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float originY[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float originZ[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float inverseX[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float inverseY[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float inverseZ[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float tMin[RayPacket::MAXIMUM_SIZE];
+    alignas(16) float tMax[RayPacket::MAXIMUM_SIZE];
+    int numberOfGroups; // Of 4 rays
+};
+
+/**
+Slab test of all packet rays against the node bounds. Returns a bit mask with bit i
+set if ray i hits the node. Gives the same results as nodeHit() for each ray
+*/
+static inline unsigned int
+nodeHitPacket(const BoundingVolumeHierarchyNode *node, const BoundingVolumeHierarchyPacketRays *packetRays) {
+    unsigned int mask = 0;
+
+#ifdef __SSE__
+    const __m128 minX = _mm_set1_ps(node->bounds[MIN_X]);
+    const __m128 minY = _mm_set1_ps(node->bounds[MIN_Y]);
+    const __m128 minZ = _mm_set1_ps(node->bounds[MIN_Z]);
+    const __m128 maxX = _mm_set1_ps(node->bounds[MAX_X]);
+    const __m128 maxY = _mm_set1_ps(node->bounds[MAX_Y]);
+    const __m128 maxZ = _mm_set1_ps(node->bounds[MAX_Z]);
+
+    for ( int g = 0; g < packetRays->numberOfGroups; g++ ) {
+        const int first = 4 * g;
+        __m128 tMin = _mm_load_ps(packetRays->tMin + first);
+        __m128 tMax = _mm_load_ps(packetRays->tMax + first);
+
+        __m128 origin = _mm_load_ps(packetRays->originX + first);
+        __m128 inverse = _mm_load_ps(packetRays->inverseX + first);
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(minX, origin), inverse);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(maxX, origin), inverse);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t0, t1));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t0, t1));
+
+        origin = _mm_load_ps(packetRays->originY + first);
+        inverse = _mm_load_ps(packetRays->inverseY + first);
+        t0 = _mm_mul_ps(_mm_sub_ps(minY, origin), inverse);
+        t1 = _mm_mul_ps(_mm_sub_ps(maxY, origin), inverse);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t0, t1));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t0, t1));
+
+        origin = _mm_load_ps(packetRays->originZ + first);
+        inverse = _mm_load_ps(packetRays->inverseZ + first);
+        t0 = _mm_mul_ps(_mm_sub_ps(minZ, origin), inverse);
+        t1 = _mm_mul_ps(_mm_sub_ps(maxZ, origin), inverse);
+        tMin = _mm_max_ps(tMin, _mm_min_ps(t0, t1));
+        tMax = _mm_min_ps(tMax, _mm_max_ps(t0, t1));
+
+        mask |= (unsigned int)_mm_movemask_ps(_mm_cmple_ps(tMin, tMax)) << first;
+    }
+#else
+    for ( int i = 0; i < 4 * packetRays->numberOfGroups; i++ ) {
+        Vector3D origin(packetRays->originX[i], packetRays->originY[i], packetRays->originZ[i]);
+        Vector3D inverseDir(packetRays->inverseX[i], packetRays->inverseY[i], packetRays->inverseZ[i]);
+        int directionIsNegative[3] = {
+            inverseDir.x < 0.0f ? 1 : 0,
+            inverseDir.y < 0.0f ? 1 : 0,
+            inverseDir.z < 0.0f ? 1 : 0
+        };
+        if ( nodeHit(node, &origin, &inverseDir, directionIsNegative, packetRays->tMin[i], packetRays->tMax[i]) ) {
+            mask |= 1u << i;
+        }
+    }
+#endif
+
+    return mask;
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const java::ArrayList<Patch *> *scenePatches):
+    nodes(),
+    numberOfNodes(),
+    patches(),
+    numberOfPatches()
+{
+    numberOfPatches = scenePatches != nullptr ? (int)scenePatches->size() : 0;
+
+    if ( numberOfPatches == 0 ) {
+        // An empty leaf with empty bounds, which no ray can hit
+        BoundingBox empty;
+        nodes = new BoundingVolumeHierarchyNode[1];
+        for ( int i = 0; i < 6; i++ ) {
+            nodes[0].bounds[i] = empty.coordinates[i];
+        }
+        nodes[0].childOrFirstPatch = 0;
+        nodes[0].numberOfPatches = 0;
+        nodes[0].splitAxis = 0;
+        numberOfNodes = 1;
+        return;
+    }
+
+    BoundingBox *patchBounds = new BoundingBox[numberOfPatches];
+    Vector3D *patchCentroids = new Vector3D[numberOfPatches];
+    int *patchIndices = new int[numberOfPatches];
+
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        Patch *patch = scenePatches->get(i);
+        if ( patch->boundingBox != nullptr ) {
+            patchBounds[i] = *patch->boundingBox;
+        } else {
+            patch->computeAndGetBoundingBox(&patchBounds[i]);
+        }
+        patchBounds[i].enlargeTinyBit();
+        patchCentroids[i].set(
+            0.5f * (patchBounds[i].coordinates[MIN_X] + patchBounds[i].coordinates[MAX_X]),
+            0.5f * (patchBounds[i].coordinates[MIN_Y] + patchBounds[i].coordinates[MAX_Y]),
+            0.5f * (patchBounds[i].coordinates[MIN_Z] + patchBounds[i].coordinates[MAX_Z]));
+        patchIndices[i] = i;
+    }
+
+    // A binary tree with n leaves at most has 2n - 1 nodes
+    nodes = new BoundingVolumeHierarchyNode[2 * numberOfPatches - 1];
+    numberOfNodes = 0;
+    buildRecursive(patchIndices, patchBounds, patchCentroids, 0, numberOfPatches, 0);
+
+    // Store the patches in leaf order, so each leaf references a contiguous range
+    patches = new Patch *[numberOfPatches];
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        patches[i] = scenePatches->get(patchIndices[i]);
+    }
+
+    delete[] patchIndices;
+    delete[] patchCentroids;
+    delete[] patchBounds;
+}
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy() {
+    delete[] nodes;
+    delete[] patches;
+}
+
+float
+BoundingVolumeHierarchy::surfaceArea(const BoundingBox *box) {
+    float dx = box->coordinates[MAX_X] - box->coordinates[MIN_X];
+    float dy = box->coordinates[MAX_Y] - box->coordinates[MIN_Y];
+    float dz = box->coordinates[MAX_Z] - box->coordinates[MIN_Z];
+    if ( dx < 0.0f || dy < 0.0f || dz < 0.0f ) {
+        return 0.0f;
+    }
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+/**
+Evaluates the surface area heuristic for NUMBER_OF_BINS equally sized bins over
+the centroid bounds on each axis. Returns false when no split is cheaper than
+making a leaf of the given patch range
+*/
+bool
+BoundingVolumeHierarchy::findBestSplit(
+    const int *patchIndices,
+    const BoundingBox *patchBounds,
+    const Vector3D *patchCentroids,
+    const int first,
+    const int count,
+    const BoundingBox *nodeBounds,
+    int *splitAxis,
+    float *splitPosition) const
+{
+    BoundingBox centroidBounds;
+    for ( int i = first; i < first + count; i++ ) {
+        centroidBounds.enlargeToIncludePoint(&patchCentroids[patchIndices[i]]);
+    }
+
+    float nodeArea = surfaceArea(nodeBounds);
+    float bestCost = INTERSECTION_COST * (float)count;
+    bool found = false;
+
+    for ( int axis = 0; axis < 3; axis++ ) {
+        float minimum = centroidBounds.coordinates[MIN_X + axis];
+        float extent = centroidBounds.coordinates[MAX_X + axis] - minimum;
+        if ( extent <= Numeric::EPSILON_FLOAT ) {
+            continue;
+        }
+
+        BoundingBox binBounds[NUMBER_OF_BINS];
+        int binCounts[NUMBER_OF_BINS] = {};
+        float scale = (float)NUMBER_OF_BINS / extent;
+
+        for ( int i = first; i < first + count; i++ ) {
+            int index = patchIndices[i];
+            int bin = (int)((axisValue(&patchCentroids[index], axis) - minimum) * scale);
+            if ( bin >= NUMBER_OF_BINS ) {
+                bin = NUMBER_OF_BINS - 1;
+            }
+            binCounts[bin]++;
+            binBounds[bin].enlarge(&patchBounds[index]);
+        }
+
+        // Sweep from the right, then from the left, accumulating counts and areas
+        float rightAreas[NUMBER_OF_BINS];
+        int rightCounts[NUMBER_OF_BINS];
+        BoundingBox accumulated;
+        int accumulatedCount = 0;
+        for ( int bin = NUMBER_OF_BINS - 1; bin > 0; bin-- ) {
+            accumulated.enlarge(&binBounds[bin]);
+            accumulatedCount += binCounts[bin];
+            rightAreas[bin] = surfaceArea(&accumulated);
+            rightCounts[bin] = accumulatedCount;
+        }
+
+        BoundingBox left;
+        int leftCount = 0;
+        for ( int bin = 0; bin < NUMBER_OF_BINS - 1; bin++ ) {
+            left.enlarge(&binBounds[bin]);
+            leftCount += binCounts[bin];
+            if ( leftCount == 0 || rightCounts[bin + 1] == 0 ) {
+                continue;
+            }
+            float cost = TRAVERSAL_COST + INTERSECTION_COST
+                * ((float)leftCount * surfaceArea(&left) + (float)rightCounts[bin + 1] * rightAreas[bin + 1])
+                / nodeArea;
+            if ( cost < bestCost ) {
+                bestCost = cost;
+                *splitAxis = axis;
+                *splitPosition = minimum + (float)(bin + 1) / scale;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+Number of levels of median splits, halving the patch count each time, needed to
+bring count patches down to MAXIMUM_PATCHES_PER_LEAF
+*/
+int
+BoundingVolumeHierarchy::medianSplitLevels(int count) {
+    int levels = 0;
+    while ( count > MAXIMUM_PATCHES_PER_LEAF ) {
+        count = (count + 1) / 2;
+        levels++;
+    }
+    return levels;
+}
+
+int
+BoundingVolumeHierarchy::longestCentroidAxis(
+    const int *patchIndices,
+    const Vector3D *patchCentroids,
+    const int first,
+    const int count)
+{
+    BoundingBox centroidBounds;
+    for ( int i = first; i < first + count; i++ ) {
+        centroidBounds.enlargeToIncludePoint(&patchCentroids[patchIndices[i]]);
+    }
+
+    int longestAxis = 0;
+    for ( int axis = 1; axis < 3; axis++ ) {
+        if ( centroidBounds.coordinates[MAX_X + axis] - centroidBounds.coordinates[MIN_X + axis]
+           > centroidBounds.coordinates[MAX_X + longestAxis] - centroidBounds.coordinates[MIN_X + longestAxis] ) {
+            longestAxis = axis;
+        }
+    }
+    return longestAxis;
+}
+
+/**
+Builds the subtree for the patch range [first, first + count) in depth first
+order, so the first child of every inner node immediately follows it. Returns
+the index of the subtree root
+*/
+int
+BoundingVolumeHierarchy::buildRecursive(
+    int *patchIndices,
+    const BoundingBox *patchBounds,
+    const Vector3D *patchCentroids,
+    const int first,
+    const int count,
+    const int depth)
+{
+    int nodeIndex = numberOfNodes;
+    numberOfNodes++;
+
+    BoundingBox nodeBounds;
+    for ( int i = first; i < first + count; i++ ) {
+        nodeBounds.enlarge(&patchBounds[patchIndices[i]]);
+    }
+
+    BoundingVolumeHierarchyNode *node = &nodes[nodeIndex];
+    for ( int i = 0; i < 6; i++ ) {
+        node->bounds[i] = nodeBounds.coordinates[i];
+    }
+
+    int splitAxis = 0;
+    float splitPosition = 0.0f;
+    int middle = first;
+    bool depthLimitReached = depth + medianSplitLevels(count) >= MAXIMUM_DEPTH - 1;
+    bool split = count > MAXIMUM_PATCHES_PER_LEAF
+        && !depthLimitReached
+        && findBestSplit(patchIndices, patchBounds, patchCentroids, first, count, &nodeBounds, &splitAxis, &splitPosition);
+
+    if ( split ) {
+        // Partition the range around the split plane
+        int right = first + count - 1;
+        while ( middle <= right ) {
+            if ( axisValue(&patchCentroids[patchIndices[middle]], splitAxis) < splitPosition ) {
+                middle++;
+            } else {
+                int swap = patchIndices[middle];
+                patchIndices[middle] = patchIndices[right];
+                patchIndices[right] = swap;
+                right--;
+            }
+        }
+        split = middle > first && middle < first + count;
+    }
+
+    if ( !split && count > MAXIMUM_PATCHES_PER_LEAF && (depthLimitReached || count > MAXIMUM_LEAF_SIZE) ) {
+        // No depth left for the heuristic, or too many patches with coincident centroids for a
+        // single leaf: halving the range at the centroid median reaches leaves of at most
+        // MAXIMUM_PATCHES_PER_LEAF patches within MAXIMUM_DEPTH levels
+        splitAxis = longestCentroidAxis(patchIndices, patchCentroids, first, count);
+        middle = first + count / 2;
+        std::nth_element(
+            patchIndices + first,
+            patchIndices + middle,
+            patchIndices + first + count,
+            [patchCentroids, splitAxis](int a, int b) {
+                return axisValue(&patchCentroids[a], splitAxis) < axisValue(&patchCentroids[b], splitAxis);
+            });
+        split = true;
+    }
+
+    if ( !split ) {
+        node->childOrFirstPatch = first;
+        node->numberOfPatches = (unsigned short)count;
+        node->splitAxis = 0;
+        return nodeIndex;
+    }
+
+    node->numberOfPatches = 0;
+    node->splitAxis = (unsigned char)splitAxis;
+    buildRecursive(patchIndices, patchBounds, patchCentroids, first, middle - first, depth + 1);
+    int secondChild = buildRecursive(patchIndices, patchBounds, patchCentroids, middle, first + count - middle, depth + 1);
+
+    // The node array is preallocated, so node pointers stay valid during recursion
+    nodes[nodeIndex].childOrFirstPatch = secondChild;
+    return nodeIndex;
+}
+
+/**
+Traces a ray through the hierarchy, visiting the nearer child first. Returns nearest
+intersection (or any intersection when requested by hitFlags) or nullptr
+*/
+RayHit *
+BoundingVolumeHierarchy::intersect(
+    Ray *ray,
+    const float minimumDistance,
+    float *maximumDistance,
+    const int hitFlags,
+    RayHit *hitStore) const
+{
+    Vector3D inverseDir(
+        inverseDirection(ray->dir.x),
+        inverseDirection(ray->dir.y),
+        inverseDirection(ray->dir.z));
+    int directionIsNegative[3] = {
+        inverseDir.x < 0.0f ? 1 : 0,
+        inverseDir.y < 0.0f ? 1 : 0,
+        inverseDir.z < 0.0f ? 1 : 0
+    };
+
+    RayHit *hit = nullptr;
+    int stack[MAXIMUM_DEPTH];
+    int stackSize = 0;
+    int current = 0;
+
+    while ( true ) {
+        const BoundingVolumeHierarchyNode *node = &nodes[current];
+        if ( nodeHit(node, &ray->pos, &inverseDir, directionIsNegative, minimumDistance, *maximumDistance) ) {
+            if ( node->numberOfPatches > 0 ) {
+                for ( int i = 0; i < node->numberOfPatches; i += PatchIntersectionRecords::BATCH_SIZE ) {
+                    RayHit *h = PatchIntersectionRecords::intersect(
+                        &patches[node->childOrFirstPatch + i],
+                        java::Math::min(node->numberOfPatches - i, PatchIntersectionRecords::BATCH_SIZE),
+                        ray,
+                        minimumDistance,
+                        maximumDistance,
+                        hitFlags,
+                        hitStore,
+                        (hitFlags & RayHitFlag::ANY) != 0);
+                    if ( h != nullptr ) {
+                        if ( hitFlags & RayHitFlag::ANY ) {
+                            return h;
+                        }
+                        hit = h;
+                    }
+                }
+            } else {
+                // Push the far child, continue with the near one
+                if ( directionIsNegative[node->splitAxis] ) {
+                    stack[stackSize++] = current + 1;
+                    current = node->childOrFirstPatch;
+                } else {
+                    stack[stackSize++] = node->childOrFirstPatch;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if ( stackSize == 0 ) {
+            break;
+        }
+        current = stack[--stackSize];
+    }
+
+    return hit;
+}
+
+/**
+Traces all rays of the packet with a single traversal of the hierarchy. A node is
+entered when at least one still active ray hits it, and its patches are tested
+only against the rays that hit it. Children are visited in the order that suits the
+first ray, which is the right order for the others as well when the packet is
+coherent. With RayHitFlag::ANY a ray stops taking part as soon as it hits something
+*/
+int
+BoundingVolumeHierarchy::intersectPacket(RayPacket *packet, const int hitFlags) const {
+    if ( packet->size <= 0 ) {
+        return 0;
+    }
+
+    BoundingVolumeHierarchyPacketRays packetRays;
+    packetRays.numberOfGroups = (packet->size + 3) / 4;
+    for ( int i = 0; i < 4 * packetRays.numberOfGroups; i++ ) {
+        if ( i < packet->size ) {
+            const Ray *ray = &packet->rays[i];
+            packetRays.originX[i] = ray->pos.x;
+            packetRays.originY[i] = ray->pos.y;
+            packetRays.originZ[i] = ray->pos.z;
+            packetRays.inverseX[i] = inverseDirection(ray->dir.x);
+            packetRays.inverseY[i] = inverseDirection(ray->dir.y);
+            packetRays.inverseZ[i] = inverseDirection(ray->dir.z);
+            packetRays.tMin[i] = packet->minimumDistance[i];
+            packetRays.tMax[i] = packet->maximumDistance[i];
+            packet->hit[i] = nullptr;
+        } else {
+            packetRays.originX[i] = 0.0f;
+            packetRays.originY[i] = 0.0f;
+            packetRays.originZ[i] = 0.0f;
+            packetRays.inverseX[i] = 1.0f;
+            packetRays.inverseY[i] = 1.0f;
+            packetRays.inverseZ[i] = 1.0f;
+            packetRays.tMin[i] = 1.0f;
+            packetRays.tMax[i] = -1.0f;
+        }
+    }
+
+    const int directionIsNegative[3] = {
+        packetRays.inverseX[0] < 0.0f ? 1 : 0,
+        packetRays.inverseY[0] < 0.0f ? 1 : 0,
+        packetRays.inverseZ[0] < 0.0f ? 1 : 0
+    };
+
+    unsigned int active = (1u << packet->size) - 1;
+    int numberOfHits = 0;
+    int stack[MAXIMUM_DEPTH];
+    int stackSize = 0;
+    int current = 0;
+
+    while ( active != 0 ) {
+        const BoundingVolumeHierarchyNode *node = &nodes[current];
+        unsigned int mask = nodeHitPacket(node, &packetRays) & active;
+        if ( mask != 0 ) {
+            if ( node->numberOfPatches > 0 ) {
+                for ( int j = 0; j < node->numberOfPatches && mask != 0; j++ ) {
+                    Patch *patch = patches[node->childOrFirstPatch + j];
+                    for ( int i = 0; i < packet->size; i++ ) {
+                        if ( !(mask & (1u << i)) || patch == packet->excludedPatch[i] ) {
+                            continue;
+                        }
+                        RayHit *h = patch->intersect(
+                            &packet->rays[i],
+                            packet->minimumDistance[i],
+                            &packetRays.tMax[i],
+                            hitFlags,
+                            &packet->hitStore[i]);
+                        if ( h != nullptr ) {
+                            if ( packet->hit[i] == nullptr ) {
+                                numberOfHits++;
+                            }
+                            packet->hit[i] = h;
+                            if ( hitFlags & RayHitFlag::ANY ) {
+                                mask &= ~(1u << i);
+                                active &= ~(1u << i);
+                            }
+                        }
+                    }
+                }
+            } else {
+                // Push the far child, continue with the near one
+                if ( directionIsNegative[node->splitAxis] ) {
+                    stack[stackSize++] = current + 1;
+                    current = node->childOrFirstPatch;
+                } else {
+                    stack[stackSize++] = node->childOrFirstPatch;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if ( stackSize == 0 ) {
+            break;
+        }
+        current = stack[--stackSize];
+    }
+
+    for ( int i = 0; i < packet->size; i++ ) {
+        if ( packet->hit[i] != nullptr ) {
+            packet->maximumDistance[i] = packetRays.tMax[i];
+        }
+    }
+
+    return numberOfHits;
+}
+
+void
+BoundingVolumeHierarchy::print() const {
+    int numberOfLeaves = 0;
+    int maximumLeafSize = 0;
+    for ( int i = 0; i < numberOfNodes; i++ ) {
+        if ( nodes[i].numberOfPatches > 0 ) {
+            numberOfLeaves++;
+            maximumLeafSize = java::Math::max(maximumLeafSize, (int)nodes[i].numberOfPatches);
+        }
+    }
+    printf("Bounding volume hierarchy: %d patches, %d nodes, %d leaves, largest leaf %d patches\n",
+           numberOfPatches, numberOfNodes, numberOfLeaves, maximumLeafSize);
+}
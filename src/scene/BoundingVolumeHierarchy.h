@@ -0,0 +1,89 @@
+#ifndef __BOUNDING_VOLUME_HIERARCHY__
+#define __BOUNDING_VOLUME_HIERARCHY__
+
+#include "java/util/ArrayList.h"
+#include "skin/Patch.h"
+#include "scene/AccelerationStructure.h"
+
+/**
+Node of the flattened hierarchy. Inner nodes store their first child right after
+themselves on the node array, and the index of the second child on childOrFirstPatch.
+Leaf nodes store the index of their first patch on childOrFirstPatch
+*/
+class BoundingVolumeHierarchyNode {
+  public:
+    float bounds[6]; // Indexed by MIN_X ... MAX_Z, as in BoundingBox
+    int childOrFirstPatch;
+    unsigned short numberOfPatches; // 0 for inner nodes
+    unsigned char splitAxis;
+};
+
+/**
+Bounding volume hierarchy over the scene patches, built with the binned surface
+area heuristic
+
+References:
+- [WALD2007] I. Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies",
+  IEEE Symposium on Interactive Ray Tracing, 2007
+- [PHAR2016] M. Pharr, W. Jakob, G. Humphreys, "Physically Based Rendering", 3rd ed., section 4.3
+*/
+class BoundingVolumeHierarchy final : public AccelerationStructure {
+  private:
+    static const int MAXIMUM_PATCHES_PER_LEAF = 4;
+    static const int NUMBER_OF_BINS = 16;
+    static const int MAXIMUM_DEPTH = 64; // Size of the traversal stacks
+    static const int MAXIMUM_LEAF_SIZE = 0xffff; // Largest BoundingVolumeHierarchyNode::numberOfPatches
+
+    BoundingVolumeHierarchyNode *nodes;
+    int numberOfNodes;
+    Patch **patches;
+    int numberOfPatches;
+
+    static float surfaceArea(const BoundingBox *box);
+    static int medianSplitLevels(int count);
+
+    static int
+    longestCentroidAxis(
+        const int *patchIndices,
+        const Vector3D *patchCentroids,
+        int first,
+        int count);
+
+    int
+    buildRecursive(
+        int *patchIndices,
+        const BoundingBox *patchBounds,
+        const Vector3D *patchCentroids,
+        int first,
+        int count,
+        int depth);
+
+    bool
+    findBestSplit(
+        const int *patchIndices,
+        const BoundingBox *patchBounds,
+        const Vector3D *patchCentroids,
+        int first,
+        int count,
+        const BoundingBox *nodeBounds,
+        int *splitAxis,
+        float *splitPosition) const;
+
+  public:
+    explicit BoundingVolumeHierarchy(const java::ArrayList<Patch *> *scenePatches);
+    ~BoundingVolumeHierarchy() final;
+
+    RayHit *
+    intersect(
+        Ray *ray,
+        float minimumDistance,
+        float *maximumDistance,
+        int hitFlags,
+        RayHit *hitStore) const final;
+
+    int intersectPacket(RayPacket *packet, int hitFlags) const final;
+
+    void print() const final;
+};
+
+#endif
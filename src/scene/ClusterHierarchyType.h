@@ -0,0 +1,9 @@
+#ifndef __CLUSTER_HIERARCHY_TYPE__
+#define __CLUSTER_HIERARCHY_TYPE__
+
+enum ClusterHierarchyType {
+    OCTREE_CLUSTERS,
+    SURFACE_AREA_HEURISTIC_CLUSTERS
+};
+
+#endif
@@ -25,6 +25,9 @@ class PatchClusterOctreeNode {
     Geometry *convertClusterToGeometry();
     static void deleteCachedGeometries();
     void print(int level) const;
+
+    friend class SceneCache;
+    friend class PatchClusterSahBuilder;
 };
 
 #endif
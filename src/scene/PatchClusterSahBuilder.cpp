@@ -0,0 +1,335 @@
+#include <thread>
+
+#include "common/linealAlgebra/Numeric.h"
+#include "java/util/ArrayList.txx"
+#include "scene/PatchClusterSahBuilder.h"
+
+/**
+Split of a patch range: patches with their centroid in bins [0, bin] of the axis go to
+the first part
+*/
+class PatchClusterSplit {
+  public:
+    int axis;
+    int bin;
+    float minimum; // Of the centroids along the axis
+    float scale; // Bins per unit length
+    float firstPartArea;
+    float secondPartArea;
+};
+
+static inline float
+axisValue(const Vector3D *v, const int axis) {
+    if ( axis == 0 ) {
+        return v->x;
+    }
+    return axis == 1 ? v->y : v->z;
+}
+
+static inline int
+binIndex(const float value, const float minimum, const float scale, const int numberOfBins) {
+    int bin = (int)((value - minimum) * scale);
+    if ( bin >= numberOfBins ) {
+        return numberOfBins - 1;
+    }
+    return bin < 0 ? 0 : bin;
+}
+
+PatchClusterSahBuilder::PatchClusterSahBuilder(const java::ArrayList<Patch *> *inPatches, int inNumberOfThreads):
+    patches(inPatches),
+    numberOfThreads(inNumberOfThreads),
+    tasks(),
+    numberOfUnfinishedTasks()
+{
+    int numberOfPatches = patches != nullptr ? (int)patches->size() : 0;
+
+    patchIndices = new int[numberOfPatches];
+    patchBounds = new BoundingBox[numberOfPatches];
+    patchCentroids = new Vector3D[numberOfPatches];
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        Patch *patch = patches->get(i);
+        if ( patch->boundingBox != nullptr ) {
+            patchBounds[i] = *patch->boundingBox;
+        } else {
+            patch->computeAndGetBoundingBox(&patchBounds[i]);
+        }
+        patchCentroids[i].set(
+            0.5f * (patchBounds[i].coordinates[MIN_X] + patchBounds[i].coordinates[MAX_X]),
+            0.5f * (patchBounds[i].coordinates[MIN_Y] + patchBounds[i].coordinates[MAX_Y]),
+            0.5f * (patchBounds[i].coordinates[MIN_Z] + patchBounds[i].coordinates[MAX_Z]));
+        patchIndices[i] = i;
+    }
+}
+
+PatchClusterSahBuilder::~PatchClusterSahBuilder() {
+    delete[] patchIndices;
+    delete[] patchBounds;
+    delete[] patchCentroids;
+}
+
+float
+PatchClusterSahBuilder::surfaceArea(const BoundingBox *box) {
+    float dx = box->coordinates[MAX_X] - box->coordinates[MIN_X];
+    float dy = box->coordinates[MAX_Y] - box->coordinates[MIN_Y];
+    float dz = box->coordinates[MAX_Z] - box->coordinates[MIN_Z];
+    if ( dx < 0.0f || dy < 0.0f || dz < 0.0f ) {
+        return 0.0f;
+    }
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+/**
+Evaluates the surface area heuristic for NUMBER_OF_BINS equally sized bins over the
+centroid bounds on each axis and returns the cheapest split in split. Returns false
+when all the centroids coincide
+*/
+bool
+PatchClusterSahBuilder::findBestSplit(int first, int count, PatchClusterSplit *split) const {
+    BoundingBox centroidBounds;
+    for ( int i = first; i < first + count; i++ ) {
+        centroidBounds.enlargeToIncludePoint(&patchCentroids[patchIndices[i]]);
+    }
+
+    float bestCost = 0.0f;
+    bool found = false;
+
+    for ( int axis = 0; axis < 3; axis++ ) {
+        float minimum = centroidBounds.coordinates[MIN_X + axis];
+        float extent = centroidBounds.coordinates[MAX_X + axis] - minimum;
+        if ( extent <= Numeric::EPSILON_FLOAT ) {
+            continue;
+        }
+
+        BoundingBox binBounds[NUMBER_OF_BINS];
+        int binCounts[NUMBER_OF_BINS] = {};
+        float scale = (float)NUMBER_OF_BINS / extent;
+
+        for ( int i = first; i < first + count; i++ ) {
+            int index = patchIndices[i];
+            int bin = binIndex(axisValue(&patchCentroids[index], axis), minimum, scale, NUMBER_OF_BINS);
+            binCounts[bin]++;
+            binBounds[bin].enlarge(&patchBounds[index]);
+        }
+
+        // Sweep from the right, then from the left, accumulating counts and areas
+        float rightAreas[NUMBER_OF_BINS];
+        int rightCounts[NUMBER_OF_BINS];
+        BoundingBox accumulated;
+        int accumulatedCount = 0;
+        for ( int bin = NUMBER_OF_BINS - 1; bin > 0; bin-- ) {
+            accumulated.enlarge(&binBounds[bin]);
+            accumulatedCount += binCounts[bin];
+            rightAreas[bin] = surfaceArea(&accumulated);
+            rightCounts[bin] = accumulatedCount;
+        }
+
+        BoundingBox left;
+        int leftCount = 0;
+        for ( int bin = 0; bin < NUMBER_OF_BINS - 1; bin++ ) {
+            left.enlarge(&binBounds[bin]);
+            leftCount += binCounts[bin];
+            if ( leftCount == 0 || rightCounts[bin + 1] == 0 ) {
+                continue;
+            }
+            float leftArea = surfaceArea(&left);
+            float cost = (float)leftCount * leftArea + (float)rightCounts[bin + 1] * rightAreas[bin + 1];
+            if ( !found || cost < bestCost ) {
+                bestCost = cost;
+                split->axis = axis;
+                split->bin = bin;
+                split->minimum = minimum;
+                split->scale = scale;
+                split->firstPartArea = leftArea;
+                split->secondPartArea = rightAreas[bin + 1];
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+Partitions the patch range with the given split. Returns the start of the second part
+*/
+int
+PatchClusterSahBuilder::partition(int first, int count, const PatchClusterSplit *split) {
+    int middle = first;
+    int right = first + count - 1;
+
+    while ( middle <= right ) {
+        float value = axisValue(&patchCentroids[patchIndices[middle]], split->axis);
+        if ( binIndex(value, split->minimum, split->scale, NUMBER_OF_BINS) <= split->bin ) {
+            middle++;
+        } else {
+            int swap = patchIndices[middle];
+            patchIndices[middle] = patchIndices[right];
+            patchIndices[right] = swap;
+            right--;
+        }
+    }
+    return middle;
+}
+
+/**
+Builds the cluster for the patch range [first, first + count) and its sub-clusters. The
+range is split in up to MAXIMUM_NUMBER_OF_SUB_CLUSTERS parts, always splitting the part
+with the largest surface area next. Large parts are left to the other threads
+*/
+void
+PatchClusterSahBuilder::buildCluster(PatchClusterOctreeNode *cluster, int first, int count) {
+    for ( int i = first; i < first + count; i++ ) {
+        cluster->boundingBox.enlarge(&patchBounds[patchIndices[i]]);
+    }
+    cluster->boundingBoxCentroid.set(
+        (cluster->boundingBox.coordinates[MIN_X] + cluster->boundingBox.coordinates[MAX_X]) * 0.5f,
+        (cluster->boundingBox.coordinates[MIN_Y] + cluster->boundingBox.coordinates[MAX_Y]) * 0.5f,
+        (cluster->boundingBox.coordinates[MIN_Z] + cluster->boundingBox.coordinates[MAX_Z]) * 0.5f);
+
+    int partFirst[MAXIMUM_NUMBER_OF_SUB_CLUSTERS];
+    int partCount[MAXIMUM_NUMBER_OF_SUB_CLUSTERS];
+    float partArea[MAXIMUM_NUMBER_OF_SUB_CLUSTERS];
+    bool partCanBeSplit[MAXIMUM_NUMBER_OF_SUB_CLUSTERS];
+    int numberOfParts = 1;
+
+    partFirst[0] = first;
+    partCount[0] = count;
+    partArea[0] = surfaceArea(&cluster->boundingBox);
+    partCanBeSplit[0] = count > MINIMUM_NUMBER_OF_PATCHES_PER_CLUSTER;
+
+    while ( numberOfParts < MAXIMUM_NUMBER_OF_SUB_CLUSTERS ) {
+        int selected = -1;
+        for ( int i = 0; i < numberOfParts; i++ ) {
+            if ( partCanBeSplit[i] && (selected < 0 || partArea[i] > partArea[selected]) ) {
+                selected = i;
+            }
+        }
+        if ( selected < 0 ) {
+            break;
+        }
+
+        PatchClusterSplit split{};
+        int middle = partFirst[selected];
+        if ( findBestSplit(partFirst[selected], partCount[selected], &split) ) {
+            middle = partition(partFirst[selected], partCount[selected], &split);
+        }
+        int end = partFirst[selected] + partCount[selected];
+        if ( middle == partFirst[selected] || middle == end ) {
+            partCanBeSplit[selected] = false;
+            continue;
+        }
+
+        // The second part goes right after the first one
+        for ( int i = numberOfParts; i > selected + 1; i-- ) {
+            partFirst[i] = partFirst[i - 1];
+            partCount[i] = partCount[i - 1];
+            partArea[i] = partArea[i - 1];
+            partCanBeSplit[i] = partCanBeSplit[i - 1];
+        }
+        numberOfParts++;
+        partCount[selected] = middle - partFirst[selected];
+        partArea[selected] = split.firstPartArea;
+        partCanBeSplit[selected] = partCount[selected] > MINIMUM_NUMBER_OF_PATCHES_PER_CLUSTER;
+        partFirst[selected + 1] = middle;
+        partCount[selected + 1] = end - middle;
+        partArea[selected + 1] = split.secondPartArea;
+        partCanBeSplit[selected + 1] = partCount[selected + 1] > MINIMUM_NUMBER_OF_PATCHES_PER_CLUSTER;
+    }
+
+    if ( numberOfParts == 1 ) {
+        // Too few patches, or patches with coincident centroids
+        for ( int i = first; i < first + count; i++ ) {
+            cluster->patches->add(patches->get(patchIndices[i]));
+        }
+        return;
+    }
+
+    for ( int i = 0; i < numberOfParts; i++ ) {
+        cluster->children[i] = new PatchClusterOctreeNode();
+        if ( tasks != nullptr && partCount[i] >= MINIMUM_PATCHES_PER_TASK ) {
+            addTask(cluster->children[i], partFirst[i], partCount[i]);
+        } else {
+            buildCluster(cluster->children[i], partFirst[i], partCount[i]);
+        }
+    }
+}
+
+void
+PatchClusterSahBuilder::addTask(PatchClusterOctreeNode *cluster, int first, int count) {
+    PatchClusterBuildTask *task = new PatchClusterBuildTask();
+    task->cluster = cluster;
+    task->first = first;
+    task->count = count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks->add(task);
+        numberOfUnfinishedTasks++;
+    }
+    taskAdded.notify_one();
+}
+
+/**
+Body of the builder threads: builds clusters until all tasks are finished. Tasks add
+new tasks for their large sub-clusters, so a thread only stops when no task is left
+running
+*/
+void
+PatchClusterSahBuilder::runTasks() {
+    for ( ;; ) {
+        PatchClusterBuildTask *task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAdded.wait(lock, [this] { return tasks->size() > 0 || numberOfUnfinishedTasks == 0; });
+            if ( tasks->size() == 0 ) {
+                return;
+            }
+            task = tasks->get(tasks->size() - 1);
+            tasks->remove(tasks->size() - 1);
+        }
+
+        buildCluster(task->cluster, task->first, task->count);
+        delete task;
+
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            numberOfUnfinishedTasks--;
+            finished = numberOfUnfinishedTasks == 0;
+        }
+        if ( finished ) {
+            taskAdded.notify_all();
+        }
+    }
+}
+
+/**
+Builds the hierarchy for all the patches. Returns its top cluster
+*/
+PatchClusterOctreeNode *
+PatchClusterSahBuilder::build() {
+    PatchClusterOctreeNode *rootCluster = new PatchClusterOctreeNode();
+    int numberOfPatches = patches != nullptr ? (int)patches->size() : 0;
+
+    if ( numberOfThreads <= 1 || numberOfPatches < MINIMUM_PATCHES_PER_TASK ) {
+        buildCluster(rootCluster, 0, numberOfPatches);
+        return rootCluster;
+    }
+
+    tasks = new java::ArrayList<PatchClusterBuildTask *>();
+    addTask(rootCluster, 0, numberOfPatches);
+
+    java::ArrayList<std::thread *> *threads = new java::ArrayList<std::thread *>();
+    for ( int i = 1; i < numberOfThreads; i++ ) {
+        threads->add(new std::thread(&PatchClusterSahBuilder::runTasks, this));
+    }
+    runTasks();
+    for ( int i = 0; i < threads->size(); i++ ) {
+        threads->get(i)->join();
+        delete threads->get(i);
+    }
+    delete threads;
+    delete tasks;
+    tasks = nullptr;
+
+    return rootCluster;
+}
@@ -0,0 +1,78 @@
+#ifndef __PATCH_CLUSTER_SAH_BUILDER__
+#define __PATCH_CLUSTER_SAH_BUILDER__
+
+#include <condition_variable>
+#include <mutex>
+
+#include "java/util/ArrayList.h"
+#include "skin/Patch.h"
+#include "scene/PatchClusterOctreeNode.h"
+
+class PatchClusterSplit;
+
+/**
+Cluster of the hierarchy still to be built, for the patch range [first, first + count)
+*/
+class PatchClusterBuildTask {
+  public:
+    PatchClusterOctreeNode *cluster;
+    int first;
+    int count;
+};
+
+/**
+Builds the patch cluster hierarchy with the binned surface area heuristic instead of
+the octree subdivision of PatchClusterOctreeNode::splitCluster().
+
+Each cluster is split into up to 8 sub-clusters, as octree clusters are: its patch
+range is split in two with the best binned SAH plane, then the largest part again,
+until there are 8 parts or no part can be split. Clusters with no more than
+MINIMUM_NUMBER_OF_PATCHES_PER_CLUSTER patches are not split. The result is made of
+PatchClusterOctreeNode clusters, so it is converted into the same Geometry hierarchy.
+
+Sub-clusters with many patches are built as tasks by several threads. Every cluster
+only depends on its own patch range, so the hierarchy is the same for any number of
+threads
+
+References:
+- [WALD2007] I. Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies",
+  IEEE Symposium on Interactive Ray Tracing, 2007
+- [WALD2008] I. Wald, C. Benthin, S. Boulos, "Getting Rid of Packets - Efficient SIMD
+  Single-Ray Traversal using Multi-branching BVHs", IEEE Symposium on Interactive Ray
+  Tracing, 2008
+*/
+class PatchClusterSahBuilder {
+  private:
+    static const int MINIMUM_NUMBER_OF_PATCHES_PER_CLUSTER = 3;
+    static const int MAXIMUM_NUMBER_OF_SUB_CLUSTERS = 8;
+    static const int NUMBER_OF_BINS = 16;
+    static const int MINIMUM_PATCHES_PER_TASK = 4096;
+
+    const java::ArrayList<Patch *> *patches;
+    int numberOfThreads;
+    int *patchIndices;
+    BoundingBox *patchBounds;
+    Vector3D *patchCentroids;
+
+    // Task queue, used with more than one thread
+    std::mutex mutex;
+    std::condition_variable taskAdded;
+    java::ArrayList<PatchClusterBuildTask *> *tasks;
+    int numberOfUnfinishedTasks;
+
+    static float surfaceArea(const BoundingBox *box);
+
+    bool findBestSplit(int first, int count, PatchClusterSplit *split) const;
+    int partition(int first, int count, const PatchClusterSplit *split);
+    void buildCluster(PatchClusterOctreeNode *cluster, int first, int count);
+    void addTask(PatchClusterOctreeNode *cluster, int first, int count);
+    void runTasks();
+
+  public:
+    explicit PatchClusterSahBuilder(const java::ArrayList<Patch *> *inPatches, int inNumberOfThreads);
+    ~PatchClusterSahBuilder();
+
+    PatchClusterOctreeNode *build();
+};
+
+#endif
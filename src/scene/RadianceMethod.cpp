@@ -5,3 +5,13 @@ RadianceMethod::RadianceMethod() {
 
 RadianceMethod::~RadianceMethod() {
 }
+
+bool
+RadianceMethod::writeCheckpoint(RadianceCheckpoint * /*checkpoint*/, const Scene * /*scene*/) const {
+    return false;
+}
+
+bool
+RadianceMethod::readCheckpoint(RadianceCheckpoint * /*checkpoint*/, Scene * /*scene*/, RenderOptions * /*renderOptions*/) {
+    return false;
+}
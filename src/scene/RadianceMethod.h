@@ -10,6 +10,8 @@
 #include "scene/Scene.h"
 #include "scene/RadianceMethodAlgorithm.h"
 
+class RadianceCheckpoint;
+
 class RadianceMethod {
   public:
     RadianceMethodAlgorithm className;
@@ -58,6 +60,17 @@ class RadianceMethod {
     // If not defined, the default method implemented in write vrml.[ch] will
     // be used
     virtual void writeVRML(const Camera *camera, FILE *fp, const RenderOptions *renderOptions) const  = 0;
+
+    // Writes the state of the computations on the scene to the checkpoint, so a
+    // later run can continue from it. Returns false if the method can not be
+    // checkpointed
+    virtual bool writeCheckpoint(RadianceCheckpoint *checkpoint, const Scene *scene) const;
+
+    // Continues the computations from the state written by writeCheckpoint(), called
+    // right after initialize(). Returns false, leaving the method as initialized,
+    // if the checkpoint was written with other options or the method can not be
+    // checkpointed
+    virtual bool readCheckpoint(RadianceCheckpoint *checkpoint, Scene *scene, RenderOptions *renderOptions);
 };
 
 #endif
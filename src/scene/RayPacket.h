@@ -0,0 +1,58 @@
+#ifndef __RAY_PACKET__
+#define __RAY_PACKET__
+
+#include "common/Ray.h"
+#include "material/RayHit.h"
+
+class Patch;
+
+/**
+A group of up to MAXIMUM_SIZE rays traced together through the acceleration
+structure, see AccelerationStructure::intersectPacket(). Packets pay off when the
+rays are coherent (same origin and similar directions, such as the samples of a
+pixel or the shadow rays from a surface point to a light), because the structure
+is then traversed once for the whole packet instead of once per ray.
+
+Besides the patches excluded for all rays with Patch::dontIntersect(), each ray can
+exclude one more patch of its own, e.g. the light patch a shadow ray goes to
+*/
+class RayPacket {
+  public:
+    static const int MAXIMUM_SIZE = 16;
+
+    int size;
+    Ray rays[MAXIMUM_SIZE];
+    float minimumDistance[MAXIMUM_SIZE];
+    float maximumDistance[MAXIMUM_SIZE]; // Set to the hit distance for rays that hit something
+    Patch *excludedPatch[MAXIMUM_SIZE];
+    RayHit *hit[MAXIMUM_SIZE]; // Results: pointer to hitStore[i] or nullptr
+    RayHit hitStore[MAXIMUM_SIZE];
+
+    RayPacket(): size() {
+    }
+
+    inline void
+    clear() {
+        size = 0;
+    }
+
+    inline bool
+    isFull() const {
+        return size == MAXIMUM_SIZE;
+    }
+
+    /**
+    Appends a ray and returns its position on the packet. The packet must not be full
+    */
+    inline int
+    add(const Ray *ray, float minimum, float maximum, Patch *excluded = nullptr) {
+        rays[size] = *ray;
+        minimumDistance[size] = minimum;
+        maximumDistance[size] = maximum;
+        excludedPatch[size] = excluded;
+        hit[size] = nullptr;
+        return size++;
+    }
+};
+
+#endif
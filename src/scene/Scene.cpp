@@ -12,7 +12,7 @@ Scene::Scene():
     geometryList(),
     clusteredGeometryList(),
     clusteredRootGeometry(),
-    voxelGrid(),
+    accelerationStructure(),
     patchList(),
     lightSourcePatchList()
 {
@@ -37,9 +37,9 @@ Scene::~Scene() {
         delete patchList;
         patchList = nullptr;
     }
-    if ( voxelGrid != nullptr ) {
-        delete voxelGrid;
-        voxelGrid = nullptr;
+    if ( accelerationStructure != nullptr ) {
+        delete accelerationStructure;
+        accelerationStructure = nullptr;
     }
     if ( background != nullptr ) {
         delete background;
@@ -215,9 +215,9 @@ Scene::printClusterHierarchy(const Geometry *node, int level, int *elementCount)
 }
 
 void
-Scene::printVoxelGrid() const {
-    printf("= voxelGrid ================================================================\n");
-    voxelGrid->print();
+Scene::printAccelerationStructure() const {
+    printf("= accelerationStructure ===========================================================\n");
+    accelerationStructure->print();
 }
 
 void
@@ -227,6 +227,6 @@ Scene::print() const {
     printPatches();
     int elementCount = 0;
     printClusterHierarchy(clusteredRootGeometry, 0, &elementCount);
-    printVoxelGrid();
+    printAccelerationStructure();
     printf("*** Total number of geometry elements on cluster hierarchy: %d\n", elementCount);
 }
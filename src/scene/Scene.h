@@ -2,7 +2,7 @@
 #define __SCENE__
 
 #include "scene/Background.h"
-#include "scene/VoxelGrid.h"
+#include "scene/AccelerationStructure.h"
 #include "scene/Camera.h"
 
 class Scene {
@@ -14,7 +14,7 @@ class Scene {
     void printGeometries() const;
     void printClusteredGeometries() const;
     void printPatches() const;
-    void printVoxelGrid() const;
+    void printAccelerationStructure() const;
     static void printClusterHierarchy(const Geometry *node, int level, int *elementCount);
 
 public:
@@ -23,7 +23,7 @@ public:
     java::ArrayList<Geometry *> *geometryList;
     java::ArrayList<Geometry *> *clusteredGeometryList;
     Geometry *clusteredRootGeometry;
-    VoxelGrid *voxelGrid;
+    AccelerationStructure *accelerationStructure;
 
     // The list of all patches in the current scene
     java::ArrayList<Patch *> *patchList;
@@ -7,6 +7,7 @@ optimisations/enhancements from ray shade 4.0.6 by Graig Kolb, Stanford U
 
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
+#include "skin/PatchIntersectionRecords.h"
 #include "scene/VoxelGrid.h"
 
 static const int MINIMUM_ELEMENT_COUNT_PER_CELL = 10;
@@ -259,13 +260,6 @@ VoxelGrid::putGeometryInsideVoxelGrid(Geometry *geometry, const short na, const
     putSubGeometryInsideVoxelGrid(geometry);
 }
 
-int
-VoxelGrid::randomRayId() {
-    static int count = 0; // TODO warning: this makes this class non re-entrant
-    count++;
-    return (count & VOXEL_DATA_RAY_COUNT_MASK);
-}
-
 /**
 Compute t0, ray's minimal intersection with the whole grid and
 position P of this intersection. Returns true if the grid getBoundingBox are
@@ -415,37 +409,64 @@ VoxelGrid::nextVoxel(float *t0, int *g, Vector3D *tNext, const Vector3D *tDelta,
 Finds the nearest intersection of the ray with an item (Geometry or Patch) in
 a voxel's item list. If there is an intersection, maximumDistance will contain
 the distance to the intersection point measured from the ray origin
-as usual. If there is no intersection, maximumDistance remains unmodified
+as usual. If there is no intersection, maximumDistance remains unmodified.
+Items already tested on this query, as recorded in context, are skipped
 */
 RayHit *
 VoxelGrid::voxelIntersect(
     const java::ArrayList<VoxelData *> *items,
     Ray *ray,
-    const unsigned int counter,
+    VoxelGridTraversalContext *context,
     const float minimumDistance,
     float *maximumDistance,
     const int hitFlags,
     RayHit *hitStore)
 {
     RayHit *hit = nullptr;
+    Patch *batch[PatchIntersectionRecords::BATCH_SIZE];
+    int batchSize = 0;
 
     for ( long i = 0; items != nullptr && i < items->size(); i++ ) {
         VoxelData *item = items->get(i);
-        if ( item->lastRayId() != counter ) {
+        if ( !context->markVisited(item) ) {
             // Avoid testing objects multiple times
-            RayHit *h = nullptr;
-            if ( item->isPatch() ) {
-                h = item->patch->intersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
-            } else if ( item->isGeom() ) {
-                h = item->geometry->discretizationIntersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
-            } else if ( item->isGrid() ) {
-                h = item->voxelGrid->gridIntersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
+            continue;
+        }
+
+        if ( item->isPatch() ) {
+            // Patches are tested in batches, in the same order
+            batch[batchSize++] = item->patch;
+            if ( batchSize < PatchIntersectionRecords::BATCH_SIZE ) {
+                continue;
             }
-            if ( h ) {
+        }
+
+        RayHit *h = nullptr;
+        if ( batchSize > 0 ) {
+            h = PatchIntersectionRecords::intersect(
+                batch, batchSize, ray, minimumDistance, maximumDistance, hitFlags, hitStore, false);
+            batchSize = 0;
+            if ( h != nullptr ) {
                 hit = h;
             }
+        }
 
-            item->updateRayId(counter);
+        h = nullptr;
+        if ( item->isGeom() ) {
+            h = item->geometry->discretizationIntersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
+        } else if ( item->isGrid() ) {
+            h = item->voxelGrid->gridIntersect(ray, context, minimumDistance, maximumDistance, hitFlags, hitStore);
+        }
+        if ( h != nullptr ) {
+            hit = h;
+        }
+    }
+
+    if ( batchSize > 0 ) {
+        RayHit *h = PatchIntersectionRecords::intersect(
+            batch, batchSize, ray, minimumDistance, maximumDistance, hitFlags, hitStore, false);
+        if ( h != nullptr ) {
+            hit = h;
         }
     }
 
@@ -453,7 +474,8 @@ VoxelGrid::voxelIntersect(
 }
 
 /**
-Traces a ray through a voxel grid. Returns nearest intersection or nullptr
+Traces a ray through a voxel grid. Returns nearest intersection or nullptr.
+Reentrant: the traversal state is kept on the caller's stack
 */
 RayHit *
 VoxelGrid::gridIntersect(
@@ -462,6 +484,23 @@ VoxelGrid::gridIntersect(
     float *maximumDistance,
     int hitFlags,
     RayHit *hitStore) const
+{
+    VoxelGridTraversalContext context;
+    return gridIntersect(ray, &context, minimumDistance, maximumDistance, hitFlags, hitStore);
+}
+
+/**
+Traces a ray through this grid, sharing the visited item set in context with the
+enclosing grids of the same query
+*/
+RayHit *
+VoxelGrid::gridIntersect(
+    Ray *ray,
+    VoxelGridTraversalContext *context,
+    float minimumDistance,
+    float *maximumDistance,
+    int hitFlags,
+    RayHit *hitStore) const
 {
     Vector3D tNext;
     Vector3D tDelta;
@@ -471,7 +510,6 @@ VoxelGrid::gridIntersect(
     int g[3]{0, 0, 0};
     RayHit *hit = nullptr;
     float t0;
-    int counter;
 
     if ( !gridBoundsIntersect(ray, minimumDistance, *maximumDistance, &t0, &P) ) {
         return nullptr;
@@ -479,13 +517,10 @@ VoxelGrid::gridIntersect(
 
     gridTraceSetup(ray, t0, &P, g, &tDelta, &tNext, step, out);
 
-    // Ray counter in order to avoid testing objects spanning several voxel grid cells multiple times
-    counter = randomRayId();
-
     do {
         const java::ArrayList<VoxelData *> *list = volumeListsOfItems[cellIndexAddress(g[0], g[1], g[2])];
         if ( list != nullptr ) {
-            RayHit *h = voxelIntersect(list, ray, counter, t0, maximumDistance, hitFlags, hitStore);
+            RayHit *h = voxelIntersect(list, ray, context, t0, maximumDistance, hitFlags, hitStore);
             if ( h != nullptr ) {
                 hit = h;
             }
@@ -495,6 +530,17 @@ VoxelGrid::gridIntersect(
     return hit;
 }
 
+RayHit *
+VoxelGrid::intersect(
+    Ray *ray,
+    const float minimumDistance,
+    float *maximumDistance,
+    const int hitFlags,
+    RayHit *hitStore) const
+{
+    return gridIntersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
+}
+
 void
 VoxelGrid::print() const {
     printf("DX: %d, DY: %d, DZ: %d\n", xSize, ySize, zSize);
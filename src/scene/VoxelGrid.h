@@ -4,8 +4,10 @@
 #include "java/util/ArrayList.h"
 #include "skin/Geometry.h"
 #include "scene/VoxelData.h"
+#include "scene/VoxelGridTraversalContext.h"
+#include "scene/AccelerationStructure.h"
 
-class VoxelGrid {
+class VoxelGrid : public AccelerationStructure {
   private:
     static java::ArrayList<VoxelGrid *> *subGridsToDelete;
     static java::ArrayList<VoxelData *> *voxelCellsToDelete;
@@ -85,20 +87,27 @@ class VoxelGrid {
     voxelIntersect(
         const java::ArrayList<VoxelData *> *items,
         Ray *ray,
-        unsigned int counter,
+        VoxelGridTraversalContext *context,
         float minimumDistance,
         float *maximumDistance,
         int hitFlags,
         RayHit *hitStore);
 
+    RayHit *
+    gridIntersect(
+        Ray *ray,
+        VoxelGridTraversalContext *context,
+        float minimumDistance,
+        float *maximumDistance,
+        int hitFlags,
+        RayHit *hitStore) const;
+
     static bool
     nextVoxel(float *t0, int *g, Vector3D *tNext, const Vector3D *tDelta, const int *step, const int *out);
 
-    static int randomRayId();
-
 public:
     explicit VoxelGrid(Geometry *geometry);
-    virtual ~VoxelGrid();
+    ~VoxelGrid() override;
 
     RayHit *
     gridIntersect(
@@ -108,7 +117,15 @@ public:
         int hitFlags,
         RayHit *hitStore) const;
 
-    void print() const;
+    RayHit *
+    intersect(
+        Ray *ray,
+        float minimumDistance,
+        float *maximumDistance,
+        int hitFlags,
+        RayHit *hitStore) const override;
+
+    void print() const override;
 
     static void freeVoxelGridElements();
 };
@@ -0,0 +1,99 @@
+#ifndef __VOXEL_GRID_TRAVERSAL_CONTEXT__
+#define __VOXEL_GRID_TRAVERSAL_CONTEXT__
+
+#include <cstdint>
+
+class VoxelData;
+
+/**
+Per ray query mailbox for the voxel grid traversal: remembers which voxel items
+(patches, geometries or sub grids spanning several cells) were already tested
+against the current ray. It lives on the stack of the tracing thread, so the shared
+grid cells are never written during traversal and several threads can trace
+rays through the same grid at the same time.
+
+Most rays test only a few items, which are kept on a short list that needs no
+initialization. Longer queries switch to a small open addressing hash table on
+item addresses. When that fills up it is cleared, which may only cause some items
+to be tested more than once
+*/
+class VoxelGridTraversalContext {
+  private:
+    static const int LIST_CAPACITY = 16;
+    static const int TABLE_CAPACITY = 256; // Must be a power of two
+    static const int TABLE_MAXIMUM_LOAD = TABLE_CAPACITY / 2;
+
+    const VoxelData *list[LIST_CAPACITY];
+    const VoxelData *table[TABLE_CAPACITY];
+    int numberOfVisited;
+
+    static inline int
+    slotFor(const VoxelData *item) {
+        uintptr_t key = (uintptr_t)item >> 4;
+        return (int)((key * 2654435761u) & (TABLE_CAPACITY - 1));
+    }
+
+    inline void
+    clearTable() {
+        for ( int i = 0; i < TABLE_CAPACITY; i++ ) {
+            table[i] = nullptr;
+        }
+    }
+
+    /**
+    Inserts the item on the hash table. Returns false if it was already there
+    */
+    inline bool
+    insertOnTable(const VoxelData *item) {
+        int slot = slotFor(item);
+        while ( table[slot] != nullptr ) {
+            if ( table[slot] == item ) {
+                return false;
+            }
+            slot = (slot + 1) & (TABLE_CAPACITY - 1);
+        }
+        table[slot] = item;
+        return true;
+    }
+
+  public:
+    // Arrays are left uninitialized on purpose, only the used part is ever read
+    VoxelGridTraversalContext(): numberOfVisited() {
+    }
+
+    /**
+    Marks the item as visited. Returns false if it was already visited on this query
+    */
+    inline bool
+    markVisited(const VoxelData *item) {
+        if ( numberOfVisited < LIST_CAPACITY ) {
+            for ( int i = 0; i < numberOfVisited; i++ ) {
+                if ( list[i] == item ) {
+                    return false;
+                }
+            }
+            list[numberOfVisited] = item;
+            numberOfVisited++;
+            return true;
+        }
+
+        if ( numberOfVisited == LIST_CAPACITY ) {
+            // Move to the hash table
+            clearTable();
+            for ( int i = 0; i < LIST_CAPACITY; i++ ) {
+                insertOnTable(list[i]);
+            }
+        } else if ( numberOfVisited >= TABLE_MAXIMUM_LOAD ) {
+            clearTable();
+            numberOfVisited = LIST_CAPACITY;
+        }
+
+        if ( !insertOnTable(item) ) {
+            return false;
+        }
+        numberOfVisited++;
+        return true;
+    }
+};
+
+#endif
@@ -7,7 +7,9 @@ enum ElementFlags {
     // If the element is or contains surfaces emitting light spontaneously
     IS_LIGHT_SOURCE_MASK = 0x02,
     // Set when all interactions have been created for a toplevel element
-    INTERACTIONS_CREATED_MASK = 0x04
+    INTERACTIONS_CREATED_MASK = 0x04,
+    // Set while a Galerkin shooting step has collected the element as a receiver
+    SHOOTING_RECEIVER_MASK = 0x08
 };
 
 #endif
@@ -1,11 +1,13 @@
+#include "java/lang/Math.h"
 #include "java/util/ArrayList.txx"
 #include "common/error.h"
 #include "common/Statistics.h"
+#include "skin/PatchIntersectionRecords.h"
 #include "skin/Geometry.h"
 
-Geometry *Geometry::excludedGeometry1 = nullptr;
-Geometry *Geometry::excludedGeometry2 = nullptr;
-int Geometry::nextGeometryId = 0;
+thread_local Geometry *Geometry::excludedGeometry1 = nullptr;
+thread_local Geometry *Geometry::excludedGeometry2 = nullptr;
+std::atomic<int> Geometry::nextGeometryId(0);
 
 Geometry::Geometry():
     id(),
@@ -33,8 +35,7 @@ Geometry::Geometry(
     GeometryClassId inClassName)
 {
     GLOBAL_statistics.numberOfGeometries++;
-    id = nextGeometryId;
-    nextGeometryId++;
+    id = nextGeometryId++;
     compoundData = inCompoundData;
     patchSetData = inPatchSetData;
     className = inClassName;
@@ -165,7 +166,7 @@ Geometry::duplicateIfPatchSet() const {
 
     Geometry *newGeometry = new Geometry();
     newGeometry->patchSetData = patchSetData;
-    newGeometry->id = GLOBAL_statistics.numberOfGeometries;
+    newGeometry->id = GLOBAL_statistics.numberOfGeometries++;
     newGeometry->boundingBox = boundingBox;
     newGeometry->radianceData = radianceData;
     newGeometry->itemCount = itemCount;
@@ -177,8 +178,6 @@ Geometry::duplicateIfPatchSet() const {
     newGeometry->compoundData = compoundData;
     newGeometry->isDuplicate = true;
 
-    GLOBAL_statistics.numberOfGeometries++;
-
     return newGeometry;
 }
 
@@ -304,8 +303,21 @@ Geometry::patchListIntersect(
     RayHit *hitStore)
 {
     RayHit *hit = nullptr;
-    for ( int i = 0; patchList != nullptr && i < patchList->size(); i++ ) {
-        RayHit *h = patchList->get(i)->intersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
+    Patch *batch[PatchIntersectionRecords::BATCH_SIZE];
+    for ( int i = 0; patchList != nullptr && i < patchList->size(); i += PatchIntersectionRecords::BATCH_SIZE ) {
+        int batchSize = java::Math::min((int)patchList->size() - i, PatchIntersectionRecords::BATCH_SIZE);
+        for ( int j = 0; j < batchSize; j++ ) {
+            batch[j] = patchList->get(i + j);
+        }
+        RayHit *h = PatchIntersectionRecords::intersect(
+            batch,
+            batchSize,
+            ray,
+            minimumDistance,
+            maximumDistance,
+            hitFlags,
+            hitStore,
+            (hitFlags & RayHitFlag::ANY) != 0);
         if ( h != nullptr ) {
             if ( hitFlags & RayHitFlag::ANY ) {
                 return h;
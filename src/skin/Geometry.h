@@ -1,6 +1,8 @@
 #ifndef __GEOMETRY__
 #define __GEOMETRY__
 
+#include <atomic>
+
 #include "java/util/ArrayList.h"
 #include "material/RayHit.h"
 #include "skin/BoundingBox.h"
@@ -25,9 +27,9 @@ class Element;
 
 class Geometry {
   public: // Will become protected
-    static int nextGeometryId;
-    static Geometry *excludedGeometry1;
-    static Geometry *excludedGeometry2;
+    static std::atomic<int> nextGeometryId; // Shaft culling creates geometries on several threads
+    static thread_local Geometry *excludedGeometry1; // Per thread, see geomDontIntersect()
+    static thread_local Geometry *excludedGeometry2;
 
     Geometry(
         PatchSet *inPatchSetData,
@@ -11,7 +11,7 @@
 static const double TOLERANCE = 1e-5;
 
 int Patch::globalPatchId = 1;
-Patch *Patch::globalExcludedPatches[MAX_EXCLUDED_PATCHES] = {nullptr, nullptr, nullptr, nullptr};
+thread_local Patch *Patch::globalExcludedPatches[MAX_EXCLUDED_PATCHES] = {nullptr, nullptr, nullptr, nullptr};
 
 /**
 This routine returns the ID number the next patch would get
@@ -808,7 +808,8 @@ Patch::averageEmittance(char components) {
 Specify up to MAX_EXCLUDED_PATCHES patches not to test for intersections with.
 Used to avoid self intersections when raytracing. First argument is number of
 patches to include. next arguments are pointers to the patches to exclude.
-Call with first parameter == 0 to clear the list
+Call with first parameter == 0 to clear the list. The list is kept per thread,
+so threads tracing rays at the same time do not see each other's exclusions
 */
 void
 Patch::dontIntersect(int n, ...) {
@@ -832,6 +833,18 @@ Patch::dontIntersect(int n, ...) {
     }
 }
 
+/**
+Replaces the last entry of the exclusion list set by dontIntersect() and returns
+the previous one. Used to exclude one more patch for a single ray of a packet, while
+the first MAX_EXCLUDED_PATCHES - 1 entries are shared by all rays
+*/
+Patch *
+Patch::setLastExcludedPatch(Patch *patch) {
+    Patch *previous = globalExcludedPatches[MAX_EXCLUDED_PATCHES - 1];
+    globalExcludedPatches[MAX_EXCLUDED_PATCHES - 1] = patch;
+    return previous;
+}
+
 /**
 Computes interpolated (= shading) normal at the point with given parameters
 on the patch
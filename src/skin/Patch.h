@@ -35,7 +35,7 @@ class Patch {
     // A static counter which is increased every time a Patch is created in
     // order to make a unique Patch id
     static int globalPatchId;
-    static Patch *globalExcludedPatches[MAX_EXCLUDED_PATCHES];
+    static thread_local Patch *globalExcludedPatches[MAX_EXCLUDED_PATCHES]; // Per thread, see dontIntersect()
 
     unsigned char flags; // Other flags
 
@@ -92,6 +92,7 @@ class Patch {
     Material *material;
 
     static void dontIntersect(int n, ...);
+    static Patch *setLastExcludedPatch(Patch *patch);
     static int getNextId();
     static void setNextId(int id);
 
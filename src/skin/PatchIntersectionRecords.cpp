@@ -0,0 +1,328 @@
+#include <cstdlib>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "java/lang/Math.h"
+#include "java/util/ArrayList.txx"
+#include "common/error.h"
+#include "common/linealAlgebra/CoordinateAxis.h"
+#include "skin/PatchIntersectionRecords.h"
+
+// Number of arrays on the records block
+static const int NUMBER_OF_FIELDS = 10;
+
+/**
+Rays more parallel than this to a plane are left to Patch::intersect(), which
+rejects them below Numeric::EPSILON
+*/
+static const float MINIMUM_ABSOLUTE_COSINE = 1e-3f;
+
+// Relative error allowed for the single precision computations, far above the actual one
+static const float RELATIVE_ERROR = 1e-5f;
+static const float ABSOLUTE_ERROR = 1e-6f;
+
+int PatchIntersectionRecords::numberOfRecords = 0;
+float *PatchIntersectionRecords::block = nullptr;
+float *PatchIntersectionRecords::normalX = nullptr;
+float *PatchIntersectionRecords::normalY = nullptr;
+float *PatchIntersectionRecords::normalZ = nullptr;
+float *PatchIntersectionRecords::planeConstant = nullptr;
+float *PatchIntersectionRecords::minimumX = nullptr;
+float *PatchIntersectionRecords::minimumY = nullptr;
+float *PatchIntersectionRecords::minimumZ = nullptr;
+float *PatchIntersectionRecords::maximumX = nullptr;
+float *PatchIntersectionRecords::maximumY = nullptr;
+float *PatchIntersectionRecords::maximumZ = nullptr;
+
+/**
+Fills in the record of a patch. Records are initialized so that the ray always
+hits the bounds and, with a zero normal, is always taken as parallel to the plane:
+such records never reject anything
+*/
+void
+PatchIntersectionRecords::setRecord(const int record, const Patch *patch) {
+    if ( patch->numberOfVertices < 3 ) {
+        return;
+    }
+
+    float low[3];
+    float high[3];
+    const Vector3D *first = patch->vertex[0]->point;
+    low[0] = high[0] = first->x;
+    low[1] = high[1] = first->y;
+    low[2] = high[2] = first->z;
+    for ( int i = 1; i < patch->numberOfVertices; i++ ) {
+        const Vector3D *point = patch->vertex[i]->point;
+        low[0] = java::Math::min(low[0], point->x);
+        low[1] = java::Math::min(low[1], point->y);
+        low[2] = java::Math::min(low[2], point->z);
+        high[0] = java::Math::max(high[0], point->x);
+        high[1] = java::Math::max(high[1], point->y);
+        high[2] = java::Math::max(high[2], point->z);
+    }
+
+    float extent = 0.0f;
+    float magnitude = 0.0f;
+    for ( int axis = 0; axis < 3; axis++ ) {
+        extent = java::Math::max(extent, high[axis] - low[axis]);
+        magnitude = java::Math::max(magnitude, java::Math::max(java::Math::abs(low[axis]), java::Math::abs(high[axis])));
+    }
+    float margin = RELATIVE_ERROR * (extent + magnitude) + ABSOLUTE_ERROR;
+    for ( int axis = 0; axis < 3; axis++ ) {
+        low[axis] -= margin;
+        high[axis] += margin;
+    }
+
+    // Inside tests are done after projection along the dominant normal axis, so a
+    // slightly warped quadrilateral may be hit away from its vertices on that axis
+    if ( patch->index == CoordinateAxis::X ) {
+        low[0] = -Numeric::HUGE_FLOAT_VALUE;
+        high[0] = Numeric::HUGE_FLOAT_VALUE;
+    } else if ( patch->index == CoordinateAxis::Y ) {
+        low[1] = -Numeric::HUGE_FLOAT_VALUE;
+        high[1] = Numeric::HUGE_FLOAT_VALUE;
+    } else {
+        low[2] = -Numeric::HUGE_FLOAT_VALUE;
+        high[2] = Numeric::HUGE_FLOAT_VALUE;
+    }
+
+    normalX[record] = patch->normal.x;
+    normalY[record] = patch->normal.y;
+    normalZ[record] = patch->normal.z;
+    planeConstant[record] = patch->planeConstant;
+    minimumX[record] = low[0];
+    minimumY[record] = low[1];
+    minimumZ[record] = low[2];
+    maximumX[record] = high[0];
+    maximumY[record] = high[1];
+    maximumZ[record] = high[2];
+}
+
+/**
+Builds the records for the given patches, replacing the previous ones
+*/
+void
+PatchIntersectionRecords::build(const java::ArrayList<Patch *> *patches) {
+    freeMemory();
+    if ( patches == nullptr || patches->size() == 0 ) {
+        return;
+    }
+
+    // Patch ids start at 1, record 0 is left as a record that never rejects
+    numberOfRecords = Patch::getNextId();
+    block = (float *)malloc(NUMBER_OF_FIELDS * numberOfRecords * sizeof(float));
+    if ( block == nullptr ) {
+        logError("PatchIntersectionRecords::build", "Not enough memory for %d records", numberOfRecords);
+        numberOfRecords = 0;
+        return;
+    }
+
+    normalX = block;
+    normalY = normalX + numberOfRecords;
+    normalZ = normalY + numberOfRecords;
+    planeConstant = normalZ + numberOfRecords;
+    minimumX = planeConstant + numberOfRecords;
+    minimumY = minimumX + numberOfRecords;
+    minimumZ = minimumY + numberOfRecords;
+    maximumX = minimumZ + numberOfRecords;
+    maximumY = maximumX + numberOfRecords;
+    maximumZ = maximumY + numberOfRecords;
+
+    for ( int i = 0; i < numberOfRecords; i++ ) {
+        normalX[i] = 0.0f;
+        normalY[i] = 0.0f;
+        normalZ[i] = 0.0f;
+        planeConstant[i] = 0.0f;
+        minimumX[i] = -Numeric::HUGE_FLOAT_VALUE;
+        minimumY[i] = -Numeric::HUGE_FLOAT_VALUE;
+        minimumZ[i] = -Numeric::HUGE_FLOAT_VALUE;
+        maximumX[i] = Numeric::HUGE_FLOAT_VALUE;
+        maximumY[i] = Numeric::HUGE_FLOAT_VALUE;
+        maximumZ[i] = Numeric::HUGE_FLOAT_VALUE;
+    }
+
+    for ( int i = 0; i < patches->size(); i++ ) {
+        const Patch *patch = patches->get(i);
+        if ( patch->id > 0 && (int)patch->id < numberOfRecords ) {
+            setRecord((int)patch->id, patch);
+        }
+    }
+}
+
+void
+PatchIntersectionRecords::freeMemory() {
+    if ( block != nullptr ) {
+        free(block);
+    }
+    block = nullptr;
+    numberOfRecords = 0;
+    normalX = normalY = normalZ = planeConstant = nullptr;
+    minimumX = minimumY = minimumZ = nullptr;
+    maximumX = maximumY = maximumZ = nullptr;
+}
+
+#ifdef __SSE2__
+static inline __m128
+gatherRecords(const float *field, const int *records) {
+    return _mm_set_ps(field[records[3]], field[records[2]], field[records[1]], field[records[0]]);
+}
+#endif
+
+/**
+Tests the ray against up to BATCH_SIZE patches. Returns a bit mask with bit i set
+when patches[i] may be hit between minimumDistance and maximumDistance, facing as
+allowed by the RayHitFlag::FRONT and RayHitFlag::BACK hitFlags, and thus needs a
+Patch::intersect() test. Cleared bits are misses for sure
+*/
+unsigned int
+PatchIntersectionRecords::candidates(
+    Patch *const *patches,
+    const int numberOfPatches,
+    const Ray *ray,
+    const float minimumDistance,
+    const float maximumDistance,
+    const int hitFlags)
+{
+    const unsigned int all = (1u << numberOfPatches) - 1;
+    if ( numberOfRecords == 0 ) {
+        return all;
+    }
+
+    int records[BATCH_SIZE];
+    for ( int i = 0; i < BATCH_SIZE; i++ ) {
+        int id = i < numberOfPatches ? (int)patches[i]->id : 0;
+        records[i] = id < numberOfRecords ? id : 0;
+    }
+
+#ifdef __SSE2__
+    const __m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 relativeError = _mm_set1_ps(RELATIVE_ERROR);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    const __m128 originX = _mm_set1_ps(ray->pos.x);
+    const __m128 originY = _mm_set1_ps(ray->pos.y);
+    const __m128 originZ = _mm_set1_ps(ray->pos.z);
+    const __m128 directionX = _mm_set1_ps(ray->dir.x);
+    const __m128 directionY = _mm_set1_ps(ray->dir.y);
+    const __m128 directionZ = _mm_set1_ps(ray->dir.z);
+
+    __m128 nx = gatherRecords(normalX, records);
+    __m128 ny = gatherRecords(normalY, records);
+    __m128 nz = gatherRecords(normalZ, records);
+    __m128 d = gatherRecords(planeConstant, records);
+
+    __m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, directionX), _mm_mul_ps(ny, directionY)), _mm_mul_ps(nz, directionZ));
+    __m128 termX = _mm_mul_ps(nx, originX);
+    __m128 termY = _mm_mul_ps(ny, originY);
+    __m128 termZ = _mm_mul_ps(nz, originZ);
+    __m128 signedDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(termX, termY), termZ), d);
+    __m128 scale = _mm_add_ps(
+        _mm_add_ps(_mm_and_ps(termX, absoluteMask), _mm_and_ps(termY, absoluteMask)),
+        _mm_add_ps(_mm_and_ps(termZ, absoluteMask), _mm_and_ps(d, absoluteMask)));
+
+    // Nearly parallel rays are always candidates, and divide by 1 to stay finite
+    __m128 uncertain = _mm_cmplt_ps(_mm_and_ps(cosine, absoluteMask), _mm_set1_ps(MINIMUM_ABSOLUTE_COSINE));
+    __m128 facing = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    if ( !(hitFlags & RayHitFlag::BACK) ) {
+        facing = _mm_and_ps(facing, _mm_cmplt_ps(cosine, _mm_setzero_ps()));
+    }
+    if ( !(hitFlags & RayHitFlag::FRONT) ) {
+        facing = _mm_and_ps(facing, _mm_cmpgt_ps(cosine, _mm_setzero_ps()));
+    }
+    cosine = _mm_or_ps(_mm_and_ps(uncertain, one), _mm_andnot_ps(uncertain, cosine));
+    __m128 absoluteCosine = _mm_and_ps(cosine, absoluteMask);
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), signedDistance), cosine);
+    __m128 error = _mm_add_ps(
+        _mm_mul_ps(relativeError, _mm_add_ps(_mm_div_ps(scale, absoluteCosine), _mm_and_ps(t, absoluteMask))),
+        _mm_set1_ps(ABSOLUTE_ERROR));
+
+    __m128 accepted = _mm_and_ps(
+        _mm_cmple_ps(_mm_sub_ps(t, error), _mm_set1_ps(maximumDistance)),
+        _mm_cmpge_ps(_mm_add_ps(t, error), _mm_set1_ps(minimumDistance)));
+    accepted = _mm_and_ps(accepted, facing);
+
+    __m128 p = _mm_add_ps(originX, _mm_mul_ps(t, directionX));
+    accepted = _mm_and_ps(accepted, _mm_cmpge_ps(_mm_add_ps(p, error), gatherRecords(minimumX, records)));
+    accepted = _mm_and_ps(accepted, _mm_cmple_ps(_mm_sub_ps(p, error), gatherRecords(maximumX, records)));
+    p = _mm_add_ps(originY, _mm_mul_ps(t, directionY));
+    accepted = _mm_and_ps(accepted, _mm_cmpge_ps(_mm_add_ps(p, error), gatherRecords(minimumY, records)));
+    accepted = _mm_and_ps(accepted, _mm_cmple_ps(_mm_sub_ps(p, error), gatherRecords(maximumY, records)));
+    p = _mm_add_ps(originZ, _mm_mul_ps(t, directionZ));
+    accepted = _mm_and_ps(accepted, _mm_cmpge_ps(_mm_add_ps(p, error), gatherRecords(minimumZ, records)));
+    accepted = _mm_and_ps(accepted, _mm_cmple_ps(_mm_sub_ps(p, error), gatherRecords(maximumZ, records)));
+
+    return (unsigned int)_mm_movemask_ps(_mm_or_ps(accepted, uncertain)) & all;
+#else
+    unsigned int mask = 0;
+    for ( int i = 0; i < numberOfPatches; i++ ) {
+        const int r = records[i];
+        float cosine = normalX[r] * ray->dir.x + normalY[r] * ray->dir.y + normalZ[r] * ray->dir.z;
+        if ( java::Math::abs(cosine) < MINIMUM_ABSOLUTE_COSINE ) {
+            mask |= 1u << i;
+            continue;
+        }
+        if ( (cosine > 0.0f && !(hitFlags & RayHitFlag::BACK))
+          || (cosine < 0.0f && !(hitFlags & RayHitFlag::FRONT)) ) {
+            continue;
+        }
+
+        float termX = normalX[r] * ray->pos.x;
+        float termY = normalY[r] * ray->pos.y;
+        float termZ = normalZ[r] * ray->pos.z;
+        float scale = java::Math::abs(termX) + java::Math::abs(termY) + java::Math::abs(termZ)
+            + java::Math::abs(planeConstant[r]);
+        float t = -(termX + termY + termZ + planeConstant[r]) / cosine;
+        float error = RELATIVE_ERROR * (scale / java::Math::abs(cosine) + java::Math::abs(t)) + ABSOLUTE_ERROR;
+
+        if ( t - error > maximumDistance || t + error < minimumDistance ) {
+            continue;
+        }
+
+        float px = ray->pos.x + t * ray->dir.x;
+        float py = ray->pos.y + t * ray->dir.y;
+        float pz = ray->pos.z + t * ray->dir.z;
+        if ( px + error >= minimumX[r] && px - error <= maximumX[r]
+          && py + error >= minimumY[r] && py - error <= maximumY[r]
+          && pz + error >= minimumZ[r] && pz - error <= maximumZ[r] ) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+Patch::intersect() of the ray with up to BATCH_SIZE patches, in the given order,
+skipping the ones rejected by candidates(). Returns the last hit found, as a loop
+over Patch::intersect() would, or the first one when stopAtFirstHit is set
+*/
+RayHit *
+PatchIntersectionRecords::intersect(
+    Patch *const *patches,
+    const int numberOfPatches,
+    const Ray *ray,
+    const float minimumDistance,
+    float *maximumDistance,
+    const int hitFlags,
+    RayHit *hitStore,
+    const bool stopAtFirstHit)
+{
+    RayHit *hit = nullptr;
+    unsigned int mask = candidates(patches, numberOfPatches, ray, minimumDistance, *maximumDistance, hitFlags);
+
+    for ( int i = 0; mask != 0; i++, mask >>= 1 ) {
+        if ( mask & 1u ) {
+            RayHit *h = patches[i]->intersect(ray, minimumDistance, maximumDistance, hitFlags, hitStore);
+            if ( h != nullptr ) {
+                hit = h;
+                if ( stopAtFirstHit ) {
+                    break;
+                }
+            }
+        }
+    }
+    return hit;
+}
@@ -0,0 +1,70 @@
+/**
+Compact per patch data for rejecting ray-patch intersection tests in batches.
+
+For every patch, indexed by patch id, the records keep the plane (normal and plane
+constant) and the bounds of the vertices on the two coordinate axes the patch is
+projected on by Patch::triangleUv() and Patch::quadUv(), in structure of arrays
+layout. candidates() tests a ray against up to BATCH_SIZE patches at once (with SSE2
+when available): it intersects the ray with the planes and rejects the patches
+facing the wrong way or whose plane is hit outside the allowed distance range or
+outside the projected bounds. Every test carries a margin for floating point error, so a patch is only
+rejected when Patch::intersect() would have rejected it as well; the remaining
+candidates still go through Patch::intersect(), which makes the final decision and
+fills in the hit record. Results are thus exactly the same as testing every patch.
+
+Patches without a record (virtual patches, or patches created after build()) are
+always candidates
+*/
+
+#ifndef __PATCH_INTERSECTION_RECORDS__
+#define __PATCH_INTERSECTION_RECORDS__
+
+#include "java/util/ArrayList.h"
+#include "common/Ray.h"
+#include "skin/Patch.h"
+
+class PatchIntersectionRecords {
+  private:
+    static int numberOfRecords;
+    static float *block;
+    static float *normalX;
+    static float *normalY;
+    static float *normalZ;
+    static float *planeConstant;
+    static float *minimumX;
+    static float *minimumY;
+    static float *minimumZ;
+    static float *maximumX;
+    static float *maximumY;
+    static float *maximumZ;
+
+    static void setRecord(int record, const Patch *patch);
+
+  public:
+    static const int BATCH_SIZE = 4;
+
+    static void build(const java::ArrayList<Patch *> *patches);
+    static void freeMemory();
+
+    static unsigned int
+    candidates(
+        Patch *const *patches,
+        int numberOfPatches,
+        const Ray *ray,
+        float minimumDistance,
+        float maximumDistance,
+        int hitFlags);
+
+    static RayHit *
+    intersect(
+        Patch *const *patches,
+        int numberOfPatches,
+        const Ray *ray,
+        float minimumDistance,
+        float *maximumDistance,
+        int hitFlags,
+        RayHit *hitStore,
+        bool stopAtFirstHit);
+};
+
+#endif